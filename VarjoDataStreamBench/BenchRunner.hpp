@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include "json/json.hpp"
+
+namespace Bench {
+
+	struct BenchOptions {
+		// 1回の計測でこの時間を超えるまで反復回数を倍にする
+		std::chrono::milliseconds min_time{ 200 };
+		// 計測を繰り返す回数．結果は中央値を採る
+		int repetitions = 5;
+	};
+
+	struct BenchResult {
+		std::string name;
+		std::string group;
+		uint64_t iterations;
+		double ns_per_op;
+		double ops_per_sec;
+		double bytes_per_sec;
+	};
+
+	/**
+	 * @brief 関数を反復実行して1回あたりの時間を測る．
+	 * @detail fnはn回分の処理を行う関数で，反復のループは呼び出し側に任せる(仮想呼び出しやstd::functionの呼び出しを計測に含めないため)．
+	 */
+	class BenchRunner {
+
+	public:
+		using BatchFunction = std::function<void(uint64_t n)>;
+
+		explicit BenchRunner(const BenchOptions& opt = BenchOptions{})
+			: opt_(opt)
+		{}
+
+		/**
+		 * @param bytes_per_op 1回あたりに処理するバイト数(bytes/sの算出に使う．0の場合は0を出す)
+		 */
+		const BenchResult& run(const std::string& group, const std::string& name, const size_t bytes_per_op, const BatchFunction& fn) {
+			// 1回の計測がmin_timeを超える反復回数を探す
+			uint64_t n = 1;
+			while (true) {
+				const double elapsed = measure(fn, n);
+				if (elapsed >= std::chrono::duration<double>(this->opt_.min_time).count() || n >= (uint64_t(1) << 40)) {
+					break;
+				}
+				n *= 2;
+			}
+
+			std::vector<double> ns_per_op;
+			for (int i = 0; i < this->opt_.repetitions; ++i) {
+				ns_per_op.push_back(measure(fn, n) * 1e9 / static_cast<double>(n));
+			}
+			std::sort(ns_per_op.begin(), ns_per_op.end());
+			const double median = ns_per_op[ns_per_op.size() / 2];
+
+			this->results_.push_back(BenchResult{
+				.name = name,
+				.group = group,
+				.iterations = n,
+				.ns_per_op = median,
+				.ops_per_sec = 1e9 / median,
+				.bytes_per_sec = static_cast<double>(bytes_per_op) * 1e9 / median
+			});
+			return this->results_.back();
+		}
+
+		nlohmann::json to_json() const {
+			auto results = nlohmann::json::array();
+			for (const auto& r : this->results_) {
+				results.push_back({
+					{ "group", r.group },
+					{ "name", r.name },
+					{ "iterations", r.iterations },
+					{ "ns_per_op", r.ns_per_op },
+					{ "ops_per_sec", r.ops_per_sec },
+					{ "bytes_per_sec", r.bytes_per_sec }
+				});
+			}
+			return nlohmann::json{
+				{ "min_time_ms", this->opt_.min_time.count() },
+				{ "repetitions", this->opt_.repetitions },
+				{ "results", results }
+			};
+		}
+
+		const std::vector<BenchResult>& results() const { return this->results_; }
+
+	private:
+		static double measure(const BatchFunction& fn, const uint64_t n) {
+			const auto start = std::chrono::steady_clock::now();
+			fn(n);
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+	private:
+		const BenchOptions opt_;
+		std::vector<BenchResult> results_;
+	};
+
+	/**
+	 * @brief 計測対象の結果を最適化で消されないようにする
+	 */
+	template<class T>
+	inline void do_not_optimize(const T& value) {
+		static volatile const void* sink;
+		sink = &value;
+	}
+}
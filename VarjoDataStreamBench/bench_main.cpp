@@ -0,0 +1,500 @@
+/************************************************************************************************************************
+	VarjoDataStreamBench
+	フレーム処理のカーネルとレコードのシリアライザ(各Writerの1行書き込み，Serial/Parallel Writer)のマイクロベンチマーク．
+	ヘッドセットもVarjoLibも使わないため，Linuxでもビルド・実行できる．
+
+	usage: VarjoDataStreamBench [--filter <部分文字列>] [--min-time-ms <ms>] [--reps <n>]
+	                            [--dummy-dir <DummyFrameDataのディレクトリ>] [--work-dir <出力先>] [--out <結果のjson>]
+
+	結果は { "results": [ { group, name, iterations, ns_per_op, ops_per_sec, bytes_per_sec }, ... ] } のJSONで出力する．
+	bytes_per_secはカーネルでは入力フレームのバイト数，Writerでは出力する1行のバイト数から求める．
+	closeまでに全レコードを書き出さなかったWriterはincomplete_writersに挙げる(その計測値は実際より速く見える)．
+
+	Linuxでのビルド例(VarjoDataStreamServerディレクトリで実行):
+		g++ -std=c++20 -O2 -I<VarjoNativeSDK>/include -Ivendor/Json/include \
+			../VarjoDataStreamBench/bench_main.cpp VarjoVSTFrame/VarjoVSTMetadataWriter.cpp \
+			VarjoEyeTracking/EyeTrackingDataCsvWriter.cpp VarjoFrameInfo/FrameInfoDataCsvWriter.cpp \
+			VarjoTimestamp/TimestampCsvWriter.cpp VarjoTimestamp/TimestampFormatter.cpp \
+			util/PerformanceChecker.cpp util/TraceRecorder.cpp util/Executor.cpp \
+			-lboost_serialization -lpthread -o VarjoDataStreamBench
+
+**************************************************************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "BenchRunner.hpp"
+
+#include "../VarjoDataStreamServer/util/vec_util.hpp"
+#include "../VarjoDataStreamServer/util/struct_json_io.hpp"
+#include "../VarjoDataStreamServer/VarjoVSTFrame/utility.hpp"
+#include "../VarjoDataStreamServer/VarjoVSTFrame/VarjoVSTMetadataWriter.hpp"
+#include "../VarjoDataStreamServer/VarjoEyeCam/EyeCam_util.hpp"
+#include "../VarjoDataStreamServer/VarjoEyeTracking/EyeTrackingDataCsvWriter.hpp"
+#include "../VarjoDataStreamServer/VarjoFrameInfo/FrameInfoDataCsvWriter.hpp"
+#include "../VarjoDataStreamServer/VarjoTimestamp/TimestampCsvWriter.hpp"
+#include "../VarjoDataStreamServer/VarjoTimestamp/TimestampFormatter.hpp"
+
+namespace {
+
+	struct BenchConfig {
+		std::string filter;
+		Bench::BenchOptions bench_opt;
+		std::string dummy_dir = "./VarjoVSTFrame/DummyFrameData";
+		std::string work_dir = "bench_out";
+		std::string out_path;
+	};
+
+	// DummyFrameDataのVSTフレーム(NV12)
+	constexpr size_t vst_width = 832;
+	constexpr size_t vst_height = 640;
+	constexpr size_t vst_row_stride = 896;
+	// 視線カメラのフレーム(Y8)
+	constexpr size_t eyecam_width = 640;
+	constexpr size_t eyecam_height = 400;
+	constexpr size_t eyecam_row_stride = 704;
+
+	// 合成データの種類数．反復ごとに順に使う
+	constexpr size_t record_variations = 64;
+
+	/****************************************************************************************************
+	* 入力データ
+	*****************************************************************************************************/
+
+	struct VSTFrames {
+		std::vector<std::vector<uint8_t>> lframes;
+		std::vector<std::vector<uint8_t>> rframes;
+		std::vector<VarjoVSTFrame::Metadata> metadata;
+		bool from_dummy = false;
+	};
+
+	/**
+	 * @brief DummyFrameDataを読む．無い場合は同じ大きさの合成フレームにする．
+	 */
+	VSTFrames load_VSTFrames(const std::string& dummy_dir, const size_t count) {
+		VSTFrames frames;
+		try {
+			for (size_t i = 0; i < count; ++i) {
+				frames.lframes.push_back(vecutil::deserialize_vector<uint8_t>(dummy_dir + "/lframedata_" + std::to_string(i) + ".bin"));
+				frames.rframes.push_back(vecutil::deserialize_vector<uint8_t>(dummy_dir + "/rframedata_" + std::to_string(i) + ".bin"));
+
+				std::ifstream ifs(dummy_dir + "/lmetadata_" + std::to_string(i) + ".json");
+				frames.metadata.push_back(nlohmann::json::parse(ifs).get<VarjoVSTFrame::Metadata>());
+			}
+			frames.from_dummy = true;
+		} catch (const std::exception&) {
+			frames = VSTFrames{};
+			const size_t size = vst_row_stride * vst_height * 3 / 2;
+			for (size_t i = 0; i < count; ++i) {
+				std::vector<uint8_t> frame(size);
+				for (size_t j = 0; j < size; ++j) {
+					frame[j] = static_cast<uint8_t>(i * 31 + j * 7);
+				}
+				frames.lframes.push_back(frame);
+				frames.rframes.push_back(std::move(frame));
+
+				VarjoVSTFrame::Metadata metadata{};
+				metadata.streamFrame.frameNumber = static_cast<int64_t>(i);
+				metadata.timestamp = static_cast<varjo_Nanoseconds>(1'000'000'000 + i * 11'111'111);
+				metadata.bufferMetadata.width = static_cast<int32_t>(vst_width);
+				metadata.bufferMetadata.height = static_cast<int32_t>(vst_height);
+				metadata.bufferMetadata.rowStride = static_cast<int32_t>(vst_row_stride);
+				frames.metadata.push_back(metadata);
+			}
+		}
+		return frames;
+	}
+
+	std::vector<VarjoEyeTracking::EyeTrackingData> make_EyeTrackingData() {
+		std::vector<VarjoEyeTracking::EyeTrackingData> records(record_variations);
+		for (size_t i = 0; i < records.size(); ++i) {
+			auto& d = records[i];
+			const double t = static_cast<double>(i) / record_variations;
+			d.gaze.captureTime = static_cast<varjo_Nanoseconds>(1'000'000'000 + i * 5'000'000);
+			d.gaze.frameNumber = static_cast<int64_t>(i);
+			d.gaze.status = varjo_GazeStatus_Valid;
+			d.gaze.gaze.forward[0] = 0.1 * t;
+			d.gaze.gaze.forward[1] = -0.05 * t;
+			d.gaze.gaze.forward[2] = 0.99;
+			d.gaze.focusDistance = 1.0 + t;
+			d.gaze.leftPupilSize = 0.4 + 0.1 * t;
+			d.gaze.rightPupilSize = 0.4 - 0.1 * t;
+			d.rendering_gaze = d.gaze;
+			d.eyeMeasurements.captureTime = d.gaze.captureTime;
+			d.eyeMeasurements.interPupillaryDistanceInMM = 63.5f + static_cast<float>(t);
+			d.eyeMeasurements.leftPupilDiameterInMM = 3.5f;
+			d.eyeMeasurements.rightPupilDiameterInMM = 3.6f;
+			d.userIPD = 63.5 + t;
+			d.headsetIPD = 64.0;
+		}
+		return records;
+	}
+
+	std::vector<VarjoFrameInfo::FrameInfoData> make_FrameInfoData() {
+		std::vector<VarjoFrameInfo::FrameInfoData> records(record_variations);
+		for (size_t i = 0; i < records.size(); ++i) {
+			auto& d = records[i];
+			d = VarjoFrameInfo::FrameInfoData{};
+			for (size_t v = 0; v < d.views.size(); ++v) {
+				for (size_t k = 0; k < 16; ++k) {
+					d.views[v].viewMatrix[k] = (k % 5 == 0) ? 1.0 : 0.001 * static_cast<double>(i + k);
+					d.views[v].projectionMatrix[k] = (k % 5 == 0) ? 1.2 : 0.0;
+				}
+				d.views[v].preferredWidth = 2880;
+				d.views[v].preferredHeight = 2720;
+				d.views[v].enabled = 1;
+				d.fovTangents[v] = varjo_FovTangents{ -1.0, 1.0, 1.0, -1.0 };
+			}
+			d.timestamp = static_cast<varjo_Nanoseconds>(1'000'000'000 + i * 11'111'111);
+			d.frameNumber = static_cast<int64_t>(i);
+		}
+		return records;
+	}
+
+	std::vector<Timestamp::TimestampData> make_TimestampData() {
+		std::vector<Timestamp::TimestampData> records(record_variations);
+		const auto now = std::chrono::system_clock::now();
+		for (size_t i = 0; i < records.size(); ++i) {
+			records[i] = Timestamp::TimestampData{
+				.varjo_timestamp = static_cast<varjo_Nanoseconds>(1'000'000'000 + i * 1'000'000),
+				.varjo_timestamp_unix = static_cast<varjo_Nanoseconds>(1'700'000'000'000'000'000 + i * 1'000'000),
+				.system_timestamp = now + std::chrono::microseconds(i * 1000)
+			};
+		}
+		return records;
+	}
+
+	/****************************************************************************************************
+	* 1行書き込みを直接呼ぶためのWriter
+	*****************************************************************************************************/
+
+	class MetadataLineWriter : public VarjoVSTFrame::SerialMetadataWriter {
+	public:
+		explicit MetadataLineWriter(const std::string& path)
+			: VarjoVSTFrame::SerialMetadataWriter(varjo_ChannelFlag_Left, path)
+		{}
+		void write(const VarjoVSTFrame::Metadata& metadata) { this->write_metadata_line(metadata, this->lout_stream_); }
+	};
+
+	class EyeTrackingLineWriter : public VarjoEyeTracking::EyeTrackingDataSerialCsvWriter {
+	public:
+		using VarjoEyeTracking::EyeTrackingDataSerialCsvWriter::EyeTrackingDataSerialCsvWriter;
+		void write(const VarjoEyeTracking::EyeTrackingData& data) { this->write_line(data); }
+	};
+
+	class FrameInfoLineWriter : public VarjoFrameInfo::SerialDataCsvWriter {
+	public:
+		using VarjoFrameInfo::SerialDataCsvWriter::SerialDataCsvWriter;
+		void write(const VarjoFrameInfo::FrameInfoData& data) { this->write_line(data); }
+	};
+
+	class TimestampLineWriter : public Timestamp::SerialDataCsvWriter {
+	public:
+		using Timestamp::SerialDataCsvWriter::SerialDataCsvWriter;
+		void write(const Timestamp::TimestampData& data) { this->write_line(data); }
+	};
+
+	/**
+	 * @brief ディレクトリを空にする．Writerは既存のファイルを避けて連番のファイルを作るため，計測ごとに消す．
+	 */
+	void reset_directory(const std::filesystem::path& dir) {
+		std::filesystem::remove_all(dir);
+		std::filesystem::create_directories(dir);
+	}
+
+	uintmax_t directory_bytes(const std::filesystem::path& dir) {
+		uintmax_t bytes = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+			if (entry.is_regular_file()) {
+				bytes += entry.file_size();
+			}
+		}
+		return bytes;
+	}
+
+	/**
+	 * @brief 1行の平均バイト数をファイルサイズの増分から求める
+	 */
+	template<class LineWriterT, class RecordT>
+	size_t measure_line_bytes(const std::filesystem::path& dir, const std::vector<RecordT>& records) {
+		constexpr size_t lines = 1024;
+		const std::string path = (dir / "line.csv").string();
+
+		reset_directory(dir);
+		{
+			LineWriterT writer(path);
+			writer.open();
+			writer.close();
+		}
+		const uintmax_t header_size = directory_bytes(dir);
+
+		reset_directory(dir);
+		{
+			LineWriterT writer(path);
+			writer.open();
+			for (size_t i = 0; i < lines; ++i) {
+				writer.write(records[i % records.size()]);
+			}
+			writer.close();
+		}
+		return static_cast<size_t>((directory_bytes(dir) - header_size) / lines);
+	}
+
+	/****************************************************************************************************
+	* ベンチマーク
+	*****************************************************************************************************/
+
+	class BenchSuite {
+
+	public:
+		explicit BenchSuite(const BenchConfig& config)
+			: config_(config),
+			runner_(config.bench_opt)
+		{}
+
+		void run_all() {
+			std::filesystem::create_directories(this->config_.work_dir);
+			this->run_frame_kernels();
+			this->run_formatters();
+			this->run_metadata_writers();
+			this->run_eyetracking_writers();
+			this->run_frameinfo_writers();
+			this->run_timestamp_writers();
+		}
+
+		nlohmann::json to_json() const {
+			auto j = this->runner_.to_json();
+			j["vst_frames_from_dummy"] = this->vst_from_dummy_;
+			j["incomplete_writers"] = this->incomplete_writers_;
+			return j;
+		}
+
+	private:
+		bool selected(const std::string& group, const std::string& name) const {
+			return this->config_.filter.empty() || (group + "/" + name).find(this->config_.filter) != std::string::npos;
+		}
+
+		void run(const std::string& group, const std::string& name, const size_t bytes_per_op, const Bench::BenchRunner::BatchFunction& fn) {
+			if (!this->selected(group, name)) {
+				return;
+			}
+			const auto& r = this->runner_.run(group, name, bytes_per_op, fn);
+			std::cerr << group << "/" << name << ": " << r.ns_per_op << " ns/op, " << r.bytes_per_sec / (1024.0 * 1024.0) << " MiB/s\n";
+		}
+
+		std::filesystem::path work_dir(const std::string& name) const {
+			return std::filesystem::path(this->config_.work_dir) / name;
+		}
+
+		void run_frame_kernels() {
+			const auto frames = load_VSTFrames(this->config_.dummy_dir, 8);
+			this->vst_from_dummy_ = frames.from_dummy;
+			const size_t raw_size = frames.lframes.front().size();
+			const size_t tight_size = vst_width * vst_height * 3 / 2;
+
+			std::vector<uint8_t> ltight(tight_size);
+			std::vector<uint8_t> rtight(tight_size);
+			this->run("kernel", "vst_remove_padding", raw_size, [&](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i) {
+					VarjoVSTFrame::remove_padding(frames.lframes[i % frames.lframes.size()], ltight, vst_width, vst_height, vst_row_stride);
+					Bench::do_not_optimize(ltight);
+				}
+			});
+
+			VarjoVSTFrame::remove_padding(frames.lframes.front(), ltight, vst_width, vst_height, vst_row_stride);
+			VarjoVSTFrame::remove_padding(frames.rframes.front(), rtight, vst_width, vst_height, vst_row_stride);
+			std::vector<uint8_t> canvas(tight_size * 2);
+			this->run("kernel", "vst_make_canvas", tight_size * 2, [&](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i) {
+					VarjoVSTFrame::make_canvas_LR(ltight, rtight, canvas, vst_width, vst_height);
+					Bench::do_not_optimize(canvas);
+				}
+			});
+
+			// 視線カメラはY8の合成フレーム
+			EyeCam::Framedata eyecam_raw(eyecam_row_stride * eyecam_height);
+			for (size_t i = 0; i < eyecam_raw.size(); ++i) {
+				eyecam_raw[i] = static_cast<uint8_t>(i * 13);
+			}
+			EyeCam::Framedata eyecam_ltight;
+			this->run("kernel", "eyecam_remove_padding", eyecam_raw.size(), [&](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i) {
+					EyeCam::remove_padding(eyecam_raw, eyecam_ltight, eyecam_width, eyecam_height, eyecam_row_stride);
+					Bench::do_not_optimize(eyecam_ltight);
+				}
+			});
+
+			const EyeCam::Framedata eyecam_rtight = eyecam_ltight;
+			EyeCam::Framedata eyecam_concat;
+			this->run("kernel", "eyecam_concat_framedata_LR", eyecam_ltight.size() * 2, [&](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i) {
+					EyeCam::concat_framedata_LR(eyecam_ltight, eyecam_rtight, eyecam_concat, eyecam_width, eyecam_height);
+					Bench::do_not_optimize(eyecam_concat);
+				}
+			});
+
+			this->metadata_ = frames.metadata;
+		}
+
+		void run_formatters() {
+			const auto records = make_TimestampData();
+			for (const auto zone : { Timestamp::TimeZone::Utc, Timestamp::TimeZone::Local }) {
+				Timestamp::DateTimeFormatter formatter(zone);
+				char buf[Timestamp::DateTimeFormatter::formatted_size];
+				this->run("formatter", zone == Timestamp::TimeZone::Utc ? "datetime_utc" : "datetime_local", sizeof(buf), [&](uint64_t n) {
+					for (uint64_t i = 0; i < n; ++i) {
+						formatter.format(records[i % records.size()].system_timestamp, buf);
+						Bench::do_not_optimize(buf);
+					}
+				});
+			}
+		}
+
+		/**
+		 * @brief 1行書き込みと，Serial/Parallel Writerへの投入からcloseまで(書き出し完了まで)を測る
+		 */
+		template<class LineWriterT, class RecordT, class MakeWriter, class Submit>
+		void run_writers(const std::string& group, const std::vector<RecordT>& records, MakeWriter make_writer, Submit submit) {
+			const auto dir = this->work_dir(group);
+			const std::string path = (dir / "out.csv").string();
+			const size_t line_bytes = measure_line_bytes<LineWriterT>(dir, records);
+
+			this->run(group, "write_line", line_bytes, [&](uint64_t n) {
+				reset_directory(dir);
+				LineWriterT writer(path);
+				writer.open();
+				for (uint64_t i = 0; i < n; ++i) {
+					writer.write(records[i % records.size()]);
+				}
+				writer.close();
+			});
+
+			for (const bool parallel : { false, true }) {
+				// closeまでに全レコードが書き出されたかも確かめる(書き出されない分は速く見えてしまうため)
+				uint64_t short_batches = 0;
+				this->run(group, parallel ? "parallel_writer" : "serial_writer", line_bytes, [&](uint64_t n) {
+					reset_directory(dir);
+					auto writer = make_writer(parallel, path);
+					writer->open();
+					for (uint64_t i = 0; i < n; ++i) {
+						submit(*writer, records[i % records.size()]);
+					}
+					writer->close();
+					if (directory_bytes(dir) < n * line_bytes) {
+						++short_batches;
+					}
+				});
+				if (short_batches > 0) {
+					std::cerr << "  warning: " << short_batches << " batches lost records on close\n";
+					this->incomplete_writers_.push_back(group + (parallel ? "/parallel_writer" : "/serial_writer"));
+				}
+			}
+			std::filesystem::remove_all(dir);
+		}
+
+		void run_metadata_writers() {
+			this->run_writers<MetadataLineWriter>("vst_metadata", this->metadata_,
+				[](const bool parallel, const std::string& path) {
+					return VarjoVSTFrame::make_MetadataWriterPtr(VarjoVSTFrame::MetadataWriterOptions{
+						.writer_type = parallel ? VarjoVSTFrame::VarjoVSTMetadataWriterType::Parallel : VarjoVSTFrame::VarjoVSTMetadataWriterType::Serial,
+						.write_channel_flag = varjo_ChannelFlag_Left,
+						.out_path = path
+					});
+				},
+				[](VarjoVSTFrame::MetadataWriter& writer, const VarjoVSTFrame::Metadata& metadata) { writer.submit_metadata(metadata); });
+		}
+
+		void run_eyetracking_writers() {
+			this->run_writers<EyeTrackingLineWriter>("eyetracking", make_EyeTrackingData(),
+				[](const bool parallel, const std::string& path) -> std::unique_ptr<VarjoEyeTracking::EyeTrackingDataCsvWriter> {
+					if (parallel) {
+						return std::make_unique<VarjoEyeTracking::EyeTrackingDataParallelCsvWriter>(path);
+					}
+					return std::make_unique<VarjoEyeTracking::EyeTrackingDataSerialCsvWriter>(path);
+				},
+				[](VarjoEyeTracking::EyeTrackingDataCsvWriter& writer, const VarjoEyeTracking::EyeTrackingData& data) { writer.submit_EyeTrackingData(data); });
+		}
+
+		void run_frameinfo_writers() {
+			this->run_writers<FrameInfoLineWriter>("frameinfo", make_FrameInfoData(),
+				[](const bool parallel, const std::string& path) {
+					return VarjoFrameInfo::make_DataCsvWriterPtr(VarjoFrameInfo::make_DataCsvWriterOptions(
+						parallel ? VarjoFrameInfo::DataCsvWriterType::Parallel : VarjoFrameInfo::DataCsvWriterType::Serial, path));
+				},
+				[](VarjoFrameInfo::DataCsvWriter& writer, const VarjoFrameInfo::FrameInfoData& data) { writer.submit_FrameInfoData(data); });
+		}
+
+		void run_timestamp_writers() {
+			this->run_writers<TimestampLineWriter>("timestamp", make_TimestampData(),
+				[](const bool parallel, const std::string& path) {
+					return Timestamp::make_DataCsvWrierPtr(Timestamp::CsvWriterOptions{
+						.type = parallel ? Timestamp::CsvWriterType::Parallel : Timestamp::CsvWriterType::Serial,
+						.path = path
+					});
+				},
+				[](Timestamp::DataCsvWriter& writer, const Timestamp::TimestampData& data) { writer.submit_TimestampData(data); });
+		}
+
+	private:
+		const BenchConfig config_;
+		Bench::BenchRunner runner_;
+		std::vector<VarjoVSTFrame::Metadata> metadata_;
+		bool vst_from_dummy_ = false;
+		std::vector<std::string> incomplete_writers_;
+	};
+
+	bool parse_args(int argc, char** argv, BenchConfig& config) {
+		for (int i = 1; i < argc; ++i) {
+			const std::string arg = argv[i];
+			if (i + 1 >= argc) {
+				return false;
+			}
+			const std::string value = argv[++i];
+			if (arg == "--filter") {
+				config.filter = value;
+			} else if (arg == "--min-time-ms") {
+				config.bench_opt.min_time = std::chrono::milliseconds(std::stoi(value));
+			} else if (arg == "--reps") {
+				config.bench_opt.repetitions = std::max(1, std::stoi(value));
+			} else if (arg == "--dummy-dir") {
+				config.dummy_dir = value;
+			} else if (arg == "--work-dir") {
+				config.work_dir = value;
+			} else if (arg == "--out") {
+				config.out_path = value;
+			} else {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	BenchConfig config;
+	try {
+		if (!parse_args(argc, argv, config)) {
+			std::cerr << "usage: VarjoDataStreamBench [--filter <name>] [--min-time-ms <ms>] [--reps <n>] [--dummy-dir <dir>] [--work-dir <dir>] [--out <json>]\n";
+			return EXIT_FAILURE;
+		}
+
+		BenchSuite suite(config);
+		suite.run_all();
+
+		const std::string result = suite.to_json().dump(2);
+		if (config.out_path.empty()) {
+			std::cout << result << "\n";
+		} else {
+			std::ofstream(config.out_path) << result << "\n";
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "Critical error caught: " << e.what();
+		return EXIT_FAILURE;
+	}
+
+	return 0;
+}
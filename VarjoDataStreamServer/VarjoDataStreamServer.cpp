@@ -1 +1,249 @@
-#include "VarjoDataStreamServer.hpp"
\ No newline at end of file
+#include <cstring>
+
+#include "VarjoDataStreamServer.hpp"
+
+using namespace VarjoServer;
+
+namespace {
+	constexpr uint32_t max_control_meta_size = 4096;
+}
+
+VarjoDataStreamServer::VarjoDataStreamServer(const ServerOptions& opt)
+	: opt_(opt)
+{}
+
+VarjoDataStreamServer::~VarjoDataStreamServer()
+{
+	this->close();
+}
+
+bool VarjoDataStreamServer::open()
+{
+	if (this->is_open()) {
+		return false;
+	}
+
+	this->listen_sock_ = Socket::listen(this->opt_.transport, this->opt_.host, this->opt_.port, this->opt_.unix_path);
+	if (!this->listen_sock_.is_valid()) {
+		return false;
+	}
+
+	// スレッドを起動
+	this->stop_accept_thread_ = false;
+	this->accept_thread_ = std::thread(&VarjoDataStreamServer::accept_worker, this);
+
+	return true;
+}
+
+void VarjoDataStreamServer::close()
+{
+	// 受付を停止
+	this->stop_accept_thread_ = true;
+	if (this->accept_thread_.joinable()) {
+		this->accept_thread_.join();
+	}
+	this->listen_sock_.close();
+
+	// 全クライアントを切断
+	this->reap_clients(true);
+	this->subscribed_topics_ = 0;
+}
+
+void VarjoDataStreamServer::publish(const Topic topic, const void* meta, const size_t meta_size,
+	std::shared_ptr<const std::vector<uint8_t>> data)
+{
+	const uint32_t bit = topic_bit(topic);
+	if ((this->subscribed_topics_.load(std::memory_order_relaxed) & bit) == 0) {
+		return;
+	}
+
+	auto msg = std::make_shared<OutboundMessage>();
+	msg->meta.assign(static_cast<const uint8_t*>(meta), static_cast<const uint8_t*>(meta) + meta_size);
+	msg->data = std::move(data);
+	msg->header = make_MessageHeader(
+		topic,
+		static_cast<uint32_t>(meta_size),
+		static_cast<uint32_t>(msg->data ? msg->data->size() : 0),
+		this->seq_[static_cast<size_t>(topic)].fetch_add(1, std::memory_order_relaxed));
+
+	std::shared_ptr<const OutboundMessage> shared_msg = std::move(msg);
+
+	std::lock_guard<std::mutex> lock(this->clients_mtx_);
+	for (auto& client : this->clients_) {
+		if (!client->alive.load() || (client->topic_mask.load(std::memory_order_relaxed) & bit) == 0) {
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> que_lock(client->que_mtx);
+			if (client->que.size() >= this->opt_.client_queue_capacity) {
+				// 送信が追いつかない場合は古いものから破棄
+				client->que.pop_front();
+				this->dropped_count_.fetch_add(1, std::memory_order_relaxed);
+			}
+			client->que.push_back(shared_msg);
+		}
+		client->que_cv.notify_one();
+	}
+}
+
+size_t VarjoDataStreamServer::client_count() const
+{
+	std::lock_guard<std::mutex> lock(this->clients_mtx_);
+	size_t n = 0;
+	for (auto& client : this->clients_) {
+		if (client->alive.load()) {
+			++n;
+		}
+	}
+	return n;
+}
+
+void VarjoDataStreamServer::accept_worker()
+{
+	while (!this->stop_accept_thread_.load()) {
+		// 切断済みクライアントの後始末
+		this->reap_clients(false);
+
+		Socket sock = this->listen_sock_.accept(100);
+		if (!sock.is_valid()) {
+			continue;
+		}
+
+		if (this->opt_.transport == Transport::Tcp) {
+			sock.set_nodelay(true);
+		}
+		sock.set_send_buffer_size(this->opt_.send_buffer_bytes);
+
+		// 接続直後に配信可能なトピックを通知する
+		ControlMessage hello{ static_cast<uint32_t>(ControlOp::Hello), all_data_topics };
+		const auto header = make_MessageHeader(Topic::Control, sizeof(hello), 0, 0);
+		const IoSlice slices[] = { { &header, sizeof(header) }, { &hello, sizeof(hello) } };
+		if (!sock.send_vectored(slices, 2)) {
+			continue;
+		}
+
+		auto client = std::make_unique<Client>();
+		client->sock = std::move(sock);
+		Client* raw = client.get();
+		{
+			std::lock_guard<std::mutex> lock(this->clients_mtx_);
+			this->clients_.push_back(std::move(client));
+		}
+		raw->sender_thread = std::thread(&VarjoDataStreamServer::sender_worker, this, raw);
+		raw->receiver_thread = std::thread(&VarjoDataStreamServer::receiver_worker, this, raw);
+	}
+}
+
+void VarjoDataStreamServer::sender_worker(Client* client)
+{
+	std::deque<std::shared_ptr<const OutboundMessage>> to_send;
+
+	while (client->alive.load()) {
+		{
+			// 送信要求まで待機
+			std::unique_lock<std::mutex> lock(client->que_mtx);
+			client->que_cv.wait(lock, [client] { return !client->que.empty() || !client->alive.load(); });
+			if (!client->alive.load()) {
+				break;
+			}
+
+			// キューの退避
+			to_send.swap(client->que);
+		}
+
+		for (auto& msg : to_send) {
+			const IoSlice slices[] = {
+				{ &msg->header, sizeof(msg->header) },
+				{ msg->meta.data(), msg->meta.size() },
+				{ msg->data ? msg->data->data() : nullptr, msg->data ? msg->data->size() : 0 }
+			};
+			if (!client->sock.send_vectored(slices, 3)) {
+				this->disconnect(client);
+				break;
+			}
+		}
+		to_send.clear();
+	}
+}
+
+void VarjoDataStreamServer::receiver_worker(Client* client)
+{
+	while (client->alive.load()) {
+		MessageHeader header;
+		if (!client->sock.recv_all(&header, sizeof(header)) || header.magic != protocol_magic) {
+			break;
+		}
+
+		// クライアントから送られるのは小さな制御メッセージのみ
+		if (header.meta_size > max_control_meta_size || header.data_size != 0) {
+			break;
+		}
+
+		std::vector<uint8_t> meta(header.meta_size);
+		if (header.meta_size > 0 && !client->sock.recv_all(meta.data(), meta.size())) {
+			break;
+		}
+
+		if (static_cast<Topic>(header.topic) == Topic::Control && meta.size() >= sizeof(ControlMessage)) {
+			ControlMessage control;
+			std::memcpy(&control, meta.data(), sizeof(control));
+			if (static_cast<ControlOp>(control.op) == ControlOp::Subscribe) {
+				client->topic_mask = control.topic_mask & all_data_topics;
+				this->update_subscribed_topics();
+			}
+		}
+	}
+
+	this->disconnect(client);
+}
+
+void VarjoDataStreamServer::disconnect(Client* client)
+{
+	if (client->alive.exchange(false)) {
+		client->sock.shutdown();
+		client->que_cv.notify_all();
+		this->update_subscribed_topics();
+	}
+}
+
+void VarjoDataStreamServer::reap_clients(bool all)
+{
+	std::list<std::unique_ptr<Client>> dead;
+	{
+		std::lock_guard<std::mutex> lock(this->clients_mtx_);
+		for (auto it = this->clients_.begin(); it != this->clients_.end();) {
+			if (all || !(*it)->alive.load()) {
+				dead.splice(dead.end(), this->clients_, it++);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	// ロックの外でスレッドを止める
+	for (auto& client : dead) {
+		this->disconnect(client.get());
+		if (client->sender_thread.joinable()) {
+			client->sender_thread.join();
+		}
+		if (client->receiver_thread.joinable()) {
+			client->receiver_thread.join();
+		}
+		client->sock.close();
+	}
+}
+
+void VarjoDataStreamServer::update_subscribed_topics()
+{
+	uint32_t mask = 0;
+	{
+		std::lock_guard<std::mutex> lock(this->clients_mtx_);
+		for (auto& client : this->clients_) {
+			if (client->alive.load()) {
+				mask |= client->topic_mask.load();
+			}
+		}
+	}
+	this->subscribed_topics_ = mask;
+}
@@ -1,5 +1,20 @@
 
 #include "EyeCamDataStreamer.hpp"
+#include "../util/PerformanceChecker.hpp"
+#include "../util/TraceRecorder.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::Counter& received = PerformanceChecker::counter("eyecam_frames_received_total");
+		PerformanceChecker::Counter& dropped = PerformanceChecker::counter("eyecam_frames_dropped_total");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+}
 
 namespace EyeCam {
 	EyeCamDataStreamer::EyeCamDataStreamer(
@@ -33,6 +48,7 @@ namespace EyeCam {
 	std::pair<std::deque<Framedata>, std::deque<Metadata>> EyeCamDataStreamer::take_lframe_que()
 	{
 		std::lock_guard lk(this->lframe_que_mtx_);
+		this->capture_account_->release(std::exchange(this->lqueued_bytes_, 0));
 		return std::make_pair(
 			std::exchange(this->lframedata_que_, std::deque<Framedata>()),
 			std::exchange(this->lmetadata_que_, std::deque<Metadata>())
@@ -42,6 +58,7 @@ namespace EyeCam {
 	std::pair<std::deque<Framedata>, std::deque<Metadata>> EyeCamDataStreamer::take_rframe_que()
 	{
 		std::lock_guard lk(this->rframe_que_mtx_);
+		this->capture_account_->release(std::exchange(this->rqueued_bytes_, 0));
 		return std::make_pair(
 			std::exchange(this->rframedata_que_, std::deque<Framedata>()),
 			std::exchange(this->rmetadata_que_, std::deque<Metadata>())
@@ -50,35 +67,53 @@ namespace EyeCam {
 
 	void EyeCamDataStreamer::onFrameReceived(const Frame& frame)
 	{
-		if (frame.metadata.channelIndex == varjo_ChannelIndex_Left) {
-			std::lock_guard lk(this->lframe_que_mtx_);
+		Profiling::trace_thread_name("varjo_eyecam_callback");
+		Profiling::TraceScope trace("eyecam.callback", frame.metadata.streamFrame.frameNumber);
 
-			this->lframedata_que_.push_back(std::move(frame.data));
-			this->lmetadata_que_.push_back(std::move(frame.metadata));
+		// 共有メモリの読み手へは受信バッファから直接書き込む
+		if (this->frame_publisher_ != nullptr) {
+			this->frame_publisher_->publish(frame);
+		}
 
-			// 容量を超えたものは切り捨て
-			auto que_size = this->lframedata_que_.size();
-			auto excess_size = que_size > this->buffer_capacity_ ? que_size - this->buffer_capacity_ : 0;
-			for (auto i = 0; i < excess_size; ++i) {
-				this->lframedata_que_.pop_front();
-				this->lmetadata_que_.pop_front();
-			}
+		if (frame.metadata.channelIndex == varjo_ChannelIndex_Left) {
+			std::lock_guard lk(this->lframe_que_mtx_);
+			this->enqueue_frame(this->lframedata_que_, this->lmetadata_que_, this->lqueued_bytes_, frame);
 		} else if (frame.metadata.channelIndex == varjo_ChannelIndex_Right) {
 			std::lock_guard lk(this->rframe_que_mtx_);
+			this->enqueue_frame(this->rframedata_que_, this->rmetadata_que_, this->rqueued_bytes_, frame);
+		} else {
+			throw std::runtime_error("Unkown channel index");
+		}
+	}
 
-			this->rframedata_que_.push_back(std::move(frame.data));
-			this->rmetadata_que_.push_back(std::move(frame.metadata));
+	void EyeCamDataStreamer::enqueue_frame(std::deque<Framedata>& frame_que, std::deque<Metadata>& metadata_que, uint64_t& queued_bytes, const Frame& frame)
+	{
+		metrics().received.inc();
 
-			// 容量を超えたものは切り捨て
-			auto que_size = this->rframedata_que_.size();
-			auto excess_size = que_size > this->buffer_capacity_ ? que_size - this->buffer_capacity_ : 0;
-			for (auto i = 0; i < excess_size; ++i) {
-				this->rframedata_que_.pop_front();
-				this->rmetadata_que_.pop_front();
+		const auto pop_oldest = [&]() {
+			queued_bytes -= frame_que.front().size();
+			this->capture_account_->release(frame_que.front().size());
+			frame_que.pop_front();
+			metadata_que.pop_front();
+			metrics().dropped.inc();
+		};
+
+		// 予算に収まるまで古いものから捨てる．全て捨てても収まらなければ受け取ったフレームを捨てる
+		const uint64_t bytes = frame.data.size();
+		while (!this->capture_account_->try_reserve(bytes)) {
+			if (frame_que.empty()) {
+				metrics().dropped.inc();
+				return;
 			}
+			pop_oldest();
+		}
+		frame_que.push_back(frame.data);
+		metadata_que.push_back(frame.metadata);
+		queued_bytes += bytes;
 
-		} else {
-			throw std::runtime_error("Unkown channel index");
+		// 容量を超えたものは切り捨て
+		while (frame_que.size() > this->buffer_capacity_) {
+			pop_oldest();
 		}
 	}
 
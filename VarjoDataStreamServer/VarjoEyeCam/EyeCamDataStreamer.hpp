@@ -12,6 +12,8 @@
 #include "../VarjoExample/DataStreamer.hpp"
 
 #include "EyeCam_types.hpp"
+#include "../VarjoSharedMemory/SharedFrameRing.hpp"
+#include "../util/MemoryBudget.hpp"
 
 namespace EyeCam {
 	class EyeCamDataStreamer {
@@ -34,11 +36,22 @@ namespace EyeCam {
 
 		std::pair<std::deque<Framedata>, std::deque<Metadata>> take_rframe_que();
 
+		/**
+		 * @brief 受信したフレームを共有メモリのリングにも書き込む．start_streamの前に設定する．
+		 */
+		void set_frame_publisher(std::shared_ptr<SharedMemory::FramePublisher> publisher) { this->frame_publisher_ = std::move(publisher); }
+
 		inline varjo_ChannelFlag datastream_chnls() const { return this->channels_; }
 
 	private:
 		void onFrameReceived(const Frame& frame);
 
+		/**
+		 * @brief 受信キューに1フレーム積む．キューのロックを持って呼ぶ
+		 * @detail buffer_capacityを超える分，メモリ予算("eyecam_capture")に収まらない分は古いものから捨てる
+		 */
+		void enqueue_frame(std::deque<Framedata>& frame_que, std::deque<Metadata>& metadata_que, uint64_t& queued_bytes, const Frame& frame);
+
 	private:
 		std::shared_ptr<Session> session_;
 
@@ -48,9 +61,15 @@ namespace EyeCam {
 		const size_t buffer_capacity_;
 		std::deque<Framedata> lframedata_que_;
 		std::deque<Metadata> lmetadata_que_;
+		uint64_t lqueued_bytes_ = 0;
 		std::mutex lframe_que_mtx_;
 		std::deque<Framedata> rframedata_que_;
 		std::deque<Metadata> rmetadata_que_;
+		uint64_t rqueued_bytes_ = 0;
 		std::mutex rframe_que_mtx_;
+		const std::shared_ptr<Memory::MemoryAccount> capture_account_ =
+			Memory::MemoryBudget::shared().open_account("eyecam_capture", Memory::MemoryClass::Recording);
+
+		std::shared_ptr<SharedMemory::FramePublisher> frame_publisher_;
 	};
 }
\ No newline at end of file
@@ -2,6 +2,22 @@
 #include "EyeCamVideoWriter.hpp"
 
 #include "EyeCam_util.hpp"
+#include "../util/PerformanceChecker.hpp"
+#include "../util/TraceRecorder.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::LatencyHistogram& pipe_write = PerformanceChecker::histogram("eyecam_video_pipe_write_ns");
+		PerformanceChecker::Counter& frames_written = PerformanceChecker::counter("eyecam_video_frames_written_total");
+		PerformanceChecker::Counter& bytes_written = PerformanceChecker::counter("eyecam_video_bytes_written_total");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+}
 
 namespace EyeCam {
 
@@ -93,6 +109,10 @@ namespace EyeCam {
 			}
 
 			// 書き込み
+			Profiling::TraceScope trace("eyecam.video_write", metadata.streamFrame.frameNumber);
+			PerformanceChecker::ScopedTimer timer(metrics().pipe_write);
+			metrics().frames_written.inc();
+			metrics().bytes_written.inc(f.data.size());
 			fwrite(
 				f.data.data(),
 				sizeof(uint8_t),
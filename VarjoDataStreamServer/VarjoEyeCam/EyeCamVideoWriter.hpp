@@ -83,17 +83,8 @@ namespace EyeCam {
 			const FrameLayout layout
 		);
 
-		void submit_Frame(const Frame& frame) override;
-		void submit_Frame(Frame&& frame) override;
-
-		void submit_Frame(const std::vector<Frame>& frames) override;
-		void submit_Frame(std::vector<Frame>&& frames) override;
-
-		void submit_Frame(std::queue<Frame>& frames) override;
-		void submit_Frame(std::queue<Frame>&& frames) override;
-
 	private:
-		void submit_frame_impl(BorrowedOrOwned<Frame> frame) override;
+		void submit_batch_impl(SubmitBatch<Frame> frames) override;
 	};
 
 };
\ No newline at end of file
@@ -1,64 +1,50 @@
-
 #pragma	once
 
 #include <vector>
 #include <queue>
 
-#include "../util/BorrowedOrOwned.hpp"
+#include "../util/ISubmit.hpp"
 #include "EyeCam_types.hpp"
 
 namespace EyeCam {
 
-	class ISubmitFrame {
-	public:
-		~ISubmitFrame() = default;
+	// 実装はsubmit_batch_impl(SubmitBatch<T>)を書く．以下は従来の呼び出し方を残すための転送
 
-		virtual void submit_Frame(const Frame& data) = 0;
-		virtual void submit_Frame(Frame&& data) = 0;
+	class ISubmitFrame : public ISubmit<Frame> {
+	public:
+		void submit_Frame(const Frame& data) { this->submit(data); }
+		void submit_Frame(Frame&& data) { this->submit(std::move(data)); }
 		
-		virtual void submit_Frame(const std::vector<Frame>& data) = 0;
-		virtual void submit_Frame(std::vector<Frame>&& data) = 0;
-
-		virtual void submit_Frame(std::queue<Frame>& data) = 0;
-		virtual void submit_Frame(std::queue<Frame>&& data) = 0;
+		void submit_Frame(const std::vector<Frame>& data) { this->submit(data); }
+		void submit_Frame(std::vector<Frame>&& data) { this->submit(std::move(data)); }
 
-	protected:
-		virtual void submit_Frame_impl(BorrowedOrOwned<Frame> data) = 0;
+		void submit_Frame(std::queue<Frame>& data) { this->submit(data); }
+		void submit_Frame(std::queue<Frame>&& data) { this->submit(std::move(data)); }
 	};
 
-	class ISubmitFramedata {
+	class ISubmitFramedata : public ISubmit<Framedata> {
 
 	public:
-		~ISubmitFramedata() = default;
+		void submit_Framedata(const Framedata& data) { this->submit(data); }
+		void submit_Framedata(Framedata&& data) { this->submit(std::move(data)); }
 
-		virtual void submit_Framedata(const Framedata& data) = 0;
-		virtual void submit_Framedata(Framedata&& data) = 0;
+		void submit_Framedata(const std::vector<Framedata>& data) { this->submit(data); }
+		void submit_Framedata(std::vector<Framedata>&& data) { this->submit(std::move(data)); }
 
-		virtual void submit_Framedata(const std::vector<Framedata>& data) = 0;
-		virtual void submit_Framedata(std::vector<Framedata>&& data) = 0;
-
-		virtual void submit_Framedata(std::queue<Framedata>& data) = 0;
-		virtual void submit_Framedata(std::queue<Framedata>&& data) = 0;
-
-	protected:
-		virtual void submit_Framedata_impl(BorrowedOrOwned<Framedata> data) = 0;
+		void submit_Framedata(std::queue<Framedata>& data) { this->submit(data); }
+		void submit_Framedata(std::queue<Framedata>&& data) { this->submit(std::move(data)); }
 	};
 
-	class ISubmitMetadata {
+	class ISubmitMetadata : public ISubmit<Metadata> {
 
 	public:
-		~ISubmitMetadata() = default;
-
-		virtual void submit_Metadata(const Metadata& data) = 0;
-		virtual void submit_Metadata(Metadata&& data) = 0;
-
-		virtual void submit_Metadata(const std::vector<Metadata>& data) = 0;
-		virtual void submit_Metadata(std::vector<Metadata>&& data) = 0;
+		void submit_Metadata(const Metadata& data) { this->submit(data); }
+		void submit_Metadata(Metadata&& data) { this->submit(std::move(data)); }
 
-		virtual void submit_Metadata(std::queue<Metadata>& data) = 0;
-		virtual void submit_Metadata(std::queue<Metadata>&& data) = 0;
+		void submit_Metadata(const std::vector<Metadata>& data) { this->submit(data); }
+		void submit_Metadata(std::vector<Metadata>&& data) { this->submit(std::move(data)); }
 
-	protected:
-		virtual void submit_Metadata_impl(BorrowedOrOwned<Metadata> data) = 0;
+		void submit_Metadata(std::queue<Metadata>& data) { this->submit(data); }
+		void submit_Metadata(std::queue<Metadata>&& data) { this->submit(std::move(data)); }
 	};
-}
\ No newline at end of file
+}
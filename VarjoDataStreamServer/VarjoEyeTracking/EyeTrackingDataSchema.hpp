@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Varjo_types.h>
+
+#include "../util/RecordSchema.hpp"
+#include "EyeTracking_types.hpp"
+
+namespace VarjoEyeTracking {
+
+	/**
+	 * @brief EyeTrackingDataの列の定義．CSVのヘッダ・1行の書き出し・読み込み・バイナリ形式はここから生成する
+	 */
+	namespace Schema {
+
+		inline constexpr std::array<std::string_view, 3> xyz{ "X", "Y", "Z" };
+
+		inline constexpr RecordSchema::NameTable<varjo_GazeEyeStatus, 4> gaze_eye_status_names{ {
+			{ varjo_GazeEyeStatus_Invalid, "Invalid" },
+			{ varjo_GazeEyeStatus_Visible, "Visible" },
+			{ varjo_GazeEyeStatus_Compensated, "Compensated" },
+			{ varjo_GazeEyeStatus_Tracked, "Tracked" }
+		} };
+
+		inline constexpr RecordSchema::NameTable<varjo_GazeStatus, 3> gaze_status_names{ {
+			{ varjo_GazeStatus_Invalid, "Invalid" },
+			{ varjo_GazeStatus_Adjust, "Adjust" },
+			{ varjo_GazeStatus_Valid, "Valid" }
+		} };
+
+		using GazeEyeStatusCodec = RecordSchema::NamedCodec<varjo_GazeEyeStatus, gaze_eye_status_names>;
+		using GazeStatusCodec = RecordSchema::NamedCodec<varjo_GazeStatus, gaze_status_names>;
+
+		inline constexpr auto ray_fields = RecordSchema::fields(
+			RecordSchema::columns<3>("Origin", [](auto& r) -> auto& { return r.origin; }, xyz),
+			RecordSchema::columns<3>("Forward", [](auto& r) -> auto& { return r.forward; }, xyz)
+		);
+
+		inline constexpr auto gaze_fields = RecordSchema::fields(
+			RecordSchema::nested("leftEye", [](auto& g) -> auto& { return g.leftEye; }, ray_fields),
+			RecordSchema::nested("rightEye", [](auto& g) -> auto& { return g.rightEye; }, ray_fields),
+			RecordSchema::nested("gaze", [](auto& g) -> auto& { return g.gaze; }, ray_fields),
+			RecordSchema::column("focusDistance", [](auto& g) -> auto& { return g.focusDistance; }),
+			RecordSchema::column("stability", [](auto& g) -> auto& { return g.stability; }),
+			RecordSchema::column("captureTime", [](auto& g) -> auto& { return g.captureTime; }),
+			RecordSchema::column<GazeEyeStatusCodec>("leftStatus", [](auto& g) -> auto& { return g.leftStatus; }),
+			RecordSchema::column<GazeEyeStatusCodec>("rightStatus", [](auto& g) -> auto& { return g.rightStatus; }),
+			RecordSchema::column<GazeStatusCodec>("status", [](auto& g) -> auto& { return g.status; }),
+			RecordSchema::column("frameNumber", [](auto& g) -> auto& { return g.frameNumber; })
+		);
+
+		inline constexpr auto measurements_fields = RecordSchema::fields(
+			RecordSchema::column("frameNumber", [](auto& m) -> auto& { return m.frameNumber; }),
+			RecordSchema::column("captureTime", [](auto& m) -> auto& { return m.captureTime; }),
+			RecordSchema::column("interPupillaryDistanceInMM", [](auto& m) -> auto& { return m.interPupillaryDistanceInMM; }),
+			RecordSchema::column("leftPupilIrisDiameterRatio", [](auto& m) -> auto& { return m.leftPupilIrisDiameterRatio; }),
+			RecordSchema::column("rightPupilIrisDiameterRatio", [](auto& m) -> auto& { return m.rightPupilIrisDiameterRatio; }),
+			RecordSchema::column("leftPupilDiameterInMM", [](auto& m) -> auto& { return m.leftPupilDiameterInMM; }),
+			RecordSchema::column("rightPupilDiameterInMM", [](auto& m) -> auto& { return m.rightPupilDiameterInMM; }),
+			RecordSchema::column("leftIrisDiameterInMM", [](auto& m) -> auto& { return m.leftIrisDiameterInMM; }),
+			RecordSchema::column("rightIrisDiameterInMM", [](auto& m) -> auto& { return m.rightIrisDiameterInMM; }),
+			RecordSchema::column("leftEyeOpenness", [](auto& m) -> auto& { return m.leftEyeOpenness; }),
+			RecordSchema::column("rightEyeOpenness", [](auto& m) -> auto& { return m.rightEyeOpenness; })
+		);
+
+		inline constexpr auto eye_tracking_data_fields = RecordSchema::fields(
+			RecordSchema::nested("gaze_", [](auto& d) -> auto& { return d.gaze; }, gaze_fields),
+			RecordSchema::nested("renderingGaze_", [](auto& d) -> auto& { return d.rendering_gaze; }, gaze_fields),
+			RecordSchema::nested("measurements_", [](auto& d) -> auto& { return d.eyeMeasurements; }, measurements_fields),
+			RecordSchema::column("userIPD", [](auto& d) -> auto& { return d.userIPD; }),
+			RecordSchema::column("headsetIPD", [](auto& d) -> auto& { return d.headsetIPD; })
+		);
+	}
+
+	using EyeTrackingDataRecord = RecordSchema::Record<EyeTrackingData, Schema::eye_tracking_data_fields>;
+}
@@ -0,0 +1,366 @@
+#include <cmath>
+#include <cstring>
+
+#include "FrameInfoBinaryFormat.hpp"
+
+namespace {
+	using namespace VarjoFrameInfo::BinaryFormat;
+
+	// 対象環境(x64/ARM64)はリトルエンディアンのため，そのままmemcpyする
+	template<class T>
+	void put(std::vector<char>& out, const T& value) {
+		const size_t pos = out.size();
+		out.resize(pos + sizeof(T));
+		std::memcpy(out.data() + pos, &value, sizeof(T));
+	}
+
+	template<class T>
+	T get(const char*& p) {
+		T value;
+		std::memcpy(&value, p, sizeof(T));
+		p += sizeof(T);
+		return value;
+	}
+
+	constexpr size_t view_state_payload_size = 1 + 16 * sizeof(double) + 3 * sizeof(int32_t) + 4 * sizeof(double);
+	constexpr size_t pose_payload_size = 7 * sizeof(float);
+	constexpr size_t matrix_payload_size = 16 * sizeof(double);
+
+	ViewState make_ViewState(const varjo_ViewInfo& view, const varjo_FovTangents& fov) {
+		ViewState state{};
+		std::memcpy(state.projectionMatrix.data(), view.projectionMatrix, sizeof(view.projectionMatrix));
+		state.preferredWidth = view.preferredWidth;
+		state.preferredHeight = view.preferredHeight;
+		state.enabled = view.enabled;
+		state.fovTangents = fov;
+		return state;
+	}
+
+	bool same_ViewState(const ViewState& a, const ViewState& b) {
+		return std::memcmp(a.projectionMatrix.data(), b.projectionMatrix.data(), sizeof(double) * 16) == 0
+			&& a.preferredWidth == b.preferredWidth
+			&& a.preferredHeight == b.preferredHeight
+			&& a.enabled == b.enabled
+			&& std::memcmp(&a.fovTangents, &b.fovTangents, sizeof(varjo_FovTangents)) == 0;
+	}
+
+	// 列優先4x4行列の(row, col)要素
+	inline double at(const double* m, int row, int col) {
+		return m[col * 4 + row];
+	}
+
+	/**
+	 * @brief 剛体変換(回転 + 平行移動)であればPoseへ変換する
+	 */
+	bool to_Pose(const double* m, Pose& pose) {
+		constexpr double eps = 1e-5;
+
+		if (std::abs(m[3]) > eps || std::abs(m[7]) > eps || std::abs(m[11]) > eps || std::abs(m[15] - 1.0) > eps) {
+			return false;
+		}
+
+		// R^T R = I の確認
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				double dot = 0.0;
+				for (int k = 0; k < 3; ++k) {
+					dot += at(m, k, i) * at(m, k, j);
+				}
+				if (std::abs(dot - (i == j ? 1.0 : 0.0)) > eps) {
+					return false;
+				}
+			}
+		}
+
+		const double r00 = at(m, 0, 0), r01 = at(m, 0, 1), r02 = at(m, 0, 2);
+		const double r10 = at(m, 1, 0), r11 = at(m, 1, 1), r12 = at(m, 1, 2);
+		const double r20 = at(m, 2, 0), r21 = at(m, 2, 1), r22 = at(m, 2, 2);
+
+		const double det = r00 * (r11 * r22 - r12 * r21) - r01 * (r10 * r22 - r12 * r20) + r02 * (r10 * r21 - r11 * r20);
+		if (det <= 0.0) {
+			return false;
+		}
+
+		double x, y, z, w;
+		const double tr = r00 + r11 + r22;
+		if (tr > 0.0) {
+			const double s = std::sqrt(tr + 1.0) * 2.0;
+			w = 0.25 * s;
+			x = (r21 - r12) / s;
+			y = (r02 - r20) / s;
+			z = (r10 - r01) / s;
+		} else if (r00 > r11 && r00 > r22) {
+			const double s = std::sqrt(1.0 + r00 - r11 - r22) * 2.0;
+			w = (r21 - r12) / s;
+			x = 0.25 * s;
+			y = (r01 + r10) / s;
+			z = (r02 + r20) / s;
+		} else if (r11 > r22) {
+			const double s = std::sqrt(1.0 + r11 - r00 - r22) * 2.0;
+			w = (r02 - r20) / s;
+			x = (r01 + r10) / s;
+			y = 0.25 * s;
+			z = (r12 + r21) / s;
+		} else {
+			const double s = std::sqrt(1.0 + r22 - r00 - r11) * 2.0;
+			w = (r10 - r01) / s;
+			x = (r02 + r20) / s;
+			y = (r12 + r21) / s;
+			z = 0.25 * s;
+		}
+
+		// q と -q は同じ回転を表すため，w >= 0 に揃えて同一判定を安定させる
+		if (w < 0.0) {
+			x = -x; y = -y; z = -z; w = -w;
+		}
+
+		pose.rotation = { static_cast<float>(x), static_cast<float>(y), static_cast<float>(z), static_cast<float>(w) };
+		pose.translation = { static_cast<float>(m[12]), static_cast<float>(m[13]), static_cast<float>(m[14]) };
+		return true;
+	}
+
+	void from_Pose(const Pose& pose, double* m) {
+		double x = pose.rotation[0], y = pose.rotation[1], z = pose.rotation[2], w = pose.rotation[3];
+		const double n = std::sqrt(x * x + y * y + z * z + w * w);
+		if (n > 0.0) {
+			x /= n; y /= n; z /= n; w /= n;
+		}
+
+		// 列優先
+		m[0] = 1.0 - 2.0 * (y * y + z * z);
+		m[1] = 2.0 * (x * y + z * w);
+		m[2] = 2.0 * (x * z - y * w);
+		m[3] = 0.0;
+		m[4] = 2.0 * (x * y - z * w);
+		m[5] = 1.0 - 2.0 * (x * x + z * z);
+		m[6] = 2.0 * (y * z + x * w);
+		m[7] = 0.0;
+		m[8] = 2.0 * (x * z + y * w);
+		m[9] = 2.0 * (y * z - x * w);
+		m[10] = 1.0 - 2.0 * (x * x + y * y);
+		m[11] = 0.0;
+		m[12] = pose.translation[0];
+		m[13] = pose.translation[1];
+		m[14] = pose.translation[2];
+		m[15] = 1.0;
+	}
+}
+
+namespace VarjoFrameInfo {
+
+	namespace BinaryFormat {
+
+		bool Pose::operator==(const Pose& other) const
+		{
+			return std::memcmp(this->rotation.data(), other.rotation.data(), sizeof(float) * 4) == 0
+				&& std::memcmp(this->translation.data(), other.translation.data(), sizeof(float) * 3) == 0;
+		}
+
+		void write_file_header(std::vector<char>& out)
+		{
+			out.insert(out.end(), std::begin(magic), std::end(magic));
+			put<uint16_t>(out, version);
+			put<uint16_t>(out, static_cast<uint16_t>(view_count));
+		}
+
+		bool check_file_header(const char* data, size_t size)
+		{
+			if (size < file_header_size || std::memcmp(data, magic, sizeof(magic)) != 0) {
+				return false;
+			}
+			const char* p = data + sizeof(magic);
+			const auto file_version = get<uint16_t>(p);
+			const auto file_view_count = get<uint16_t>(p);
+			return file_version == version && file_view_count == view_count;
+		}
+
+		//////////////////////////////////////////////////////////////////////////////////////////////
+		// Encoder
+		//////////////////////////////////////////////////////////////////////////////////////////////
+
+		void Encoder::encode(const FrameInfoData& data, std::vector<char>& out)
+		{
+			// 変化したビュー情報
+			for (size_t i = 0; i < view_count; ++i) {
+				const auto state = make_ViewState(data.views[i], data.fovTangents[i]);
+				if (this->has_state_[i] && same_ViewState(state, this->states_[i])) {
+					continue;
+				}
+
+				put<uint8_t>(out, static_cast<uint8_t>(RecordTag::ViewState));
+				put<uint8_t>(out, static_cast<uint8_t>(i));
+				put(out, state.projectionMatrix);
+				put(out, state.preferredWidth);
+				put(out, state.preferredHeight);
+				put(out, state.enabled);
+				put(out, state.fovTangents.top);
+				put(out, state.fovTangents.bottom);
+				put(out, state.fovTangents.left);
+				put(out, state.fovTangents.right);
+
+				this->states_[i] = state;
+				this->has_state_[i] = true;
+			}
+
+			// フレーム
+			put<uint8_t>(out, static_cast<uint8_t>(RecordTag::Frame));
+			put<int64_t>(out, data.timestamp);
+			put<int64_t>(out, data.frameNumber);
+
+			std::array<PoseKind, view_count> kind{};
+			std::array<Pose, view_count> pose{};
+			std::array<std::array<double, 16>, view_count> matrix{};
+
+			for (size_t i = 0; i < view_count; ++i) {
+				const double* m = data.views[i].viewMatrix;
+				if (to_Pose(m, pose[i])) {
+					kind[i] = PoseKind::Pose;
+				} else {
+					kind[i] = PoseKind::Matrix;
+					std::memcpy(matrix[i].data(), m, sizeof(double) * 16);
+				}
+
+				auto same_as = [&](PoseKind k, const Pose& p, const std::array<double, 16>& mat) {
+					if (k != kind[i]) return false;
+					return kind[i] == PoseKind::Pose ? p == pose[i] : std::memcmp(mat.data(), matrix[i].data(), sizeof(double) * 16) == 0;
+				};
+
+				if (i >= 2 && same_as(kind[i - 2], pose[i - 2], matrix[i - 2])) {
+					put<uint8_t>(out, static_cast<uint8_t>(PoseKind::SameAsPair));
+				} else if (this->has_pose_[i] && same_as(this->prev_kind_[i], this->prev_pose_[i], this->prev_matrix_[i])) {
+					put<uint8_t>(out, static_cast<uint8_t>(PoseKind::SameAsPrevious));
+				} else if (kind[i] == PoseKind::Pose) {
+					put<uint8_t>(out, static_cast<uint8_t>(PoseKind::Pose));
+					put(out, pose[i].rotation);
+					put(out, pose[i].translation);
+				} else {
+					put<uint8_t>(out, static_cast<uint8_t>(PoseKind::Matrix));
+					put(out, matrix[i]);
+				}
+
+				this->has_pose_[i] = true;
+				this->prev_kind_[i] = kind[i];
+				this->prev_pose_[i] = pose[i];
+				this->prev_matrix_[i] = matrix[i];
+			}
+		}
+
+		void Encoder::reset()
+		{
+			this->has_state_ = {};
+			this->has_pose_ = {};
+		}
+
+		//////////////////////////////////////////////////////////////////////////////////////////////
+		// Decoder
+		//////////////////////////////////////////////////////////////////////////////////////////////
+
+		Decoder::Result Decoder::decode(const char* data, size_t size, size_t& consumed, FrameInfoData& out)
+		{
+			consumed = 0;
+			if (size < 1) {
+				return Result::NeedMoreData;
+			}
+
+			const char* p = data;
+			const char* const end = data + size;
+			const auto tag = static_cast<RecordTag>(get<uint8_t>(p));
+
+			if (tag == RecordTag::ViewState) {
+				if (static_cast<size_t>(end - p) < view_state_payload_size) {
+					return Result::NeedMoreData;
+				}
+
+				const auto view = get<uint8_t>(p);
+				if (view >= view_count) {
+					return Result::Corrupted;
+				}
+
+				auto& state = this->states_[view];
+				state.projectionMatrix = get<std::array<double, 16>>(p);
+				state.preferredWidth = get<int32_t>(p);
+				state.preferredHeight = get<int32_t>(p);
+				state.enabled = get<int32_t>(p);
+				state.fovTangents.top = get<double>(p);
+				state.fovTangents.bottom = get<double>(p);
+				state.fovTangents.left = get<double>(p);
+				state.fovTangents.right = get<double>(p);
+
+				consumed = p - data;
+				return Result::ViewState;
+
+			} else if (tag == RecordTag::Frame) {
+				if (static_cast<size_t>(end - p) < 2 * sizeof(int64_t)) {
+					return Result::NeedMoreData;
+				}
+
+				const auto timestamp = get<int64_t>(p);
+				const auto frameNumber = get<int64_t>(p);
+
+				// 途中で切れていた場合に状態を壊さないよう，一時領域へ復元する
+				auto view_matrix = this->view_matrix_;
+				for (size_t i = 0; i < view_count; ++i) {
+					if (end - p < 1) {
+						return Result::NeedMoreData;
+					}
+
+					const auto kind = static_cast<PoseKind>(get<uint8_t>(p));
+					switch (kind) {
+					case PoseKind::SameAsPrevious:
+						break;
+					case PoseKind::SameAsPair:
+						if (i < 2) {
+							return Result::Corrupted;
+						}
+						view_matrix[i] = view_matrix[i - 2];
+						break;
+					case PoseKind::Pose: {
+						if (static_cast<size_t>(end - p) < pose_payload_size) {
+							return Result::NeedMoreData;
+						}
+						Pose pose;
+						pose.rotation = get<std::array<float, 4>>(p);
+						pose.translation = get<std::array<float, 3>>(p);
+						from_Pose(pose, view_matrix[i].data());
+						break;
+					}
+					case PoseKind::Matrix:
+						if (static_cast<size_t>(end - p) < matrix_payload_size) {
+							return Result::NeedMoreData;
+						}
+						view_matrix[i] = get<std::array<double, 16>>(p);
+						break;
+					default:
+						return Result::Corrupted;
+					}
+				}
+				this->view_matrix_ = view_matrix;
+
+				for (size_t i = 0; i < view_count; ++i) {
+					const auto& state = this->states_[i];
+					auto& view = out.views[i];
+					view = varjo_ViewInfo{};
+					std::memcpy(view.projectionMatrix, state.projectionMatrix.data(), sizeof(view.projectionMatrix));
+					std::memcpy(view.viewMatrix, this->view_matrix_[i].data(), sizeof(view.viewMatrix));
+					view.preferredWidth = state.preferredWidth;
+					view.preferredHeight = state.preferredHeight;
+					view.enabled = state.enabled;
+					out.fovTangents[i] = state.fovTangents;
+				}
+				out.timestamp = timestamp;
+				out.frameNumber = frameNumber;
+
+				consumed = p - data;
+				return Result::Frame;
+			}
+
+			return Result::Corrupted;
+		}
+
+		void Decoder::reset()
+		{
+			this->states_ = {};
+			this->view_matrix_ = {};
+		}
+	}
+}
@@ -0,0 +1,121 @@
+/************************************************************************************************************************
+	FrameInfo Binary Format
+	FrameInfoDataのバイナリ形式．
+
+	[FileHeader] [Record] [Record] ...
+
+	FileHeader : magic "VFIB"(4) | version u16 | view_count u16
+	Record     : tag u8 | payload
+		ViewState (tag=1) : view u8 | projectionMatrix f64[16] | preferredWidth i32 | preferredHeight i32 | enabled i32 | fovTangents f64[4]
+			ビューの射影行列・解像度・有効フラグ・FOVタンジェントのいずれかが変化したときのみ出力する
+		Frame     (tag=2) : timestamp i64 | frameNumber i64 | (pose_kind u8 | pose)[view_count]
+			pose_kind = SameAsPrevious : 前フレームの同じビューと同一(データなし)
+			            SameAsPair     : 2つ前のビュー(focus→context)と同一(データなし)
+			            Pose           : 回転クォータニオン f32[4](x,y,z,w) | 平行移動 f32[3]
+			            Matrix         : 剛体変換でないビュー行列 f64[16]
+
+	数値はすべてリトルエンディアン．Pose形式は単精度のため，ビュー行列は1e-6程度の誤差で復元される．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include "FrameInfo_types.hpp"
+
+namespace VarjoFrameInfo {
+
+	namespace BinaryFormat {
+
+		inline constexpr char magic[4] = { 'V', 'F', 'I', 'B' };
+		inline constexpr uint16_t version = 1;
+		inline constexpr size_t view_count = 4;
+		inline constexpr size_t file_header_size = 8;
+
+		enum class RecordTag : uint8_t {
+			ViewState = 1,
+			Frame = 2
+		};
+
+		enum class PoseKind : uint8_t {
+			SameAsPrevious = 0,
+			SameAsPair = 1,
+			Pose = 2,
+			Matrix = 3
+		};
+
+		// 1ビュー分の，変化時のみ出力する情報
+		struct ViewState {
+			std::array<double, 16> projectionMatrix;
+			int32_t preferredWidth;
+			int32_t preferredHeight;
+			int32_t enabled;
+			varjo_FovTangents fovTangents;
+		};
+
+		// 単精度の姿勢表現．同一判定はこの表現のビット比較で行う
+		struct Pose {
+			std::array<float, 4> rotation;		// x, y, z, w
+			std::array<float, 3> translation;
+
+			bool operator==(const Pose& other) const;
+		};
+
+		void write_file_header(std::vector<char>& out);
+
+		/**
+		 * @brief 先頭file_header_sizeバイトを検証する
+		 */
+		bool check_file_header(const char* data, size_t size);
+
+		/**
+		 * @brief FrameInfoDataを差分符号化する．ファイルの先頭から順に全フレームを渡すこと．
+		 */
+		class Encoder {
+
+		public:
+			/**
+			 * @brief dataのレコード列をoutの末尾に追記する
+			 */
+			void encode(const FrameInfoData& data, std::vector<char>& out);
+
+			void reset();
+
+		private:
+			std::array<bool, view_count> has_state_{};
+			std::array<ViewState, view_count> states_{};
+			std::array<bool, view_count> has_pose_{};
+			std::array<PoseKind, view_count> prev_kind_{};
+			std::array<Pose, view_count> prev_pose_{};
+			std::array<std::array<double, 16>, view_count> prev_matrix_{};
+		};
+
+		/**
+		 * @brief Encoderの出力からFrameInfoDataを復元する．
+		 */
+		class Decoder {
+
+		public:
+			enum class Result {
+				Frame,			// outにフレームを復元した
+				ViewState,		// ビュー情報を更新した(フレームはまだ)
+				NeedMoreData,	// レコードが途中で切れている
+				Corrupted		// 不正なレコード
+			};
+
+			/**
+			 * @brief data[0..size)の先頭1レコードを処理する．消費したバイト数をconsumedに返す．
+			 */
+			Result decode(const char* data, size_t size, size_t& consumed, FrameInfoData& out);
+
+			void reset();
+
+		private:
+			std::array<ViewState, view_count> states_{};
+			std::array<std::array<double, 16>, view_count> view_matrix_{};
+		};
+	}
+}
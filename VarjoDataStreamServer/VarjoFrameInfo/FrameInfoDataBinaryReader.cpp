@@ -0,0 +1,99 @@
+#include "FrameInfoDataBinaryReader.hpp"
+
+namespace VarjoFrameInfo {
+
+	DataBinaryReader::DataBinaryReader(const std::string& path)
+		: path_(path)
+	{}
+
+	DataBinaryReader::~DataBinaryReader()
+	{
+		this->close();
+	}
+
+	bool DataBinaryReader::open()
+	{
+		if (this->is_open()) return false;
+
+		this->file_.open(this->path_, std::ios::in | std::ios::binary);
+		if (!this->file_.is_open()) {
+			return false;
+		}
+
+		char header[BinaryFormat::file_header_size];
+		this->file_.read(header, sizeof(header));
+		if (this->file_.gcount() != sizeof(header) || !BinaryFormat::check_file_header(header, sizeof(header))) {
+			this->file_.close();
+			return false;
+		}
+
+		this->decoder_.reset();
+		this->buf_.clear();
+		this->buf_pos_ = 0;
+		this->corrupted_ = false;
+
+		return true;
+	}
+
+	void DataBinaryReader::close()
+	{
+		if (this->file_.is_open()) {
+			this->file_.close();
+		}
+	}
+
+	bool DataBinaryReader::read_next(FrameInfoData& out)
+	{
+		if (!this->is_open() || this->corrupted_) {
+			return false;
+		}
+
+		while (true) {
+			size_t consumed = 0;
+			const auto result = this->decoder_.decode(
+				this->buf_.data() + this->buf_pos_, this->buf_.size() - this->buf_pos_, consumed, out);
+			this->buf_pos_ += consumed;
+
+			switch (result) {
+			case BinaryFormat::Decoder::Result::Frame:
+				return true;
+			case BinaryFormat::Decoder::Result::ViewState:
+				break;
+			case BinaryFormat::Decoder::Result::NeedMoreData:
+				if (!this->fill_buffer()) {
+					// 終端，または末尾の不完全なレコード
+					return false;
+				}
+				break;
+			case BinaryFormat::Decoder::Result::Corrupted:
+				this->corrupted_ = true;
+				return false;
+			}
+		}
+	}
+
+	std::vector<FrameInfoData> DataBinaryReader::read_all()
+	{
+		std::vector<FrameInfoData> frames;
+		FrameInfoData data;
+		while (this->read_next(data)) {
+			frames.push_back(data);
+		}
+		return frames;
+	}
+
+	bool DataBinaryReader::fill_buffer()
+	{
+		// 未処理分を先頭へ詰める
+		this->buf_.erase(this->buf_.begin(), this->buf_.begin() + this->buf_pos_);
+		this->buf_pos_ = 0;
+
+		const size_t old_size = this->buf_.size();
+		this->buf_.resize(old_size + read_chunk_size);
+		this->file_.read(this->buf_.data() + old_size, read_chunk_size);
+		const auto n = static_cast<size_t>(this->file_.gcount());
+		this->buf_.resize(old_size + n);
+
+		return n > 0;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "FrameInfo_types.hpp"
+#include "FrameInfoBinaryFormat.hpp"
+
+namespace VarjoFrameInfo {
+
+	/**
+	 * @brief DataBinaryWriterで書き込んだファイルを先頭から読み出し，FrameInfoDataを復元する．
+	 *
+	 * 書き込み中に終了したファイルは，末尾の不完全なレコードを無視してそれまでのフレームを返す．
+	 */
+	class DataBinaryReader {
+
+	public:
+		DataBinaryReader(const std::string& path);
+
+		~DataBinaryReader();
+
+		bool open();
+		void close();
+
+		/**
+		 * @brief 次のフレームを読み出す．ファイル終端または不正なレコードに達した場合はfalseを返す．
+		 */
+		bool read_next(FrameInfoData& out);
+
+		std::vector<FrameInfoData> read_all();
+
+		// getter
+		inline bool is_open() const {
+			return file_.is_open();
+		}
+
+		// 不正なレコードで読み出しを打ち切った場合true
+		inline bool is_corrupted() const {
+			return corrupted_;
+		}
+
+	private:
+		bool fill_buffer();
+
+	private:
+		static constexpr size_t read_chunk_size = 64 * 1024;
+
+		std::filesystem::path path_;
+		std::ifstream file_;
+
+		BinaryFormat::Decoder decoder_;
+		std::vector<char> buf_;
+		size_t buf_pos_ = 0;
+		bool corrupted_ = false;
+	};
+}
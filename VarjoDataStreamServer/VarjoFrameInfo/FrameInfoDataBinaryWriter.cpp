@@ -0,0 +1,137 @@
+#include "FrameInfoDataBinaryWriter.hpp"
+#include "../util/PerformanceChecker.hpp"
+
+namespace VarjoFrameInfo {
+
+	DataBinaryWriter::DataBinaryWriter(const std::string& path, const Segmentation::SegmentOptions& segment)
+		: path_(solve_filename_conflict(path))
+		, file_(segment)
+	{}
+
+	DataBinaryWriter::~DataBinaryWriter()
+	{
+		if (this->file_.is_open()) {
+			this->file_.close();
+		}
+	}
+
+	bool DataBinaryWriter::open()
+	{
+		if (this->is_open()) return false;
+
+		this->written_bytes_ = 0;
+		return this->file_.open(this->path_, [this](AsyncIo::AsyncFile& file) { this->write_header(file); });
+	}
+
+	void DataBinaryWriter::close()
+	{
+		if (this->file_.is_open()) {
+			this->file_.close();
+		}
+	}
+
+	void DataBinaryWriter::write_header(AsyncIo::AsyncFile& file)
+	{
+		// ファイル(セグメント)の先頭からデコードできるよう，差分の基準も作り直す
+		this->encoder_.reset();
+		this->record_buf_.clear();
+		BinaryFormat::write_file_header(this->record_buf_);
+		file.write(this->record_buf_.data(), this->record_buf_.size());
+		this->written_bytes_ += this->record_buf_.size();
+	}
+
+	void DataBinaryWriter::write_record(const FrameInfoData& data)
+	{
+		if (!this->file_.is_open()) {
+			return;
+		}
+
+		this->file_.begin_record(static_cast<int64_t>(data.timestamp));
+
+		this->record_buf_.clear();
+		this->encoder_.encode(data, this->record_buf_);
+		this->file_.write(this->record_buf_.data(), this->record_buf_.size());
+		this->written_bytes_ += this->record_buf_.size();
+	}
+
+
+	SerialDataBinaryWriter::SerialDataBinaryWriter(const std::string& path, const Segmentation::SegmentOptions& segment)
+		: DataBinaryWriter(path, segment)
+	{}
+
+	void SerialDataBinaryWriter::submit_batch_impl(SubmitBatch<FrameInfoData> data)
+	{
+		for (const auto& d : data.view()) {
+			this->write_record(d);
+		}
+	}
+
+	ParallelDataBinaryWriter::ParallelDataBinaryWriter(const std::string& path, const Segmentation::SegmentOptions& segment)
+		: DataBinaryWriter(path, segment)
+	{}
+
+	ParallelDataBinaryWriter::~ParallelDataBinaryWriter()
+	{
+		this->close();
+	}
+
+	bool ParallelDataBinaryWriter::open()
+	{
+		// ファイルを開く
+		if (!DataBinaryWriter::open()) {
+			return false;
+		}
+
+		return true;
+	}
+
+	void ParallelDataBinaryWriter::close()
+	{
+		// 積まれている分を書き終えるまで待つ
+		this->write_task_.notify();
+		this->write_task_.wait_idle();
+
+		// ファイルを閉じる
+		DataBinaryWriter::close();
+	}
+
+	void ParallelDataBinaryWriter::submit_batch_impl(SubmitBatch<FrameInfoData> data)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->data_que_mtx_);
+			std::move(data).consume([this](FrameInfoData&& d) { this->data_que_.push_back(std::move(d)); });
+		}
+		this->write_task_.notify();
+	}
+
+	void ParallelDataBinaryWriter::writer_worker()
+	{
+		std::deque<FrameInfoData> data_toWrite;
+		{
+			// キューの退避
+			std::lock_guard lk(this->data_que_mtx_);
+			data_toWrite.swap(this->data_que_);
+		}
+
+		// データの書き込み
+		for (auto& data : data_toWrite) {
+			this->write_record(data);
+		}
+	}
+
+	std::unique_ptr<DataBinaryWriter> make_DataBinaryWriterPtr(const DataBinaryWriterOptions& opt)
+	{
+		if (opt.writer_type == DataBinaryWriterType::Serial) {
+			return std::make_unique<SerialDataBinaryWriter>(opt.out_path, opt.segment);
+		} else if (opt.writer_type == DataBinaryWriterType::Parallel) {
+			return std::make_unique<ParallelDataBinaryWriter>(opt.out_path, opt.segment);
+		} else {
+			throw std::runtime_error("Invalid DataBinaryWriterType");
+		}
+	}
+
+	std::unique_ptr<ISubmitFrameInfo> make_DataBinaryWriter_asISubmit(const DataBinaryWriterOptions& opt)
+	{
+		return make_DataBinaryWriterPtr(opt);
+	}
+}
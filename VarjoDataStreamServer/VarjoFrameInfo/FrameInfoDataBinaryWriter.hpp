@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+#include "../util/filesystem_util.hpp"
+
+#include "FrameInfo_types.hpp"
+#include "FrameInfoBinaryFormat.hpp"
+#include "ISubmitFrameInfo.hpp"
+#include "../util/Executor.hpp"
+#include "../util/Segmentation.hpp"
+
+namespace VarjoFrameInfo {
+
+	enum class DataBinaryWriterType {
+		Serial,
+		Parallel
+	};
+
+	/**
+	 * @brief FrameInfoDataをバイナリ形式(FrameInfoBinaryFormat.hpp)で書き込む．
+	 * segmentを指定するとtimestampでファイルを区切る．差分の基準はセグメントごとに作り直すので，各セグメントは単独で読める
+	 */
+	class DataBinaryWriter : public ISubmitFrameInfo {
+
+	public:
+		DataBinaryWriter(const std::string& path, const Segmentation::SegmentOptions& segment = {});
+
+		~DataBinaryWriter();
+
+		virtual bool open();
+		virtual void close();
+
+	protected:
+		void write_header(AsyncIo::AsyncFile& file);
+		void write_record(const FrameInfoData& data);
+
+	public:
+
+		// getter
+		inline std::filesystem::path get_path() const {
+			return path_;
+		}
+
+		inline bool is_open() const {
+			return file_.is_open();
+		}
+
+		inline uint64_t written_bytes() const {
+			return written_bytes_;
+		}
+
+	protected:
+		std::filesystem::path path_;
+		Segmentation::SegmentedFile file_;
+
+		BinaryFormat::Encoder encoder_;
+		std::vector<char> record_buf_;
+		uint64_t written_bytes_ = 0;
+	};
+
+	class SerialDataBinaryWriter : public DataBinaryWriter {
+	public:
+		SerialDataBinaryWriter(const std::string& path, const Segmentation::SegmentOptions& segment = {});
+
+	private:
+		void submit_batch_impl(SubmitBatch<FrameInfoData> data) override;
+	};
+
+	class ParallelDataBinaryWriter : public DataBinaryWriter {
+
+	public:
+		ParallelDataBinaryWriter(const std::string& path, const Segmentation::SegmentOptions& segment = {});
+		~ParallelDataBinaryWriter();
+
+		bool open() override;
+		void close() override;
+
+	private:
+		void submit_batch_impl(SubmitBatch<FrameInfoData> data) override;
+
+		void writer_worker();
+
+	private:
+		std::deque<FrameInfoData> data_que_;
+		std::mutex data_que_mtx_;
+		Execution::WorkerTask write_task_{ [this] { this->writer_worker(); }, Execution::TaskKind::Io };
+	};
+
+	struct DataBinaryWriterOptions {
+		DataBinaryWriterType writer_type;
+		std::string out_path;
+		Segmentation::SegmentOptions segment{};
+	};
+
+	std::unique_ptr<DataBinaryWriter> make_DataBinaryWriterPtr(const DataBinaryWriterOptions& opt);
+	std::unique_ptr<ISubmitFrameInfo> make_DataBinaryWriter_asISubmit(const DataBinaryWriterOptions& opt);
+}
@@ -0,0 +1,155 @@
+#include "FrameInfoDataLogger.hpp"
+#include "../util/PerformanceChecker.hpp"
+#include "../util/TraceRecorder.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::Counter& samples = PerformanceChecker::counter("frame_info_samples_total");
+		PerformanceChecker::Counter& dropped = PerformanceChecker::counter("frame_info_dropped_total");
+		PerformanceChecker::LatencyHistogram& write_batch = PerformanceChecker::histogram("frame_info_write_batch_ns");
+		PerformanceChecker::Gauge& batch_size = PerformanceChecker::gauge("frame_info_write_batch_size");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+}
+
+namespace VarjoFrameInfo {
+
+	DataLogger::DataLogger(const size_t queue_capacity, const int check_interval_ms)
+		: check_interval_ms_(check_interval_ms)
+		, data_que_(queue_capacity)
+	{
+		this->write_buffer_.reserve(this->data_que_.capacity());
+	}
+
+	DataLogger::~DataLogger()
+	{
+		this->close();
+	}
+
+	bool DataLogger::open(const FrameInfoDataStreamerOptions& dstream_opt, const DataCsvWriterOptions& writer_opt)
+	{
+		if (this->is_open()) {
+			return false;
+		}
+
+		this->csvwriter_ = make_DataCsvWriterPtr(writer_opt);
+		if (!this->csvwriter_->open()) {
+			this->csvwriter_.reset();
+			return false;
+		}
+		this->writer_ = this->csvwriter_.get();
+
+		this->start(dstream_opt);
+		return true;
+	}
+
+	bool DataLogger::open(const FrameInfoDataStreamerOptions& dstream_opt, const DataBinaryWriterOptions& writer_opt)
+	{
+		if (this->is_open()) {
+			return false;
+		}
+
+		this->binwriter_ = make_DataBinaryWriterPtr(writer_opt);
+		if (!this->binwriter_->open()) {
+			this->binwriter_.reset();
+			return false;
+		}
+		this->writer_ = this->binwriter_.get();
+
+		this->start(dstream_opt);
+		return true;
+	}
+
+	void DataLogger::start(const FrameInfoDataStreamerOptions& dstream_opt)
+	{
+		this->dstreamer_ = make_FrameInfoDataStreamerPtr(dstream_opt);
+
+		this->streamed_count_ = 0;
+		this->dropped_count_ = 0;
+
+		// WaitSyncは専用スレッドで待つ．書き込みも専用のスレッド(WorkerTaskのBlocking)で行う
+		this->stop_datastream_thread_ = false;
+		this->stop_logging_ = false;
+		this->datastream_thread_ = std::thread(&DataLogger::datastream_worker, this);
+	}
+
+	void DataLogger::close()
+	{
+		// WaitSyncスレッドを先に止め，残りのキューを掃き出す
+		this->stop_datastream_thread_ = true;
+		if (this->datastream_thread_.joinable()) {
+			this->datastream_thread_.join();
+		}
+		this->logging_task_.notify();
+		this->logging_task_.wait_idle();
+		this->stop_logging_ = true;
+
+		this->writer_ = nullptr;
+		if (this->csvwriter_) {
+			this->csvwriter_->close();
+			this->csvwriter_.reset();
+		}
+		if (this->binwriter_) {
+			this->binwriter_->close();
+			this->binwriter_.reset();
+		}
+		this->dstreamer_.reset();
+	}
+
+	void DataLogger::datastream_worker()
+	{
+		auto thread_reg = PerformanceChecker::register_thread("frame_info_streamer");
+		const auto check_interval = std::chrono::milliseconds(this->check_interval_ms_);
+		auto last_notify = std::chrono::steady_clock::now();
+
+		while (!this->stop_datastream_thread_.load()) {
+			auto data = this->dstreamer_->get_FrameInfoData();
+			this->streamed_count_.fetch_add(1, std::memory_order_relaxed);
+			metrics().samples.inc();
+
+			if (!this->data_que_.try_push(std::move(data))) {
+				this->dropped_count_.fetch_add(1, std::memory_order_relaxed);
+				metrics().dropped.inc();
+				Profiling::trace_instant("frame_info.drop");
+			}
+
+			// check_interval_msごとにまとめて書き込ませる
+			const auto now = std::chrono::steady_clock::now();
+			if (now - last_notify >= check_interval) {
+				this->logging_task_.notify();
+				last_notify = now;
+			}
+		}
+	}
+
+	void DataLogger::logging_worker()
+	{
+		if (this->stop_logging_.load()) {
+			return;
+		}
+
+		this->drain_queue(this->write_buffer_);
+		if (this->write_buffer_.empty()) {
+			return;
+		}
+		metrics().batch_size.set(static_cast<int64_t>(this->write_buffer_.size()));
+		{
+			Profiling::TraceScope trace("frame_info.write_batch");
+			PerformanceChecker::ScopedTimer timer(metrics().write_batch);
+			this->writer_->submit_FrameInfoData(this->write_buffer_);
+		}
+		this->write_buffer_.clear();
+	}
+
+	void DataLogger::drain_queue(std::vector<FrameInfoData>& buffer)
+	{
+		this->data_que_.drain([&buffer](FrameInfoData&& data) {
+			buffer.push_back(std::move(data));
+		});
+	}
+}
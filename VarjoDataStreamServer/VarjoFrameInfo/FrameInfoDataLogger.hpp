@@ -2,21 +2,75 @@
 
 #include <filesystem>
 #include <memory>
+#include <thread>
+#include <atomic>
+#include <vector>
 
 #include "../VarjoExample/Session.hpp"
+#include "../util/SpscRingBuffer.hpp"
+#include "../util/Executor.hpp"
 
 #include "FrameInfo_types.hpp"
+#include "FrameInfoDataStreamer.hpp"
+#include "FrameInfoDataCsvWriter.hpp"
+#include "FrameInfoDataBinaryWriter.hpp"
 
 namespace VarjoFrameInfo {
 
+	/**
+	 * @brief varjo_WaitSync専用スレッドでフレーム情報を取得し，ロックフリーキュー経由で書き込みスレッドへ渡す．
+	 *
+	 * 書き込みがディスクで詰まってもWaitSyncスレッドは待たされないため，表示フレームを取りこぼさない．
+	 * キューが満杯の場合はそのフレームを破棄し，dropped_count()に計上する．
+	 * 書き込みはWaitSyncスレッドがcheck_interval_msごとに通知し，ロガー専用のスレッド(WorkerTaskのBlocking)でまとめて行う．
+	 */
 	class DataLogger {
 
 	public:
-		DataLogger();
+		DataLogger(const size_t queue_capacity = 1024, const int check_interval_ms = 5);
 
 		~DataLogger();
 
-		bool open_csvWriter();
+		bool open(const FrameInfoDataStreamerOptions& dstream_opt, const DataCsvWriterOptions& writer_opt);
+		bool open(const FrameInfoDataStreamerOptions& dstream_opt, const DataBinaryWriterOptions& writer_opt);
 		void close();
+
+		bool is_open() const { return !this->stop_logging_.load(); }
+
+		void invalidate_fovTangents() {
+			if (this->dstreamer_) {
+				this->dstreamer_->invalidate_fovTangents();
+			}
+		}
+
+		uint64_t streamed_count() const { return this->streamed_count_.load(std::memory_order_relaxed); }
+		uint64_t dropped_count() const { return this->dropped_count_.load(std::memory_order_relaxed); }
+
+	private:
+		void start(const FrameInfoDataStreamerOptions& dstream_opt);
+
+		void datastream_worker();
+		void logging_worker();
+
+		void drain_queue(std::vector<FrameInfoData>& buffer);
+
+	private:
+		const int check_interval_ms_;
+
+		std::unique_ptr<FrameInfoDataStreamer> dstreamer_;
+		std::unique_ptr<DataCsvWriter> csvwriter_;
+		std::unique_ptr<DataBinaryWriter> binwriter_;
+		ISubmitFrameInfo* writer_ = nullptr;
+
+		SpscRingBuffer<FrameInfoData> data_que_;
+		std::vector<FrameInfoData> write_buffer_;		// logging_task_のみが触る
+		std::thread datastream_thread_;
+		std::atomic_bool stop_datastream_thread_{true};
+		std::atomic_bool stop_logging_{true};
+
+		std::atomic<uint64_t> streamed_count_{0};
+		std::atomic<uint64_t> dropped_count_{0};
+
+		Execution::WorkerTask logging_task_{ [this] { this->logging_worker(); }, Execution::TaskKind::Blocking };
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../util/RecordSchema.hpp"
+#include "FrameInfo_types.hpp"
+
+namespace VarjoFrameInfo {
+
+	/**
+	 * @brief FrameInfoDataのCSVの列の定義．ヘッダ・1行の書き出し・読み込みはここから生成する
+	 * @detail バイナリはFrameInfoBinaryFormat.hppの差分形式を使う
+	 */
+	namespace Schema {
+
+		inline constexpr auto view_info_fields = RecordSchema::fields(
+			RecordSchema::columns<16>("projectionMatrix", [](auto& v) -> auto& { return v.projectionMatrix; }),
+			RecordSchema::columns<16>("viewMatrix", [](auto& v) -> auto& { return v.viewMatrix; }),
+			RecordSchema::column("preferredWidth", [](auto& v) -> auto& { return v.preferredWidth; }),
+			RecordSchema::column("preferredHeight", [](auto& v) -> auto& { return v.preferredHeight; }),
+			RecordSchema::column("enabled", [](auto& v) -> auto& { return v.enabled; })
+		);
+
+		inline constexpr auto fov_tangents_fields = RecordSchema::fields(
+			RecordSchema::column("top", [](auto& f) -> auto& { return f.top; }),
+			RecordSchema::column("bottom", [](auto& f) -> auto& { return f.bottom; }),
+			RecordSchema::column("left", [](auto& f) -> auto& { return f.left; }),
+			RecordSchema::column("right", [](auto& f) -> auto& { return f.right; })
+		);
+
+		inline constexpr auto frame_info_data_fields = RecordSchema::fields(
+			RecordSchema::nested_array<4>("view", "_", [](auto& d) -> auto& { return d.views; }, view_info_fields),
+			RecordSchema::nested_array<4>("fovTangents", "_", [](auto& d) -> auto& { return d.fovTangents; }, fov_tangents_fields),
+			RecordSchema::column("timestamp", [](auto& d) -> auto& { return d.timestamp; }),
+			RecordSchema::column("frameNumber", [](auto& d) -> auto& { return d.frameNumber; })
+		);
+	}
+
+	using FrameInfoDataRecord = RecordSchema::Record<FrameInfoData, Schema::frame_info_data_fields>;
+}
@@ -3,23 +3,22 @@
 #include <vector>
 #include <queue>
 
-#include "../util/BorrowedOrOwned.hpp"
+#include "../util/ISubmit.hpp"
 
 #include "FrameInfo_types.hpp"
 
 namespace VarjoFrameInfo {
-	class ISubmitFrameInfo {
-	public:
-		virtual ~ISubmitFrameInfo() = default;
-
-		virtual void submit_FrameInfoData(const FrameInfoData& data) = 0;
-		virtual void submit_FrameInfoData(FrameInfoData&& data) = 0;
-		virtual void submit_FrameInfoData(const std::vector<FrameInfoData>& data) = 0;
-		virtual void submit_FrameInfoData(std::vector<FrameInfoData>&& data) = 0;
-		virtual void submit_FrameInfoData(std::queue<FrameInfoData>& data) = 0;
-		virtual void submit_FrameInfoData(std::queue<FrameInfoData>&& data) = 0;
 
-	protected:
-		virtual void submit_FrameInfoData_impl(BorrowedOrOwned<FrameInfoData> data) = 0;
+	/**
+	 * @brief 実装はsubmit_batch_impl(SubmitBatch<FrameInfoData>)を書く．以下は従来の呼び出し方を残すための転送
+	 */
+	class ISubmitFrameInfo : public ISubmit<FrameInfoData> {
+	public:
+		void submit_FrameInfoData(const FrameInfoData& data) { this->submit(data); }
+		void submit_FrameInfoData(FrameInfoData&& data) { this->submit(std::move(data)); }
+		void submit_FrameInfoData(const std::vector<FrameInfoData>& data) { this->submit(data); }
+		void submit_FrameInfoData(std::vector<FrameInfoData>&& data) { this->submit(std::move(data)); }
+		void submit_FrameInfoData(std::queue<FrameInfoData>& data) { this->submit(data); }
+		void submit_FrameInfoData(std::queue<FrameInfoData>&& data) { this->submit(std::move(data)); }
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,462 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <windows.h>
+
+#include "Pipeline.hpp"
+
+namespace VarjoPipeline {
+
+	Pipeline::Pipeline(PipelineConfig config)
+		: config_(std::move(config))
+	{}
+
+	Pipeline::~Pipeline()
+	{
+		try {
+			this->close();
+		}
+		catch (const std::exception& e) {
+			std::cerr << "Pipeline: failed to close: " << e.what() << std::endl;
+		}
+	}
+
+	void Pipeline::open()
+	{
+		if (this->opened_) {
+			throw std::runtime_error("Pipeline is already opened.");
+		}
+
+		// ロガーが最初にshared()を使う前にスレッド数を決める
+		if (!Execution::Executor::configure_shared(this->config_.executor)) {
+			std::cerr << "Pipeline: the shared executor is already running; executor settings are ignored" << std::endl;
+		}
+
+		// 各段のキュー・プールが確保を始める前に上限を決める
+		Memory::MemoryBudget::shared().configure(this->config_.memory);
+
+		if (this->config_.needs_session()) {
+			this->session_ = std::make_shared<Session>();
+			if (!this->session_->isValid()) {
+				this->session_ = nullptr;
+				throw std::runtime_error("Failed to initialize session. Is Varjo system running?");
+			}
+		}
+
+		// セグメントの時間の区切りは，この記録で最初に届いたレコードの時刻から数える
+		Segmentation::reset_shared_epoch();
+
+		// 各sourceが出力先の手前にリングを挟めるよう先に作る
+		if (this->config_.dashcam.enabled) {
+			this->dashcam_ = std::make_shared<Dashcam::Trigger>(this->config_.dashcam.ring);
+			this->dashcam_events_.clear();
+		}
+
+		this->opened_ = true;
+		try {
+			for (const auto& source : this->config_.sources) {
+				switch (source.type) {
+				case SourceType::VST:
+					this->open_vst(source);
+					break;
+				case SourceType::Gaze:
+					this->open_gaze(source);
+					break;
+				case SourceType::FrameInfo:
+					this->open_frame_info(source);
+					break;
+				case SourceType::Timestamp:
+					this->open_timestamp(source);
+					break;
+				}
+			}
+
+			// 全ての出力先が動き始めてから見始める
+			if (this->config_.overload.enabled) {
+				this->open_overload_controller();
+			}
+		}
+		catch (...) {
+			this->close();
+			throw;
+		}
+	}
+
+	void Pipeline::open_vst(const SourceConfig& source)
+	{
+		using namespace VarjoVSTFrame;
+
+		auto logger = std::make_unique<DataLogger>(source.width, source.height, source.row_stride, source.fanout_capacity);
+		if (this->dashcam_ != nullptr) {
+			logger->set_dashcam(this->dashcam_);
+		}
+
+		for (const auto& sink : source.sinks) {
+			const bool parallel = sink.mode == SinkMode::Parallel;
+
+			switch (sink.type) {
+			case SinkType::VideoWriter:
+				logger->open_VideoWriter(VideoWriterOptions{
+					.writer_type = parallel ? VideoWriterType::Parallel : VideoWriterType::Serial,
+					.write_channel_index = sink.channels,
+					.vw_encode_opt = make_VideoWriteEncodeOptions(
+						source.width, source.height, sink.fps, sink.path, sink.container, sink.encoder),
+					.row_stride = source.row_stride,
+					.pad_opt = InputFramedataPaddingOption::WithoutPadding,
+					.segment = this->config_.segment,
+					.adaptive = sink.adaptive
+				}, sink.subscriber);
+				break;
+			case SinkType::VideoPreviewer:
+				logger->open_VideoPreviewer(VideoPreviewerOptions{
+					.previewer_type = parallel ? VideoPreviewerType::Parallel : VideoPreviewerType::Serial,
+					.preview_channel_flag = sink.channels,
+					.width = source.width,
+					.height = source.height,
+					.row_stride = source.row_stride,
+					.pad_opt = InputFramedataPaddingOption::WithoutPadding,
+					.buffer_size = sink.buffer_size
+				}, sink.subscriber);
+				break;
+			case SinkType::MetadataWriter:
+				logger->open_MetadataWriter(MetadataWriterOptions{
+					.writer_type = parallel ? VarjoVSTMetadataWriterType::Parallel : VarjoVSTMetadataWriterType::Serial,
+					.write_channel_flag = sink.channels,
+					.out_path = sink.path,
+					.segment = this->config_.segment
+				}, sink.subscriber);
+				break;
+			default:
+				throw std::logic_error("Pipeline: unsupported sink for vst source " + source.id);
+			}
+		}
+
+		if (source.dummy_input) {
+			logger->open_dataStreamer(std::make_unique<VarjoVSTDummyCamStreamer>(source.channels, source.buffer_capacity, source.dummy_fps));
+		} else {
+			logger->open_dataStreamer(VarjoVSTCamStreamerOptions{
+				.session = this->session_,
+				.chnls = source.channels,
+				.buffer_capacity = source.buffer_capacity
+			});
+		}
+
+		// 閉じる対象に入れてから開始する
+		auto& component = this->vst_.emplace_back(Component<DataLogger>{ source.id, std::move(logger) });
+		component.logger->start_logging();
+	}
+
+	void Pipeline::open_gaze(const SourceConfig& source)
+	{
+		using namespace VarjoEyeTracking;
+
+		const auto& sink = source.sinks.front();
+		auto& component = this->gaze_.emplace_back(Component<EyeTrackingDataLogger>{ source.id, std::make_unique<EyeTrackingDataLogger>() });
+
+		const auto format = sink.type == SinkType::Binary ? RecordSchema::RecordFormat::Binary : RecordSchema::RecordFormat::Csv;
+		std::unique_ptr<EyeTrackingDataCsvWriter> writer;
+		if (sink.mode == SinkMode::Parallel) {
+			writer = std::make_unique<EyeTrackingDataParallelCsvWriter>(sink.path, format, this->config_.segment);
+		} else {
+			writer = std::make_unique<EyeTrackingDataSerialCsvWriter>(sink.path, format, this->config_.segment);
+		}
+		if (!component.logger->open_EyeTrackingDataWriter(std::move(writer))) {
+			throw std::runtime_error("Failed to open gaze writer for " + source.id + ": " + sink.path);
+		}
+		if (this->dashcam_ != nullptr) {
+			const auto event = this->config_.dashcam.gaze_event;
+			component.logger->set_dashcam(this->dashcam_, make_gaze_trigger_condition(event),
+				event == GazeTriggerEvent::Blink ? "gaze_blink" : "gaze_tracking_lost");
+		}
+
+		component.logger->open_dataStreamer(EyeTrackingDataStreamerOptions{
+			.session = this->session_,
+			.outputFilterType = source.gaze_filter,
+			.outputFrequency = source.gaze_frequency
+		});
+	}
+
+	void Pipeline::open_frame_info(const SourceConfig& source)
+	{
+		using namespace VarjoFrameInfo;
+
+		const auto& sink = source.sinks.front();
+		auto& component = this->frame_info_.emplace_back(Component<DataLogger>{
+			source.id, std::make_unique<DataLogger>(source.queue_capacity, source.check_interval_ms) });
+
+		const FrameInfoDataStreamerOptions dstream_opt{
+			.session = this->session_,
+			.fov_refresh_interval_frames = source.fov_refresh_interval_frames
+		};
+		const bool parallel = sink.mode == SinkMode::Parallel;
+
+		bool opened;
+		if (sink.type == SinkType::Binary) {
+			opened = component.logger->open(dstream_opt, DataBinaryWriterOptions{
+				.writer_type = parallel ? DataBinaryWriterType::Parallel : DataBinaryWriterType::Serial,
+				.out_path = sink.path,
+				.segment = this->config_.segment
+			});
+		} else {
+			opened = component.logger->open(dstream_opt,
+				make_DataCsvWriterOptions(parallel ? DataCsvWriterType::Parallel : DataCsvWriterType::Serial, sink.path, this->config_.segment));
+		}
+		if (!opened) {
+			throw std::runtime_error("Failed to open FrameInfo DataLogger for " + source.id + ": " + sink.path);
+		}
+	}
+
+	void Pipeline::open_timestamp(const SourceConfig& source)
+	{
+		const auto& sink = source.sinks.front();
+		auto& component = this->timestamp_.emplace_back(Component<Timestamp::DataLogger>{
+			source.id, std::make_unique<Timestamp::DataLogger>(source.check_interval_ms) });
+
+		const bool opened = component.logger->open(
+			Timestamp::DataStreamerOptions{
+				.session = this->session_,
+				.separate_ms = 100,
+				.sampler = source.sampler
+			},
+			Timestamp::CsvWriterOptions{
+				.type = sink.mode == SinkMode::Parallel ? Timestamp::CsvWriterType::Parallel : Timestamp::CsvWriterType::Serial,
+				.path = sink.path,
+				.format = sink.type == SinkType::Binary ? RecordSchema::RecordFormat::Binary : RecordSchema::RecordFormat::Csv,
+				.segment = this->config_.segment
+			});
+		if (!opened) {
+			throw std::runtime_error("Failed to open Timestamp DataLogger for " + source.id + ": " + sink.path);
+		}
+	}
+
+	void Pipeline::run()
+	{
+		if (!this->opened_) {
+			throw std::runtime_error("Pipeline is not opened.");
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		const auto duration = std::chrono::duration<double>(this->config_.stop.duration_s);
+		const DashcamConfig& dc = this->config_.dashcam;
+		bool space_down = false;
+
+		while (true) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+			if (this->dashcam_ != nullptr) {
+				// 押し続けている間に何度も引かないよう，押した瞬間だけ引く
+				const bool down = dc.on_space_key && (GetAsyncKeyState(VK_SPACE) & 0x8000);
+				if (down && !space_down) {
+					this->trigger("key");
+				}
+				space_down = down;
+
+				std::error_code ec;
+				if (!dc.marker_file.empty() && std::filesystem::remove(dc.marker_file, ec)) {
+					this->trigger("marker");
+				}
+			}
+
+			if (this->config_.stop.on_enter_key && (GetAsyncKeyState(VK_RETURN) & 0x8000)) {
+				break;
+			}
+			if (this->config_.stop.duration_s > 0.0 && std::chrono::steady_clock::now() - start >= duration) {
+				break;
+			}
+		}
+	}
+
+	bool Pipeline::trigger(const std::string& reason)
+	{
+		if (this->dashcam_ == nullptr) {
+			return false;
+		}
+		this->dashcam_->fire(reason);
+		return true;
+	}
+
+	void Pipeline::close()
+	{
+		if (!this->opened_) {
+			return;
+		}
+		this->opened_ = false;
+
+		// 削った処理を戻してから止める(止める間に判断しないよう先に止める)
+		if (this->overload_ != nullptr) {
+			this->overload_->stop();
+			this->shed_decisions_ = this->overload_->decisions();
+			this->overload_ = nullptr;
+		}
+
+		// 開いた順に止める．各ロガーは積まれている分を書き終えてから戻る
+		for (auto& c : this->vst_) {
+			c.logger->end_logging();
+			c.logger->close();
+		}
+		for (auto& c : this->gaze_) {
+			c.logger->close();
+		}
+		for (auto& c : this->frame_info_) {
+			c.logger->close();
+		}
+		for (auto& c : this->timestamp_) {
+			c.logger->close();
+		}
+
+		if (this->dashcam_ != nullptr) {
+			this->dashcam_events_ = this->dashcam_->events();
+			this->dashcam_ = nullptr;
+		}
+	}
+
+	void Pipeline::open_overload_controller()
+	{
+		const OverloadConfig& oc = this->config_.overload;
+		auto controller = std::make_unique<Overload::OverloadController>(oc.controller);
+
+		// signal: 記録の出力先の遅れ・書き込み待ち・ディスク・gaze・メモリ
+		if (oc.max_queue_frames > 0) {
+			for (const auto& c : this->vst_) {
+				for (const auto& stats : c.logger->subscriber_stats()) {
+					if (stats.policy != FanoutPolicy::Lossless) {
+						continue;
+					}
+					controller->add_signal(c.id + "/" + stats.name + ".lag",
+						[logger = c.logger.get(), name = stats.name, max = oc.max_queue_frames] {
+							for (const auto& s : logger->subscriber_stats()) {
+								if (s.name == name) return static_cast<double>(s.lag) / max;
+							}
+							return 0.0;
+						});
+				}
+			}
+			controller->add_signal("vst_video_writer_queue", Overload::gauge_probe("vst_video_writer_queue", oc.max_queue_frames));
+			controller->add_signal("vst_metadata_writer_queue", Overload::gauge_probe("vst_metadata_writer_queue", oc.max_queue_frames));
+		}
+		if (oc.max_io_blocks > 0) {
+			controller->add_signal("async_io_pending_blocks", Overload::gauge_probe("async_io_pending_blocks", oc.max_io_blocks));
+		}
+		if (oc.max_gaze_queue > 0 && !this->gaze_.empty()) {
+			controller->add_signal("gaze_logger_queue", Overload::gauge_probe("gaze_logger_queue", oc.max_gaze_queue));
+		}
+		if (oc.max_write_latency_ms > 0) {
+			controller->add_signal("vst_video_pipe_write_p99", Overload::latency_probe("vst_video_pipe_write_ns", oc.max_write_latency_ms));
+		}
+		if (this->config_.memory.limit_bytes > 0) {
+			controller->add_signal("memory_budget", [] {
+				const auto& budget = Memory::MemoryBudget::shared();
+				return static_cast<double>(budget.used()) / static_cast<double>(budget.limit());
+			});
+		}
+
+		// action: 指定の順に削る．対象の出力先がないものは飛ばす
+		for (const ShedAction action : oc.order) {
+			bool applicable = false;
+			switch (action) {
+			case ShedAction::Preview:
+				this->for_each_vst_sink(SinkType::VideoPreviewer, [&](auto&, const auto&) { applicable = true; });
+				if (applicable) {
+					controller->add_action(to_string(action), [this](const bool engage) {
+						this->for_each_vst_sink(SinkType::VideoPreviewer, [engage](VarjoVSTFrame::DataLogger& logger, const std::string& name) {
+							logger.set_subscriber_decimation(name, engage ? 0 : 1);
+						});
+					});
+				}
+				break;
+			case ShedAction::Metadata:
+				this->for_each_vst_sink(SinkType::MetadataWriter, [&](auto&, const auto&) { applicable = true; });
+				if (applicable) {
+					controller->add_action(to_string(action), [this, keep = oc.metadata_keep_every](const bool engage) {
+						this->for_each_vst_sink(SinkType::MetadataWriter, [engage, keep](VarjoVSTFrame::DataLogger& logger, const std::string& name) {
+							logger.set_subscriber_decimation(name, engage ? keep : 1);
+						});
+					});
+				}
+				break;
+			case ShedAction::Encoder:
+				// ffmpegを起動し直して反映するため，セグメントに区切っているかadaptiveの場合のみ
+				this->for_each_vst_sink(SinkType::VideoWriter, [&](VarjoVSTFrame::DataLogger& logger, const auto&) { applicable = applicable || logger.can_change_encoder(); });
+				if (applicable) {
+					controller->add_action(to_string(action), [this, steps = oc.encoder_downgrade](const bool engage) {
+						for (auto& c : this->vst_) {
+							c.logger->set_encoder_downgrade(engage ? steps : 0);
+						}
+					});
+				}
+				break;
+			case ShedAction::Recording:
+				this->for_each_vst_sink(SinkType::VideoWriter, [&](auto&, const auto&) { applicable = true; });
+				if (applicable) {
+					controller->add_action(to_string(action), [this, keep = oc.recording_keep_every](const bool engage) {
+						this->for_each_vst_sink(SinkType::VideoWriter, [engage, keep](VarjoVSTFrame::DataLogger& logger, const std::string& name) {
+							logger.set_subscriber_decimation(name, engage ? keep : 1);
+						});
+					});
+				}
+				break;
+			}
+			if (!applicable) {
+				std::cerr << "Pipeline: overload action '" << to_string(action) << "' has nothing to shed in this configuration; skipped" << std::endl;
+			}
+		}
+
+		controller->start();
+		this->overload_ = std::move(controller);
+	}
+
+	void Pipeline::for_each_vst_sink(const SinkType type, const std::function<void(VarjoVSTFrame::DataLogger&, const std::string&)>& fn) const
+	{
+		for (const auto& c : this->vst_) {
+			for (const auto& source : this->config_.sources) {
+				if (source.id != c.id) {
+					continue;
+				}
+				for (const auto& sink : source.sinks) {
+					if (sink.type == type) {
+						fn(*c.logger, sink.subscriber.name);
+					}
+				}
+			}
+		}
+	}
+
+	void Pipeline::print_summary(std::ostream& os) const
+	{
+		for (const auto& c : this->vst_) {
+			for (const auto& stats : c.logger->subscriber_stats()) {
+				os << c.id << "/" << stats.name << ": delivered=" << stats.delivered << ", skipped=" << stats.skipped << ", lag=" << stats.lag << "\n";
+			}
+		}
+		for (const auto& c : this->frame_info_) {
+			os << c.id << ": streamed=" << c.logger->streamed_count() << ", dropped=" << c.logger->dropped_count() << "\n";
+		}
+		for (const auto& c : this->timestamp_) {
+			const auto jitter = c.logger->jitter_summary();
+			os << c.id << ": sampling jitter n=" << jitter.count << ", missed=" << jitter.missed
+				<< ", mean=" << jitter.mean_us << "us, p50=" << jitter.p50_us << "us, p99=" << jitter.p99_us
+				<< "us, p99.9=" << jitter.p999_us << "us, max=" << jitter.max_us << "us\n";
+		}
+
+		for (const auto& d : this->shed_decisions_) {
+			os << "overload: " << (d.engaged ? "shed " : "restore ") << d.action << " (level " << d.level << ", " << d.signal << "=" << d.load << ")\n";
+		}
+
+		for (const auto& e : this->dashcam_events_) {
+			os << "dashcam: " << e.reason << " at " << e.time_ns << " (window " << e.window_begin_ns << " - " << e.window_end_ns << ")\n";
+		}
+
+		const auto memory = Memory::MemoryBudget::shared().snapshot();
+		os << "memory: used=" << memory.used_bytes / (1024 * 1024) << "MB, limit=" << memory.limit_bytes / (1024 * 1024) << "MB\n";
+		for (const auto& account : memory.accounts) {
+			os << "memory/" << account.name << ": used=" << account.used_bytes / (1024 * 1024) << "MB, peak=" << account.peak_bytes / (1024 * 1024)
+				<< "MB, denied=" << account.denied << "\n";
+		}
+	}
+
+	std::unique_ptr<Pipeline> make_PipelinePtr(const PipelineConfig& config)
+	{
+		return std::make_unique<Pipeline>(config);
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <ostream>
+#include <functional>
+
+#include "PipelineConfig.hpp"
+
+#include "../VarjoExample/Session.hpp"
+#include "../VarjoVSTFrame/VSTFrameDataLogger.hpp"
+#include "../VarjoEyeTracking/EyeTrackingDataLogger.hpp"
+#include "../VarjoFrameInfo/FrameInfoDataLogger.hpp"
+#include "../VarjoTimestamp/TimestampDataLogger.hpp"
+#include "../util/OverloadController.hpp"
+#include "../util/DashcamRing.hpp"
+
+namespace VarjoPipeline {
+
+	/**
+	 * @brief PipelineConfigの各sourceを既存のDataLoggerで組み立てて動かす
+	 * @detail open → run(停止条件まで待つ) → close の順に呼ぶ．closeはデストラクタでも呼ばれる．
+	 */
+	class Pipeline {
+
+	public:
+		explicit Pipeline(PipelineConfig config);
+
+		~Pipeline();
+
+		Pipeline(const Pipeline&) = delete;
+		Pipeline& operator=(const Pipeline&) = delete;
+
+		/**
+		 * @brief セッションを開始し(必要な場合のみ)，全てのsourceと出力先を開いて記録を始める
+		 * @detail 途中で失敗した場合は開いた分を閉じてから例外を投げる
+		 */
+		void open();
+
+		/**
+		 * @brief 停止条件(Enterキー・経過時間)を満たすまでブロックする．dashcamのときはスペースキーとmarker_fileも見てtriggerを引く
+		 */
+		void run();
+
+		/**
+		 * @brief dashcamのtriggerを引き，今の前後の窓を書き出す．どのスレッドから呼んでもよい
+		 * @return dashcamを指定していなければ何もせずfalse
+		 */
+		bool trigger(const std::string& reason = "api");
+
+		/**
+		 * @brief 記録を止め，積まれている分を書き終えてから閉じる
+		 */
+		void close();
+
+		/**
+		 * @brief 購読者の遅れ・破棄数・サンプリングのジッタ・過負荷で削った判断・dashcamの窓・メモリ予算を表示する．closeの後に呼ぶ
+		 */
+		void print_summary(std::ostream& os) const;
+
+		const PipelineConfig& config() const { return this->config_; }
+
+	private:
+		void open_vst(const SourceConfig& source);
+		void open_gaze(const SourceConfig& source);
+		void open_frame_info(const SourceConfig& source);
+		void open_timestamp(const SourceConfig& source);
+		void open_overload_controller();
+
+		/**
+		 * @brief vst sourceのうち，typeの出力先を持つものそれぞれについてfn(logger, 購読者名)を呼ぶ
+		 */
+		void for_each_vst_sink(const SinkType type, const std::function<void(VarjoVSTFrame::DataLogger&, const std::string&)>& fn) const;
+
+		template <typename Logger>
+		struct Component {
+			std::string id;
+			std::unique_ptr<Logger> logger;
+		};
+
+	private:
+		const PipelineConfig config_;
+		std::shared_ptr<Session> session_;
+		bool opened_ = false;
+
+		std::shared_ptr<Dashcam::Trigger> dashcam_;		// 全ての出力先のリングで共有する．dashcamのときのみ
+		std::vector<Dashcam::TriggerEvent> dashcam_events_;		// closeの時点で取り出しておく
+
+		std::vector<Component<VarjoVSTFrame::DataLogger>> vst_;
+		std::vector<Component<VarjoEyeTracking::EyeTrackingDataLogger>> gaze_;
+		std::vector<Component<VarjoFrameInfo::DataLogger>> frame_info_;
+		std::vector<Component<Timestamp::DataLogger>> timestamp_;
+
+		std::unique_ptr<Overload::OverloadController> overload_;
+		std::vector<Overload::ShedDecision> shed_decisions_;		// closeの時点で取り出しておく
+	};
+
+	std::unique_ptr<Pipeline> make_PipelinePtr(const PipelineConfig& config);
+}
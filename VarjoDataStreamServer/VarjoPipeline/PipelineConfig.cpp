@@ -0,0 +1,689 @@
+#include <fstream>
+#include <set>
+#include <map>
+#include <limits>
+#include <filesystem>
+#include <algorithm>
+
+#include "PipelineConfig.hpp"
+
+namespace {
+	using nlohmann::json;
+	using namespace VarjoPipeline;
+
+	template <typename E>
+	using NameTable = std::vector<std::pair<const char*, E>>;
+
+	const NameTable<SourceType> source_types = {
+		{ "vst", SourceType::VST }, { "gaze", SourceType::Gaze },
+		{ "frame_info", SourceType::FrameInfo }, { "timestamp", SourceType::Timestamp }
+	};
+
+	const NameTable<SinkType> sink_types = {
+		{ "video_writer", SinkType::VideoWriter }, { "video_previewer", SinkType::VideoPreviewer },
+		{ "metadata_writer", SinkType::MetadataWriter }, { "csv", SinkType::Csv }, { "binary", SinkType::Binary }
+	};
+
+	const NameTable<SinkMode> sink_modes = {
+		{ "serial", SinkMode::Serial }, { "parallel", SinkMode::Parallel }
+	};
+
+	const NameTable<varjo_ChannelFlag> channel_flags = {
+		{ "left", varjo_ChannelFlag_Left }, { "right", varjo_ChannelFlag_Right },
+		{ "both", varjo_ChannelFlag_Left | varjo_ChannelFlag_Right }
+	};
+
+	const NameTable<FanoutPolicy> fanout_policies = {
+		{ "lossless", FanoutPolicy::Lossless }, { "latest_only", FanoutPolicy::LatestOnly }, { "decimate", FanoutPolicy::Decimate }
+	};
+
+	const NameTable<ShedAction> shed_actions = {
+		{ "preview", ShedAction::Preview }, { "metadata", ShedAction::Metadata },
+		{ "encoder", ShedAction::Encoder }, { "recording", ShedAction::Recording }
+	};
+
+	const NameTable<VarjoVSTFrame::VideoContainer> containers = {
+		{ "mp4", VarjoVSTFrame::VideoContainer::mp4 }, { "mkv", VarjoVSTFrame::VideoContainer::mkv }
+	};
+
+	const NameTable<VarjoEyeTracking::OutputFilterType> gaze_filters = {
+		{ "none", VarjoEyeTracking::OutputFilterType::NONE }, { "standard", VarjoEyeTracking::OutputFilterType::STANDARD }
+	};
+
+	const NameTable<VarjoEyeTracking::OutputFrequency> gaze_frequencies = {
+		{ "maximum", VarjoEyeTracking::OutputFrequency::MAXIMUM },
+		{ "100hz", VarjoEyeTracking::OutputFrequency::_100HZ }, { "200hz", VarjoEyeTracking::OutputFrequency::_200HZ }
+	};
+
+	const NameTable<VarjoEyeTracking::GazeTriggerEvent> gaze_trigger_events = {
+		{ "none", VarjoEyeTracking::GazeTriggerEvent::None }, { "blink", VarjoEyeTracking::GazeTriggerEvent::Blink },
+		{ "tracking_lost", VarjoEyeTracking::GazeTriggerEvent::TrackingLost }
+	};
+
+	const NameTable<Sampling::SleepMode> sleep_modes = {
+		{ "sleep", Sampling::SleepMode::Sleep }, { "hybrid", Sampling::SleepMode::Hybrid }, { "spin", Sampling::SleepMode::Spin }
+	};
+
+	using X264 = VarjoVSTFrame::X264Options;
+	using Nvenc = VarjoVSTFrame::NvencH264Options;
+
+	const NameTable<X264::X264Preset> x264_presets = {
+		{ "ultrafast", X264::X264Preset::Ultrafast }, { "superfast", X264::X264Preset::Superfast },
+		{ "veryfast", X264::X264Preset::Veryfast }, { "faster", X264::X264Preset::Faster },
+		{ "fast", X264::X264Preset::Fast }, { "medium", X264::X264Preset::Medium },
+		{ "slow", X264::X264Preset::Slow }, { "slower", X264::X264Preset::Slower }, { "veryslow", X264::X264Preset::Veryslow }
+	};
+
+	const NameTable<X264::Mode> x264_modes = {
+		{ "crf", X264::Mode::Crf }, { "qp", X264::Mode::Qp }
+	};
+
+	const NameTable<Nvenc::NvencPreset> nvenc_presets = {
+		{ "p1", Nvenc::NvencPreset::P1 }, { "p2", Nvenc::NvencPreset::P2 }, { "p3", Nvenc::NvencPreset::P3 },
+		{ "p4", Nvenc::NvencPreset::P4 }, { "p5", Nvenc::NvencPreset::P5 }, { "p6", Nvenc::NvencPreset::P6 },
+		{ "p7", Nvenc::NvencPreset::P7 }
+	};
+
+	const NameTable<Nvenc::NvencRc> nvenc_rcs = {
+		{ "vbr_hq", Nvenc::NvencRc::VbrHq }, { "const_qp", Nvenc::NvencRc::ConstQp }
+	};
+
+	template <typename E>
+	const char* name_of(const NameTable<E>& table, const E value) {
+		for (const auto& [name, v] : table) {
+			if (v == value) return name;
+		}
+		return "?";
+	}
+
+	template <typename E>
+	std::string names_of(const NameTable<E>& table) {
+		std::string out;
+		for (const auto& [name, v] : table) {
+			if (!out.empty()) out += ", ";
+			out += name;
+		}
+		return out;
+	}
+
+	/**
+	 * @brief JSONオブジェクトを読み，誤りをpath付きでerrorsに溜める．finish()で読まなかったキーを未知のキーとして報告する
+	 */
+	class ObjectReader {
+
+	public:
+		ObjectReader(const json& j, std::string path, std::vector<std::string>& errors)
+			: j_(j), path_(std::move(path)), errors_(errors)
+		{
+			if (!this->j_.is_object()) {
+				this->errors_.push_back(this->path_ + ": expected an object, got " + this->j_.type_name());
+			}
+		}
+
+		bool is_object() const { return this->j_.is_object(); }
+
+		std::string path_of(const char* key) const {
+			return this->path_.empty() ? key : this->path_ + "." + key;
+		}
+
+		void error(const char* key, const std::string& message) {
+			this->errors_.push_back(this->path_of(key) + ": " + message);
+		}
+
+		/**
+		 * @brief キーの値．ないかオブジェクトでない場合はnullptr
+		 */
+		const json* find(const char* key) {
+			if (!this->j_.is_object()) {
+				return nullptr;
+			}
+			auto it = this->j_.find(key);
+			if (it == this->j_.end()) {
+				return nullptr;
+			}
+			this->used_.insert(key);
+			return &*it;
+		}
+
+		const json* require(const char* key) {
+			const json* v = this->find(key);
+			if (v == nullptr && this->j_.is_object()) {
+				this->error(key, "required");
+			}
+			return v;
+		}
+
+		void read(const char* key, bool& out) {
+			if (const json* v = this->find(key)) {
+				if (!v->is_boolean()) {
+					this->error(key, std::string("expected a boolean, got ") + v->type_name());
+					return;
+				}
+				out = v->get<bool>();
+			}
+		}
+
+		void read(const char* key, std::string& out, const bool required = false) {
+			if (const json* v = required ? this->require(key) : this->find(key)) {
+				if (!v->is_string()) {
+					this->error(key, std::string("expected a string, got ") + v->type_name());
+					return;
+				}
+				out = v->get<std::string>();
+			}
+		}
+
+		template <typename T>
+		void read_integer(const char* key, T& out, const int64_t min, const int64_t max) {
+			if (const json* v = this->find(key)) {
+				if (!v->is_number_integer()) {
+					this->error(key, std::string("expected an integer, got ") + v->type_name());
+					return;
+				}
+				const int64_t n = v->get<int64_t>();
+				if (n < min || n > max) {
+					this->error(key, "must be in [" + std::to_string(min) + ", " + std::to_string(max) + "], got " + std::to_string(n));
+					return;
+				}
+				out = static_cast<T>(n);
+			}
+		}
+
+		void read_number(const char* key, double& out, const double min, const double max) {
+			if (const json* v = this->find(key)) {
+				if (!v->is_number()) {
+					this->error(key, std::string("expected a number, got ") + v->type_name());
+					return;
+				}
+				const double d = v->get<double>();
+				if (d < min || d > max) {
+					this->error(key, "must be in [" + std::to_string(min) + ", " + std::to_string(max) + "], got " + std::to_string(d));
+					return;
+				}
+				out = d;
+			}
+		}
+
+		template <typename E>
+		bool read_enum(const char* key, E& out, const NameTable<E>& table, const bool required = false) {
+			std::string name;
+			const size_t n_errors = this->errors_.size();
+			this->read(key, name, required);
+			if (name.empty()) {
+				return this->errors_.size() == n_errors && !required;
+			}
+			for (const auto& [n, v] : table) {
+				if (name == n) {
+					out = v;
+					return true;
+				}
+			}
+			this->error(key, "unknown value '" + name + "' (expected one of: " + names_of(table) + ")");
+			return false;
+		}
+
+		/**
+		 * @brief 読まなかったキーを報告する(綴りの誤りで既定値のまま動くのを防ぐ)
+		 */
+		void finish() {
+			if (!this->j_.is_object()) {
+				return;
+			}
+			for (auto it = this->j_.begin(); it != this->j_.end(); ++it) {
+				if (!this->used_.contains(it.key())) {
+					this->errors_.push_back(this->path_of(it.key().c_str()) + ": unknown key");
+				}
+			}
+		}
+
+	private:
+		const json& j_;
+		const std::string path_;
+		std::vector<std::string>& errors_;
+		std::set<std::string> used_;
+	};
+
+	constexpr int64_t max_int = std::numeric_limits<int>::max();
+	constexpr int64_t max_size = int64_t(1) << 40;
+
+	VarjoVSTFrame::AdaptiveRateOptions parse_adaptive(const json& j, const std::string& path, std::vector<std::string>& errors)
+	{
+		ObjectReader r(j, path, errors);
+		VarjoVSTFrame::AdaptiveRateOptions adaptive{ .enabled = true };
+		r.read_enum("fastest", adaptive.fastest, x264_presets);
+		r.read_enum("slowest", adaptive.slowest, x264_presets);
+		if (adaptive.fastest > adaptive.slowest) {
+			r.error("slowest", "must not be faster than fastest");
+		}
+		r.read_integer("interval_frames", adaptive.interval_frames, 0, 100000);
+		r.read_integer("raise_backlog", adaptive.raise_backlog, 1, 100000);
+		r.read_integer("lower_backlog", adaptive.lower_backlog, 0, 100000);
+		if (adaptive.lower_backlog >= adaptive.raise_backlog) {
+			r.error("lower_backlog", "must be less than raise_backlog");
+		}
+		r.read_integer("hold_intervals", adaptive.hold_intervals, 1, 10000);
+		r.finish();
+		return adaptive;
+	}
+
+	VarjoVSTFrame::EncodeOptions parse_encoder(const json& j, const std::string& path, VarjoVSTFrame::AdaptiveRateOptions& adaptive, std::vector<std::string>& errors)
+	{
+		ObjectReader r(j, path, errors);
+		std::string codec = "x264";
+		r.read("codec", codec);
+
+		VarjoVSTFrame::EncodeOptions encoder = X264{};
+		if (codec == "x264") {
+			X264 opt;
+			r.read_enum("preset", opt.preset, x264_presets);
+			r.read_enum("mode", opt.mode, x264_modes);
+			r.read_integer("crf", opt.crf, 0, 51);
+			r.read_integer("qp", opt.qp, 0, 69);
+			if (const json* a = r.find("adaptive")) {
+				adaptive = parse_adaptive(*a, r.path_of("adaptive"), errors);
+			}
+			encoder = opt;
+		} else if (codec == "nvenc") {
+			Nvenc opt;
+			r.read_enum("preset", opt.preset, nvenc_presets);
+			r.read_enum("rc", opt.rc, nvenc_rcs);
+			r.read_integer("cq", opt.cq, 0, 51);
+			r.read_integer("qp", opt.qp, 0, 51);
+			r.read("spatial_aq", opt.spatial_aq);
+			r.read("temporal_aq", opt.temporal_aq);
+			encoder = opt;
+		} else if (codec == "ffv1") {
+			VarjoVSTFrame::Ffv1Options opt;
+			r.read_integer("level", opt.level, 0, 3);
+			encoder = opt;
+		} else {
+			r.error("codec", "unknown value '" + codec + "' (expected one of: x264, nvenc, ffv1)");
+		}
+		if (codec != "x264" && r.find("adaptive") != nullptr) {
+			r.error("adaptive", "only supported for codec x264");
+		}
+		r.finish();
+		return encoder;
+	}
+
+	SinkConfig parse_sink(const json& j, const std::string& path, const SourceConfig& source, std::vector<std::string>& errors)
+	{
+		ObjectReader r(j, path, errors);
+		SinkConfig sink{ .type = SinkType::Csv };
+		if (!r.read_enum("type", sink.type, sink_types, true)) {
+			// 種類が分からなければ他のキーの正否も決められない
+			return sink;
+		}
+		r.read_enum("mode", sink.mode, sink_modes);
+		r.read("path", sink.path, sink.type != SinkType::VideoPreviewer);
+
+		if (source.type == SourceType::VST) {
+			sink.channels = source.channels;	// 省略時はsourceが流すチャンネル全て
+			sink.subscriber.name = to_string(sink.type);
+			sink.subscriber.policy = sink.type == SinkType::VideoPreviewer ? FanoutPolicy::LatestOnly : FanoutPolicy::Lossless;
+			r.read_enum("policy", sink.subscriber.policy, fanout_policies);
+			r.read_number("decimate_hz", sink.subscriber.decimate_hz, 0.0, 1000.0);
+			if (sink.subscriber.policy == FanoutPolicy::Decimate && sink.subscriber.decimate_hz <= 0.0) {
+				r.error("decimate_hz", "required (> 0) when policy is decimate");
+			}
+			r.read_enum("channels", sink.channels, channel_flags);
+		}
+
+		if (sink.type == SinkType::VideoWriter) {
+			r.read_integer("fps", sink.fps, 1, 1000);
+			r.read_enum("container", sink.container, containers);
+			if (const json* e = r.find("encoder")) {
+				sink.encoder = parse_encoder(*e, r.path_of("encoder"), sink.adaptive, errors);
+			}
+		}
+		if (sink.type == SinkType::VideoPreviewer) {
+			r.read_integer("buffer_size", sink.buffer_size, 1, 1024);
+		}
+
+		r.finish();
+		return sink;
+	}
+
+	SourceConfig parse_source(const json& j, const std::string& path, std::vector<std::string>& errors)
+	{
+		ObjectReader r(j, path, errors);
+		SourceConfig source{ .type = SourceType::VST };
+		r.read("id", source.id, true);
+		if (!r.read_enum("type", source.type, source_types, true)) {
+			return source;
+		}
+
+		switch (source.type) {
+		case SourceType::VST: {
+			std::string input = "device";
+			r.read("input", input);
+			if (input == "dummy") {
+				source.dummy_input = true;
+			} else if (input != "device") {
+				r.error("input", "unknown value '" + input + "' (expected one of: device, dummy)");
+			}
+			r.read_number("dummy_fps", source.dummy_fps, 0.1, 10000.0);
+			r.read_enum("channels", source.channels, channel_flags);
+			r.read_integer("width", source.width, 2, 16384);
+			r.read_integer("height", source.height, 2, 16384);
+			r.read_integer("row_stride", source.row_stride, 2, 65536);
+			r.read_integer("buffer_capacity", source.buffer_capacity, 1, 4096);
+			r.read_integer("fanout_capacity", source.fanout_capacity, 2, 4096);
+			break;
+		}
+		case SourceType::Gaze:
+			r.read_enum("filter", source.gaze_filter, gaze_filters);
+			r.read_enum("frequency", source.gaze_frequency, gaze_frequencies);
+			break;
+		case SourceType::FrameInfo:
+			r.read_integer("queue_capacity", source.queue_capacity, 2, max_size);
+			r.read_integer("check_interval_ms", source.check_interval_ms, 1, 60000);
+			r.read_integer("fov_refresh_interval_frames", source.fov_refresh_interval_frames, 0, max_int);
+			break;
+		case SourceType::Timestamp: {
+			source.check_interval_ms = 1000;
+			r.read_integer("check_interval_ms", source.check_interval_ms, 1, 60000);
+			int64_t period_us = std::chrono::duration_cast<std::chrono::microseconds>(source.sampler.period).count();
+			int64_t spin_window_us = std::chrono::duration_cast<std::chrono::microseconds>(source.sampler.spin_window).count();
+			r.read_integer("period_us", period_us, 1, 60000000);
+			r.read_integer("spin_window_us", spin_window_us, 0, 60000000);
+			r.read_enum("sleep_mode", source.sampler.mode, sleep_modes);
+			source.sampler.period = std::chrono::microseconds(period_us);
+			source.sampler.spin_window = std::chrono::microseconds(spin_window_us);
+			break;
+		}
+		}
+
+		if (const json* sinks = r.require("sinks")) {
+			if (!sinks->is_array()) {
+				r.error("sinks", std::string("expected an array, got ") + sinks->type_name());
+			} else {
+				for (size_t i = 0; i < sinks->size(); ++i) {
+					source.sinks.push_back(parse_sink((*sinks)[i], r.path_of("sinks") + "[" + std::to_string(i) + "]", source, errors));
+				}
+			}
+		}
+
+		r.finish();
+		return source;
+	}
+
+	/**
+	 * @brief sourceの種類ごとに使える出力先
+	 */
+	bool is_allowed_sink(const SourceType source, const SinkType sink) {
+		switch (source) {
+		case SourceType::VST:
+			return sink == SinkType::VideoWriter || sink == SinkType::VideoPreviewer || sink == SinkType::MetadataWriter;
+		case SourceType::FrameInfo:
+		case SourceType::Gaze:
+		case SourceType::Timestamp:
+			return sink == SinkType::Csv || sink == SinkType::Binary;
+		}
+		return false;
+	}
+
+	std::string join_lines(const std::vector<std::string>& errors) {
+		std::string out = "invalid pipeline config:";
+		for (const auto& e : errors) {
+			out += "\n  " + e;
+		}
+		return out;
+	}
+}
+
+namespace VarjoPipeline {
+
+	const char* to_string(const SourceType type)
+	{
+		return name_of(source_types, type);
+	}
+
+	const char* to_string(const SinkType type)
+	{
+		return name_of(sink_types, type);
+	}
+
+	const char* to_string(const ShedAction action)
+	{
+		return name_of(shed_actions, action);
+	}
+
+	bool PipelineConfig::needs_session() const
+	{
+		for (const auto& source : this->sources) {
+			if (!(source.type == SourceType::VST && source.dummy_input)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	PipelineConfigError::PipelineConfigError(const std::vector<std::string>& errors)
+		: std::runtime_error(join_lines(errors)), errors_(errors)
+	{}
+
+	PipelineConfig parse_PipelineConfig(const nlohmann::json& j)
+	{
+		std::vector<std::string> errors;
+		PipelineConfig config;
+
+		ObjectReader r(j, "", errors);
+
+		if (const json* ex = r.find("executor")) {
+			ObjectReader er(*ex, "executor", errors);
+			er.read_integer("cpu_threads", config.executor.cpu_threads, 0, 256);
+			er.read_integer("io_threads", config.executor.io_threads, 1, 256);
+			er.finish();
+		}
+
+		if (const json* stop = r.find("stop")) {
+			ObjectReader sr(*stop, "stop", errors);
+			std::string key = "enter";
+			sr.read("key", key);
+			if (key == "none") {
+				config.stop.on_enter_key = false;
+			} else if (key != "enter") {
+				sr.error("key", "unknown value '" + key + "' (expected one of: enter, none)");
+			}
+			sr.read_number("duration_s", config.stop.duration_s, 0.0, 7.0 * 24 * 3600);
+			sr.finish();
+		}
+
+		if (const json* segment = r.find("segment")) {
+			ObjectReader gr(*segment, "segment", errors);
+			double max_mb = 0.0;
+			gr.read_number("duration_s", config.segment.duration_s, 0.0, 24.0 * 3600);
+			gr.read_number("max_mb", max_mb, 0.0, 1024.0 * 1024);
+			config.segment.max_bytes = static_cast<uint64_t>(max_mb * 1024 * 1024);
+			gr.finish();
+		}
+
+		if (const json* memory = r.find("memory")) {
+			ObjectReader mr(*memory, "memory", errors);
+			double limit_mb = 0.0;
+			mr.read_number("limit_mb", limit_mb, 0.0, 1024.0 * 1024);
+			mr.read_number("preview_high_water", config.memory.preview_high_water, 0.0, 1.0);
+			config.memory.limit_bytes = static_cast<uint64_t>(limit_mb * 1024 * 1024);
+			mr.finish();
+		}
+
+		if (const json* overload = r.find("overload")) {
+			ObjectReader lr(*overload, "overload", errors);
+			OverloadConfig& oc = config.overload;
+			oc.enabled = true;
+			if (const json* order = lr.find("order")) {
+				if (!order->is_array()) {
+					lr.error("order", std::string("expected an array, got ") + order->type_name());
+				} else {
+					oc.order.clear();
+					for (size_t i = 0; i < order->size(); ++i) {
+						const json& item = (*order)[i];
+						const std::string path = lr.path_of("order") + "[" + std::to_string(i) + "]";
+						bool found = false;
+						for (const auto& [name, action] : shed_actions) {
+							if (item.is_string() && item.get<std::string>() == name) {
+								if (std::find(oc.order.begin(), oc.order.end(), action) != oc.order.end()) {
+									errors.push_back(path + ": '" + name + "' is listed twice");
+								}
+								oc.order.push_back(action);
+								found = true;
+							}
+						}
+						if (!found) {
+							errors.push_back(path + ": expected one of: " + names_of(shed_actions));
+						}
+					}
+				}
+			}
+			lr.read_integer("period_ms", oc.controller.period_ms, 1, 60 * 1000);
+			lr.read_integer("engage_after", oc.controller.engage_after, 1, 1000);
+			lr.read_integer("release_after", oc.controller.release_after, 1, 100000);
+			lr.read_number("release_below", oc.controller.release_below, 0.0, 1.0);
+			lr.read("log", oc.controller.log_path);
+			lr.read_number("max_queue_frames", oc.max_queue_frames, 0.0, 1e9);
+			lr.read_number("max_io_blocks", oc.max_io_blocks, 0.0, 1e9);
+			lr.read_number("max_gaze_queue", oc.max_gaze_queue, 0.0, 1e9);
+			lr.read_number("max_write_latency_ms", oc.max_write_latency_ms, 0.0, 60.0 * 1000);
+			lr.read_integer("metadata_keep_every", oc.metadata_keep_every, 0, 1000);
+			lr.read_integer("encoder_downgrade", oc.encoder_downgrade, 0, 8);
+			lr.read_integer("recording_keep_every", oc.recording_keep_every, 0, 1000);
+			lr.finish();
+		}
+
+		if (const json* dashcam = r.find("dashcam")) {
+			ObjectReader dr(*dashcam, "dashcam", errors);
+			DashcamConfig& dc = config.dashcam;
+			dc.enabled = true;
+			dr.read_number("pre_s", dc.ring.pre_s, 0.0, 3600.0);
+			dr.read_number("post_s", dc.ring.post_s, 0.0, 3600.0);
+			dr.read("compress", dc.ring.compress);
+			dr.read_integer("catchup", dc.ring.catchup, 1, 1000);
+			dr.read("log", dc.ring.log_path);
+			std::string key = "space";
+			dr.read("key", key);
+			if (key == "none") {
+				dc.on_space_key = false;
+			} else if (key != "space") {
+				dr.error("key", "unknown value '" + key + "' (expected one of: space, none)");
+			}
+			dr.read("marker_file", dc.marker_file);
+			dr.read_enum("gaze", dc.gaze_event, gaze_trigger_events);
+			dr.finish();
+		}
+
+		if (const json* sources = r.require("sources")) {
+			if (!sources->is_array()) {
+				r.error("sources", std::string("expected an array, got ") + sources->type_name());
+			} else {
+				for (size_t i = 0; i < sources->size(); ++i) {
+					config.sources.push_back(parse_source((*sources)[i], "sources[" + std::to_string(i) + "]", errors));
+				}
+			}
+		}
+		r.finish();
+
+		// 値の読み取りで誤りがあれば，組み合わせの検証は誤解を招くので行わない
+		if (errors.empty()) {
+			errors = validate_PipelineConfig(config);
+		}
+		if (!errors.empty()) {
+			throw PipelineConfigError(errors);
+		}
+		return config;
+	}
+
+	PipelineConfig load_PipelineConfig(const std::string& path)
+	{
+		std::ifstream ifs(path);
+		if (!ifs.is_open()) {
+			throw std::runtime_error("Failed to open pipeline config: " + path);
+		}
+
+		json j;
+		try {
+			j = json::parse(ifs, nullptr, true, true);	// コメントを許す
+		} catch (const json::parse_error& e) {
+			throw PipelineConfigError({ path + ": " + e.what() });
+		}
+		return parse_PipelineConfig(j);
+	}
+
+	std::vector<std::string> validate_PipelineConfig(const PipelineConfig& config)
+	{
+		std::vector<std::string> errors;
+
+		if (config.sources.empty()) {
+			errors.push_back("sources: at least one source is required");
+		}
+		if (!config.stop.on_enter_key && config.stop.duration_s <= 0.0) {
+			errors.push_back("stop: duration_s must be > 0 when key is none (otherwise the pipeline never stops)");
+		}
+		if (config.dashcam.enabled) {
+			const auto& dc = config.dashcam;
+			if (dc.ring.pre_s + dc.ring.post_s <= 0.0) {
+				errors.push_back("dashcam: pre_s + post_s must be > 0 (otherwise nothing is written)");
+			}
+			if (dc.gaze_event != VarjoEyeTracking::GazeTriggerEvent::None
+				&& std::none_of(config.sources.begin(), config.sources.end(), [](const SourceConfig& s) { return s.type == SourceType::Gaze; })) {
+				errors.push_back("dashcam.gaze: requires a gaze source");
+			}
+		}
+
+		std::map<std::string, std::string> ids;		// id → 最初に使った場所
+		std::map<std::string, std::string> paths;
+		for (size_t i = 0; i < config.sources.size(); ++i) {
+			const auto& source = config.sources[i];
+			const std::string path = "sources[" + std::to_string(i) + "]";
+
+			if (source.id.empty()) {
+				errors.push_back(path + ".id: must not be empty");
+			} else if (auto [it, inserted] = ids.emplace(source.id, path); !inserted) {
+				errors.push_back(path + ".id: '" + source.id + "' is already used by " + it->second);
+			}
+
+			if (source.type == SourceType::VST) {
+				if (source.row_stride < source.width) {
+					errors.push_back(path + ".row_stride: must be >= width");
+				}
+				if (source.height % 2 != 0 || source.width % 2 != 0) {
+					errors.push_back(path + ": width and height must be even (NV12)");
+				}
+			}
+
+			// VSTは出力先の種類ごとに1つ，それ以外は出力先を1つだけ持てる
+			if (source.sinks.empty()) {
+				errors.push_back(path + ".sinks: at least one sink is required");
+			}
+			if (source.type != SourceType::VST && source.sinks.size() > 1) {
+				errors.push_back(path + ".sinks: a " + std::string(to_string(source.type)) + " source takes exactly one sink");
+			}
+
+			std::set<SinkType> seen;
+			for (size_t k = 0; k < source.sinks.size(); ++k) {
+				const auto& sink = source.sinks[k];
+				const std::string sink_path = path + ".sinks[" + std::to_string(k) + "]";
+
+				if (!is_allowed_sink(source.type, sink.type)) {
+					errors.push_back(sink_path + ".type: '" + to_string(sink.type) + "' cannot be used with a " + to_string(source.type) + " source");
+					continue;
+				}
+				if (source.type == SourceType::VST && !seen.insert(sink.type).second) {
+					errors.push_back(sink_path + ".type: only one " + std::string(to_string(sink.type)) + " per vst source");
+				}
+				if (source.type == SourceType::VST && (sink.channels & source.channels) != sink.channels) {
+					errors.push_back(sink_path + ".channels: includes a channel the source does not stream");
+				}
+
+				if (!sink.path.empty()) {
+					const std::string key = std::filesystem::path(sink.path).lexically_normal().generic_string();
+					if (auto [it, inserted] = paths.emplace(key, sink_path); !inserted) {
+						errors.push_back(sink_path + ".path: '" + sink.path + "' is already written by " + it->second);
+					}
+				}
+			}
+		}
+
+		return errors;
+	}
+}
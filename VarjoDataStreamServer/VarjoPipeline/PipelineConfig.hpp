@@ -0,0 +1,216 @@
+/************************************************************************************************************************
+	Pipeline Config
+	記録するストリーム(source)と，それぞれの出力先(sink)・キューの大きさ・スレッド数をJSONで記述する．
+	main_for*のように組み合わせごとにコードを書かずに，研究ごとの設定ファイルで構成とバッファを調整する．
+
+	{
+		"executor": { "cpu_threads": 0, "io_threads": 4 },
+		"stop": { "key": "enter", "duration_s": 0 },
+		"segment": { "duration_s": 60, "max_mb": 0 },
+		"memory": { "limit_mb": 4096, "preview_high_water": 0.75 },
+		"overload": { "order": ["preview", "metadata", "encoder", "recording"], "log": "overload.csv" },
+		"dashcam": { "pre_s": 10, "post_s": 5, "key": "space", "marker_file": "mark", "gaze": "blink", "log": "dashcam.csv" },
+		"sources": [
+			{ "id": "vst", "type": "vst", "input": "device", "channels": "both",
+			  "width": 832, "height": 640, "row_stride": 896, "buffer_capacity": 10, "fanout_capacity": 32,
+			  "sinks": [
+				{ "type": "video_writer", "mode": "parallel", "path": "output.mp4", "fps": 90,
+				  "encoder": { "codec": "x264", "preset": "veryfast", "crf": 18,
+				               "adaptive": { "fastest": "ultrafast", "slowest": "medium", "raise_backlog": 30 } } },
+				{ "type": "metadata_writer", "path": "vstmeta/metadata.csv" },
+				{ "type": "video_previewer", "policy": "latest_only", "buffer_size": 10 } ] },
+			{ "id": "gaze", "type": "gaze", "filter": "standard", "frequency": "200hz",
+			  "sinks": [ { "type": "csv", "path": "gaze.csv" } ] },
+			{ "id": "frame_info", "type": "frame_info", "queue_capacity": 1024, "check_interval_ms": 5,
+			  "sinks": [ { "type": "binary", "mode": "parallel", "path": "frame_info.bin" } ] },
+			{ "id": "timestamp", "type": "timestamp", "period_us": 1000, "sleep_mode": "hybrid",
+			  "sinks": [ { "type": "csv", "path": "timestamp.csv" } ] }
+		]
+	}
+
+	省略した項目は各クラスの既定値(main_for*で使っていた値)になる．
+	VSTの出力先は"policy"(lossless / latest_only / decimate)でFanoutRingの購読方法を選ぶ．
+	vst以外のsourceはそれぞれのDataLoggerが持てる出力先が1つなので，sinkも1つだけ指定する．
+	gaze / frame_info / timestampは"csv"と"binary"を選べる．gaze / timestampのbinaryはCSVと同じ列の固定長レコード(*Schema.hpp)，
+	frame_infoのbinaryは差分形式(FrameInfoBinaryFormat.hpp)．
+	"segment"を指定すると，全ての書き出し(動画・メタデータ・gaze・frame_info・timestamp)を同じ時間帯で区切った
+	セグメントのファイルに分け，出力ごとに"<名前>_segments.csv"へ閉じ終えたセグメントを記録する(Segmentation.hpp)．
+	max_mbは出力ごとの上限．0または省略で区切らない．
+	"memory"はキュー・プール・書き込みブロックが共有するメモリ予算(MemoryBudget.hpp)．limit_mbを超える分のフレームは
+	受信側で捨て，使用量がlimit_mb * preview_high_waterを超えるとプレビューから先に間引く．0または省略で上限なし(計上のみ)．
+	"overload"を指定すると，キューの深さと書き込みの遅延を見て過負荷の間だけ"order"の順に処理を削る(OverloadController.hpp)．
+	preview: プレビューを止める / metadata: メタデータの出力を間引く / encoder: x264のpresetを下げる(segmentかadaptive指定時のみ) /
+	recording: 記録するフレームを間引く．gaze・frame_info・timestampは削らない．判断は"log"のCSVと標準エラーに残す．
+	x264の"adaptive"を指定すると，書き待ちのフレーム数と入出力のfpsを見てpresetをfastest～slowestの間で記録中に変える
+	(VarjoVSTVideoWriter.hpp)．変えた位置でpartに分けるので，segmentを指定しなくても"<名前>_segments.csv"ができる．
+	"dashcam"を指定すると，動画・メタデータ・gazeは直近pre_s秒分をメモリ上のリングに持つだけにし，triggerを引いた時刻の
+	[-pre_s, +post_s]の窓に入る分だけを書く(DashcamRing.hpp)．triggerはスペースキー("key")・marker_fileの作成(見つけたら消す)・
+	gazeの出来事("gaze": blink / tracking_lost)・Pipeline::trigger()で引ける．窓は"log"のCSVと標準エラーに残す．
+	frame_info・timestampは時刻の対応付けに使うので常に全て書く．
+	未知のキー・型違い・範囲外の値・id/出力パスの重複はまとめてPipelineConfigErrorとして報告する．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+
+#include "json/json.hpp"
+
+#include "../VarjoVSTFrame/varjo_vst_frame_type.hpp"
+#include "../VarjoEyeTracking/EyeTracking_types.hpp"
+#include "../util/FanoutRing.hpp"
+#include "../util/DeadlineSampler.hpp"
+#include "../util/Executor.hpp"
+#include "../util/Segmentation.hpp"
+#include "../util/MemoryBudget.hpp"
+#include "../util/OverloadController.hpp"
+#include "../util/DashcamRing.hpp"
+
+namespace VarjoPipeline {
+
+	enum class SourceType {
+		VST, Gaze, FrameInfo, Timestamp
+	};
+
+	enum class SinkType {
+		VideoWriter, VideoPreviewer, MetadataWriter, Csv, Binary
+	};
+
+	/**
+	 * @brief 出力先ごとのSerial/Parallelクラスの選択
+	 */
+	enum class SinkMode {
+		Serial, Parallel
+	};
+
+	struct SinkConfig {
+		SinkType type;
+		SinkMode mode = SinkMode::Serial;
+		std::string path;
+
+		// VSTのみ
+		varjo_ChannelFlag channels = varjo_ChannelFlag_Left | varjo_ChannelFlag_Right;	// 省略時はsourceのchannels
+		FanoutSubscriberOptions subscriber;		// nameはtypeの名前，policyはtypeごとの既定値
+		int fps = 90;
+		VarjoVSTFrame::VideoContainer container = VarjoVSTFrame::VideoContainer::mp4;
+		VarjoVSTFrame::EncodeOptions encoder = VarjoVSTFrame::X264Options{};
+		VarjoVSTFrame::AdaptiveRateOptions adaptive{};		// x264のみ．encoder.adaptiveを指定したら有効
+		size_t buffer_size = 10;				// ParallelVideoPreviewerの左右それぞれのキュー長
+	};
+
+	struct SourceConfig {
+		std::string id;
+		SourceType type;
+		std::vector<SinkConfig> sinks;
+
+		// vst
+		bool dummy_input = false;		// 実機の代わりに保存済みのフレームを流す
+		double dummy_fps = 90.0;
+		varjo_ChannelFlag channels = varjo_ChannelFlag_Left | varjo_ChannelFlag_Right;
+		size_t width = 832;
+		size_t height = 640;
+		size_t row_stride = 896;
+		size_t buffer_capacity = 10;
+		size_t fanout_capacity = 32;
+
+		// gaze
+		VarjoEyeTracking::OutputFilterType gaze_filter = VarjoEyeTracking::OutputFilterType::STANDARD;
+		VarjoEyeTracking::OutputFrequency gaze_frequency = VarjoEyeTracking::OutputFrequency::_200HZ;
+
+		// frame_info
+		size_t queue_capacity = 1024;
+		int64_t fov_refresh_interval_frames = 0;
+
+		// frame_info / timestamp
+		int check_interval_ms = 5;
+
+		// timestamp
+		Sampling::SamplerOptions sampler{};
+	};
+
+	struct StopConfig {
+		bool on_enter_key = true;		// Enterキーで止める
+		double duration_s = 0.0;		// 0より大きければこの時間で止める
+	};
+
+	/**
+	 * @brief 過負荷のときに削る処理．OverloadConfig::orderの順に効かせる
+	 */
+	enum class ShedAction {
+		Preview, Metadata, Encoder, Recording
+	};
+
+	struct OverloadConfig {
+		bool enabled = false;
+		Overload::OverloadOptions controller{};
+		std::vector<ShedAction> order = { ShedAction::Preview, ShedAction::Metadata, ShedAction::Encoder, ShedAction::Recording };
+
+		// signalの閾値．0なら見ない
+		double max_queue_frames = 60;			// 動画・メタデータの出力先が未処理のフレーム数(FanoutRingの遅れ・書き込み待ち)
+		double max_io_blocks = 64;				// ディスクへの書き込み待ちのブロック数(AsyncFile)
+		double max_gaze_queue = 1000;			// gazeの書き込み待ちのサンプル数
+		double max_write_latency_ms = 50;		// ffmpegへのパイプ書き込みのp99
+
+		// 削り方
+		uint32_t metadata_keep_every = 3;		// metadata: N枚に1枚だけ書く
+		int encoder_downgrade = 2;				// encoder: presetを何段速くするか
+		uint32_t recording_keep_every = 2;		// recording: N枚に1枚だけ書く
+	};
+
+	struct DashcamConfig {
+		bool enabled = false;
+		Dashcam::DashcamOptions ring{};
+		bool on_space_key = true;			// スペースキーで引く
+		std::string marker_file;			// 空でなければ，このファイルが作られたら引いて消す
+		VarjoEyeTracking::GazeTriggerEvent gaze_event = VarjoEyeTracking::GazeTriggerEvent::None;
+	};
+
+	struct PipelineConfig {
+		Execution::ExecutorOptions executor{};
+		StopConfig stop{};
+		Segmentation::SegmentOptions segment{};		// 全ての出力に共通
+		Memory::MemoryBudgetOptions memory{};
+		OverloadConfig overload{};
+		DashcamConfig dashcam{};
+		std::vector<SourceConfig> sources;
+
+		/**
+		 * @brief 実機のセッションが必要なsourceを含むか
+		 */
+		bool needs_session() const;
+	};
+
+	/**
+	 * @brief 設定の誤り．what()には見つかった誤りを全て "sources[0].sinks[1].type: ..." の形で1行ずつ並べる
+	 */
+	class PipelineConfigError : public std::runtime_error {
+
+	public:
+		explicit PipelineConfigError(const std::vector<std::string>& errors);
+
+		const std::vector<std::string>& errors() const { return this->errors_; }
+
+	private:
+		std::vector<std::string> errors_;
+	};
+
+	/**
+	 * @brief JSONから読み込み，検証する．誤りがあればPipelineConfigErrorを投げる
+	 */
+	PipelineConfig parse_PipelineConfig(const nlohmann::json& j);
+	PipelineConfig load_PipelineConfig(const std::string& path);
+
+	/**
+	 * @brief 組み合わせの検証(idと出力パスの重複，sourceごとに使える出力先と数)．誤りの一覧を返す
+	 */
+	std::vector<std::string> validate_PipelineConfig(const PipelineConfig& config);
+
+	const char* to_string(const SourceType type);
+	const char* to_string(const SinkType type);
+	const char* to_string(const ShedAction action);
+}
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <charconv>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "MetricsEndpoint.hpp"
+
+namespace {
+	constexpr size_t max_request_size = 8192;
+	constexpr int request_timeout_ms = 1000;
+	constexpr int accept_poll_ms = 100;		// close()への応答間隔
+
+	int64_t steady_now_ns() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * @brief 計測対象のスレッドよりCPUを譲るよう，呼び出したスレッドの優先度を下げる
+	 */
+	void lower_current_thread_priority() {
+#ifdef _WIN32
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+		// Linuxではスレッドごとにnice値を持つ
+		setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+	}
+
+	/**
+	 * @brief "name{a=\"b\"}" を名前とラベル部分("a=\"b\"")に分ける
+	 */
+	std::pair<std::string, std::string> split_labels(const std::string& name) {
+		const size_t pos = name.find('{');
+		if (pos == std::string::npos || name.back() != '}') {
+			return { name, "" };
+		}
+		return { name.substr(0, pos), name.substr(pos + 1, name.size() - pos - 2) };
+	}
+
+	std::string escape_label(const std::string& value) {
+		std::string out;
+		out.reserve(value.size());
+		for (const char c : value) {
+			if (c == '\\' || c == '"') {
+				out += '\\';
+				out += c;
+			} else if (c == '\n') {
+				out += "\\n";
+			} else {
+				out += c;
+			}
+		}
+		return out;
+	}
+
+	std::string join_labels(const std::string& a, const std::string& b) {
+		if (a.empty()) return b;
+		if (b.empty()) return a;
+		return a + "," + b;
+	}
+
+	/**
+	 * @brief 同じ名前(ラベル違い)のサンプルを# TYPEの下にまとめて出力するための集合
+	 */
+	class FamilyWriter {
+
+	public:
+		void add(const std::string& family, const char* type, const std::string& name, const std::string& labels, const double value) {
+			auto& f = this->families_[family];
+			f.type = type;
+
+			// 往復で値が変わらない最短の表記にする(大きなカウンタを指数表記で丸めない)
+			char buf[32];
+			const auto end = std::to_chars(buf, buf + sizeof(buf), value).ptr;
+
+			f.lines += name;
+			if (!labels.empty()) {
+				f.lines += '{' + labels + '}';
+			}
+			f.lines += ' ';
+			f.lines.append(buf, end);
+			f.lines += '\n';
+		}
+
+		std::string str() const {
+			std::string out;
+			for (const auto& [family, f] : this->families_) {
+				out += "# TYPE " + family + " " + f.type + "\n";
+				out += f.lines;
+			}
+			return out;
+		}
+
+	private:
+		struct Family {
+			std::string type;
+			std::string lines;
+		};
+		std::map<std::string, Family> families_;
+	};
+
+	bool ends_with(const std::string& s, const std::string& suffix) {
+		return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+}
+
+namespace VarjoServer {
+
+	std::string format_Prometheus(const PerformanceChecker::MetricsSnapshot& snap,
+		const std::map<std::string, double>& rates,
+		const std::vector<std::pair<std::string, uint64_t>>& disk_free_bytes)
+	{
+		FamilyWriter w;
+
+		for (const auto& [full_name, value] : snap.counters) {
+			const auto [name, labels] = split_labels(full_name);
+			w.add(name, "counter", name, labels, static_cast<double>(value));
+		}
+		for (const auto& [full_name, value] : snap.gauges) {
+			const auto [name, labels] = split_labels(full_name);
+			w.add(name, "gauge", name, labels, static_cast<double>(value));
+		}
+		for (const auto& [full_name, value] : rates) {
+			const auto [name, labels] = split_labels(full_name);
+			const std::string rate_name = name.substr(0, name.size() - std::string("_total").size()) + "_per_second";
+			w.add(rate_name, "gauge", rate_name, labels, value);
+		}
+
+		static constexpr std::pair<const char*, double> quantiles[] = {
+			{ "0.5", 0.5 }, { "0.9", 0.9 }, { "0.99", 0.99 }, { "0.999", 0.999 }
+		};
+		for (const auto& [full_name, h] : snap.histograms) {
+			const auto [name, labels] = split_labels(full_name);
+			for (const auto& [q_str, q] : quantiles) {
+				const double v = h.count > 0 ? h.percentile_ns(q) : 0.0;
+				w.add(name, "summary", name, join_labels(labels, std::string("quantile=\"") + q_str + "\""), v);
+			}
+			w.add(name, "summary", name + "_sum", labels, static_cast<double>(h.sum_ns));
+			w.add(name, "summary", name + "_count", labels, static_cast<double>(h.count));
+			w.add(name + "_max", "gauge", name + "_max", labels, static_cast<double>(h.max_ns));
+		}
+
+		for (const auto& [path, bytes] : disk_free_bytes) {
+			w.add("disk_free_bytes", "gauge", "disk_free_bytes", "path=\"" + escape_label(path) + "\"", static_cast<double>(bytes));
+		}
+
+		for (const auto& t : snap.threads) {
+			const std::string labels = "thread=\"" + escape_label(t.name) + "\",id=\"" + std::to_string(t.id) + "\"";
+			w.add("thread_cpu_seconds_total", "counter", "thread_cpu_seconds_total", labels, t.cpu_ns / 1e9);
+		}
+
+		return w.str();
+	}
+
+	MetricsEndpoint::MetricsEndpoint(const MetricsEndpointOptions& opt)
+		: opt_(opt)
+	{}
+
+	MetricsEndpoint::~MetricsEndpoint()
+	{
+		this->close();
+	}
+
+	bool MetricsEndpoint::open()
+	{
+		if (this->is_open()) {
+			return false;
+		}
+
+		this->listen_sock_ = Socket::listen(Transport::Tcp, this->opt_.host, this->opt_.port, "");
+		if (!this->listen_sock_.is_valid()) {
+			return false;
+		}
+
+		// スレッドを起動
+		this->stop_thread_ = false;
+		this->serve_thread_ = std::thread(&MetricsEndpoint::serve_worker, this);
+
+		return true;
+	}
+
+	void MetricsEndpoint::close()
+	{
+		this->stop_thread_ = true;
+		if (this->serve_thread_.joinable()) {
+			this->serve_thread_.join();
+		}
+		this->listen_sock_.close();
+	}
+
+	void MetricsEndpoint::serve_worker()
+	{
+		lower_current_thread_priority();
+		auto thread_reg = PerformanceChecker::register_thread("metrics_endpoint");
+
+		const int64_t interval_ns = static_cast<int64_t>(std::max(this->opt_.sample_interval_ms, 1)) * 1000000;
+		this->sample();
+		int64_t next_sample_ns = steady_now_ns() + interval_ns;
+
+		while (!this->stop_thread_.load()) {
+			const int64_t remaining_ms = (next_sample_ns - steady_now_ns()) / 1000000;
+			const int timeout_ms = static_cast<int>(std::clamp<int64_t>(remaining_ms, 0, accept_poll_ms));
+
+			Socket sock = this->listen_sock_.accept(timeout_ms);
+			if (sock.is_valid()) {
+				this->respond(sock);
+				sock.shutdown();
+			}
+
+			const int64_t now = steady_now_ns();
+			if (now >= next_sample_ns) {
+				this->sample();
+				// 処理が遅れた場合は間隔を詰めずに次の周期へ
+				next_sample_ns = std::max(next_sample_ns + interval_ns, now + interval_ns / 2);
+			}
+		}
+	}
+
+	void MetricsEndpoint::sample()
+	{
+		const auto snap = PerformanceChecker::Registry::instance().snapshot();
+		const int64_t now = steady_now_ns();
+
+		if (this->prev_sample_ns_ != 0) {
+			const double dt_s = (now - this->prev_sample_ns_) * 1e-9;
+			for (const auto& [full_name, value] : snap.counters) {
+				if (!ends_with(split_labels(full_name).first, "_total")) {
+					continue;
+				}
+				auto it = this->prev_counters_.find(full_name);
+				const uint64_t prev = it != this->prev_counters_.end() ? it->second : 0;
+				this->rates_[full_name] = value >= prev ? (value - prev) / dt_s : 0.0;
+			}
+		}
+
+		this->prev_counters_.clear();
+		for (const auto& [full_name, value] : snap.counters) {
+			this->prev_counters_.emplace(full_name, value);
+		}
+		this->prev_sample_ns_ = now;
+
+		this->disk_free_bytes_.clear();
+		for (const auto& path : this->opt_.disk_paths) {
+			std::error_code ec;
+			const auto info = std::filesystem::space(path, ec);
+			if (!ec) {
+				this->disk_free_bytes_.emplace_back(path, static_cast<uint64_t>(info.available));
+			}
+		}
+	}
+
+	void MetricsEndpoint::respond(Socket& sock)
+	{
+		// リクエストヘッダの終わりまで読む(本文は扱わない)
+		std::string request;
+		char buf[1024];
+		while (request.find("\r\n\r\n") == std::string::npos && request.size() < max_request_size) {
+			const size_t n = sock.recv_some(buf, sizeof(buf), request_timeout_ms);
+			if (n == 0) {
+				break;
+			}
+			request.append(buf, n);
+		}
+
+		std::istringstream first_line(request.substr(0, request.find("\r\n")));
+		std::string method, target;
+		first_line >> method >> target;
+		target = target.substr(0, target.find('?'));
+
+		const char* status = "200 OK";
+		std::string body;
+		if (method != "GET") {
+			status = "405 Method Not Allowed";
+			body = "only GET is supported\n";
+		} else if (target != "/metrics") {
+			status = "404 Not Found";
+			body = "see /metrics\n";
+		} else {
+			body = format_Prometheus(PerformanceChecker::Registry::instance().snapshot(), this->rates_, this->disk_free_bytes_);
+			this->request_count_.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		const std::string header =
+			std::string("HTTP/1.1 ") + status + "\r\n"
+			"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+			"Content-Length: " + std::to_string(body.size()) + "\r\n"
+			"Connection: close\r\n\r\n";
+		const IoSlice slices[] = { { header.data(), header.size() }, { body.data(), body.size() } };
+		sock.send_vectored(slices, 2);
+	}
+}
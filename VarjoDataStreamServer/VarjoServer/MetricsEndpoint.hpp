@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+
+#include "Socket.hpp"
+#include "../util/PerformanceChecker.hpp"
+
+/****************************************************************************************************
+* PerformanceChecker::Registryの計測値をPrometheusのテキスト形式で配信するHTTPエンドポイント．
+* GET /metrics にのみ応答する．記録中にcurlやPrometheusから劣化(fps低下・キュー滞留・破棄)を確認できる．
+*
+* Counter → counter，Gauge → gauge，LatencyHistogram → summary(quantile 0.5/0.9/0.99/0.999)として出力する．
+* 名前が "_total" で終わるCounterは，サンプリング間隔ごとの増分から "_per_second" のgaugeも出力する
+* (例: vst_frames_received_total → vst_frames_received_per_second がfps，*_bytes_written_total → 書き込み帯域)．
+* そのほかdisk_pathsの空き容量と，register_threadで登録したスレッドのCPU時間を出力する．
+*
+* 受付・応答・サンプリングは優先度を下げた1本のスレッドで行い，計測対象のスレッドとはロックを共有しない．
+*****************************************************************************************************/
+
+namespace VarjoServer {
+
+	struct MetricsEndpointOptions {
+		std::string host = "127.0.0.1";		// 既定ではローカルからのみ受け付ける
+		uint16_t port = 9464;
+		int sample_interval_ms = 1000;			// *_per_secondを求める間隔
+		std::vector<std::string> disk_paths = { "." };	// 空き容量を出力するパス(記録先のディレクトリ)
+	};
+
+	/**
+	 * @brief Prometheusのテキスト形式(version 0.0.4)に変換する．ratesは "_per_second" で出力するgauge
+	 */
+	std::string format_Prometheus(const PerformanceChecker::MetricsSnapshot& snap,
+		const std::map<std::string, double>& rates,
+		const std::vector<std::pair<std::string, uint64_t>>& disk_free_bytes);
+
+	class MetricsEndpoint {
+
+	public:
+		explicit MetricsEndpoint(const MetricsEndpointOptions& opt = MetricsEndpointOptions{});
+		~MetricsEndpoint();
+
+		MetricsEndpoint(const MetricsEndpoint&) = delete;
+		MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+		bool open();
+		void close();
+
+		// getter
+		bool is_open() const { return !this->stop_thread_.load(); }
+		uint64_t request_count() const { return this->request_count_.load(std::memory_order_relaxed); }
+
+	private:
+		void serve_worker();
+		void sample();
+		void respond(Socket& sock);
+
+	private:
+		const MetricsEndpointOptions opt_;
+
+		Socket listen_sock_;
+		std::thread serve_thread_;
+		std::atomic_bool stop_thread_{ true };
+		std::atomic<uint64_t> request_count_{ 0 };
+
+		// 以下はserve_thread_のみが触る
+		std::map<std::string, uint64_t> prev_counters_;
+		int64_t prev_sample_ns_ = 0;
+		std::map<std::string, double> rates_;
+		std::vector<std::pair<std::string, uint64_t>> disk_free_bytes_;
+	};
+}
@@ -0,0 +1,141 @@
+#include "ServerSinks.hpp"
+
+namespace {
+
+	/**
+	 * @brief Frameの画素データを共有バッファにする．所有している場合はムーブし，借用の場合のみ複製する．
+	 */
+	template<class FrameT>
+	std::shared_ptr<const std::vector<uint8_t>> share_framedata(BorrowedOrOwned<FrameT>& frame, typename FrameT::Metadata& metadata) {
+		FrameT owned = std::move(frame).materialize();
+		metadata = owned.metadata;
+		return std::make_shared<const std::vector<uint8_t>>(std::move(owned.data));
+	}
+}
+
+namespace VarjoServer {
+
+	/****************************************************************************************************
+	* VSTFrameServerSink
+	*****************************************************************************************************/
+
+	VSTFrameServerSink::VSTFrameServerSink(std::shared_ptr<VarjoDataStreamServer> server)
+		: server_(std::move(server))
+	{}
+
+	void VSTFrameServerSink::submit_batch_impl(SubmitBatch<VarjoVSTFrame::Frame> frames)
+	{
+		if (!this->server_->has_subscriber(Topic::VSTFrame)) {
+			return;
+		}
+
+		std::move(frames).for_each([this](BorrowedOrOwned<VarjoVSTFrame::Frame> frame) {
+			VarjoVSTFrame::Metadata metadata;
+			auto data = share_framedata(frame, metadata);
+			this->server_->publish(Topic::VSTFrame, &metadata, sizeof(metadata), std::move(data));
+		});
+	}
+
+	void VSTFrameServerSink::submit_shared_impl(VarjoVSTFrame::SharedFrame frame)
+	{
+		if (!this->server_->has_subscriber(Topic::VSTFrame)) {
+			return;
+		}
+
+		// フレームの所有権を共有したまま画素データだけを指す
+		const VarjoVSTFrame::Metadata metadata = frame->metadata;
+		std::shared_ptr<const std::vector<uint8_t>> data(frame, &frame->data);
+		this->server_->publish(Topic::VSTFrame, &metadata, sizeof(metadata), std::move(data));
+	}
+
+	/****************************************************************************************************
+	* EyeCamServerSink
+	*****************************************************************************************************/
+
+	EyeCamServerSink::EyeCamServerSink(std::shared_ptr<VarjoDataStreamServer> server)
+		: server_(std::move(server))
+	{}
+
+	void EyeCamServerSink::submit_batch_impl(SubmitBatch<EyeCam::Frame> frames)
+	{
+		if (!this->server_->has_subscriber(Topic::EyeCam)) {
+			return;
+		}
+
+		std::move(frames).for_each([this](BorrowedOrOwned<EyeCam::Frame> frame) {
+			EyeCam::Metadata metadata;
+			auto framedata = share_framedata(frame, metadata);
+			this->server_->publish(Topic::EyeCam, &metadata, sizeof(metadata), std::move(framedata));
+		});
+	}
+
+	/****************************************************************************************************
+	* GazeServerSink
+	*****************************************************************************************************/
+
+	GazeServerSink::GazeServerSink(std::shared_ptr<VarjoDataStreamServer> server)
+		: server_(std::move(server))
+	{}
+
+	void GazeServerSink::submit_batch_impl(SubmitBatch<VarjoEyeTracking::EyeTrackingData> data)
+	{
+		if (!this->server_->has_subscriber(Topic::Gaze)) {
+			return;
+		}
+
+		for (const auto& d : data.view()) {
+			const GazeRecord record{
+				.gaze = d.gaze,
+				.rendering_gaze = d.rendering_gaze,
+				.eyeMeasurements = d.eyeMeasurements,
+				.userIPD = d.userIPD.value_or(0.0),
+				.headsetIPD = d.headsetIPD.value_or(0.0),
+				.has_userIPD = static_cast<uint8_t>(d.userIPD.has_value()),
+				.has_headsetIPD = static_cast<uint8_t>(d.headsetIPD.has_value())
+			};
+			this->server_->publish(Topic::Gaze, &record, sizeof(record));
+		}
+	}
+
+	/****************************************************************************************************
+	* FrameInfoServerSink
+	*****************************************************************************************************/
+
+	FrameInfoServerSink::FrameInfoServerSink(std::shared_ptr<VarjoDataStreamServer> server)
+		: server_(std::move(server))
+	{}
+
+	void FrameInfoServerSink::submit_batch_impl(SubmitBatch<VarjoFrameInfo::FrameInfoData> data)
+	{
+		if (!this->server_->has_subscriber(Topic::FrameInfo)) {
+			return;
+		}
+		for (const auto& d : data.view()) {
+			this->server_->publish(Topic::FrameInfo, &d, sizeof(VarjoFrameInfo::FrameInfoData));
+		}
+	}
+
+	/****************************************************************************************************
+	* TimestampServerSink
+	*****************************************************************************************************/
+
+	TimestampServerSink::TimestampServerSink(std::shared_ptr<VarjoDataStreamServer> server)
+		: server_(std::move(server))
+	{}
+
+	void TimestampServerSink::submit_batch_impl(SubmitBatch<Timestamp::TimestampData> data)
+	{
+		if (!this->server_->has_subscriber(Topic::Timestamp)) {
+			return;
+		}
+
+		for (const auto& d : data.view()) {
+			const TimestampRecord record{
+				.varjo_timestamp = d.varjo_timestamp,
+				.varjo_timestamp_unix = d.varjo_timestamp_unix,
+				.system_timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d.system_timestamp.time_since_epoch()).count()
+			};
+			this->server_->publish(Topic::Timestamp, &record, sizeof(record));
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <queue>
+#include <deque>
+
+#include "../VarjoDataStreamServer.hpp"
+#include "../VarjoVSTFrame/ISubmitFrame.hpp"
+#include "../VarjoEyeCam/ISubmitEyeCam.hpp"
+#include "../VarjoEyeTracking/ISubmit.hpp"
+#include "../VarjoFrameInfo/ISubmitFrameInfo.hpp"
+#include "../VarjoTimestamp/ISubmitTimestamp.hpp"
+
+/****************************************************************************************************
+* 各ストリームのISubmit*をVarjoDataStreamServerへの配信につなぐアダプタ．
+* 既存のDataLogger/Writerと同じI/Fで受け取るため，書き込み先の代わりにそのまま差し込める．
+* 購読者がいないトピックはメッセージを組み立てずに捨てる．
+*****************************************************************************************************/
+
+namespace VarjoServer {
+
+	/****************************************************************************************************
+	* @class VSTFrameServerSink
+	*****************************************************************************************************/
+
+	class VSTFrameServerSink : public VarjoVSTFrame::ISubmitFrame {
+
+	public:
+		explicit VSTFrameServerSink(std::shared_ptr<VarjoDataStreamServer> server);
+
+	protected:
+		// 所有して渡された画素データはムーブされ，全クライアントで共有される(複製なし)
+		void submit_batch_impl(SubmitBatch<VarjoVSTFrame::Frame> frames) override;
+		// ハンドルで渡された場合は画素データをそのまま参照して配信する(複製なし)
+		void submit_shared_impl(VarjoVSTFrame::SharedFrame frame) override;
+
+	private:
+		const std::shared_ptr<VarjoDataStreamServer> server_;
+	};
+
+	/****************************************************************************************************
+	* @class EyeCamServerSink
+	*****************************************************************************************************/
+
+	class EyeCamServerSink : public EyeCam::ISubmitFrame {
+
+	public:
+		explicit EyeCamServerSink(std::shared_ptr<VarjoDataStreamServer> server);
+
+	protected:
+		void submit_batch_impl(SubmitBatch<EyeCam::Frame> frames) override;
+
+	private:
+		const std::shared_ptr<VarjoDataStreamServer> server_;
+	};
+
+	/****************************************************************************************************
+	* @class GazeServerSink
+	*****************************************************************************************************/
+
+	class GazeServerSink : public VarjoEyeTracking::ISubmitEyeTrackingData {
+
+	public:
+		explicit GazeServerSink(std::shared_ptr<VarjoDataStreamServer> server);
+
+	protected:
+		void submit_batch_impl(SubmitBatch<VarjoEyeTracking::EyeTrackingData> data) override;
+
+	private:
+		const std::shared_ptr<VarjoDataStreamServer> server_;
+	};
+
+	/****************************************************************************************************
+	* @class FrameInfoServerSink
+	*****************************************************************************************************/
+
+	class FrameInfoServerSink : public VarjoFrameInfo::ISubmitFrameInfo {
+
+	public:
+		explicit FrameInfoServerSink(std::shared_ptr<VarjoDataStreamServer> server);
+
+	protected:
+		void submit_batch_impl(SubmitBatch<VarjoFrameInfo::FrameInfoData> data) override;
+
+	private:
+		const std::shared_ptr<VarjoDataStreamServer> server_;
+	};
+
+	/****************************************************************************************************
+	* @class TimestampServerSink
+	*****************************************************************************************************/
+
+	class TimestampServerSink : public Timestamp::ISubmitTimestamp {
+
+	public:
+		explicit TimestampServerSink(std::shared_ptr<VarjoDataStreamServer> server);
+
+	protected:
+		void submit_batch_impl(SubmitBatch<Timestamp::TimestampData> data) override;
+
+	private:
+		const std::shared_ptr<VarjoDataStreamServer> server_;
+	};
+}
@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "Socket.hpp"
+
+namespace {
+#ifdef _WIN32
+	using socklen_type = int;
+	constexpr size_t max_slices_per_call = 64;
+
+	inline void close_native(SOCKET s) { closesocket(s); }
+#else
+	using socklen_type = socklen_t;
+	constexpr size_t max_slices_per_call = 64;	// IOV_MAXより十分小さい値
+
+	inline void close_native(int s) { ::close(s); }
+#endif
+
+	/**
+	 * @brief TCP/Unixのアドレスを作る．失敗した場合はlenに0を返す．
+	 */
+	void make_address(
+		const VarjoServer::Transport transport, const std::string& host, const uint16_t port, const std::string& unix_path,
+		sockaddr_storage& addr, socklen_type& len)
+	{
+		std::memset(&addr, 0, sizeof(addr));
+		len = 0;
+
+		if (transport == VarjoServer::Transport::Tcp) {
+			auto* in = reinterpret_cast<sockaddr_in*>(&addr);
+			in->sin_family = AF_INET;
+			in->sin_port = htons(port);
+			if (inet_pton(AF_INET, host.c_str(), &in->sin_addr) != 1) {
+				return;
+			}
+			len = sizeof(sockaddr_in);
+		} else {
+			auto* un = reinterpret_cast<sockaddr_un*>(&addr);
+			un->sun_family = AF_UNIX;
+			if (unix_path.size() >= sizeof(un->sun_path)) {
+				return;
+			}
+			std::memcpy(un->sun_path, unix_path.c_str(), unix_path.size() + 1);
+			len = static_cast<socklen_type>(offsetof(sockaddr_un, sun_path) + unix_path.size() + 1);
+		}
+	}
+}
+
+namespace VarjoServer {
+
+	Socket::native_handle_type Socket::invalid_handle()
+	{
+#ifdef _WIN32
+		return static_cast<native_handle_type>(INVALID_SOCKET);
+#else
+		return -1;
+#endif
+	}
+
+	Socket::~Socket()
+	{
+		this->close();
+	}
+
+	Socket::Socket(Socket&& other) noexcept
+		: handle_(std::exchange(other.handle_, invalid_handle()))
+	{}
+
+	Socket& Socket::operator=(Socket&& other) noexcept
+	{
+		if (this != &other) {
+			this->close();
+			this->handle_ = std::exchange(other.handle_, invalid_handle());
+		}
+		return *this;
+	}
+
+	bool Socket::startup()
+	{
+#ifdef _WIN32
+		static const bool initialized = [] {
+			WSADATA wsa_data;
+			return WSAStartup(MAKEWORD(2, 2), &wsa_data) == 0;
+		}();
+		return initialized;
+#else
+		return true;
+#endif
+	}
+
+	Socket Socket::listen(const Transport transport, const std::string& host, const uint16_t port, const std::string& unix_path)
+	{
+		if (!startup()) {
+			return Socket();
+		}
+
+		sockaddr_storage addr;
+		socklen_type len;
+		make_address(transport, host, port, unix_path, addr, len);
+		if (len == 0) {
+			return Socket();
+		}
+
+		const int family = transport == Transport::Tcp ? AF_INET : AF_UNIX;
+		Socket sock(static_cast<native_handle_type>(::socket(family, SOCK_STREAM, 0)));
+		if (!sock.is_valid()) {
+			return Socket();
+		}
+
+		if (transport == Transport::Tcp) {
+			int reuse = 1;
+			setsockopt(sock.handle_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+		} else {
+			// 前回の実行で残ったソケットファイルを消す
+#ifdef _WIN32
+			DeleteFileA(unix_path.c_str());
+#else
+			::unlink(unix_path.c_str());
+#endif
+		}
+
+		if (::bind(sock.handle_, reinterpret_cast<sockaddr*>(&addr), len) != 0) {
+			return Socket();
+		}
+		if (::listen(sock.handle_, SOMAXCONN) != 0) {
+			return Socket();
+		}
+		return sock;
+	}
+
+	Socket Socket::connect(const Transport transport, const std::string& host, const uint16_t port, const std::string& unix_path)
+	{
+		if (!startup()) {
+			return Socket();
+		}
+
+		sockaddr_storage addr;
+		socklen_type len;
+		make_address(transport, host, port, unix_path, addr, len);
+		if (len == 0) {
+			return Socket();
+		}
+
+		const int family = transport == Transport::Tcp ? AF_INET : AF_UNIX;
+		Socket sock(static_cast<native_handle_type>(::socket(family, SOCK_STREAM, 0)));
+		if (!sock.is_valid()) {
+			return Socket();
+		}
+
+		if (::connect(sock.handle_, reinterpret_cast<sockaddr*>(&addr), len) != 0) {
+			return Socket();
+		}
+		if (transport == Transport::Tcp) {
+			sock.set_nodelay(true);
+		}
+		return sock;
+	}
+
+	Socket Socket::accept(const int timeout_ms)
+	{
+		if (!this->is_valid()) {
+			return Socket();
+		}
+
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(this->handle_, &fds);
+		timeval tv{ timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+
+		const int ready = ::select(static_cast<int>(this->handle_ + 1), &fds, nullptr, nullptr, &tv);
+		if (ready <= 0) {
+			return Socket();
+		}
+
+		return Socket(static_cast<native_handle_type>(::accept(this->handle_, nullptr, nullptr)));
+	}
+
+	bool Socket::send_vectored(const IoSlice* slices, size_t count)
+	{
+		if (!this->is_valid()) {
+			return false;
+		}
+
+		// 部分送信に備え，送信済みの分だけ先頭を進める
+		size_t index = 0;
+		size_t offset = 0;
+		while (index < count) {
+			if (slices[index].size == offset) {
+				++index;
+				offset = 0;
+				continue;
+			}
+
+			const size_t n = std::min(count - index, max_slices_per_call);
+#ifdef _WIN32
+			WSABUF bufs[max_slices_per_call];
+			for (size_t i = 0; i < n; ++i) {
+				const size_t skip = i == 0 ? offset : 0;
+				bufs[i].buf = const_cast<char*>(static_cast<const char*>(slices[index + i].data) + skip);
+				bufs[i].len = static_cast<ULONG>(slices[index + i].size - skip);
+			}
+			DWORD sent_dw = 0;
+			if (WSASend(this->handle_, bufs, static_cast<DWORD>(n), &sent_dw, 0, nullptr, nullptr) != 0) {
+				return false;
+			}
+			size_t sent = sent_dw;
+#else
+			iovec iov[max_slices_per_call];
+			for (size_t i = 0; i < n; ++i) {
+				const size_t skip = i == 0 ? offset : 0;
+				iov[i].iov_base = const_cast<char*>(static_cast<const char*>(slices[index + i].data) + skip);
+				iov[i].iov_len = slices[index + i].size - skip;
+			}
+			msghdr msg{};
+			msg.msg_iov = iov;
+			msg.msg_iovlen = n;
+			const ssize_t ret = ::sendmsg(this->handle_, &msg, MSG_NOSIGNAL);
+			if (ret < 0) {
+				if (errno == EINTR) continue;
+				return false;
+			}
+			size_t sent = static_cast<size_t>(ret);
+#endif
+			while (sent > 0 && index < count) {
+				const size_t rest = slices[index].size - offset;
+				if (sent >= rest) {
+					sent -= rest;
+					++index;
+					offset = 0;
+				} else {
+					offset += sent;
+					sent = 0;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool Socket::send_all(const void* data, size_t size)
+	{
+		IoSlice slice{ data, size };
+		return this->send_vectored(&slice, 1);
+	}
+
+	bool Socket::recv_all(void* data, size_t size)
+	{
+		auto* p = static_cast<char*>(data);
+		while (size > 0) {
+			const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+#ifdef _WIN32
+			const int ret = ::recv(this->handle_, p, chunk, 0);
+#else
+			const ssize_t ret = ::recv(this->handle_, p, chunk, 0);
+			if (ret < 0 && errno == EINTR) continue;
+#endif
+			if (ret <= 0) {
+				return false;
+			}
+			p += ret;
+			size -= static_cast<size_t>(ret);
+		}
+		return true;
+	}
+
+	size_t Socket::recv_some(void* data, size_t size, const int timeout_ms)
+	{
+		if (!this->is_valid() || size == 0) {
+			return 0;
+		}
+
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(this->handle_, &fds);
+		timeval tv{ timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+
+		if (::select(static_cast<int>(this->handle_ + 1), &fds, nullptr, nullptr, &tv) <= 0) {
+			return 0;
+		}
+
+		const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+#ifdef _WIN32
+		const int ret = ::recv(this->handle_, static_cast<char*>(data), chunk, 0);
+#else
+		const ssize_t ret = ::recv(this->handle_, data, chunk, 0);
+#endif
+		return ret > 0 ? static_cast<size_t>(ret) : 0;
+	}
+
+	void Socket::shutdown()
+	{
+		if (this->is_valid()) {
+#ifdef _WIN32
+			::shutdown(this->handle_, SD_BOTH);
+#else
+			::shutdown(this->handle_, SHUT_RDWR);
+#endif
+		}
+	}
+
+	void Socket::close()
+	{
+		if (this->is_valid()) {
+			close_native(this->handle_);
+			this->handle_ = invalid_handle();
+		}
+	}
+
+	void Socket::set_nodelay(bool enable)
+	{
+		int value = enable ? 1 : 0;
+		setsockopt(this->handle_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void Socket::set_send_buffer_size(int bytes)
+	{
+		setsockopt(this->handle_, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+	}
+
+	void Socket::set_recv_buffer_size(int bytes)
+	{
+		setsockopt(this->handle_, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+	}
+
+	bool Socket::is_valid() const
+	{
+		return this->handle_ != invalid_handle();
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace VarjoServer {
+
+	enum class Transport {
+		Tcp,	// host:port
+		Unix	// ファイルパス(Windows 10 1803以降はAF_UNIXに対応)
+	};
+
+	/**
+	 * @brief 送信するバッファの断片．send_vectoredで連結せずにまとめて送る．
+	 */
+	struct IoSlice {
+		const void* data;
+		size_t size;
+	};
+
+	/**
+	 * @brief ブロッキングソケットの薄いラッパー(Winsock2 / POSIX)．ムーブのみ可能．
+	 */
+	class Socket {
+
+	public:
+#ifdef _WIN32
+		using native_handle_type = uintptr_t;
+#else
+		using native_handle_type = int;
+#endif
+
+		Socket() = default;
+		~Socket();
+
+		Socket(Socket&& other) noexcept;
+		Socket& operator=(Socket&& other) noexcept;
+
+		Socket(const Socket&) = delete;
+		Socket& operator=(const Socket&) = delete;
+
+		/**
+		 * @brief ソケットライブラリを初期化する(WindowsのWSAStartup)．何度呼んでもよい．
+		 */
+		static bool startup();
+
+		static Socket listen(const Transport transport, const std::string& host, const uint16_t port, const std::string& unix_path);
+		static Socket connect(const Transport transport, const std::string& host, const uint16_t port, const std::string& unix_path);
+
+		/**
+		 * @brief timeout_ms以内に接続が来なければ無効なSocketを返す
+		 */
+		Socket accept(const int timeout_ms);
+
+		/**
+		 * @brief 全スライスを送信し終えるまでブロックする．切断・エラーの場合false．
+		 */
+		bool send_vectored(const IoSlice* slices, size_t count);
+		bool send_all(const void* data, size_t size);
+
+		/**
+		 * @brief sizeバイト受信し終えるまでブロックする．切断・エラーの場合false．
+		 */
+		bool recv_all(void* data, size_t size);
+
+		/**
+		 * @brief timeout_ms以内に届いた分だけ(最大sizeバイト)受信する．タイムアウト・切断・エラーの場合0．
+		 */
+		size_t recv_some(void* data, size_t size, const int timeout_ms);
+
+		/**
+		 * @brief 送受信を止め，ブロック中のsend/recvを戻らせる．ハンドルは閉じない．
+		 */
+		void shutdown();
+		void close();
+
+		void set_nodelay(bool enable);
+		void set_send_buffer_size(int bytes);
+		void set_recv_buffer_size(int bytes);
+
+		bool is_valid() const;
+
+	private:
+		explicit Socket(native_handle_type handle)
+			: handle_(handle)
+		{}
+
+	private:
+		native_handle_type handle_ = invalid_handle();
+
+		static native_handle_type invalid_handle();
+	};
+}
@@ -0,0 +1,94 @@
+#include <cstring>
+
+#include "StreamClient.hpp"
+
+namespace VarjoServer {
+
+	StreamClient::StreamClient(const StreamClientOptions& opt)
+		: opt_(opt)
+	{}
+
+	bool StreamClient::connect()
+	{
+		this->sock_ = Socket::connect(this->opt_.transport, this->opt_.host, this->opt_.port, this->opt_.unix_path);
+		if (!this->sock_.is_valid()) {
+			return false;
+		}
+		this->sock_.set_recv_buffer_size(this->opt_.recv_buffer_bytes);
+
+		// Helloを受け取ってから購読を送る
+		if (!this->receive_one()) {
+			this->sock_.close();
+			return false;
+		}
+		return this->subscribe(this->opt_.topic_mask);
+	}
+
+	void StreamClient::disconnect()
+	{
+		this->sock_.shutdown();
+		this->sock_.close();
+	}
+
+	bool StreamClient::subscribe(const uint32_t topic_mask)
+	{
+		const ControlMessage control{ static_cast<uint32_t>(ControlOp::Subscribe), topic_mask };
+		const auto header = make_MessageHeader(Topic::Control, sizeof(control), 0, 0);
+		const IoSlice slices[] = { { &header, sizeof(header) }, { &control, sizeof(control) } };
+		return this->sock_.send_vectored(slices, 2);
+	}
+
+	bool StreamClient::receive_one()
+	{
+		MessageHeader header;
+		if (!this->sock_.recv_all(&header, sizeof(header))) {
+			return false;
+		}
+		if (header.magic != protocol_magic || header.version != protocol_version || header.topic >= static_cast<uint8_t>(Topic::Count)) {
+			return false;
+		}
+
+		this->meta_buf_.resize(header.meta_size);
+		this->data_buf_.resize(header.data_size);
+		if (header.meta_size > 0 && !this->sock_.recv_all(this->meta_buf_.data(), header.meta_size)) {
+			return false;
+		}
+		if (header.data_size > 0 && !this->sock_.recv_all(this->data_buf_.data(), header.data_size)) {
+			return false;
+		}
+		const int64_t received_ns = now_ns();
+
+		const auto topic = static_cast<Topic>(header.topic);
+		if (topic == Topic::Control) {
+			if (this->meta_buf_.size() >= sizeof(ControlMessage)) {
+				ControlMessage control;
+				std::memcpy(&control, this->meta_buf_.data(), sizeof(control));
+				if (static_cast<ControlOp>(control.op) == ControlOp::Hello) {
+					this->available_topics_ = control.topic_mask;
+				}
+			}
+		} else {
+			const size_t index = static_cast<size_t>(topic);
+			auto& stats = this->stats_[index];
+			stats.messages.fetch_add(1, std::memory_order_relaxed);
+			stats.bytes.fetch_add(sizeof(header) + header.meta_size + header.data_size, std::memory_order_relaxed);
+			stats.latency.record(std::chrono::nanoseconds(received_ns - header.server_time_ns));
+
+			if (this->seq_started_[index] && header.seq > this->next_seq_[index]) {
+				stats.seq_gaps.fetch_add(header.seq - this->next_seq_[index], std::memory_order_relaxed);
+			}
+			this->seq_started_[index] = true;
+			this->next_seq_[index] = header.seq + 1;
+		}
+
+		if (this->callback_) {
+			this->callback_(header, this->meta_buf_.data(), this->data_buf_.data());
+		}
+		return true;
+	}
+
+	void StreamClient::run(const std::atomic_bool& stop)
+	{
+		while (!stop.load() && this->receive_one()) {}
+	}
+}
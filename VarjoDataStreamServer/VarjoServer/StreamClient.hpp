@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <functional>
+#include <atomic>
+
+#include "Socket.hpp"
+#include "StreamProtocol.hpp"
+#include "../util/DeadlineSampler.hpp"
+
+namespace VarjoServer {
+
+	struct StreamClientOptions {
+		Transport transport = Transport::Tcp;
+		std::string host = "127.0.0.1";
+		uint16_t port = 50700;
+		std::string unix_path = "varjo_datastream.sock";
+		uint32_t topic_mask = all_data_topics;
+		int recv_buffer_bytes = 8 * 1024 * 1024;
+	};
+
+	/**
+	 * @brief トピックごとの受信統計．latencyはサーバーの送信キュー投入から受信完了までの時間．
+	 */
+	struct TopicStats {
+		std::atomic<uint64_t> messages{0};
+		std::atomic<uint64_t> bytes{0};
+		std::atomic<uint64_t> seq_gaps{0};	// サーバー側で破棄されたメッセージ数
+		Sampling::JitterHistogram latency;
+	};
+
+	/**
+	 * @brief VarjoDataStreamServerの受信クライアント．スループットと遅延の計測に使う．
+	 */
+	class StreamClient {
+
+	public:
+		using MessageCallback = std::function<void(const MessageHeader& header, const uint8_t* meta, const uint8_t* data)>;
+
+		explicit StreamClient(const StreamClientOptions& opt = StreamClientOptions{});
+
+		bool connect();
+		void disconnect();
+
+		/**
+		 * @brief 購読するトピックを変更する．接続中いつでも呼べる．
+		 */
+		bool subscribe(const uint32_t topic_mask);
+
+		/**
+		 * @brief 1メッセージ受信して統計を更新する．切断・プロトコルエラーの場合false．
+		 */
+		bool receive_one();
+
+		/**
+		 * @brief 切断されるかstopがtrueになるまで受信を続ける
+		 */
+		void run(const std::atomic_bool& stop);
+
+		void set_callback(MessageCallback callback) { this->callback_ = std::move(callback); }
+
+		const TopicStats& stats(const Topic topic) const { return this->stats_[static_cast<size_t>(topic)]; }
+		uint32_t available_topics() const { return this->available_topics_; }
+
+	private:
+		const StreamClientOptions opt_;
+		Socket sock_;
+		uint32_t available_topics_ = 0;
+
+		// 受信バッファはメッセージ間で使い回す
+		std::vector<uint8_t> meta_buf_;
+		std::vector<uint8_t> data_buf_;
+
+		std::array<TopicStats, static_cast<size_t>(Topic::Count)> stats_;
+		std::array<uint64_t, static_cast<size_t>(Topic::Count)> next_seq_{};
+		std::array<bool, static_cast<size_t>(Topic::Count)> seq_started_{};
+
+		MessageCallback callback_;
+	};
+}
@@ -0,0 +1,106 @@
+/************************************************************************************************************************
+	Stream Protocol
+	VarjoDataStreamServerとクライアント間のバイナリフレーミング．
+
+	Message : MessageHeader(32) | meta[meta_size] | data[data_size]
+
+	サーバー → クライアント
+		Topic::Control  : meta = ControlMessage(Hello, 配信可能なトピック)
+		Topic::VSTFrame : meta = VarjoVSTFrame::Metadata,  data = 画素データ(ストリームのまま)
+		Topic::EyeCam   : meta = EyeCam::Metadata,         data = 画素データ(ストリームのまま)
+		Topic::Gaze     : meta = GazeRecord
+		Topic::FrameInfo: meta = VarjoFrameInfo::FrameInfoData
+		Topic::Timestamp: meta = TimestampRecord
+	クライアント → サーバー
+		Topic::Control  : meta = ControlMessage(Subscribe, 購読するトピックのビットマスク)
+
+	メタデータはサーバーと同じ構造体をそのまま送る(同一ビルドのクライアントを前提とする)．
+	server_time_nsは送信キューに積んだ時刻(steady_clock)で，同一マシン上のクライアントでは遅延計測に使える．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+#include <Varjo_types.h>
+
+namespace VarjoServer {
+
+	inline constexpr uint32_t protocol_magic = 0x53534456;	// "VDSS"
+	inline constexpr uint8_t protocol_version = 1;
+
+	enum class Topic : uint8_t {
+		Control = 0,
+		VSTFrame = 1,
+		EyeCam = 2,
+		Gaze = 3,
+		FrameInfo = 4,
+		Timestamp = 5,
+		Count
+	};
+
+	constexpr uint32_t topic_bit(const Topic topic) {
+		return 1u << static_cast<uint8_t>(topic);
+	}
+
+	inline constexpr uint32_t all_data_topics =
+		topic_bit(Topic::VSTFrame) | topic_bit(Topic::EyeCam) | topic_bit(Topic::Gaze) |
+		topic_bit(Topic::FrameInfo) | topic_bit(Topic::Timestamp);
+
+	enum class ControlOp : uint32_t {
+		Hello = 1,
+		Subscribe = 2
+	};
+
+	struct MessageHeader {
+		uint32_t magic;
+		uint8_t version;
+		uint8_t topic;
+		uint16_t flags;
+		uint32_t meta_size;
+		uint32_t data_size;
+		uint64_t seq;				// トピックごとの通し番号(欠番はサーバー側での破棄を表す)
+		int64_t server_time_ns;
+	};
+	static_assert(sizeof(MessageHeader) == 32, "MessageHeader must be 32 bytes");
+
+	struct ControlMessage {
+		uint32_t op;
+		uint32_t topic_mask;
+	};
+
+	struct GazeRecord {
+		varjo_Gaze gaze;
+		varjo_Gaze rendering_gaze;
+		varjo_EyeMeasurements eyeMeasurements;
+		double userIPD;
+		double headsetIPD;
+		uint8_t has_userIPD;
+		uint8_t has_headsetIPD;
+	};
+
+	struct TimestampRecord {
+		varjo_Nanoseconds varjo_timestamp;
+		varjo_Nanoseconds varjo_timestamp_unix;
+		int64_t system_timestamp_ns;	// system_clockのエポックからのns
+	};
+
+	inline int64_t now_ns() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	inline MessageHeader make_MessageHeader(const Topic topic, const uint32_t meta_size, const uint32_t data_size, const uint64_t seq) {
+		return MessageHeader{
+			.magic = protocol_magic,
+			.version = protocol_version,
+			.topic = static_cast<uint8_t>(topic),
+			.flags = 0,
+			.meta_size = meta_size,
+			.data_size = data_size,
+			.seq = seq,
+			.server_time_ns = now_ns()
+		};
+	}
+}
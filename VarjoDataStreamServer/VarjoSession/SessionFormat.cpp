@@ -0,0 +1,232 @@
+#include <array>
+#include <cstring>
+
+#include "SessionFormat.hpp"
+
+namespace {
+
+	// 対象環境(x64/ARM64)はリトルエンディアンのため，そのままmemcpyする
+	template<class T>
+	void put(std::vector<uint8_t>& out, const T& value) {
+		const size_t pos = out.size();
+		out.resize(pos + sizeof(T));
+		std::memcpy(out.data() + pos, &value, sizeof(T));
+	}
+
+	template<class T>
+	T get(const uint8_t* p) {
+		T value;
+		std::memcpy(&value, p, sizeof(T));
+		return value;
+	}
+
+	void put_bytes(std::vector<uint8_t>& out, const void* data, const size_t size) {
+		const auto* p = static_cast<const uint8_t*>(data);
+		out.insert(out.end(), p, p + size);
+	}
+
+	const std::array<uint32_t, 256>& crc_table() {
+		static const std::array<uint32_t, 256> table = [] {
+			std::array<uint32_t, 256> t{};
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t c = i;
+				for (int k = 0; k < 8; ++k) {
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				t[i] = c;
+			}
+			return t;
+		}();
+		return table;
+	}
+}
+
+namespace VarjoSession::Format {
+
+	uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc)
+	{
+		const auto& table = crc_table();
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i) {
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	void write_file_header(std::vector<uint8_t>& out, int64_t created_unix_ns)
+	{
+		put_bytes(out, file_magic, sizeof(file_magic));
+		put<uint16_t>(out, version);
+		put<uint16_t>(out, 0);
+		put<int64_t>(out, created_unix_ns);
+	}
+
+	bool check_file_header(const uint8_t* data, size_t size)
+	{
+		return size >= file_header_size
+			&& std::memcmp(data, file_magic, sizeof(file_magic)) == 0
+			&& get<uint16_t>(data + 4) == version;
+	}
+
+	void write_record_header(std::vector<uint8_t>& out, const RecordHeader& header)
+	{
+		put_bytes(out, record_magic, sizeof(record_magic));
+		put<uint8_t>(out, static_cast<uint8_t>(header.type));
+		put<uint8_t>(out, static_cast<uint8_t>(header.compression));
+		put<uint16_t>(out, 0);
+		put<uint32_t>(out, header.payload_size);
+		put<uint32_t>(out, header.crc);
+	}
+
+	bool read_record_header(const uint8_t* data, RecordHeader& header)
+	{
+		if (std::memcmp(data, record_magic, sizeof(record_magic)) != 0) {
+			return false;
+		}
+		header.type = static_cast<RecordType>(data[4]);
+		header.compression = static_cast<Compression>(data[5]);
+		header.payload_size = get<uint32_t>(data + 8);
+		header.crc = get<uint32_t>(data + 12);
+		return true;
+	}
+
+	void write_channel(std::vector<uint8_t>& out, const ChannelInfo& channel)
+	{
+		put<uint16_t>(out, channel.id);
+		put<uint16_t>(out, static_cast<uint16_t>(channel.name.size()));
+		put<uint16_t>(out, static_cast<uint16_t>(channel.encoding.size()));
+		put_bytes(out, channel.name.data(), channel.name.size());
+		put_bytes(out, channel.encoding.data(), channel.encoding.size());
+	}
+
+	size_t read_channel(const uint8_t* data, size_t size, ChannelInfo& channel)
+	{
+		if (size < 6) {
+			return 0;
+		}
+		const uint16_t name_len = get<uint16_t>(data + 2);
+		const uint16_t encoding_len = get<uint16_t>(data + 4);
+		const size_t total = size_t(6) + name_len + encoding_len;
+		if (size < total) {
+			return 0;
+		}
+		channel.id = get<uint16_t>(data);
+		channel.name.assign(reinterpret_cast<const char*>(data + 6), name_len);
+		channel.encoding.assign(reinterpret_cast<const char*>(data + 6 + name_len), encoding_len);
+		return total;
+	}
+
+	void write_chunk_info(std::vector<uint8_t>& out, const ChunkInfo& info)
+	{
+		put<int64_t>(out, info.start_ns);
+		put<int64_t>(out, info.end_ns);
+		put<uint32_t>(out, info.message_count);
+		put<uint32_t>(out, info.uncompressed_size);
+		put<uint64_t>(out, info.channel_mask);
+		put<uint64_t>(out, 0);
+	}
+
+	ChunkInfo read_chunk_info(const uint8_t* data)
+	{
+		return ChunkInfo{
+			.start_ns = get<int64_t>(data),
+			.end_ns = get<int64_t>(data + 8),
+			.message_count = get<uint32_t>(data + 16),
+			.uncompressed_size = get<uint32_t>(data + 20),
+			.channel_mask = get<uint64_t>(data + 24)
+		};
+	}
+
+	void write_message_header(std::vector<uint8_t>& out, const MessageHeader& header)
+	{
+		put<uint16_t>(out, header.channel);
+		put<uint16_t>(out, 0);
+		put<uint32_t>(out, header.size);
+		put<int64_t>(out, header.timestamp_ns);
+	}
+
+	MessageHeader read_message_header(const uint8_t* data)
+	{
+		return MessageHeader{
+			.channel = get<uint16_t>(data),
+			.size = get<uint32_t>(data + 4),
+			.timestamp_ns = get<int64_t>(data + 8)
+		};
+	}
+
+	void write_index(std::vector<uint8_t>& out, const std::vector<ChannelInfo>& channels, const std::vector<ChunkIndexEntry>& chunks)
+	{
+		put<uint16_t>(out, static_cast<uint16_t>(channels.size()));
+		for (const auto& channel : channels) {
+			write_channel(out, channel);
+		}
+		put<uint32_t>(out, static_cast<uint32_t>(chunks.size()));
+		for (const auto& chunk : chunks) {
+			put<uint64_t>(out, chunk.offset);
+			put<int64_t>(out, chunk.start_ns);
+			put<int64_t>(out, chunk.end_ns);
+			put<uint32_t>(out, chunk.message_count);
+			put<uint32_t>(out, 0);
+			put<uint64_t>(out, chunk.channel_mask);
+		}
+	}
+
+	bool read_index(const uint8_t* data, size_t size, std::vector<ChannelInfo>& channels, std::vector<ChunkIndexEntry>& chunks)
+	{
+		size_t pos = 0;
+		if (size < 2) {
+			return false;
+		}
+		const uint16_t channel_count = get<uint16_t>(data);
+		pos += 2;
+
+		channels.clear();
+		for (uint16_t i = 0; i < channel_count; ++i) {
+			ChannelInfo channel;
+			const size_t n = read_channel(data + pos, size - pos, channel);
+			if (n == 0) {
+				return false;
+			}
+			channels.push_back(std::move(channel));
+			pos += n;
+		}
+
+		if (size - pos < 4) {
+			return false;
+		}
+		const uint32_t chunk_count = get<uint32_t>(data + pos);
+		pos += 4;
+		if ((size - pos) / index_entry_size < chunk_count) {
+			return false;
+		}
+
+		chunks.clear();
+		chunks.reserve(chunk_count);
+		for (uint32_t i = 0; i < chunk_count; ++i, pos += index_entry_size) {
+			chunks.push_back(ChunkIndexEntry{
+				.offset = get<uint64_t>(data + pos),
+				.start_ns = get<int64_t>(data + pos + 8),
+				.end_ns = get<int64_t>(data + pos + 16),
+				.message_count = get<uint32_t>(data + pos + 24),
+				.channel_mask = get<uint64_t>(data + pos + 32)
+			});
+		}
+		return true;
+	}
+
+	void write_footer(std::vector<uint8_t>& out, uint64_t index_offset)
+	{
+		put<uint64_t>(out, index_offset);
+		put<uint32_t>(out, 0);
+		put_bytes(out, footer_magic, sizeof(footer_magic));
+	}
+
+	bool read_footer(const uint8_t* data, uint64_t& index_offset)
+	{
+		if (std::memcmp(data + 12, footer_magic, sizeof(footer_magic)) != 0) {
+			return false;
+		}
+		index_offset = get<uint64_t>(data);
+		return true;
+	}
+}
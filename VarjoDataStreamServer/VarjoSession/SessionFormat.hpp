@@ -0,0 +1,130 @@
+/************************************************************************************************************************
+	Session Container Format
+	1セッションの全ストリームを1ファイルに追記していくコンテナ形式．
+
+	[FileHeader] [Record] [Record] ... [Index Record] [Footer]
+
+	FileHeader   : magic "VSES"(4) | version u16 | reserved u16 | created_unix_ns i64
+	Record       : RecordHeader | payload[payload_size]
+	RecordHeader : magic "VREC"(4) | type u8 | compression u8 | reserved u16 | payload_size u32 | crc32 u32(payloadのCRC)
+		Channel (type=1) : id u16 | name_len u16 | encoding_len u16 | name | encoding
+		Chunk   (type=2) : ChunkInfo | messages(compressionで圧縮)
+			ChunkInfo : start_ns i64 | end_ns i64 | message_count u32 | uncompressed_size u32 | channel_mask u64 | reserved u64
+			message   : channel u16 | reserved u16 | size u32 | timestamp_ns i64 | data[size]   (チャンク内は時刻順)
+		Index   (type=3) : channel_count u16 | Channel payload[channel_count] | chunk_count u32 | ChunkIndexEntry[chunk_count]
+			ChunkIndexEntry : offset u64 | start_ns i64 | end_ns i64 | message_count u32 | reserved u32 | channel_mask u64
+	Footer       : index_offset u64 | reserved u32 | magic "VEND"(4)
+
+	チャンクは書き終えるたびにフラッシュする．異常終了でIndexとFooterがない場合も，先頭からRecordHeaderと
+	ChunkInfoだけを辿って索引を作り直せる(途中で切れた最後のチャンクは捨てる)．
+	数値はすべてリトルエンディアン．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace VarjoSession {
+
+	using ChannelId = uint16_t;
+
+	// channel_maskで表せるチャンネル数
+	inline constexpr size_t max_channels = 64;
+
+	enum class Compression : uint8_t {
+		None = 0,
+		Lz = 1
+	};
+
+	struct ChannelInfo {
+		ChannelId id;
+		std::string name;
+		std::string encoding;
+	};
+
+	struct ChunkIndexEntry {
+		uint64_t offset;		// RecordHeaderのファイル先頭からの位置
+		int64_t start_ns;
+		int64_t end_ns;
+		uint32_t message_count;
+		uint64_t channel_mask;
+	};
+
+	namespace Format {
+
+		inline constexpr char file_magic[4] = { 'V', 'S', 'E', 'S' };
+		inline constexpr char record_magic[4] = { 'V', 'R', 'E', 'C' };
+		inline constexpr char footer_magic[4] = { 'V', 'E', 'N', 'D' };
+		inline constexpr uint16_t version = 1;
+
+		inline constexpr size_t file_header_size = 16;
+		inline constexpr size_t record_header_size = 16;
+		inline constexpr size_t chunk_info_size = 40;
+		inline constexpr size_t message_header_size = 16;
+		inline constexpr size_t index_entry_size = 40;
+		inline constexpr size_t footer_size = 16;
+
+		enum class RecordType : uint8_t {
+			Channel = 1,
+			Chunk = 2,
+			Index = 3
+		};
+
+		struct RecordHeader {
+			RecordType type;
+			Compression compression;
+			uint32_t payload_size;
+			uint32_t crc;
+		};
+
+		struct ChunkInfo {
+			int64_t start_ns;
+			int64_t end_ns;
+			uint32_t message_count;
+			uint32_t uncompressed_size;
+			uint64_t channel_mask;
+		};
+
+		struct MessageHeader {
+			ChannelId channel;
+			uint32_t size;
+			int64_t timestamp_ns;
+		};
+
+		uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+		void write_file_header(std::vector<uint8_t>& out, int64_t created_unix_ns);
+		bool check_file_header(const uint8_t* data, size_t size);
+
+		void write_record_header(std::vector<uint8_t>& out, const RecordHeader& header);
+		/**
+		 * @brief record_header_sizeバイトを読む．magicが異なる場合false．
+		 */
+		bool read_record_header(const uint8_t* data, RecordHeader& header);
+
+		void write_channel(std::vector<uint8_t>& out, const ChannelInfo& channel);
+		/**
+		 * @brief dataからChannelを1つ読み，読んだバイト数を返す．足りない場合0．
+		 */
+		size_t read_channel(const uint8_t* data, size_t size, ChannelInfo& channel);
+
+		void write_chunk_info(std::vector<uint8_t>& out, const ChunkInfo& info);
+		ChunkInfo read_chunk_info(const uint8_t* data);
+
+		void write_message_header(std::vector<uint8_t>& out, const MessageHeader& header);
+		MessageHeader read_message_header(const uint8_t* data);
+
+		void write_index(std::vector<uint8_t>& out, const std::vector<ChannelInfo>& channels, const std::vector<ChunkIndexEntry>& chunks);
+		bool read_index(const uint8_t* data, size_t size, std::vector<ChannelInfo>& channels, std::vector<ChunkIndexEntry>& chunks);
+
+		void write_footer(std::vector<uint8_t>& out, uint64_t index_offset);
+		/**
+		 * @brief footer_sizeバイトを読む．magicが異なる場合false．
+		 */
+		bool read_footer(const uint8_t* data, uint64_t& index_offset);
+	}
+}
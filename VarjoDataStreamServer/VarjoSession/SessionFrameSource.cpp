@@ -0,0 +1,81 @@
+#include <stdexcept>
+
+#include "SessionFrameSource.hpp"
+
+namespace VarjoSession {
+
+	SessionFrameSource::SessionFrameSource(const SessionFrameSourceOptions& opt)
+		: opt_(opt)
+	{}
+
+	SessionFrameSource::~SessionFrameSource()
+	{
+		this->stopStream();
+	}
+
+	void SessionFrameSource::startStream()
+	{
+		if (this->replayer_ != nullptr) {
+			return;
+		}
+
+		auto replayer = std::make_unique<SessionReplayer>(SessionReplayerOptions{
+			.path = this->opt_.path,
+			.speed = this->opt_.speed,
+			.loop = this->opt_.loop,
+			.vst_frame_sink = std::make_shared<FrameQueueSink>(*this)
+		});
+		if (!replayer->open()) {
+			throw std::runtime_error("Failed to open session file: " + this->opt_.path);
+		}
+		this->replayer_ = std::move(replayer);
+		this->replayer_->start();
+	}
+
+	void SessionFrameSource::stopStream()
+	{
+		if (this->replayer_ != nullptr) {
+			this->replayer_->stop();
+		}
+	}
+
+	std::pair<std::queue<VarjoVSTFrame::Framedata>, std::queue<VarjoVSTFrame::Metadata>> SessionFrameSource::take_lframe_que()
+	{
+		std::lock_guard lk(this->lframe_que_mtx_);
+		this->release_taken(this->lqueued_bytes_);
+		return std::make_pair(
+			std::exchange(this->lframedata_que_, std::queue<VarjoVSTFrame::Framedata>()),
+			std::exchange(this->lmetadata_que_, std::queue<VarjoVSTFrame::Metadata>())
+		);
+	}
+
+	std::pair<std::queue<VarjoVSTFrame::Framedata>, std::queue<VarjoVSTFrame::Metadata>> SessionFrameSource::take_rframe_que()
+	{
+		std::lock_guard lk(this->rframe_que_mtx_);
+		this->release_taken(this->rqueued_bytes_);
+		return std::make_pair(
+			std::exchange(this->rframedata_que_, std::queue<VarjoVSTFrame::Framedata>()),
+			std::exchange(this->rmetadata_que_, std::queue<VarjoVSTFrame::Metadata>())
+		);
+	}
+
+	void SessionFrameSource::push_frame(VarjoVSTFrame::Frame&& frame)
+	{
+		// 再生スレッドからのみ呼ばれる
+		frame.metadata.streamFrame.frameNumber = this->frame_number_++;
+
+		const bool is_left = frame.metadata.channelIndex == varjo_ChannelIndex_Left;
+		std::mutex& mtx = is_left ? this->lframe_que_mtx_ : this->rframe_que_mtx_;
+		auto& framedata_que = is_left ? this->lframedata_que_ : this->rframedata_que_;
+		auto& metadata_que = is_left ? this->lmetadata_que_ : this->rmetadata_que_;
+		uint64_t& queued_bytes = is_left ? this->lqueued_bytes_ : this->rqueued_bytes_;
+
+		std::lock_guard lk(mtx);
+		this->enqueue_frame(framedata_que, metadata_que, queued_bytes, std::move(frame.data), frame.metadata, this->opt_.buffer_capacity);
+	}
+
+	void SessionFrameSource::FrameQueueSink::submit_batch_impl(SubmitBatch<VarjoVSTFrame::Frame> frames)
+	{
+		std::move(frames).consume([this](VarjoVSTFrame::Frame&& frame) { this->owner_.push_frame(std::move(frame)); });
+	}
+}
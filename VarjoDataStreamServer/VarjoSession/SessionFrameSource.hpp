@@ -0,0 +1,75 @@
+#pragma once
+
+#include <queue>
+#include <mutex>
+#include <memory>
+
+#include "SessionReplayer.hpp"
+#include "../VarjoVSTFrame/VarjoVSTCamStreamer.hpp"
+#include "../VarjoVSTFrame/ISubmitFrame.hpp"
+
+namespace VarjoSession {
+
+	struct SessionFrameSourceOptions {
+		std::string path = "session.vses";
+		// SessionReplayerOptions::speedと同じ．負荷試験では記録時のレートの何倍で流すかを指定する
+		double speed = 1.0;
+		bool loop = true;
+		size_t buffer_capacity = 20;
+	};
+
+	/**
+	 * @brief 記録したセッションのVSTフレームを，実機のVarjoVSTCamStreamerと同じI/FでDataLoggerへ供給するクラス．
+	 * @detail loopで繰り返す場合もframeNumberが重ならないよう，フレームごとに通し番号を振り直す．
+	 */
+	class SessionFrameSource final : public VarjoVSTFrame::IFrameSource {
+
+	public:
+		explicit SessionFrameSource(const SessionFrameSourceOptions& opt);
+		~SessionFrameSource();
+
+		/**
+		 * @brief セッションファイルを開いて再生を始める．開けない場合は例外を投げる
+		 */
+		void startStream() override;
+		void stopStream() override;
+
+		std::pair<std::queue<VarjoVSTFrame::Framedata>, std::queue<VarjoVSTFrame::Metadata>> take_lframe_que() override;
+		std::pair<std::queue<VarjoVSTFrame::Framedata>, std::queue<VarjoVSTFrame::Metadata>> take_rframe_que() override;
+
+		// getter
+		bool is_finished() const { return this->replayer_ != nullptr && this->replayer_->is_finished(); }
+		ReplayStats replay_stats() const { return this->replayer_ != nullptr ? this->replayer_->stats() : ReplayStats{}; }
+
+	private:
+		/**
+		 * @brief SessionReplayerから受け取ったフレームを左右のキューへ積む
+		 */
+		class FrameQueueSink final : public VarjoVSTFrame::ISubmitFrame {
+		public:
+			explicit FrameQueueSink(SessionFrameSource& owner) : owner_(owner) {}
+
+		protected:
+			void submit_batch_impl(SubmitBatch<VarjoVSTFrame::Frame> frames) override;
+
+		private:
+			SessionFrameSource& owner_;
+		};
+
+		void push_frame(VarjoVSTFrame::Frame&& frame);
+
+	private:
+		const SessionFrameSourceOptions opt_;
+		std::unique_ptr<SessionReplayer> replayer_;
+		int64_t frame_number_ = 0;
+
+		std::queue<VarjoVSTFrame::Framedata> lframedata_que_;
+		std::queue<VarjoVSTFrame::Metadata> lmetadata_que_;
+		uint64_t lqueued_bytes_ = 0;
+		std::mutex lframe_que_mtx_;
+		std::queue<VarjoVSTFrame::Framedata> rframedata_que_;
+		std::queue<VarjoVSTFrame::Metadata> rmetadata_que_;
+		uint64_t rqueued_bytes_ = 0;
+		std::mutex rframe_que_mtx_;
+	};
+}
@@ -0,0 +1,248 @@
+#include <algorithm>
+
+#include "SessionReader.hpp"
+#include "../util/LzCodec.hpp"
+
+namespace VarjoSession {
+
+	SessionReader::SessionReader(const std::string& path)
+		: path_(path)
+	{}
+
+	bool SessionReader::open()
+	{
+		if (this->is_open()) {
+			return false;
+		}
+
+		this->file_.open(this->path_, std::ios::in | std::ios::binary);
+		if (!this->file_.is_open()) {
+			return false;
+		}
+
+		this->file_.seekg(0, std::ios::end);
+		const uint64_t file_size = static_cast<uint64_t>(this->file_.tellg());
+
+		uint8_t header[Format::file_header_size];
+		this->file_.seekg(0);
+		if (!this->file_.read(reinterpret_cast<char*>(header), sizeof(header)) || !Format::check_file_header(header, sizeof(header))) {
+			this->file_.close();
+			return false;
+		}
+
+		this->index_rebuilt_ = !this->read_footer_index(file_size);
+		if (this->index_rebuilt_) {
+			this->rebuild_index(file_size);
+		}
+		this->corrupted_chunks_ = 0;
+		return true;
+	}
+
+	void SessionReader::close()
+	{
+		this->file_.close();
+		this->channels_.clear();
+		this->chunks_.clear();
+	}
+
+	size_t SessionReader::read_range(const int64_t start_ns, const int64_t end_ns, const MessageCallback& callback, const uint64_t channel_mask)
+	{
+		size_t delivered = 0;
+		for (const auto& entry : this->chunks_) {
+			// 範囲にもチャンネルにも重ならないチャンクは読まない
+			if (entry.end_ns < start_ns || entry.start_ns > end_ns || (entry.channel_mask & channel_mask) == 0) {
+				continue;
+			}
+			if (!this->load_chunk(entry)) {
+				++this->corrupted_chunks_;
+				continue;
+			}
+			delivered += this->deliver_messages(start_ns, end_ns, callback, channel_mask);
+		}
+		return delivered;
+	}
+
+	size_t SessionReader::read_all(const MessageCallback& callback, const uint64_t channel_mask)
+	{
+		return this->read_range(std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), callback, channel_mask);
+	}
+
+	size_t SessionReader::read_chunk(const size_t index, const MessageCallback& callback, const uint64_t channel_mask)
+	{
+		if (index >= this->chunks_.size() || (this->chunks_[index].channel_mask & channel_mask) == 0) {
+			return 0;
+		}
+		if (!this->load_chunk(this->chunks_[index])) {
+			++this->corrupted_chunks_;
+			return 0;
+		}
+		return this->deliver_messages(std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), callback, channel_mask);
+	}
+
+	std::optional<ChannelId> SessionReader::find_channel(const std::string& name) const
+	{
+		for (const auto& channel : this->channels_) {
+			if (channel.name == name) {
+				return channel.id;
+			}
+		}
+		return std::nullopt;
+	}
+
+	int64_t SessionReader::start_ns() const
+	{
+		int64_t ret = std::numeric_limits<int64_t>::max();
+		for (const auto& entry : this->chunks_) {
+			ret = std::min(ret, entry.start_ns);
+		}
+		return ret;
+	}
+
+	int64_t SessionReader::end_ns() const
+	{
+		int64_t ret = std::numeric_limits<int64_t>::min();
+		for (const auto& entry : this->chunks_) {
+			ret = std::max(ret, entry.end_ns);
+		}
+		return ret;
+	}
+
+	bool SessionReader::read_footer_index(const uint64_t file_size)
+	{
+		if (file_size < Format::file_header_size + Format::record_header_size + Format::footer_size) {
+			return false;
+		}
+
+		uint8_t footer[Format::footer_size];
+		this->file_.seekg(static_cast<std::streamoff>(file_size - Format::footer_size));
+		uint64_t index_offset = 0;
+		if (!this->file_.read(reinterpret_cast<char*>(footer), sizeof(footer)) || !Format::read_footer(footer, index_offset)) {
+			return false;
+		}
+		if (index_offset < Format::file_header_size || index_offset + Format::record_header_size > file_size - Format::footer_size) {
+			return false;
+		}
+
+		uint8_t head[Format::record_header_size];
+		Format::RecordHeader header;
+		this->file_.seekg(static_cast<std::streamoff>(index_offset));
+		if (!this->file_.read(reinterpret_cast<char*>(head), sizeof(head)) || !Format::read_record_header(head, header)
+			|| header.type != Format::RecordType::Index
+			|| index_offset + Format::record_header_size + header.payload_size > file_size - Format::footer_size) {
+			return false;
+		}
+
+		this->payload_buf_.resize(header.payload_size);
+		if (!this->file_.read(reinterpret_cast<char*>(this->payload_buf_.data()), header.payload_size)
+			|| Format::crc32(this->payload_buf_.data(), this->payload_buf_.size()) != header.crc) {
+			return false;
+		}
+
+		return Format::read_index(this->payload_buf_.data(), this->payload_buf_.size(), this->channels_, this->chunks_);
+	}
+
+	void SessionReader::rebuild_index(const uint64_t file_size)
+	{
+		this->file_.clear();
+		this->channels_.clear();
+		this->chunks_.clear();
+
+		uint64_t offset = Format::file_header_size;
+		uint8_t head[Format::record_header_size + Format::chunk_info_size];
+		while (offset + Format::record_header_size <= file_size) {
+			this->file_.seekg(static_cast<std::streamoff>(offset));
+			Format::RecordHeader header;
+			if (!this->file_.read(reinterpret_cast<char*>(head), Format::record_header_size) || !Format::read_record_header(head, header)) {
+				break;
+			}
+
+			// 書き込み途中で切れたレコード以降は捨てる
+			const uint64_t next = offset + Format::record_header_size + header.payload_size;
+			if (next > file_size) {
+				break;
+			}
+
+			if (header.type == Format::RecordType::Channel) {
+				this->payload_buf_.resize(header.payload_size);
+				ChannelInfo channel;
+				if (!this->file_.read(reinterpret_cast<char*>(this->payload_buf_.data()), header.payload_size)
+					|| Format::read_channel(this->payload_buf_.data(), this->payload_buf_.size(), channel) == 0) {
+					break;
+				}
+				this->channels_.push_back(std::move(channel));
+			} else if (header.type == Format::RecordType::Chunk) {
+				// チャンクはヘッダだけを読んで本体は読み飛ばす
+				if (header.payload_size < Format::chunk_info_size
+					|| !this->file_.read(reinterpret_cast<char*>(head + Format::record_header_size), Format::chunk_info_size)) {
+					break;
+				}
+				const auto info = Format::read_chunk_info(head + Format::record_header_size);
+				this->chunks_.push_back(ChunkIndexEntry{
+					.offset = offset,
+					.start_ns = info.start_ns,
+					.end_ns = info.end_ns,
+					.message_count = info.message_count,
+					.channel_mask = info.channel_mask
+				});
+			} else if (header.type == Format::RecordType::Index) {
+				break;
+			}
+			offset = next;
+		}
+		this->file_.clear();
+	}
+
+	bool SessionReader::load_chunk(const ChunkIndexEntry& entry)
+	{
+		this->file_.clear();
+		this->file_.seekg(static_cast<std::streamoff>(entry.offset));
+
+		uint8_t head[Format::record_header_size];
+		Format::RecordHeader header;
+		if (!this->file_.read(reinterpret_cast<char*>(head), sizeof(head)) || !Format::read_record_header(head, header)
+			|| header.type != Format::RecordType::Chunk || header.payload_size < Format::chunk_info_size) {
+			return false;
+		}
+
+		this->payload_buf_.resize(header.payload_size);
+		if (!this->file_.read(reinterpret_cast<char*>(this->payload_buf_.data()), header.payload_size)
+			|| Format::crc32(this->payload_buf_.data(), this->payload_buf_.size()) != header.crc) {
+			return false;
+		}
+
+		const auto info = Format::read_chunk_info(this->payload_buf_.data());
+		const uint8_t* body = this->payload_buf_.data() + Format::chunk_info_size;
+		const size_t body_size = this->payload_buf_.size() - Format::chunk_info_size;
+		if (header.compression == Compression::Lz) {
+			return Lz::decompress(body, body_size, this->message_buf_, info.uncompressed_size);
+		}
+		if (header.compression == Compression::None && body_size == info.uncompressed_size) {
+			this->message_buf_.assign(body, body + body_size);
+			return true;
+		}
+		return false;
+	}
+
+	size_t SessionReader::deliver_messages(const int64_t start_ns, const int64_t end_ns, const MessageCallback& callback, const uint64_t channel_mask)
+	{
+		size_t delivered = 0;
+		size_t pos = 0;
+		const size_t size = this->message_buf_.size();
+		while (size - pos >= Format::message_header_size) {
+			const auto header = Format::read_message_header(this->message_buf_.data() + pos);
+			pos += Format::message_header_size;
+			if (header.size > size - pos) {
+				++this->corrupted_chunks_;
+				break;
+			}
+
+			if (header.timestamp_ns >= start_ns && header.timestamp_ns <= end_ns
+				&& header.channel < max_channels && (channel_mask & (uint64_t(1) << header.channel)) != 0) {
+				callback(MessageView{ header.channel, header.timestamp_ns, this->message_buf_.data() + pos, header.size });
+				++delivered;
+			}
+			pos += header.size;
+		}
+		return delivered;
+	}
+}
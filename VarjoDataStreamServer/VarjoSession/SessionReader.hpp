@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <limits>
+
+#include "SessionFormat.hpp"
+
+namespace VarjoSession {
+
+	/**
+	 * @brief 読み出したメッセージ．dataはコールバックの間だけ有効．
+	 */
+	struct MessageView {
+		ChannelId channel;
+		int64_t timestamp_ns;
+		const uint8_t* data;
+		size_t size;
+	};
+
+	/**
+	 * @brief セッションファイルを読むクラス．
+	 * @detail openはフッタから索引だけを読むため，ファイルの大きさによらずすぐに終わる．索引がない(異常終了した)場合は
+	 *         チャンクのヘッダを辿って作り直す．時刻範囲の読み出しは範囲に重なるチャンクだけを読む．
+	 */
+	class SessionReader {
+
+	public:
+		using MessageCallback = std::function<void(const MessageView& message)>;
+
+		explicit SessionReader(const std::string& path);
+
+		bool open();
+		void close();
+
+		/**
+		 * @brief [start_ns, end_ns]のメッセージを時刻順(チャンク内)に渡す．渡した数を返す．
+		 * @param channel_mask 読むチャンネルのビットマスク
+		 */
+		size_t read_range(const int64_t start_ns, const int64_t end_ns, const MessageCallback& callback,
+			const uint64_t channel_mask = std::numeric_limits<uint64_t>::max());
+
+		size_t read_all(const MessageCallback& callback, const uint64_t channel_mask = std::numeric_limits<uint64_t>::max());
+
+		/**
+		 * @brief chunk_index()[index]のチャンクだけを読む．チャンク単位で先読みする再生などに使う．
+		 */
+		size_t read_chunk(const size_t index, const MessageCallback& callback,
+			const uint64_t channel_mask = std::numeric_limits<uint64_t>::max());
+
+		std::optional<ChannelId> find_channel(const std::string& name) const;
+
+		// getter
+		bool is_open() const { return this->file_.is_open(); }
+		bool index_rebuilt() const { return this->index_rebuilt_; }
+		const std::vector<ChannelInfo>& channels() const { return this->channels_; }
+		const std::vector<ChunkIndexEntry>& chunk_index() const { return this->chunks_; }
+		int64_t start_ns() const;
+		int64_t end_ns() const;
+		uint64_t corrupted_chunks() const { return this->corrupted_chunks_; }
+
+	private:
+		bool read_footer_index(const uint64_t file_size);
+		void rebuild_index(const uint64_t file_size);
+		bool load_chunk(const ChunkIndexEntry& entry);
+		size_t deliver_messages(const int64_t start_ns, const int64_t end_ns, const MessageCallback& callback, const uint64_t channel_mask);
+
+	private:
+		const std::string path_;
+		std::ifstream file_;
+
+		std::vector<ChannelInfo> channels_;
+		std::vector<ChunkIndexEntry> chunks_;
+		bool index_rebuilt_ = false;
+		uint64_t corrupted_chunks_ = 0;
+
+		// チャンクの読み込みに使い回す
+		std::vector<uint8_t> payload_buf_;
+		std::vector<uint8_t> message_buf_;
+	};
+}
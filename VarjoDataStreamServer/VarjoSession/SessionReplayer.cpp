@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <queue>
+#include <cstring>
+
+#include "SessionReplayer.hpp"
+#include "../VarjoServer/StreamProtocol.hpp"
+#include "../util/PerformanceChecker.hpp"
+
+namespace {
+	constexpr auto late_threshold = std::chrono::milliseconds(1);
+
+	template<class T>
+	T read_pod(const std::vector<uint8_t>& payload) {
+		T value;
+		std::memcpy(&value, payload.data(), sizeof(T));
+		return value;
+	}
+
+	/**
+	 * @brief Metadata | 画素データ のメッセージをFrameに戻す
+	 */
+	VarjoExamples::DataStreamer::Frame make_frame(const std::vector<uint8_t>& payload) {
+		using Frame = VarjoExamples::DataStreamer::Frame;
+		Frame frame;
+		std::memcpy(&frame.metadata, payload.data(), sizeof(Frame::Metadata));
+		frame.data.assign(payload.begin() + sizeof(Frame::Metadata), payload.end());
+		return frame;
+	}
+}
+
+namespace VarjoSession {
+
+	SessionReplayer::SessionReplayer(const SessionReplayerOptions& opt)
+		: opt_(opt),
+		reader_(opt.path)
+	{}
+
+	SessionReplayer::~SessionReplayer()
+	{
+		this->stop();
+	}
+
+	bool SessionReplayer::open()
+	{
+		if (!this->reader_.open()) {
+			return false;
+		}
+
+		// sinkが設定されているストリームのチャンネルだけを読む
+		this->channel_kinds_.assign(max_channels, StreamKind::None);
+		this->channel_mask_ = 0;
+		for (const auto& channel : this->reader_.channels()) {
+			StreamKind kind = StreamKind::None;
+			if (channel.name == "vst/left" || channel.name == "vst/right") {
+				if (this->opt_.vst_frame_sink || this->opt_.vst_metadata_sink) kind = StreamKind::VSTFrame;
+			} else if (channel.name == "eyecam/left" || channel.name == "eyecam/right") {
+				if (this->opt_.eyecam_frame_sink || this->opt_.eyecam_metadata_sink) kind = StreamKind::EyeCam;
+			} else if (channel.name == "gaze") {
+				if (this->opt_.gaze_sink) kind = StreamKind::Gaze;
+			} else if (channel.name == "frame_info") {
+				if (this->opt_.frame_info_sink) kind = StreamKind::FrameInfo;
+			} else if (channel.name == "timestamp") {
+				if (this->opt_.timestamp_sink) kind = StreamKind::Timestamp;
+			}
+
+			if (kind != StreamKind::None && channel.id < max_channels) {
+				this->channel_kinds_[channel.id] = kind;
+				this->channel_mask_ |= uint64_t(1) << channel.id;
+			}
+		}
+
+		// チャンクは書き込み順に並んでいるので開始時刻順に並べ直す
+		const auto& chunks = this->reader_.chunk_index();
+		this->chunk_order_.resize(chunks.size());
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			this->chunk_order_[i] = i;
+		}
+		std::stable_sort(this->chunk_order_.begin(), this->chunk_order_.end(), [&chunks](size_t a, size_t b) {
+			return chunks[a].start_ns < chunks[b].start_ns;
+		});
+		return true;
+	}
+
+	void SessionReplayer::start()
+	{
+		if (!this->reader_.is_open() || this->replay_thread_.joinable()) {
+			return;
+		}
+		this->stop_replay_thread_ = false;
+		this->finished_ = false;
+		this->replay_thread_ = std::thread(&SessionReplayer::replay_worker, this);
+	}
+
+	void SessionReplayer::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->stop_mtx_);
+			this->stop_replay_thread_ = true;
+		}
+		this->stop_cv_.notify_all();
+		if (this->replay_thread_.joinable()) {
+			this->replay_thread_.join();
+		}
+	}
+
+	void SessionReplayer::wait()
+	{
+		if (this->replay_thread_.joinable()) {
+			this->replay_thread_.join();
+		}
+	}
+
+	ReplayStats SessionReplayer::stats() const
+	{
+		std::lock_guard<std::mutex> lock(this->stats_mtx_);
+		return this->stats_;
+	}
+
+	void SessionReplayer::replay_worker()
+	{
+		auto thread_reg = PerformanceChecker::register_thread("session_replayer");
+		while (this->replay_once() && this->opt_.loop) {
+			std::lock_guard<std::mutex> lock(this->stats_mtx_);
+			++this->stats_.loops;
+		}
+		this->finished_ = true;
+	}
+
+	bool SessionReplayer::replay_once()
+	{
+		const auto later = [](const PendingMessage& a, const PendingMessage& b) {
+			return a.timestamp_ns != b.timestamp_ns ? a.timestamp_ns > b.timestamp_ns : a.seq > b.seq;
+		};
+		std::priority_queue<PendingMessage, std::vector<PendingMessage>, decltype(later)> pending(later);
+
+		const auto& chunks = this->reader_.chunk_index();
+		size_t next_chunk = 0;
+		uint64_t seq = 0;
+
+		bool started = false;
+		int64_t base_ns = 0;
+		std::chrono::steady_clock::time_point base_time;
+
+		while (true) {
+			// 先頭のメッセージより前に始まるチャンクを全て読み込んでから渡す
+			while (next_chunk < this->chunk_order_.size()
+				&& (pending.empty() || chunks[this->chunk_order_[next_chunk]].start_ns <= pending.top().timestamp_ns)) {
+				this->reader_.read_chunk(this->chunk_order_[next_chunk++], [&](const MessageView& view) {
+					pending.push(PendingMessage{
+						.timestamp_ns = view.timestamp_ns,
+						.seq = seq++,
+						.kind = this->channel_kinds_[view.channel],
+						.payload = std::vector<uint8_t>(view.data, view.data + view.size)
+					});
+				}, this->channel_mask_);
+			}
+			if (pending.empty()) {
+				// 再生するメッセージがなければloopでも終える
+				return seq > 0;
+			}
+
+			PendingMessage message = std::move(const_cast<PendingMessage&>(pending.top()));
+			pending.pop();
+
+			if (this->opt_.speed > 0.0) {
+				if (!started) {
+					started = true;
+					base_ns = message.timestamp_ns;
+					base_time = std::chrono::steady_clock::now();
+				}
+				const auto offset = std::chrono::nanoseconds(static_cast<int64_t>((message.timestamp_ns - base_ns) / this->opt_.speed));
+				const auto target = base_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+				if (!this->wait_until(target)) {
+					return false;
+				}
+
+				const auto lag = std::chrono::steady_clock::now() - target;
+				if (lag >= late_threshold) {
+					std::lock_guard<std::mutex> lock(this->stats_mtx_);
+					++this->stats_.late_messages;
+					this->stats_.max_lag_ns = std::max<int64_t>(this->stats_.max_lag_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(lag).count());
+				}
+			} else if (this->stop_replay_thread_.load(std::memory_order_relaxed)) {
+				return false;
+			}
+
+			this->dispatch(message);
+		}
+	}
+
+	bool SessionReplayer::wait_until(const std::chrono::steady_clock::time_point& time_point)
+	{
+		std::unique_lock<std::mutex> lock(this->stop_mtx_);
+		return !this->stop_cv_.wait_until(lock, time_point, [this] { return this->stop_replay_thread_.load(); });
+	}
+
+	void SessionReplayer::dispatch(PendingMessage& message)
+	{
+		const auto& payload = message.payload;
+		bool malformed = false;
+
+		switch (message.kind) {
+		case StreamKind::VSTFrame:
+		case StreamKind::EyeCam:
+			if (payload.size() < sizeof(VarjoExamples::DataStreamer::Frame::Metadata)) {
+				malformed = true;
+				break;
+			}
+			if (message.kind == StreamKind::VSTFrame) {
+				auto frame = make_frame(payload);
+				if (this->opt_.vst_metadata_sink) {
+					this->opt_.vst_metadata_sink->submit_metadata(frame.metadata);
+				}
+				if (this->opt_.vst_frame_sink) {
+					this->opt_.vst_frame_sink->submit_frame(std::move(frame));
+				}
+			} else {
+				auto frame = make_frame(payload);
+				if (this->opt_.eyecam_metadata_sink) {
+					this->opt_.eyecam_metadata_sink->submit_Metadata(frame.metadata);
+				}
+				if (this->opt_.eyecam_frame_sink) {
+					this->opt_.eyecam_frame_sink->submit_Frame(std::move(frame));
+				}
+			}
+			break;
+
+		case StreamKind::Gaze: {
+			if (payload.size() != sizeof(VarjoServer::GazeRecord)) {
+				malformed = true;
+				break;
+			}
+			const auto record = read_pod<VarjoServer::GazeRecord>(payload);
+			VarjoEyeTracking::EyeTrackingData data{
+				.gaze = record.gaze,
+				.rendering_gaze = record.rendering_gaze,
+				.eyeMeasurements = record.eyeMeasurements
+			};
+			if (record.has_userIPD) data.userIPD = record.userIPD;
+			if (record.has_headsetIPD) data.headsetIPD = record.headsetIPD;
+			this->opt_.gaze_sink->submit_EyeTrackingData(std::move(data));
+			break;
+		}
+
+		case StreamKind::FrameInfo:
+			if (payload.size() != sizeof(VarjoFrameInfo::FrameInfoData)) {
+				malformed = true;
+				break;
+			}
+			this->opt_.frame_info_sink->submit_FrameInfoData(read_pod<VarjoFrameInfo::FrameInfoData>(payload));
+			break;
+
+		case StreamKind::Timestamp: {
+			if (payload.size() != sizeof(VarjoServer::TimestampRecord)) {
+				malformed = true;
+				break;
+			}
+			const auto record = read_pod<VarjoServer::TimestampRecord>(payload);
+			this->opt_.timestamp_sink->submit_TimestampData(Timestamp::TimestampData{
+				.varjo_timestamp = record.varjo_timestamp,
+				.varjo_timestamp_unix = record.varjo_timestamp_unix,
+				.system_timestamp = std::chrono::system_clock::time_point(
+					std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(record.system_timestamp_ns)))
+			});
+			break;
+		}
+
+		default:
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(this->stats_mtx_);
+		if (malformed) {
+			++this->stats_.malformed_messages;
+		} else {
+			++this->stats_.messages;
+		}
+	}
+}
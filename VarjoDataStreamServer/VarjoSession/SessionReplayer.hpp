@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "SessionReader.hpp"
+#include "../VarjoVSTFrame/ISubmitFrame.hpp"
+#include "../VarjoEyeCam/ISubmitEyeCam.hpp"
+#include "../VarjoEyeTracking/ISubmit.hpp"
+#include "../VarjoFrameInfo/ISubmitFrameInfo.hpp"
+#include "../VarjoTimestamp/ISubmitTimestamp.hpp"
+
+namespace VarjoSession {
+
+	/**
+	 * @brief 再生の設定．sinkがnullptrのストリームは読まない．
+	 */
+	struct SessionReplayerOptions {
+		std::string path = "session.vses";
+		// 1.0で実時間，2.0で2倍速．0以下の場合は待たずに最速で流す
+		double speed = 1.0;
+		// 末尾まで再生したら先頭に戻る
+		bool loop = false;
+
+		std::shared_ptr<VarjoVSTFrame::ISubmitFrame> vst_frame_sink;
+		std::shared_ptr<VarjoVSTFrame::ISubmitMetadata> vst_metadata_sink;
+		std::shared_ptr<EyeCam::ISubmitFrame> eyecam_frame_sink;
+		std::shared_ptr<EyeCam::ISubmitMetadata> eyecam_metadata_sink;
+		std::shared_ptr<VarjoEyeTracking::ISubmitEyeTrackingData> gaze_sink;
+		std::shared_ptr<VarjoFrameInfo::ISubmitFrameInfo> frame_info_sink;
+		std::shared_ptr<Timestamp::ISubmitTimestamp> timestamp_sink;
+	};
+
+	struct ReplayStats {
+		uint64_t messages = 0;
+		uint64_t loops = 0;
+		// 予定時刻より1ms以上遅れて渡したメッセージ数と最大の遅れ(sinkが遅い場合に増える)
+		uint64_t late_messages = 0;
+		int64_t max_lag_ns = 0;
+		uint64_t malformed_messages = 0;
+	};
+
+	/**
+	 * @brief SessionWriterで記録したセッションを，全ストリームを時刻順に合流させて既存のISubmit*へ流すクラス．
+	 * @detail チャンクを開始時刻順に読み，次のチャンクの開始時刻までに確定したメッセージから順に渡すため，
+	 *         チャンク同士の時刻が重なっていても全体として時刻順になる．ヘッドセットなしでDataLoggerやWriterの
+	 *         負荷試験を決まった入力で繰り返すために使う．
+	 */
+	class SessionReplayer {
+
+	public:
+		explicit SessionReplayer(const SessionReplayerOptions& opt);
+		~SessionReplayer();
+
+		SessionReplayer(const SessionReplayer&) = delete;
+		SessionReplayer& operator=(const SessionReplayer&) = delete;
+
+		bool open();
+
+		void start();
+		void stop();
+
+		/**
+		 * @brief 末尾まで再生し終える(loopの場合はstopされる)まで待つ
+		 */
+		void wait();
+
+		// getter
+		bool is_finished() const { return this->finished_.load(); }
+		ReplayStats stats() const;
+		const SessionReader& reader() const { return this->reader_; }
+
+	private:
+		enum class StreamKind : uint8_t {
+			None, VSTFrame, EyeCam, Gaze, FrameInfo, Timestamp
+		};
+
+		struct PendingMessage {
+			int64_t timestamp_ns;
+			uint64_t seq;		// 同時刻のメッセージはファイル内の順序を保つ
+			StreamKind kind;
+			std::vector<uint8_t> payload;
+		};
+
+		void replay_worker();
+		bool replay_once();
+		bool wait_until(const std::chrono::steady_clock::time_point& time_point);
+		void dispatch(PendingMessage& message);
+
+	private:
+		const SessionReplayerOptions opt_;
+		SessionReader reader_;
+
+		std::vector<StreamKind> channel_kinds_;
+		uint64_t channel_mask_ = 0;
+		std::vector<size_t> chunk_order_;
+
+		std::thread replay_thread_;
+		std::atomic_bool stop_replay_thread_{true};
+		std::atomic_bool finished_{false};
+		std::mutex stop_mtx_;
+		std::condition_variable stop_cv_;
+
+		ReplayStats stats_;
+		mutable std::mutex stats_mtx_;
+	};
+}
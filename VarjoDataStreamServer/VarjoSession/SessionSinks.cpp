@@ -0,0 +1,122 @@
+#include "SessionSinks.hpp"
+#include "../VarjoServer/StreamProtocol.hpp"
+
+namespace {
+
+	/**
+	 * @brief Frameを1メッセージ(Metadata | 画素データ)として書く．画素データは複製せずにチャンクへ直接書き込む．
+	 */
+	template<class FrameT>
+	void write_frame(VarjoSession::SessionWriter& writer, const VarjoSession::ChannelId lchannel, const VarjoSession::ChannelId rchannel,
+		const bool with_framedata, const FrameT& frame)
+	{
+		const auto& metadata = frame.metadata;
+		const auto channel = metadata.channelIndex == varjo_ChannelIndex_Left ? lchannel : rchannel;
+		writer.write(
+			channel,
+			static_cast<int64_t>(metadata.timestamp),
+			&metadata, sizeof(metadata),
+			frame.data.data(), with_framedata ? frame.data.size() : 0);
+	}
+}
+
+namespace VarjoSession {
+
+	/****************************************************************************************************
+	* VSTFrameSessionSink
+	*****************************************************************************************************/
+
+	VSTFrameSessionSink::VSTFrameSessionSink(std::shared_ptr<SessionWriter> writer, const bool with_framedata)
+		: writer_(std::move(writer)),
+		with_framedata_(with_framedata),
+		lchannel_(this->writer_->add_channel("vst/left", "VarjoVSTFrame::Metadata+framedata")),
+		rchannel_(this->writer_->add_channel("vst/right", "VarjoVSTFrame::Metadata+framedata"))
+	{}
+
+	void VSTFrameSessionSink::submit_batch_impl(SubmitBatch<VarjoVSTFrame::Frame> frames)
+	{
+		for (const auto& frame : frames.view()) {
+			write_frame(*this->writer_, this->lchannel_, this->rchannel_, this->with_framedata_, frame);
+		}
+	}
+
+	/****************************************************************************************************
+	* EyeCamSessionSink
+	*****************************************************************************************************/
+
+	EyeCamSessionSink::EyeCamSessionSink(std::shared_ptr<SessionWriter> writer, const bool with_framedata)
+		: writer_(std::move(writer)),
+		with_framedata_(with_framedata),
+		lchannel_(this->writer_->add_channel("eyecam/left", "EyeCam::Metadata+framedata")),
+		rchannel_(this->writer_->add_channel("eyecam/right", "EyeCam::Metadata+framedata"))
+	{}
+
+	void EyeCamSessionSink::submit_batch_impl(SubmitBatch<EyeCam::Frame> frames)
+	{
+		for (const auto& frame : frames.view()) {
+			write_frame(*this->writer_, this->lchannel_, this->rchannel_, this->with_framedata_, frame);
+		}
+	}
+
+	/****************************************************************************************************
+	* GazeSessionSink
+	*****************************************************************************************************/
+
+	GazeSessionSink::GazeSessionSink(std::shared_ptr<SessionWriter> writer)
+		: writer_(std::move(writer)),
+		channel_(this->writer_->add_channel("gaze", "VarjoServer::GazeRecord"))
+	{}
+
+	void GazeSessionSink::submit_batch_impl(SubmitBatch<VarjoEyeTracking::EyeTrackingData> data)
+	{
+		for (const auto& d : data.view()) {
+			const VarjoServer::GazeRecord record{
+				.gaze = d.gaze,
+				.rendering_gaze = d.rendering_gaze,
+				.eyeMeasurements = d.eyeMeasurements,
+				.userIPD = d.userIPD.value_or(0.0),
+				.headsetIPD = d.headsetIPD.value_or(0.0),
+				.has_userIPD = static_cast<uint8_t>(d.userIPD.has_value()),
+				.has_headsetIPD = static_cast<uint8_t>(d.headsetIPD.has_value())
+			};
+			this->writer_->write(this->channel_, static_cast<int64_t>(d.gaze.captureTime), &record, sizeof(record));
+		}
+	}
+
+	/****************************************************************************************************
+	* FrameInfoSessionSink
+	*****************************************************************************************************/
+
+	FrameInfoSessionSink::FrameInfoSessionSink(std::shared_ptr<SessionWriter> writer)
+		: writer_(std::move(writer)),
+		channel_(this->writer_->add_channel("frame_info", "VarjoFrameInfo::FrameInfoData"))
+	{}
+
+	void FrameInfoSessionSink::submit_batch_impl(SubmitBatch<VarjoFrameInfo::FrameInfoData> data)
+	{
+		for (const auto& d : data.view()) {
+			this->writer_->write(this->channel_, static_cast<int64_t>(d.timestamp), &d, sizeof(VarjoFrameInfo::FrameInfoData));
+		}
+	}
+
+	/****************************************************************************************************
+	* TimestampSessionSink
+	*****************************************************************************************************/
+
+	TimestampSessionSink::TimestampSessionSink(std::shared_ptr<SessionWriter> writer)
+		: writer_(std::move(writer)),
+		channel_(this->writer_->add_channel("timestamp", "VarjoServer::TimestampRecord"))
+	{}
+
+	void TimestampSessionSink::submit_batch_impl(SubmitBatch<Timestamp::TimestampData> data)
+	{
+		for (const auto& d : data.view()) {
+			const VarjoServer::TimestampRecord record{
+				.varjo_timestamp = d.varjo_timestamp,
+				.varjo_timestamp_unix = d.varjo_timestamp_unix,
+				.system_timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d.system_timestamp.time_since_epoch()).count()
+			};
+			this->writer_->write(this->channel_, static_cast<int64_t>(d.varjo_timestamp), &record, sizeof(record));
+		}
+	}
+}
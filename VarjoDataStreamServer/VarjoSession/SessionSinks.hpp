@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <queue>
+#include <deque>
+
+#include "SessionWriter.hpp"
+#include "../VarjoVSTFrame/ISubmitFrame.hpp"
+#include "../VarjoEyeCam/ISubmitEyeCam.hpp"
+#include "../VarjoEyeTracking/ISubmit.hpp"
+#include "../VarjoFrameInfo/ISubmitFrameInfo.hpp"
+#include "../VarjoTimestamp/ISubmitTimestamp.hpp"
+
+/****************************************************************************************************
+* 各ストリームのISubmit*をSessionWriterのチャンネルにつなぐアダプタ．
+* 既存のCSV/動画Writerと並べてDataLoggerに渡せば，同じデータがセッションファイルにも記録される．
+* メッセージの形式はVarjoServer(StreamProtocol.hpp)のメタデータと同じ構造体で，フレームは後ろに画素データが続く．
+*****************************************************************************************************/
+
+namespace VarjoSession {
+
+	/****************************************************************************************************
+	* @class VSTFrameSessionSink
+	* チャンネル : "vst/left", "vst/right"
+	*****************************************************************************************************/
+
+	class VSTFrameSessionSink : public VarjoVSTFrame::ISubmitFrame {
+
+	public:
+		/**
+		 * @param with_framedata falseの場合はメタデータのみを記録する
+		 */
+		explicit VSTFrameSessionSink(std::shared_ptr<SessionWriter> writer, const bool with_framedata = true);
+
+	protected:
+		void submit_batch_impl(SubmitBatch<VarjoVSTFrame::Frame> frames) override;
+
+	private:
+		const std::shared_ptr<SessionWriter> writer_;
+		const bool with_framedata_;
+		ChannelId lchannel_;
+		ChannelId rchannel_;
+	};
+
+	/****************************************************************************************************
+	* @class EyeCamSessionSink
+	* チャンネル : "eyecam/left", "eyecam/right"
+	*****************************************************************************************************/
+
+	class EyeCamSessionSink : public EyeCam::ISubmitFrame {
+
+	public:
+		explicit EyeCamSessionSink(std::shared_ptr<SessionWriter> writer, const bool with_framedata = true);
+
+	protected:
+		void submit_batch_impl(SubmitBatch<EyeCam::Frame> frames) override;
+
+	private:
+		const std::shared_ptr<SessionWriter> writer_;
+		const bool with_framedata_;
+		ChannelId lchannel_;
+		ChannelId rchannel_;
+	};
+
+	/****************************************************************************************************
+	* @class GazeSessionSink
+	* チャンネル : "gaze"
+	*****************************************************************************************************/
+
+	class GazeSessionSink : public VarjoEyeTracking::ISubmitEyeTrackingData {
+
+	public:
+		explicit GazeSessionSink(std::shared_ptr<SessionWriter> writer);
+
+	protected:
+		void submit_batch_impl(SubmitBatch<VarjoEyeTracking::EyeTrackingData> data) override;
+
+	private:
+		const std::shared_ptr<SessionWriter> writer_;
+		ChannelId channel_;
+	};
+
+	/****************************************************************************************************
+	* @class FrameInfoSessionSink
+	* チャンネル : "frame_info"
+	*****************************************************************************************************/
+
+	class FrameInfoSessionSink : public VarjoFrameInfo::ISubmitFrameInfo {
+
+	public:
+		explicit FrameInfoSessionSink(std::shared_ptr<SessionWriter> writer);
+
+	protected:
+		void submit_batch_impl(SubmitBatch<VarjoFrameInfo::FrameInfoData> data) override;
+
+	private:
+		const std::shared_ptr<SessionWriter> writer_;
+		ChannelId channel_;
+	};
+
+	/****************************************************************************************************
+	* @class TimestampSessionSink
+	* チャンネル : "timestamp"
+	*****************************************************************************************************/
+
+	class TimestampSessionSink : public Timestamp::ISubmitTimestamp {
+
+	public:
+		explicit TimestampSessionSink(std::shared_ptr<SessionWriter> writer);
+
+	protected:
+		void submit_batch_impl(SubmitBatch<Timestamp::TimestampData> data) override;
+
+	private:
+		const std::shared_ptr<SessionWriter> writer_;
+		ChannelId channel_;
+	};
+}
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "SessionWriter.hpp"
+#include "../util/LzCodec.hpp"
+#include "../util/filesystem_util.hpp"
+#include "../util/PerformanceChecker.hpp"
+
+namespace VarjoSession {
+
+	SessionWriter::SessionWriter(const SessionWriterOptions& opt)
+		: opt_(opt)
+		, path_(solve_filename_conflict(opt.path))
+		, file_(AsyncIo::AsyncFileOptions{ .unbuffered = opt.unbuffered_io })
+	{}
+
+	SessionWriter::~SessionWriter()
+	{
+		this->close();
+	}
+
+	bool SessionWriter::open()
+	{
+		if (this->is_open()) {
+			return false;
+		}
+
+		if (!this->file_.open(this->path_)) {
+			return false;
+		}
+
+		std::vector<uint8_t> header;
+		const int64_t created = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		Format::write_file_header(header, created);
+		this->file_.write(header.data(), header.size());
+		this->file_.flush();
+		this->file_offset_ = header.size();
+
+		// スレッドを起動
+		this->stop_writer_thread_ = false;
+		this->writer_thread_ = std::thread(&SessionWriter::writer_worker, this);
+
+		return true;
+	}
+
+	void SessionWriter::close()
+	{
+		if (!this->is_open()) {
+			return;
+		}
+
+		// 書きかけのチャンクを渡してから書き込みスレッドを止める
+		{
+			std::lock_guard<std::mutex> lock(this->current_mtx_);
+			this->rotate_chunk_locked();
+		}
+		this->stop_writer_thread_ = true;
+		this->job_que_cv_.notify_all();
+		if (this->writer_thread_.joinable()) {
+			this->writer_thread_.join();
+		}
+
+		// 索引とフッタ
+		std::vector<uint8_t> payload;
+		Format::write_index(payload, this->channels_, this->chunk_index_);
+		const uint64_t index_offset = this->file_offset_;
+		this->write_record(Format::RecordHeader{
+			.type = Format::RecordType::Index,
+			.compression = Compression::None,
+			.payload_size = static_cast<uint32_t>(payload.size()),
+			.crc = Format::crc32(payload.data(), payload.size())
+		}, payload);
+
+		std::vector<uint8_t> footer;
+		Format::write_footer(footer, index_offset);
+		this->file_.write(footer.data(), footer.size());
+		this->file_.close();
+	}
+
+	ChannelId SessionWriter::add_channel(const std::string& name, const std::string& encoding)
+	{
+		std::lock_guard<std::mutex> lock(this->current_mtx_);
+		for (const auto& channel : this->channels_) {
+			if (channel.name == name) {
+				return channel.id;
+			}
+		}
+		if (this->channels_.size() >= max_channels) {
+			throw std::runtime_error("SessionWriter: too many channels");
+		}
+
+		ChannelInfo channel{ static_cast<ChannelId>(this->channels_.size()), name, encoding };
+		this->channels_.push_back(channel);
+
+		// 先に溜まっているメッセージより後ろに置かれるよう，チャンクを区切ってから渡す
+		this->rotate_chunk_locked();
+		Job job;
+		Format::write_channel(job.channel_payload, channel);
+		{
+			std::lock_guard<std::mutex> que_lock(this->job_que_mtx_);
+			this->job_que_.push_back(std::move(job));
+		}
+		this->job_que_cv_.notify_one();
+
+		return channel.id;
+	}
+
+	void SessionWriter::write(const ChannelId channel, const int64_t timestamp_ns, const void* data, const size_t size)
+	{
+		this->write(channel, timestamp_ns, data, size, nullptr, 0);
+	}
+
+	void SessionWriter::write(const ChannelId channel, const int64_t timestamp_ns, const void* header, const size_t header_size, const void* data, const size_t data_size)
+	{
+		if (channel >= max_channels) {
+			throw std::invalid_argument("SessionWriter: invalid channel");
+		}
+
+		std::lock_guard<std::mutex> lock(this->current_mtx_);
+		auto& chunk = this->current_;
+		if (chunk.refs.empty()) {
+			chunk.start_ns = timestamp_ns;
+			chunk.end_ns = timestamp_ns;
+		}
+
+		const size_t offset = chunk.messages.size();
+		Format::write_message_header(chunk.messages, Format::MessageHeader{
+			.channel = channel,
+			.size = static_cast<uint32_t>(header_size + data_size),
+			.timestamp_ns = timestamp_ns
+		});
+		if (header_size > 0) {
+			const auto* p = static_cast<const uint8_t*>(header);
+			chunk.messages.insert(chunk.messages.end(), p, p + header_size);
+		}
+		if (data_size > 0) {
+			const auto* p = static_cast<const uint8_t*>(data);
+			chunk.messages.insert(chunk.messages.end(), p, p + data_size);
+		}
+
+		chunk.refs.push_back(MessageRef{ timestamp_ns, offset, chunk.messages.size() - offset });
+		chunk.start_ns = std::min(chunk.start_ns, timestamp_ns);
+		chunk.end_ns = std::max(chunk.end_ns, timestamp_ns);
+		chunk.channel_mask |= uint64_t(1) << channel;
+		this->message_count_.fetch_add(1, std::memory_order_relaxed);
+
+		const auto duration = std::chrono::nanoseconds(chunk.end_ns - chunk.start_ns);
+		if (chunk.messages.size() >= this->opt_.chunk_bytes || duration >= this->opt_.chunk_duration) {
+			this->rotate_chunk_locked();
+		}
+	}
+
+	void SessionWriter::rotate_chunk_locked()
+	{
+		if (this->current_.refs.empty()) {
+			return;
+		}
+
+		Job job;
+		job.chunk = std::move(this->current_);
+		this->current_ = PendingChunk{};
+		{
+			std::lock_guard<std::mutex> lock(this->job_que_mtx_);
+			this->job_que_.push_back(std::move(job));
+		}
+		this->job_que_cv_.notify_one();
+	}
+
+	void SessionWriter::writer_worker()
+	{
+		auto thread_reg = PerformanceChecker::register_thread("session_writer");
+		std::deque<Job> jobs;
+
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(this->job_que_mtx_);
+				this->job_que_cv_.wait(lock, [this] { return !this->job_que_.empty() || this->stop_writer_thread_; });
+				if (this->job_que_.empty() && this->stop_writer_thread_) {
+					break;
+				}
+
+				// キューの退避
+				jobs.swap(this->job_que_);
+			}
+
+			for (auto& job : jobs) {
+				if (!job.channel_payload.empty()) {
+					this->write_record(Format::RecordHeader{
+						.type = Format::RecordType::Channel,
+						.compression = Compression::None,
+						.payload_size = static_cast<uint32_t>(job.channel_payload.size()),
+						.crc = Format::crc32(job.channel_payload.data(), job.channel_payload.size())
+					}, job.channel_payload);
+				} else {
+					this->write_chunk(job.chunk);
+				}
+			}
+			jobs.clear();
+
+			// チャンク単位でI/Oプールへ渡し，異常終了しても書き終えたチャンクは読めるようにする(unbufferedではブロック単位)
+			this->file_.flush();
+		}
+	}
+
+	void SessionWriter::write_chunk(PendingChunk& chunk)
+	{
+		// 各ストリームのメッセージを時刻順に並べる
+		std::stable_sort(chunk.refs.begin(), chunk.refs.end(),
+			[](const MessageRef& a, const MessageRef& b) { return a.timestamp_ns < b.timestamp_ns; });
+
+		this->ordered_buf_.clear();
+		this->ordered_buf_.reserve(chunk.messages.size());
+		for (const auto& ref : chunk.refs) {
+			this->ordered_buf_.insert(this->ordered_buf_.end(),
+				chunk.messages.begin() + ref.offset, chunk.messages.begin() + ref.offset + ref.size);
+		}
+
+		Compression compression = this->opt_.compression;
+		const std::vector<uint8_t>* body = &this->ordered_buf_;
+		if (compression == Compression::Lz) {
+			Lz::compress(this->ordered_buf_.data(), this->ordered_buf_.size(), this->compressed_buf_);
+			// 縮まない場合(画素データなど)は無圧縮で置く
+			if (this->compressed_buf_.size() < this->ordered_buf_.size()) {
+				body = &this->compressed_buf_;
+			} else {
+				compression = Compression::None;
+			}
+		}
+
+		std::vector<uint8_t>& payload = this->record_buf_;
+		payload.clear();
+		Format::write_chunk_info(payload, Format::ChunkInfo{
+			.start_ns = chunk.start_ns,
+			.end_ns = chunk.end_ns,
+			.message_count = static_cast<uint32_t>(chunk.refs.size()),
+			.uncompressed_size = static_cast<uint32_t>(this->ordered_buf_.size()),
+			.channel_mask = chunk.channel_mask
+		});
+		payload.insert(payload.end(), body->begin(), body->end());
+
+		this->chunk_index_.push_back(ChunkIndexEntry{
+			.offset = this->file_offset_,
+			.start_ns = chunk.start_ns,
+			.end_ns = chunk.end_ns,
+			.message_count = static_cast<uint32_t>(chunk.refs.size()),
+			.channel_mask = chunk.channel_mask
+		});
+
+		this->write_record(Format::RecordHeader{
+			.type = Format::RecordType::Chunk,
+			.compression = compression,
+			.payload_size = static_cast<uint32_t>(payload.size()),
+			.crc = Format::crc32(payload.data(), payload.size())
+		}, payload);
+		this->chunk_count_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void SessionWriter::write_record(const Format::RecordHeader& header, const std::vector<uint8_t>& payload)
+	{
+		std::vector<uint8_t> head;
+		Format::write_record_header(head, header);
+		this->file_.write(head.data(), head.size());
+		this->file_.write(payload.data(), payload.size());
+
+		this->file_offset_ += head.size() + payload.size();
+		this->written_bytes_.store(this->file_offset_, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "SessionFormat.hpp"
+#include "../util/AsyncFile.hpp"
+
+namespace VarjoSession {
+
+	struct SessionWriterOptions {
+		std::string path = "session.vses";
+		// どちらかを超えたらチャンクを閉じる
+		size_t chunk_bytes = 4 * 1024 * 1024;
+		std::chrono::milliseconds chunk_duration{ 1000 };
+		Compression compression = Compression::Lz;
+		// OSのキャッシュを通さずに書く(フレームデータなど大きなセッション向け)
+		bool unbuffered_io = false;
+	};
+
+	/**
+	 * @brief 全ストリームを1つのセッションファイルに書くクラス．
+	 * @detail writeは任意のスレッドから呼べる．メッセージはチャンクにまとめられ，専用スレッドで時刻順に並べ替え・圧縮してから
+	 *         追記される．closeで索引とフッタを書く．
+	 */
+	class SessionWriter {
+
+	public:
+		explicit SessionWriter(const SessionWriterOptions& opt = SessionWriterOptions{});
+		~SessionWriter();
+
+		SessionWriter(const SessionWriter&) = delete;
+		SessionWriter& operator=(const SessionWriter&) = delete;
+
+		bool open();
+		void close();
+
+		/**
+		 * @brief チャンネルを登録する．同名のチャンネルがあればそのidを返す．
+		 */
+		ChannelId add_channel(const std::string& name, const std::string& encoding);
+
+		void write(const ChannelId channel, const int64_t timestamp_ns, const void* data, const size_t size);
+
+		/**
+		 * @brief headerとdataを連結して1メッセージとして書く(一時バッファを作らない)
+		 */
+		void write(const ChannelId channel, const int64_t timestamp_ns, const void* header, const size_t header_size, const void* data, const size_t data_size);
+
+		// getter
+		bool is_open() const { return this->file_.is_open(); }
+		const std::string& path() const { return this->path_; }
+		uint64_t message_count() const { return this->message_count_.load(std::memory_order_relaxed); }
+		uint64_t chunk_count() const { return this->chunk_count_.load(std::memory_order_relaxed); }
+		uint64_t written_bytes() const { return this->written_bytes_.load(std::memory_order_relaxed); }
+
+	private:
+		struct MessageRef {
+			int64_t timestamp_ns;
+			size_t offset;
+			size_t size;
+		};
+
+		struct PendingChunk {
+			std::vector<uint8_t> messages;
+			std::vector<MessageRef> refs;
+			int64_t start_ns = 0;
+			int64_t end_ns = 0;
+			uint64_t channel_mask = 0;
+		};
+
+		// 書き込みスレッドへ渡す仕事．チャンネル定義もファイル内の順序を保つため同じキューを通す
+		struct Job {
+			std::vector<uint8_t> channel_payload;
+			PendingChunk chunk;
+		};
+
+		void writer_worker();
+		void rotate_chunk_locked();
+		void write_chunk(PendingChunk& chunk);
+		void write_record(const Format::RecordHeader& header, const std::vector<uint8_t>& payload);
+
+	private:
+		const SessionWriterOptions opt_;
+		const std::string path_;
+		AsyncIo::AsyncFile file_;
+		uint64_t file_offset_ = 0;
+
+		std::vector<ChannelInfo> channels_;
+		std::vector<ChunkIndexEntry> chunk_index_;
+
+		PendingChunk current_;
+		std::mutex current_mtx_;
+
+		std::deque<Job> job_que_;
+		std::mutex job_que_mtx_;
+		std::condition_variable job_que_cv_;
+		std::thread writer_thread_;
+		std::atomic_bool stop_writer_thread_{true};
+
+		// 書き込みスレッドのみが使う作業領域
+		std::vector<uint8_t> ordered_buf_;
+		std::vector<uint8_t> compressed_buf_;
+		std::vector<uint8_t> record_buf_;
+
+		std::atomic<uint64_t> message_count_{0};
+		std::atomic<uint64_t> chunk_count_{0};
+		std::atomic<uint64_t> written_bytes_{0};
+	};
+}
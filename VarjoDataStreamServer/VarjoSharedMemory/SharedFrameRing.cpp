@@ -0,0 +1,515 @@
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <utility>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "SharedFrameRing.hpp"
+
+namespace {
+
+	// これより長く更新のない読み手は終了したとみなし，テーブルのエントリを再利用する
+	constexpr int64_t stale_reader_ns = 5'000'000'000;
+
+	inline std::atomic_ref<uint64_t> atomic_field(const uint64_t& field) {
+		return std::atomic_ref<uint64_t>(const_cast<uint64_t&>(field));
+	}
+
+	inline std::atomic_ref<uint32_t> atomic_field(const uint32_t& field) {
+		return std::atomic_ref<uint32_t>(const_cast<uint32_t&>(field));
+	}
+
+	inline uint64_t align_up(const uint64_t value, const uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	inline int64_t steady_now_ns() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+#ifdef _WIN32
+	std::wstring mapping_name(const std::string& name) {
+		return L"Local\\" + std::wstring(name.begin(), name.end());
+	}
+#else
+	std::string posix_name(const std::string& name) {
+		return "/" + name;
+	}
+#endif
+}
+
+namespace SharedMemory {
+
+	/****************************************************************************************************
+	* SharedRegion
+	*****************************************************************************************************/
+
+	SharedRegion::~SharedRegion()
+	{
+		this->close();
+	}
+
+	SharedRegion::SharedRegion(SharedRegion&& other) noexcept
+		: base_(std::exchange(other.base_, nullptr))
+		, size_(std::exchange(other.size_, 0))
+#ifdef _WIN32
+		, mapping_(std::exchange(other.mapping_, nullptr))
+#else
+		, posix_name_(std::move(other.posix_name_))
+		, unlink_on_close_(std::exchange(other.unlink_on_close_, false))
+#endif
+	{}
+
+	SharedRegion& SharedRegion::operator=(SharedRegion&& other) noexcept
+	{
+		if (this != &other) {
+			this->close();
+			this->base_ = std::exchange(other.base_, nullptr);
+			this->size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+			this->mapping_ = std::exchange(other.mapping_, nullptr);
+#else
+			this->posix_name_ = std::move(other.posix_name_);
+			this->unlink_on_close_ = std::exchange(other.unlink_on_close_, false);
+#endif
+		}
+		return *this;
+	}
+
+	SharedRegion SharedRegion::create(const std::string& name, const size_t size)
+	{
+		SharedRegion region;
+#ifdef _WIN32
+		HANDLE mapping = CreateFileMappingW(
+			INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), mapping_name(name).c_str());
+		if (mapping == nullptr) {
+			return region;
+		}
+
+		// 読み手が残っていると既存の領域が返るため，大きさを確認する
+		void* base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		MEMORY_BASIC_INFORMATION info{};
+		if (base == nullptr || VirtualQuery(base, &info, sizeof(info)) == 0 || info.RegionSize < size) {
+			if (base != nullptr) {
+				UnmapViewOfFile(base);
+			}
+			CloseHandle(mapping);
+			return region;
+		}
+		region.mapping_ = mapping;
+		region.base_ = static_cast<uint8_t*>(base);
+#else
+		const std::string shm_name = posix_name(name);
+		::shm_unlink(shm_name.c_str());
+
+		const int fd = ::shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0) {
+			return region;
+		}
+		if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+			::close(fd);
+			::shm_unlink(shm_name.c_str());
+			return region;
+		}
+		void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (base == MAP_FAILED) {
+			::shm_unlink(shm_name.c_str());
+			return region;
+		}
+		region.base_ = static_cast<uint8_t*>(base);
+		region.posix_name_ = shm_name;
+		region.unlink_on_close_ = true;
+#endif
+		region.size_ = size;
+		return region;
+	}
+
+	SharedRegion SharedRegion::open(const std::string& name)
+	{
+		SharedRegion region;
+#ifdef _WIN32
+		HANDLE mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, mapping_name(name).c_str());
+		if (mapping == nullptr) {
+			return region;
+		}
+		void* base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		MEMORY_BASIC_INFORMATION info{};
+		if (base == nullptr || VirtualQuery(base, &info, sizeof(info)) == 0) {
+			if (base != nullptr) {
+				UnmapViewOfFile(base);
+			}
+			CloseHandle(mapping);
+			return region;
+		}
+		region.mapping_ = mapping;
+		region.base_ = static_cast<uint8_t*>(base);
+		region.size_ = info.RegionSize;
+#else
+		const std::string shm_name = posix_name(name);
+		const int fd = ::shm_open(shm_name.c_str(), O_RDWR, 0600);
+		if (fd < 0) {
+			return region;
+		}
+		struct stat st{};
+		if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+			::close(fd);
+			return region;
+		}
+		void* base = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (base == MAP_FAILED) {
+			return region;
+		}
+		region.base_ = static_cast<uint8_t*>(base);
+		region.size_ = static_cast<size_t>(st.st_size);
+#endif
+		return region;
+	}
+
+	void SharedRegion::close()
+	{
+		if (this->base_ == nullptr) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(this->base_);
+		CloseHandle(static_cast<HANDLE>(this->mapping_));
+		this->mapping_ = nullptr;
+#else
+		::munmap(this->base_, this->size_);
+		if (this->unlink_on_close_) {
+			::shm_unlink(this->posix_name_.c_str());
+			this->unlink_on_close_ = false;
+		}
+#endif
+		this->base_ = nullptr;
+		this->size_ = 0;
+	}
+
+	/****************************************************************************************************
+	* FramePublisher
+	*****************************************************************************************************/
+
+	FramePublisher::FramePublisher(const FramePublisherOptions& opt)
+		: opt_(opt)
+	{
+		if (opt.slot_count < 2) {
+			throw std::invalid_argument("FramePublisher: slot_count must be at least 2");
+		}
+		if (opt.name.empty()) {
+			throw std::invalid_argument("FramePublisher: name is empty");
+		}
+	}
+
+	FramePublisher::~FramePublisher()
+	{
+		this->close();
+	}
+
+	bool FramePublisher::open()
+	{
+		if (this->is_open()) {
+			return false;
+		}
+
+		// numpyでそのまま参照できるよう，metaとdataは64バイト境界，スロットはページ境界に揃える
+		const uint64_t meta_capacity = align_up(this->opt_.meta_capacity, 64);
+		const uint64_t readers_offset = VSHM_RING_HEADER_SIZE;
+		const uint64_t slots_offset = align_up(readers_offset + uint64_t(VSHM_READER_ENTRY_SIZE) * this->opt_.max_readers, VSHM_SLOT_ALIGNMENT);
+		const uint64_t slot_stride = align_up(VSHM_SLOT_HEADER_SIZE + meta_capacity + this->opt_.data_capacity, VSHM_SLOT_ALIGNMENT);
+		const uint64_t total_size = slots_offset + slot_stride * this->opt_.slot_count;
+
+		this->region_ = SharedRegion::create(this->opt_.name, static_cast<size_t>(total_size));
+		if (!this->region_.is_valid()) {
+			return false;
+		}
+
+		uint8_t* base = this->region_.data();
+		auto* header = reinterpret_cast<vshm_RingHeader*>(base);
+
+		// 既存の領域を再利用した場合に備え，ヘッダと読み手テーブルとスロットの番号を初期化する
+		atomic_field(header->magic).store(0, std::memory_order_relaxed);
+		std::memset(base + sizeof(uint32_t), 0, static_cast<size_t>(slots_offset) - sizeof(uint32_t));
+		for (uint32_t i = 0; i < this->opt_.slot_count; ++i) {
+			auto* slot = reinterpret_cast<vshm_SlotHeader*>(base + slots_offset + slot_stride * i);
+			atomic_field(slot->seq).store(0, std::memory_order_relaxed);
+		}
+
+		header->version = VSHM_VERSION;
+		header->slot_count = this->opt_.slot_count;
+		header->max_readers = this->opt_.max_readers;
+		header->total_size = total_size;
+		header->slot_stride = slot_stride;
+		header->slots_offset = slots_offset;
+		header->readers_offset = readers_offset;
+		header->meta_capacity = static_cast<uint32_t>(meta_capacity);
+		header->data_capacity = this->opt_.data_capacity;
+		atomic_field(header->write_seq).store(0, std::memory_order_relaxed);
+		atomic_field(header->writer_open).store(1, std::memory_order_relaxed);
+
+		// magicは最後に書き，読み手が初期化途中のヘッダを見ないようにする
+		atomic_field(header->magic).store(VSHM_MAGIC, std::memory_order_release);
+
+		return true;
+	}
+
+	void FramePublisher::close()
+	{
+		std::lock_guard<std::mutex> lock(this->publish_mtx_);
+		if (!this->region_.is_valid()) {
+			return;
+		}
+		auto* header = reinterpret_cast<vshm_RingHeader*>(this->region_.data());
+		atomic_field(header->writer_open).store(0, std::memory_order_release);
+		this->region_.close();
+	}
+
+	bool FramePublisher::publish(const VarjoExamples::DataStreamer::Frame& frame)
+	{
+		return this->publish(frame.metadata, frame.data);
+	}
+
+	bool FramePublisher::publish(const VarjoExamples::DataStreamer::Frame::Metadata& metadata, const std::vector<uint8_t>& framedata)
+	{
+		const auto& buffer = metadata.bufferMetadata;
+
+		vshm_SlotHeader info{};
+		info.timestamp_ns = metadata.timestamp;
+		info.channel = static_cast<uint32_t>(metadata.channelIndex);
+		info.format = static_cast<uint32_t>(buffer.format);
+		info.width = static_cast<uint32_t>(buffer.width);
+		info.height = static_cast<uint32_t>(buffer.height);
+		info.row_stride = static_cast<uint32_t>(buffer.rowStride);
+
+		return this->publish(info, &metadata, sizeof(metadata), framedata.data(), framedata.size());
+	}
+
+	bool FramePublisher::publish(const vshm_SlotHeader& info, const void* meta, const size_t meta_size, const void* data, const size_t data_size)
+	{
+		std::lock_guard<std::mutex> lock(this->publish_mtx_);
+		if (!this->region_.is_valid()) {
+			return false;
+		}
+
+		uint8_t* base = this->region_.data();
+		auto* header = reinterpret_cast<vshm_RingHeader*>(base);
+		if (meta_size > header->meta_capacity || data_size > header->data_capacity) {
+			this->rejected_count_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		const uint64_t n = atomic_field(header->write_seq).load(std::memory_order_relaxed) + 1;
+		uint8_t* slot_base = base + header->slots_offset + header->slot_stride * ((n - 1) % header->slot_count);
+		auto* slot = reinterpret_cast<vshm_SlotHeader*>(slot_base);
+
+		// 書き込み中は奇数にし，上書き中のスロットを読んだ読み手が検出できるようにする
+		auto seq = atomic_field(slot->seq);
+		seq.store(2 * n + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		slot->timestamp_ns = info.timestamp_ns;
+		slot->publish_time_ns = steady_now_ns();
+		slot->channel = info.channel;
+		slot->format = info.format;
+		slot->width = info.width;
+		slot->height = info.height;
+		slot->row_stride = info.row_stride;
+		slot->meta_size = static_cast<uint32_t>(meta_size);
+		slot->data_size = data_size;
+		if (meta_size > 0) {
+			std::memcpy(slot_base + VSHM_SLOT_HEADER_SIZE, meta, meta_size);
+		}
+		if (data_size > 0) {
+			std::memcpy(slot_base + VSHM_SLOT_HEADER_SIZE + header->meta_capacity, data, data_size);
+		}
+
+		seq.store(2 * n, std::memory_order_release);
+		atomic_field(header->write_seq).store(n, std::memory_order_release);
+		atomic_field(header->writer_heartbeat_ns).store(static_cast<uint64_t>(slot->publish_time_ns), std::memory_order_relaxed);
+
+		this->published_count_.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	std::vector<ReaderStatus> FramePublisher::readers() const
+	{
+		std::vector<ReaderStatus> ret;
+		if (!this->region_.is_valid()) {
+			return ret;
+		}
+
+		const uint8_t* base = this->region_.data();
+		const auto* header = reinterpret_cast<const vshm_RingHeader*>(base);
+		const uint64_t write_seq = atomic_field(header->write_seq).load(std::memory_order_acquire);
+		const auto* entries = reinterpret_cast<const vshm_ReaderEntry*>(base + header->readers_offset);
+		for (uint32_t i = 0; i < header->max_readers; ++i) {
+			if (atomic_field(entries[i].owner).load(std::memory_order_acquire) == 0) {
+				continue;
+			}
+			const uint64_t cursor = atomic_field(entries[i].cursor).load(std::memory_order_relaxed);
+			ret.push_back(ReaderStatus{
+				.cursor = cursor,
+				.lag = write_seq > cursor ? write_seq - cursor : 0,
+				.overruns = atomic_field(entries[i].overruns).load(std::memory_order_relaxed)
+			});
+		}
+		return ret;
+	}
+
+	/****************************************************************************************************
+	* FrameReader
+	*****************************************************************************************************/
+
+	FrameReader::FrameReader(const std::string& name)
+		: name_(name)
+	{}
+
+	FrameReader::~FrameReader()
+	{
+		this->detach();
+	}
+
+	bool FrameReader::attach()
+	{
+		if (this->is_attached()) {
+			return false;
+		}
+
+		this->region_ = SharedRegion::open(this->name_);
+		if (!this->region_.is_valid()) {
+			return false;
+		}
+
+		const auto* header = this->ring_header();
+		if (this->region_.size() < sizeof(vshm_RingHeader)
+			|| atomic_field(header->magic).load(std::memory_order_acquire) != VSHM_MAGIC
+			|| header->version != VSHM_VERSION
+			|| header->total_size > this->region_.size()) {
+			this->region_.close();
+			return false;
+		}
+
+		// 読み手テーブルに登録する．空きがない場合も読み込みはできる
+		std::random_device rd;
+		do {
+			this->owner_token_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+		} while (this->owner_token_ == 0);
+
+		auto* entries = reinterpret_cast<vshm_ReaderEntry*>(this->region_.data() + header->readers_offset);
+		const int64_t now = steady_now_ns();
+		for (uint32_t i = 0; i < header->max_readers && this->entry_ == nullptr; ++i) {
+			auto owner = atomic_field(entries[i].owner);
+			uint64_t current = owner.load(std::memory_order_acquire);
+			const int64_t heartbeat = static_cast<int64_t>(atomic_field(entries[i].heartbeat_ns).load(std::memory_order_relaxed));
+			if (current != 0 && now - heartbeat < stale_reader_ns) {
+				continue;
+			}
+			if (owner.compare_exchange_strong(current, this->owner_token_, std::memory_order_acq_rel)) {
+				this->entry_ = &entries[i];
+			}
+		}
+
+		this->cursor_ = atomic_field(header->write_seq).load(std::memory_order_acquire);
+		this->overruns_ = 0;
+		if (this->entry_ != nullptr) {
+			atomic_field(this->entry_->overruns).store(0, std::memory_order_relaxed);
+		}
+		this->update_reader_entry();
+		return true;
+	}
+
+	void FrameReader::detach()
+	{
+		if (this->entry_ != nullptr) {
+			uint64_t expected = this->owner_token_;
+			atomic_field(this->entry_->owner).compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+			this->entry_ = nullptr;
+		}
+		this->region_.close();
+	}
+
+	ReadResult FrameReader::next(FrameView& view)
+	{
+		if (!this->is_attached()) {
+			return ReadResult::Detached;
+		}
+
+		const auto* header = this->ring_header();
+		while (true) {
+			const uint64_t write_seq = atomic_field(header->write_seq).load(std::memory_order_acquire);
+
+			// 書き手が開き直した場合は先頭から読み直す
+			if (write_seq < this->cursor_) {
+				this->cursor_ = write_seq;
+			}
+			if (write_seq == this->cursor_) {
+				this->update_reader_entry();
+				return ReadResult::NoData;
+			}
+
+			// リングを一周以上追い越された分は失う
+			if (write_seq - this->cursor_ > header->slot_count) {
+				this->overruns_ += write_seq - header->slot_count - this->cursor_;
+				this->cursor_ = write_seq - header->slot_count;
+			}
+
+			const uint64_t n = this->cursor_ + 1;
+			const auto* slot_header = this->slot(n);
+			if (atomic_field(slot_header->seq).load(std::memory_order_acquire) == 2 * n) {
+				view.header = slot_header;
+				view.meta = reinterpret_cast<const uint8_t*>(slot_header) + VSHM_SLOT_HEADER_SIZE;
+				view.data = view.meta + header->meta_capacity;
+				view.seq = n;
+				this->cursor_ = n;
+				this->update_reader_entry();
+				return ReadResult::Frame;
+			}
+
+			// 確認している間に上書きが始まった
+			++this->overruns_;
+			this->cursor_ = n;
+		}
+	}
+
+	bool FrameReader::is_valid(const FrameView& view) const
+	{
+		if (!this->is_attached() || view.header == nullptr) {
+			return false;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return atomic_field(view.header->seq).load(std::memory_order_relaxed) == 2 * view.seq;
+	}
+
+	bool FrameReader::writer_open() const
+	{
+		return this->is_attached() && atomic_field(this->ring_header()->writer_open).load(std::memory_order_acquire) == 1;
+	}
+
+	const vshm_SlotHeader* FrameReader::slot(const uint64_t seq) const
+	{
+		const auto* header = this->ring_header();
+		return reinterpret_cast<const vshm_SlotHeader*>(
+			this->region_.data() + header->slots_offset + header->slot_stride * ((seq - 1) % header->slot_count));
+	}
+
+	void FrameReader::update_reader_entry()
+	{
+		if (this->entry_ == nullptr) {
+			return;
+		}
+		atomic_field(this->entry_->cursor).store(this->cursor_, std::memory_order_relaxed);
+		atomic_field(this->entry_->overruns).store(this->overruns_, std::memory_order_relaxed);
+		atomic_field(this->entry_->heartbeat_ns).store(static_cast<uint64_t>(steady_now_ns()), std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include "vshm_layout.h"
+#include "../VarjoExample/DataStreamer.hpp"
+
+namespace SharedMemory {
+
+	/**
+	 * @brief 名前付き共有メモリの割り当て(WindowsはFile Mapping，それ以外はPOSIX shm)．ムーブのみ可能．
+	 */
+	class SharedRegion {
+
+	public:
+		SharedRegion() = default;
+		~SharedRegion();
+
+		SharedRegion(SharedRegion&& other) noexcept;
+		SharedRegion& operator=(SharedRegion&& other) noexcept;
+
+		SharedRegion(const SharedRegion&) = delete;
+		SharedRegion& operator=(const SharedRegion&) = delete;
+
+		/**
+		 * @brief 書き手として作成する．同名の領域が残っている場合は作り直す．
+		 */
+		static SharedRegion create(const std::string& name, const size_t size);
+
+		/**
+		 * @brief 読み手として既存の領域を開く．大きさは領域から取得する．
+		 */
+		static SharedRegion open(const std::string& name);
+
+		void close();
+
+		uint8_t* data() const { return this->base_; }
+		size_t size() const { return this->size_; }
+		bool is_valid() const { return this->base_ != nullptr; }
+
+	private:
+		uint8_t* base_ = nullptr;
+		size_t size_ = 0;
+#ifdef _WIN32
+		void* mapping_ = nullptr;
+#else
+		std::string posix_name_;
+		bool unlink_on_close_ = false;
+#endif
+	};
+
+	struct FramePublisherOptions {
+		std::string name = "VarjoVST";
+		uint32_t slot_count = 8;
+		uint32_t max_readers = 8;
+		uint32_t meta_capacity = 1024;
+		uint64_t data_capacity = 4 * 1024 * 1024;
+	};
+
+	/**
+	 * @brief 書き手から見た読み手の状態
+	 */
+	struct ReaderStatus {
+		uint64_t cursor;
+		uint64_t lag;			// 未読のフレーム数
+		uint64_t overruns;
+	};
+
+	/**
+	 * @brief フレームを共有メモリのリングに書き込む．
+	 * @detail 読み手は共有メモリ上のフレームをその場で参照するため，読み手の数によらず1フレームにつきコピーは1回．
+	 *         書き手は読み手を待たず，読み遅れた読み手は自分でoverrunを検出する．
+	 */
+	class FramePublisher {
+
+	public:
+		explicit FramePublisher(const FramePublisherOptions& opt = FramePublisherOptions{});
+		~FramePublisher();
+
+		FramePublisher(const FramePublisher&) = delete;
+		FramePublisher& operator=(const FramePublisher&) = delete;
+
+		bool open();
+		void close();
+
+		/**
+		 * @brief DataStreamerのフレームを書き込む．メタデータ構造体はそのままmeta領域に置く．
+		 * @return 開いていない場合やdata_capacityを超える場合false
+		 */
+		bool publish(const VarjoExamples::DataStreamer::Frame& frame);
+		bool publish(const VarjoExamples::DataStreamer::Frame::Metadata& metadata, const std::vector<uint8_t>& framedata);
+
+		bool publish(const vshm_SlotHeader& info, const void* meta, const size_t meta_size, const void* data, const size_t data_size);
+
+		std::vector<ReaderStatus> readers() const;
+
+		// getter
+		bool is_open() const { return this->region_.is_valid(); }
+		uint64_t published_count() const { return this->published_count_.load(std::memory_order_relaxed); }
+		uint64_t rejected_count() const { return this->rejected_count_.load(std::memory_order_relaxed); }
+
+	private:
+		const FramePublisherOptions opt_;
+		SharedRegion region_;
+
+		// 複数のストリーマーから書かれても書き手は常に1つにする
+		std::mutex publish_mtx_;
+
+		std::atomic<uint64_t> published_count_{0};
+		std::atomic<uint64_t> rejected_count_{0};
+	};
+
+	/**
+	 * @brief 共有メモリ上のフレームへの参照．dataは書き手に上書きされうるので，使った後にFrameReader::is_validで確認する．
+	 */
+	struct FrameView {
+		const vshm_SlotHeader* header = nullptr;
+		const uint8_t* meta = nullptr;
+		const uint8_t* data = nullptr;
+		uint64_t seq = 0;
+	};
+
+	enum class ReadResult {
+		Frame,
+		NoData,
+		Detached
+	};
+
+	/**
+	 * @brief 共有メモリのリングからフレームを読む．書き手をブロックしない．
+	 */
+	class FrameReader {
+
+	public:
+		explicit FrameReader(const std::string& name);
+		~FrameReader();
+
+		FrameReader(const FrameReader&) = delete;
+		FrameReader& operator=(const FrameReader&) = delete;
+
+		/**
+		 * @brief 共有メモリに接続し，読み手テーブルに登録する．接続後に書かれたフレームから読む．
+		 */
+		bool attach();
+		void detach();
+
+		/**
+		 * @brief 次のフレームを取得する．読み遅れた場合は残っている最古のフレームまで飛ばす．
+		 */
+		ReadResult next(FrameView& view);
+
+		/**
+		 * @brief viewを取得してから書き手に上書きされていなければtrue
+		 */
+		bool is_valid(const FrameView& view) const;
+
+		// getter
+		bool is_attached() const { return this->region_.is_valid(); }
+		bool writer_open() const;
+		uint64_t overruns() const { return this->overruns_; }
+		uint64_t cursor() const { return this->cursor_; }
+
+	private:
+		const vshm_RingHeader* ring_header() const { return reinterpret_cast<const vshm_RingHeader*>(this->region_.data()); }
+		const vshm_SlotHeader* slot(const uint64_t seq) const;
+		void update_reader_entry();
+
+	private:
+		const std::string name_;
+		SharedRegion region_;
+		vshm_ReaderEntry* entry_ = nullptr;
+		uint64_t owner_token_ = 0;
+
+		uint64_t cursor_ = 0;
+		uint64_t overruns_ = 0;
+	};
+}
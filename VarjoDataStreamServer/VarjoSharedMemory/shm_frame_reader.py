@@ -0,0 +1,145 @@
+"""
+共有メモリのフレームリング(vshm_layout.h)を読むPythonの参照実装．
+
+フレームは共有メモリ上のバッファをnumpy配列としてそのまま参照する(コピーしない)．
+書き手は読み手を待たないため，処理後に frame.valid() を確認し，Falseなら結果を捨てること．
+
+    reader = FrameRingReader("VarjoVST")
+    while True:
+        frame = reader.next()
+        if frame is None:
+            time.sleep(0.001)
+            continue
+        y, uv = frame.nv12_planes()
+        ...
+        if not frame.valid():
+            continue  # 処理中に上書きされた
+
+読み手テーブルへの登録(アトミックなCASが必要)は行わないため，書き手側の読み手一覧には表示されない．
+"""
+
+import mmap
+import os
+import struct
+import sys
+
+import numpy as np
+
+VSHM_MAGIC = 0x4D485356
+VSHM_VERSION = 1
+VSHM_RING_HEADER_SIZE = 128
+VSHM_SLOT_HEADER_SIZE = 64
+
+# vshm_RingHeader
+_RING_HEADER = struct.Struct("<IIIIQQQQIIQQQII")
+# vshm_SlotHeader
+_SLOT_HEADER = struct.Struct("<QqqIIIIIIQQ")
+_U64 = struct.Struct("<Q")
+
+_WRITE_SEQ_OFFSET = 64
+
+
+def _open_mapping(name, length):
+    if sys.platform == "win32":
+        return mmap.mmap(-1, length, tagname="Local\\" + name)
+    fd = os.open("/dev/shm/" + name, os.O_RDWR)
+    try:
+        return mmap.mmap(fd, length)
+    finally:
+        os.close(fd)
+
+
+class Frame:
+    def __init__(self, ring, seq, slot_offset):
+        self._ring = ring
+        self.seq = seq
+        self._slot_offset = slot_offset
+        (_, self.timestamp_ns, self.publish_time_ns, self.channel, self.format,
+         self.width, self.height, self.row_stride, self.meta_size, self.data_size, _) = _SLOT_HEADER.unpack_from(ring.mm, slot_offset)
+        meta_offset = slot_offset + VSHM_SLOT_HEADER_SIZE
+        data_offset = meta_offset + ring.meta_capacity
+        self.meta = memoryview(ring.mm)[meta_offset:meta_offset + self.meta_size]
+        self.data = np.frombuffer(ring.mm, dtype=np.uint8, count=self.data_size, offset=data_offset)
+
+    def valid(self):
+        """取得してから上書きされていなければTrue"""
+        return _U64.unpack_from(self._ring.mm, self._slot_offset)[0] == 2 * self.seq
+
+    def gray(self):
+        """Y8(視線カメラ)を(height, width)の配列として返す"""
+        stride = self.row_stride or self.width
+        return self.data[:stride * self.height].reshape(self.height, stride)[:, :self.width]
+
+    def nv12_planes(self):
+        """NV12(VST)をY(height, width)とUV(height/2, width/2, 2)の配列として返す"""
+        stride = self.row_stride or self.width
+        y = self.data[:stride * self.height].reshape(self.height, stride)[:, :self.width]
+        uv = self.data[stride * self.height:stride * self.height * 3 // 2].reshape(self.height // 2, stride)[:, :self.width]
+        return y, uv.reshape(self.height // 2, self.width // 2, 2)
+
+
+class FrameRingReader:
+    def __init__(self, name):
+        header = _open_mapping(name, VSHM_RING_HEADER_SIZE)
+        fields = _RING_HEADER.unpack_from(header)
+        header.close()
+
+        (magic, version, self.slot_count, self.max_readers, total_size, self.slot_stride, self.slots_offset,
+         self.readers_offset, self.meta_capacity, _, self.data_capacity, write_seq, _, _, _) = fields
+        if magic != VSHM_MAGIC or version != VSHM_VERSION:
+            raise RuntimeError("shared frame ring '%s' is not initialized or has an unsupported version" % name)
+
+        self.mm = _open_mapping(name, total_size)
+        self.cursor = write_seq
+        self.overruns = 0
+
+    def _write_seq(self):
+        return _U64.unpack_from(self.mm, _WRITE_SEQ_OFFSET)[0]
+
+    def writer_open(self):
+        return struct.unpack_from("<I", self.mm, 80)[0] == 1
+
+    def next(self):
+        """次のフレームを返す．新しいフレームがなければNone"""
+        while True:
+            write_seq = self._write_seq()
+            if write_seq < self.cursor:
+                self.cursor = write_seq
+            if write_seq == self.cursor:
+                return None
+
+            if write_seq - self.cursor > self.slot_count:
+                self.overruns += write_seq - self.slot_count - self.cursor
+                self.cursor = write_seq - self.slot_count
+
+            n = self.cursor + 1
+            slot_offset = self.slots_offset + self.slot_stride * ((n - 1) % self.slot_count)
+            self.cursor = n
+            if _U64.unpack_from(self.mm, slot_offset)[0] != 2 * n:
+                self.overruns += 1
+                continue
+
+            frame = Frame(self, n, slot_offset)
+            if frame.valid():
+                return frame
+            self.overruns += 1
+
+
+if __name__ == "__main__":
+    import time
+
+    reader = FrameRingReader(sys.argv[1] if len(sys.argv) > 1 else "VarjoVST")
+    count = 0
+    start = time.perf_counter()
+    while reader.writer_open():
+        frame = reader.next()
+        if frame is None:
+            time.sleep(0.001)
+            continue
+        mean = float(frame.data.mean())
+        if frame.valid():
+            count += 1
+        if count % 90 == 0:
+            elapsed = time.perf_counter() - start
+            print("frames=%d (%.1f fps) overruns=%d last: ch=%d %dx%d mean=%.1f"
+                  % (count, count / elapsed, reader.overruns, frame.channel, frame.width, frame.height, mean))
@@ -0,0 +1,96 @@
+#include <new>
+
+#include "vshm.h"
+#include "SharedFrameRing.hpp"
+
+struct vshm_reader {
+	explicit vshm_reader(const char* name)
+		: reader(name)
+	{}
+
+	SharedMemory::FrameReader reader;
+};
+
+extern "C" {
+
+	vshm_reader* vshm_reader_open(const char* name)
+	{
+		if (name == nullptr) {
+			return nullptr;
+		}
+
+		auto* reader = new (std::nothrow) vshm_reader(name);
+		if (reader == nullptr) {
+			return nullptr;
+		}
+		if (!reader->reader.attach()) {
+			delete reader;
+			return nullptr;
+		}
+		return reader;
+	}
+
+	void vshm_reader_close(vshm_reader* reader)
+	{
+		delete reader;
+	}
+
+	int vshm_reader_next(vshm_reader* reader, vshm_frame* frame)
+	{
+		if (reader == nullptr || frame == nullptr) {
+			return VSHM_ERROR;
+		}
+
+		while (true) {
+			SharedMemory::FrameView view;
+			switch (reader->reader.next(view)) {
+			case SharedMemory::ReadResult::Frame:
+				break;
+			case SharedMemory::ReadResult::NoData:
+				return VSHM_NO_DATA;
+			default:
+				return VSHM_ERROR;
+			}
+
+			frame->data = view.data;
+			frame->data_size = view.header->data_size;
+			frame->meta = view.meta;
+			frame->meta_size = view.header->meta_size;
+			frame->channel = view.header->channel;
+			frame->format = view.header->format;
+			frame->width = view.header->width;
+			frame->height = view.header->height;
+			frame->row_stride = view.header->row_stride;
+			frame->timestamp_ns = view.header->timestamp_ns;
+			frame->publish_time_ns = view.header->publish_time_ns;
+			frame->seq = view.seq;
+			frame->slot = view.header;
+
+			// フィールドを写している間に上書きされた場合は次のフレームを取り直す
+			if (reader->reader.is_valid(view)) {
+				return VSHM_OK;
+			}
+		}
+	}
+
+	int vshm_frame_valid(const vshm_reader* reader, const vshm_frame* frame)
+	{
+		if (reader == nullptr || frame == nullptr) {
+			return 0;
+		}
+		SharedMemory::FrameView view;
+		view.header = frame->slot;
+		view.seq = frame->seq;
+		return reader->reader.is_valid(view) ? 1 : 0;
+	}
+
+	uint64_t vshm_reader_overruns(const vshm_reader* reader)
+	{
+		return reader != nullptr ? reader->reader.overruns() : 0;
+	}
+
+	int vshm_reader_writer_open(const vshm_reader* reader)
+	{
+		return reader != nullptr && reader->reader.writer_open() ? 1 : 0;
+	}
+}
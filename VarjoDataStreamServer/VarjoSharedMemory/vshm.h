@@ -0,0 +1,75 @@
+/************************************************************************************************************************
+	vshm C API
+	共有メモリのフレームリングを他言語・他プロセスから読むための最小限のC API．
+	VSHM_BUILD_DLLを定義してビルドするとDLLとしてエクスポートされる(ctypes等から利用可能)．
+
+	使い方
+		vshm_reader* r = vshm_reader_open("VarjoVST");
+		vshm_frame f;
+		while (vshm_reader_next(r, &f) == VSHM_OK) {
+			... f.data をその場で処理 ...
+			if (!vshm_frame_valid(r, &f)) { 処理中に上書きされたので結果を捨てる }
+		}
+		vshm_reader_close(r);
+
+**************************************************************************************************************************/
+
+#ifndef VSHM_H
+#define VSHM_H
+
+#include <stdint.h>
+
+#include "vshm_layout.h"
+
+#if defined(_WIN32) && defined(VSHM_BUILD_DLL)
+#define VSHM_API __declspec(dllexport)
+#else
+#define VSHM_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vshm_reader vshm_reader;
+
+enum {
+	VSHM_OK = 0,
+	VSHM_NO_DATA = 1,
+	VSHM_ERROR = -1
+};
+
+typedef struct vshm_frame {
+	const uint8_t* data;
+	uint64_t data_size;
+	const uint8_t* meta;
+	uint32_t meta_size;
+	uint32_t channel;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t row_stride;
+	int64_t timestamp_ns;
+	int64_t publish_time_ns;
+	uint64_t seq;
+	const vshm_SlotHeader* slot;	/* vshm_frame_valid用 */
+} vshm_frame;
+
+/* 接続できない場合NULL */
+VSHM_API vshm_reader* vshm_reader_open(const char* name);
+VSHM_API void vshm_reader_close(vshm_reader* reader);
+
+/* VSHM_OK: frameに次のフレーム, VSHM_NO_DATA: 新しいフレームなし, VSHM_ERROR: 未接続 */
+VSHM_API int vshm_reader_next(vshm_reader* reader, vshm_frame* frame);
+
+/* frameを取得してから上書きされていなければ1 */
+VSHM_API int vshm_frame_valid(const vshm_reader* reader, const vshm_frame* frame);
+
+VSHM_API uint64_t vshm_reader_overruns(const vshm_reader* reader);
+VSHM_API int vshm_reader_writer_open(const vshm_reader* reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+/************************************************************************************************************************
+	Shared Frame Ring Layout
+	共有メモリ上のフレームリングの配置．C/C++/Pythonの読み手が共通で参照する．全フィールドはリトルエンディアン．
+
+	[vshm_RingHeader][vshm_ReaderEntry * max_readers][slot 0][slot 1]...[slot slot_count-1]
+
+	slot : [vshm_SlotHeader][meta(meta_capacity)][data(data_capacity)]   (slot_strideバイト, 4096境界)
+
+	書き込み手順(書き手は1つ，読み手を待たない)
+		n = write_seq + 1, slot = (n - 1) % slot_count
+		slot.seq = 2n + 1 → meta/dataを書く → slot.seq = 2n → write_seq = n
+
+	読み込み手順(seqlock)
+		s1 = slot.seq (s1 == 2n でなければ書き込み中か上書き済み)
+		dataを参照(コピー不要) → 使い終わった後に slot.seq == s1 を確認し，異なれば読んだ内容は破棄する
+		write_seq - cursor > slot_count の場合は読み遅れ(overrun)としてカーソルを進める
+
+**************************************************************************************************************************/
+
+#ifndef VSHM_LAYOUT_H
+#define VSHM_LAYOUT_H
+
+#include <stdint.h>
+
+#define VSHM_MAGIC 0x4D485356u			/* "VSHM" */
+#define VSHM_VERSION 1u
+#define VSHM_RING_HEADER_SIZE 128u
+#define VSHM_READER_ENTRY_SIZE 64u
+#define VSHM_SLOT_HEADER_SIZE 64u
+#define VSHM_SLOT_ALIGNMENT 4096u
+
+typedef struct vshm_RingHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slot_count;
+	uint32_t max_readers;
+	uint64_t total_size;			/* 共有メモリ全体のバイト数 */
+	uint64_t slot_stride;
+	uint64_t slots_offset;
+	uint64_t readers_offset;
+	uint32_t meta_capacity;
+	uint32_t reserved0;
+	uint64_t data_capacity;
+	uint64_t write_seq;				/* コミット済みフレーム数(atomic) */
+	uint64_t writer_heartbeat_ns;	/* 最後に書き込んだ時刻(steady clock) */
+	uint32_t writer_open;			/* 書き手が開いている間は1 */
+	uint32_t reserved1;
+	uint8_t padding[40];
+} vshm_RingHeader;
+
+typedef struct vshm_ReaderEntry {
+	uint64_t owner;					/* 0: 空き(atomic CASで確保) */
+	uint64_t cursor;				/* 最後に読んだフレーム番号 */
+	uint64_t overruns;				/* 読み遅れで失ったフレーム数 */
+	uint64_t heartbeat_ns;
+	uint8_t padding[32];
+} vshm_ReaderEntry;
+
+typedef struct vshm_SlotHeader {
+	uint64_t seq;					/* 2n: フレームnがコミット済み, 2n+1: 書き込み中 */
+	int64_t timestamp_ns;			/* varjoのフレーム時刻 */
+	int64_t publish_time_ns;		/* 共有メモリに書いた時刻(steady clock) */
+	uint32_t channel;				/* varjo_ChannelIndex */
+	uint32_t format;				/* varjo_TextureFormat */
+	uint32_t width;
+	uint32_t height;
+	uint32_t row_stride;
+	uint32_t meta_size;
+	uint64_t data_size;
+	uint64_t reserved;
+} vshm_SlotHeader;
+
+#ifdef __cplusplus
+static_assert(sizeof(vshm_RingHeader) == VSHM_RING_HEADER_SIZE, "vshm_RingHeader size mismatch");
+static_assert(sizeof(vshm_ReaderEntry) == VSHM_READER_ENTRY_SIZE, "vshm_ReaderEntry size mismatch");
+static_assert(sizeof(vshm_SlotHeader) == VSHM_SLOT_HEADER_SIZE, "vshm_SlotHeader size mismatch");
+#endif
+
+#endif
@@ -3,26 +3,24 @@
 #include <vector>
 #include <queue>
 
-#include "../util/BorrowedOrOwned.hpp"
+#include "../util/ISubmit.hpp"
 #include "Timestamp_types.hpp"
 
 namespace Timestamp {
 
-	class ISubmitTimestamp {
+	/**
+	 * @brief 実装はsubmit_batch_impl(SubmitBatch<TimestampData>)を書く．以下は従来の呼び出し方を残すための転送
+	 */
+	class ISubmitTimestamp : public ISubmit<TimestampData> {
 
 	public:
-		virtual ~ISubmitTimestamp() = default;
-	
-		virtual void submit_TimestampData(const TimestampData& data) = 0;
-		virtual void submit_TimestampData(TimestampData&& data) = 0;
+		void submit_TimestampData(const TimestampData& data) { this->submit(data); }
+		void submit_TimestampData(TimestampData&& data) { this->submit(std::move(data)); }
 
-		virtual void submit_TimestampData(const std::vector<TimestampData>& data_vec) = 0;
-		virtual void submit_TimestampData(std::vector<TimestampData>&& data_vec) = 0;
+		void submit_TimestampData(const std::vector<TimestampData>& data_vec) { this->submit(data_vec); }
+		void submit_TimestampData(std::vector<TimestampData>&& data_vec) { this->submit(std::move(data_vec)); }
 
-		virtual void submit_TimestampData(std::deque<TimestampData>& data_que) = 0;
-		virtual void submit_TimestampData(std::deque<TimestampData>&& data_que) = 0;
-
-	protected:
-		virtual void submit_TimestampData_impl(BorrowedOrOwned<TimestampData> data) = 0;
+		void submit_TimestampData(std::deque<TimestampData>& data_que) { this->submit(data_que); }
+		void submit_TimestampData(std::deque<TimestampData>&& data_que) { this->submit(std::move(data_que)); }
 	};
-}
\ No newline at end of file
+}
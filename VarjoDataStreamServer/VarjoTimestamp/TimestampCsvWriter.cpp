@@ -1,45 +1,27 @@
 
-#include <iomanip>
-
 #include "../util/filesystem_util.hpp"
 #include "TimestampCsvWriter.hpp"
+#include "../util/PerformanceChecker.hpp"
 
 namespace {
-	std::string format_system_clock_local_yyymmdd_hhmmss_mmm(std::chrono::system_clock::time_point tp) {
-		const auto ms_since_epoch = duration_cast<std::chrono::milliseconds>(tp.time_since_epoch());
-		const auto sec_since_epoch = duration_cast<std::chrono::seconds>(ms_since_epoch);
-		const auto msec = static_cast<int>((ms_since_epoch - sec_since_epoch).count());
-
-		std::time_t tt = std::chrono::system_clock::to_time_t(tp);
-
-		std::tm local_tm{};
-		localtime_s(&local_tm, &tt);
-
-		std::ostringstream oss;
-		oss << std::put_time(&local_tm, "%Y-%m-%d_%H:%M:%S") << "." << std::setw(3) << std::setfill('0') << msec;
-		return oss.str();
-	}
-
-	std::string format_system_clock_utc_yyymmdd_hhmmss_mmm(std::chrono::system_clock::time_point tp) {
-		const auto ms_since_epoch = duration_cast<std::chrono::milliseconds>(tp.time_since_epoch());
-		const auto sec_since_epoch = duration_cast<std::chrono::seconds>(ms_since_epoch);
-		const auto msec = static_cast<int>((ms_since_epoch - sec_since_epoch).count());
-
-		std::time_t tt = std::chrono::system_clock::to_time_t(tp);
-		std::tm utc_tm{};
-
-		gmtime_s(&utc_tm, &tt);
+	// 計装
+	struct Metrics {
+		PerformanceChecker::LatencyHistogram& line_write = PerformanceChecker::histogram("timestamp_csv_line_write_ns");
+		PerformanceChecker::Counter& bytes_written = PerformanceChecker::counter("timestamp_csv_bytes_written_total");
+	};
 
-		std::ostringstream oss;
-		oss << std::put_time(&utc_tm, "%Y-%m-%d_%H:%M:%S") << "." << std::setw(3) << std::setfill('0') << msec;
-		return oss.str();
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
 	}
 }
 
 namespace Timestamp {
 
-	DataCsvWriter::DataCsvWriter(const std::string& path)
+	DataCsvWriter::DataCsvWriter(const std::string& path, const RecordSchema::RecordFormat format, const Segmentation::SegmentOptions& segment)
 		: path_(solve_filename_conflict(path))
+		, csv_file_(segment)
+		, format_(format)
 	{}
 
 	DataCsvWriter::~DataCsvWriter()
@@ -49,95 +31,58 @@ namespace Timestamp {
 
 	bool DataCsvWriter::open()
 	{
-		this->csv_file_.open(this->path_, std::ios::out);
-		if (!this->csv_file_.is_open()) {
-			return false;
-		}
-		this->write_header();
-
-		return true;
+		// ヘッダはファイル(セグメント)を開くたびに書く
+		return this->csv_file_.open(this->path_, [this](AsyncIo::AsyncFile& file) { this->write_header(file); });
 	}
 
 	void DataCsvWriter::close()
 	{
 		if (this->csv_file_.is_open()) {
-			this->csv_file_.flush();
 			this->csv_file_.close();
 		}
 	}
 
-	void DataCsvWriter::write_header()
+	void DataCsvWriter::write_header(AsyncIo::AsyncFile& file)
 	{
-		if (this->csv_file_.is_open()) {
-			for (size_t i = 0; i < header_.size(); ++i) {
-				this->csv_file_ << header_[i];
-				if (i != header_.size() - 1) {
-					this->csv_file_ << ",";
-				}
-			}
-			this->csv_file_ << "\n";
+		if (this->format_ == RecordSchema::RecordFormat::Binary) {
+			std::vector<char> header;
+			TimestampDataRecord::write_binary_header(header);
+			file.write(header.data(), header.size());
+		} else {
+			file.write(TimestampDataRecord::header());
 		}
 	}
 
 	void DataCsvWriter::write_line(const TimestampData& data)
 	{
+		PerformanceChecker::ScopedTimer timer(metrics().line_write);
 		if (this->csv_file_.is_open()) {
-			this->csv_file_ << data.varjo_timestamp << ",";
-			this->csv_file_ << data.varjo_timestamp_unix << ",";
-			this->csv_file_ << format_system_clock_utc_yyymmdd_hhmmss_mmm(data.system_timestamp) << ",";
-			this->csv_file_ << format_system_clock_local_yyymmdd_hhmmss_mmm(data.system_timestamp) << "\n";
-		}
-	}
+			this->csv_file_.begin_record(static_cast<int64_t>(data.varjo_timestamp));
 
-	SerialDataCsvWriter::SerialDataCsvWriter(const std::string& path)
-		: DataCsvWriter(path)
-	{}
-
-	void SerialDataCsvWriter::submit_TimestampData(const TimestampData & data)
-	{
-		this->submit_TimestampData_impl(data);
-	}
+			// 1行分をバッファに組み立ててから1回で書き込む
+			char* const begin = this->line_buf_.data();
+			char* const end = this->format_ == RecordSchema::RecordFormat::Binary
+				? TimestampDataRecord::write_binary(data, begin)
+				: TimestampDataRecord::write_text(data, begin);
 
-	void SerialDataCsvWriter::submit_TimestampData(TimestampData&& data)
-	{
-		this->submit_TimestampData_impl(std::move(data));
-	}
-
-	void SerialDataCsvWriter::submit_TimestampData(const std::vector<TimestampData>&data)
-	{
-		for (auto& d : data) {
-			this->submit_TimestampData_impl(d);
+			this->csv_file_.write(begin, end - begin);
+			metrics().bytes_written.inc(static_cast<uint64_t>(end - begin));
 		}
 	}
 
-	void SerialDataCsvWriter::submit_TimestampData(std::vector<TimestampData>&& data)
-	{
-		for (auto& d : data) {
-			this->submit_TimestampData_impl(std::move(d));
-		}
-	}
-
-	void SerialDataCsvWriter::submit_TimestampData(std::deque<TimestampData>& data_que)
-	{
-		for (auto& d : data_que) {
-			this->submit_TimestampData_impl(d);
-		}
-	}
+	SerialDataCsvWriter::SerialDataCsvWriter(const std::string& path, const RecordSchema::RecordFormat format, const Segmentation::SegmentOptions& segment)
+		: DataCsvWriter(path, format, segment)
+	{}
 
-	void SerialDataCsvWriter::submit_TimestampData(std::deque<TimestampData>&& data_que)
+	void SerialDataCsvWriter::submit_batch_impl(SubmitBatch<TimestampData> data)
 	{
-		for (auto& d : data_que) {
-			this->submit_TimestampData_impl(std::move(d));
+		for (const auto& d : data.view()) {
+			this->write_line(d);
 		}
 	}
 
-	void SerialDataCsvWriter::submit_TimestampData_impl(BorrowedOrOwned<TimestampData> data)
-	{
-		this->write_line(data.view());
-	}
-
-	ParallelDataCsvWriter::ParallelDataCsvWriter(const std::string& path)
-		: DataCsvWriter(path)
+	ParallelDataCsvWriter::ParallelDataCsvWriter(const std::string& path, const RecordSchema::RecordFormat format, const Segmentation::SegmentOptions& segment)
+		: DataCsvWriter(path, format, segment)
 	{}
 
 	ParallelDataCsvWriter::~ParallelDataCsvWriter()
@@ -150,110 +95,49 @@ namespace Timestamp {
 		// csvファイルを開く
 		if (!DataCsvWriter::open()) return false;
 
-		// スレッドを起動
-		this->stop_thread_.store(false);
-		this->worker_thread_ = std::thread(&ParallelDataCsvWriter::writer_worker, this);
-
 		return true;
 	}
 
 	void ParallelDataCsvWriter::close()
 	{
-		// スレッドを停止
-		this->stop_thread_.store(true);
-		this->data_que_cv_.notify_all();
-		if (this->worker_thread_.joinable()) {
-			this->worker_thread_.join();
-		}
+		// 積まれている分を書き終えるまで待つ
+		this->write_task_.notify();
+		this->write_task_.wait_idle();
 
 		// csvファイルを閉じる
 		DataCsvWriter::close();
 	}
 
-	void ParallelDataCsvWriter::submit_TimestampData(const TimestampData& data)
+	void ParallelDataCsvWriter::submit_batch_impl(SubmitBatch<TimestampData> data)
 	{
-		std::lock_guard<std::mutex> lock(this->data_que_mtx_);
-		this->submit_TimestampData_impl(data);
-		this->data_que_cv_.notify_all();
-	}
-
-	void ParallelDataCsvWriter::submit_TimestampData(TimestampData&& data)
-	{
-		std::lock_guard<std::mutex> lock(this->data_que_mtx_);
-		this->submit_TimestampData_impl(std::move(data));
-		this->data_que_cv_.notify_all();
-	}
-
-	void ParallelDataCsvWriter::submit_TimestampData(const std::vector<TimestampData>& data)
-	{
-		std::lock_guard<std::mutex> lock(this->data_que_mtx_);
-		for (auto& d : data) {
-			this->submit_TimestampData_impl(d);
+		{
+			std::lock_guard<std::mutex> lock(this->data_que_mtx_);
+			std::move(data).consume([this](TimestampData&& d) { this->data_que_.push_back(std::move(d)); });
 		}
-		this->data_que_cv_.notify_all();
-	}
-
-	void ParallelDataCsvWriter::submit_TimestampData(std::vector<TimestampData>&& data)
-	{
-		std::lock_guard<std::mutex> lock(this->data_que_mtx_);
-		for (auto& d : data) {
-			this->submit_TimestampData_impl(std::move(d));
-		}
-		this->data_que_cv_.notify_all();
-	}
-
-	void ParallelDataCsvWriter::submit_TimestampData(std::deque<TimestampData>& data_que)
-	{
-		std::lock_guard<std::mutex> lock(this->data_que_mtx_);
-		for (auto& d : data_que) {
-			this->submit_TimestampData_impl(d);
-		}
-		this->data_que_cv_.notify_all();
-	}
-
-	void ParallelDataCsvWriter::submit_TimestampData(std::deque<TimestampData>&& data_que)
-	{
-		std::lock_guard<std::mutex> lock(this->data_que_mtx_);
-		for (auto& d : data_que) {
-			this->submit_TimestampData_impl(std::move(d));
-		}
-		this->data_que_cv_.notify_all();
-	}
-
-	void ParallelDataCsvWriter::submit_TimestampData_impl(BorrowedOrOwned<TimestampData> data)
-	{
-		this->data_que_.push_back(std::move(data).materialize());
+		this->write_task_.notify();
 	}
 
 	void ParallelDataCsvWriter::writer_worker()
 	{
-		while (!this->stop_thread_.load()) {
-			std::deque<TimestampData> data_que_copy;
-			{
-				// 提出通知まで待機
-				std::unique_lock<std::mutex> lock(this->data_que_mtx_);
-				this->data_que_cv_.wait(lock, [this] { return !this->data_que_.empty() || this->stop_thread_.load(); });
-				if (this->stop_thread_.load()) {
-					break;
-				}
-
-				// データキューを退避
-				data_que_copy = std::exchange(this->data_que_, std::deque<TimestampData>{});
-			}
+		std::deque<TimestampData> data_que_copy;
+		{
+			// データキューを退避
+			std::lock_guard<std::mutex> lock(this->data_que_mtx_);
+			data_que_copy = std::exchange(this->data_que_, std::deque<TimestampData>{});
+		}
 
-			// 書き込み
-			for (auto& data : data_que_copy) {
-				this->write_line(data);
-			}
+		// 書き込み
+		for (auto& data : data_que_copy) {
+			this->write_line(data);
 		}
 	}
 
 	std::unique_ptr<DataCsvWriter> make_DataCsvWrierPtr(const CsvWriterOptions& opt)
 	{
 		if (opt.type == CsvWriterType::Serial) {
-			return std::make_unique<SerialDataCsvWriter>(opt.path);
+			return std::make_unique<SerialDataCsvWriter>(opt.path, opt.format, opt.segment);
 		} else if (opt.type == CsvWriterType::Parallel) {
-			return std::make_unique<ParallelDataCsvWriter>(opt.path);
+			return std::make_unique<ParallelDataCsvWriter>(opt.path, opt.format, opt.segment);
 		} else {
 			throw std::invalid_argument("Invalid CsvWriterType");
 		}
@@ -262,9 +146,9 @@ namespace Timestamp {
 	std::unique_ptr<ISubmitTimestamp> make_DataCsvWrierPtr_asISubmit(const CsvWriterOptions& opt)
 	{
 		if (opt.type == CsvWriterType::Serial) {
-			return std::make_unique<SerialDataCsvWriter>(opt.path);
+			return std::make_unique<SerialDataCsvWriter>(opt.path, opt.format, opt.segment);
 		} else if (opt.type == CsvWriterType::Parallel) {
-			return std::make_unique<ParallelDataCsvWriter>(opt.path);
+			return std::make_unique<ParallelDataCsvWriter>(opt.path, opt.format, opt.segment);
 		} else {
 			throw std::invalid_argument("Invalid CsvWriterType");
 		}
@@ -1,15 +1,19 @@
 #pragma once
 
 #include <string>
-#include <fstream>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <memory>
+#include <array>
+#include <algorithm>
 
 #include "Timestamp_types.hpp"
+#include "TimestampDataSchema.hpp"
 #include "ISubmitTimestamp.hpp"
+#include "../util/Executor.hpp"
+#include "../util/Segmentation.hpp"
 
 namespace Timestamp {
 
@@ -17,17 +21,14 @@ namespace Timestamp {
 		Serial, Parallel
 	};
 	
+	/**
+	 * @brief 列はTimestampDataSchema.hppの定義から生成する．format=Binaryの場合は同じ列を固定長のバイナリで書く
+	 * segmentを指定するとvarjo_timestampでファイルを区切る
+	 */
 	class DataCsvWriter : public ISubmitTimestamp {
 
-		inline static std::vector<std::string> header_ = {
-			"varjo_timestamp",
-			"varjo_timestamp_unix",
-			"system_timestamp_utc",
-			"sytem_timestamp_local"
-		};
-
 	public:
-		DataCsvWriter(const std::string& path);
+		DataCsvWriter(const std::string& path, const RecordSchema::RecordFormat format = RecordSchema::RecordFormat::Csv, const Segmentation::SegmentOptions& segment = {});
 
 		~DataCsvWriter();
 
@@ -39,66 +40,52 @@ namespace Timestamp {
 		}
 
 	protected:
-		void write_header();
+		void write_header(AsyncIo::AsyncFile& file);
 		void write_line(const TimestampData& data);
 
 	protected:
 		const std::string path_;
-		std::fstream csv_file_;
+		Segmentation::SegmentedFile csv_file_;
+		const RecordSchema::RecordFormat format_;
+
+	private:
+		std::array<char, std::max(TimestampDataRecord::max_line_size, TimestampDataRecord::binary_size)> line_buf_{};
 	};
 
 	class SerialDataCsvWriter : public DataCsvWriter {
 
 	public:
-		SerialDataCsvWriter(const std::string& path);
-
-		void submit_TimestampData(const TimestampData& data) override;
-		void submit_TimestampData(TimestampData&& data) override;
-
-		void submit_TimestampData(const std::vector<TimestampData>& data) override;
-		void submit_TimestampData(std::vector<TimestampData>&& data) override;
-
-		void submit_TimestampData(std::deque<TimestampData>& data_que) override;
-		void submit_TimestampData(std::deque<TimestampData>&& data_que) override;
+		SerialDataCsvWriter(const std::string& path, const RecordSchema::RecordFormat format = RecordSchema::RecordFormat::Csv, const Segmentation::SegmentOptions& segment = {});
 
 	private:
-		void submit_TimestampData_impl(BorrowedOrOwned<TimestampData> data) override;
+		void submit_batch_impl(SubmitBatch<TimestampData> data) override;
 	};
 
 	class ParallelDataCsvWriter : public DataCsvWriter {
 
 	public:
-		ParallelDataCsvWriter(const std::string& path);
+		ParallelDataCsvWriter(const std::string& path, const RecordSchema::RecordFormat format = RecordSchema::RecordFormat::Csv, const Segmentation::SegmentOptions& segment = {});
 		~ParallelDataCsvWriter();
 
 		bool open() override;
 		void close() override;
 
-		void submit_TimestampData(const TimestampData& data) override;
-		void submit_TimestampData(TimestampData&& data) override;
-
-		void submit_TimestampData(const std::vector<TimestampData>& data) override;
-		void submit_TimestampData(std::vector<TimestampData>&& data) override;
-
-		void submit_TimestampData(std::deque<TimestampData>& data_que) override;
-		void submit_TimestampData(std::deque<TimestampData>&& data_que) override;
-
 	private:
-		void submit_TimestampData_impl(BorrowedOrOwned<TimestampData> data) override;
+		void submit_batch_impl(SubmitBatch<TimestampData> data) override;
 
 		void writer_worker();
 
 	private:
 		std::deque<TimestampData> data_que_;
 		std::mutex data_que_mtx_;
-		std::condition_variable data_que_cv_;
-		std::thread worker_thread_;
-		std::atomic_bool stop_thread_{true};
+		Execution::WorkerTask write_task_{ [this] { this->writer_worker(); }, Execution::TaskKind::Io };
 	};
 
 	struct CsvWriterOptions {
 		CsvWriterType type;
 		std::string path;
+		RecordSchema::RecordFormat format = RecordSchema::RecordFormat::Csv;
+		Segmentation::SegmentOptions segment{};
 	};
 
 	std::unique_ptr<DataCsvWriter> make_DataCsvWrierPtr(const CsvWriterOptions& opt);
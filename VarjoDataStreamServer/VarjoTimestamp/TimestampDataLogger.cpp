@@ -1,5 +1,20 @@
 
 #include "TimestampDataLogger.hpp"
+#include "../util/PerformanceChecker.hpp"
+#include "../util/TraceRecorder.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::LatencyHistogram& write_batch = PerformanceChecker::histogram("timestamp_write_batch_ns");
+		PerformanceChecker::Gauge& batch_size = PerformanceChecker::gauge("timestamp_write_batch_size");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+}
 
 namespace Timestamp {
 	
@@ -18,7 +33,6 @@ namespace Timestamp {
 		this->csvwriter_ = make_DataCsvWrierPtr(writer_opt);
 
 		if (!this->dstreamer_->is_open()) {
-			printf("DataLogger: opening dstreamer...\n");
 			this->dstreamer_->open();
 		}
 
@@ -26,8 +40,6 @@ namespace Timestamp {
 			this->csvwriter_->open();
 		}
 
-		printf("DataLogger: dstreamer open=%d, csvwriter open=%d\n", this->dstreamer_->is_open(), this->csvwriter_->is_open());
-
 		if (this->dstreamer_->is_open() && this->csvwriter_->is_open()) {
 			this->stop_thread_ = false;
 			this->logging_thread_ = std::thread(&DataLogger::logging_worker, this);
@@ -52,14 +64,25 @@ namespace Timestamp {
 		}
 	}
 
+	Sampling::JitterSummary DataLogger::jitter_summary() const
+	{
+		if (!this->dstreamer_) {
+			return Sampling::JitterSummary{};
+		}
+		return this->dstreamer_->jitter_histogram().summary();
+	}
+
 	void DataLogger::logging_worker()
 	{
+		auto thread_reg = PerformanceChecker::register_thread("timestamp_logger");
 		while (!this->stop_thread_) {
 			std::deque<TimestampData> data_que = this->dstreamer_->take_data();
-			printf("DataLogger: got data_que with size=%d\n", data_que.size());
+
+			metrics().batch_size.set(static_cast<int64_t>(data_que.size()));
 
 			if (this->csvwriter_ && this->csvwriter_->is_open()) {
-				printf("DataLogger: submit data_que to csvwriter...\n");
+				Profiling::TraceScope trace("timestamp.write_batch");
+				PerformanceChecker::ScopedTimer timer(metrics().write_batch);
 				this->csvwriter_->submit_TimestampData(std::move(data_que));
 			}
 
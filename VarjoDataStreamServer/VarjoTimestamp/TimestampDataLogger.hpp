@@ -26,6 +26,11 @@ namespace Timestamp {
 
 		void close();
 
+		/**
+		 * @brief サンプリングのジッタ統計．open前は全て0を返す．
+		 */
+		Sampling::JitterSummary jitter_summary() const;
+
 	private:
 
 		void logging_worker();
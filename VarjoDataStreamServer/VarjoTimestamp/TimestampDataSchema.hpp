@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+
+#include "../util/RecordSchema.hpp"
+#include "Timestamp_types.hpp"
+#include "TimestampFormatter.hpp"
+
+namespace Timestamp {
+
+	/**
+	 * @brief TimestampDataの列の定義．CSVのヘッダ・1行の書き出し・読み込み・バイナリ形式はここから生成する
+	 */
+	namespace Schema {
+
+		/**
+		 * @brief system_clockの時刻をUTCの"YYYY-MM-DD_HH:MM:SS.mmm"で書く．バイナリではエポックからのナノ秒(int64)
+		 * @detail 読み込みはミリ秒精度になる
+		 */
+		struct UtcDateTimeCodec {
+			using Inner = RecordSchema::ValueCodec<int64_t>;
+			static constexpr size_t max_text = DateTimeFormatter::formatted_size;
+			static constexpr size_t binary_size = Inner::binary_size;
+
+			static char* to_text(const std::chrono::system_clock::time_point tp, char* p) {
+				// DateTimeFormatterはスレッドセーフではないので書き込みスレッドごとに持つ
+				thread_local DateTimeFormatter formatter{ TimeZone::Utc };
+				return formatter.format(tp, p);
+			}
+
+			static bool from_text(std::string_view s, std::chrono::system_clock::time_point& tp) {
+				if (s.size() != max_text || s[4] != '-' || s[7] != '-' || s[10] != '_' || s[13] != ':' || s[16] != ':' || s[19] != '.') {
+					return false;
+				}
+				int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0, millisecond = 0;
+				if (!parse(s.substr(0, 4), year) || !parse(s.substr(5, 2), month) || !parse(s.substr(8, 2), day)
+					|| !parse(s.substr(11, 2), hour) || !parse(s.substr(14, 2), minute) || !parse(s.substr(17, 2), second)
+					|| !parse(s.substr(20, 3), millisecond)) {
+					return false;
+				}
+				const std::chrono::year_month_day ymd{ std::chrono::year(year), std::chrono::month(month), std::chrono::day(day) };
+				if (!ymd.ok()) {
+					return false;
+				}
+				tp = std::chrono::sys_days(ymd) + std::chrono::hours(hour) + std::chrono::minutes(minute)
+					+ std::chrono::seconds(second) + std::chrono::milliseconds(millisecond);
+				return true;
+			}
+
+			static char* to_binary(const std::chrono::system_clock::time_point tp, char* p) {
+				return Inner::to_binary(std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count(), p);
+			}
+
+			static const char* from_binary(const char* p, std::chrono::system_clock::time_point& tp) {
+				int64_t ns = 0;
+				p = Inner::from_binary(p, ns);
+				tp = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns)));
+				return p;
+			}
+
+		private:
+			static bool parse(std::string_view s, int& v) {
+				const auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+				return ec == std::errc() && ptr == s.data() + s.size();
+			}
+		};
+
+		/**
+		 * @brief 同じ時刻をローカル時刻で書く表示用の列．UTCの列から導出できるのでバイナリには含めず，読み込みでは読み飛ばす
+		 */
+		struct LocalDateTimeCodec {
+			static constexpr size_t max_text = DateTimeFormatter::formatted_size;
+			static constexpr size_t binary_size = 0;
+
+			static char* to_text(const std::chrono::system_clock::time_point tp, char* p) {
+				thread_local DateTimeFormatter formatter{ TimeZone::Local };
+				return formatter.format(tp, p);
+			}
+
+			static bool from_text(std::string_view, const std::chrono::system_clock::time_point&) { return true; }
+			static char* to_binary(const std::chrono::system_clock::time_point, char* p) { return p; }
+			static const char* from_binary(const char* p, const std::chrono::system_clock::time_point&) { return p; }
+		};
+
+		inline constexpr auto timestamp_data_fields = RecordSchema::fields(
+			RecordSchema::column("varjo_timestamp", [](auto& d) -> auto& { return d.varjo_timestamp; }),
+			RecordSchema::column("varjo_timestamp_unix", [](auto& d) -> auto& { return d.varjo_timestamp_unix; }),
+			RecordSchema::column<UtcDateTimeCodec>("system_timestamp_utc", [](auto& d) -> auto& { return d.system_timestamp; }),
+			RecordSchema::column<LocalDateTimeCodec>("system_timestamp_local", [](auto& d) -> auto& { return d.system_timestamp; })
+		);
+	}
+
+	using TimestampDataRecord = RecordSchema::Record<TimestampData, Schema::timestamp_data_fields>;
+}
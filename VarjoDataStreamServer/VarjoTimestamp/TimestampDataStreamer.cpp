@@ -1,10 +1,32 @@
 #include "TimestampDataStreamer.hpp"
+#include "../util/PerformanceChecker.hpp"
+#include "../util/TraceRecorder.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::Counter& samples = PerformanceChecker::counter("timestamp_samples_total");
+		PerformanceChecker::LatencyHistogram& capture = PerformanceChecker::histogram("timestamp_capture_ns");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+}
 
 namespace Timestamp {
 
 	DataStreamer::DataStreamer(const std::shared_ptr<Session>& session, const int separate_ms)
+		: DataStreamer(session, Sampling::SamplerOptions{
+			.period = std::chrono::milliseconds(separate_ms),
+			.mode = Sampling::SleepMode::Sleep
+		})
+	{}
+
+	DataStreamer::DataStreamer(const std::shared_ptr<Session>& session, const Sampling::SamplerOptions& sampler_opt)
 		: session_(session)
-		, separate_ms_(separate_ms)
+		, sampler_(sampler_opt)
 	{}
 
 	DataStreamer::~DataStreamer()
@@ -40,34 +62,37 @@ namespace Timestamp {
 
 	void DataStreamer::datastream_worker()
 	{
+		auto thread_reg = PerformanceChecker::register_thread("timestamp_streamer");
+		// 絶対デッドラインで周期実行する
+		this->sampler_.histogram().reset();
+		this->sampler_.start();
+
 		while (!this->worker_stop_flag_.load()) {
-			auto start = std::chrono::high_resolution_clock::now();
+			this->sampler_.wait_next();
 
 			// TimestampData作成
 			TimestampData data;
-			data.varjo_timestamp = this->session_->getCurrentTime();
-			data.system_timestamp = std::chrono::system_clock::now();
-			data.varjo_timestamp_unix = varjo_ConvertToUnixTime(*(this->session_), data.varjo_timestamp);
+			{
+				Profiling::TraceScope trace("timestamp.capture");
+				PerformanceChecker::ScopedTimer timer(metrics().capture);
+				data.varjo_timestamp = this->session_->getCurrentTime();
+				data.system_timestamp = std::chrono::system_clock::now();
+				data.varjo_timestamp_unix = varjo_ConvertToUnixTime(*(this->session_), data.varjo_timestamp);
+			}
+			metrics().samples.inc();
 			{
 				std::lock_guard<std::mutex> lock(data_que_mtx_);
 				data_que_.push_back(data);
 			}
-
-			auto end = std::chrono::high_resolution_clock::now();
-
-			std::chrono::milliseconds elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-			auto sleep_time = std::chrono::milliseconds(separate_ms_) - elapsed;
-
-			if (sleep_time > std::chrono::milliseconds(0)) {
-				std::this_thread::sleep_for(sleep_time);
-			}
 		}
 	}
 
 
 	std::unique_ptr<DataStreamer> make_DataStreamerPtr(const DataStreamerOptions& opt)
 	{
+		if (opt.sampler) {
+			return std::make_unique<DataStreamer>(opt.session, *opt.sampler);
+		}
 		return std::make_unique<DataStreamer>(opt.session, opt.separate_ms);
 	}
 
@@ -7,11 +7,13 @@
 #include <condition_variable>
 #include <atomic>
 #include <memory>
+#include <optional>
 
 #include <Varjo.h>
 #include <Varjo_types.h>
 
 #include "../VarjoExample/Session.hpp"
+#include "../util/DeadlineSampler.hpp"
 #include "Timestamp_types.hpp"
 
 namespace Timestamp {
@@ -24,6 +26,7 @@ namespace Timestamp {
 
 	public:
 		DataStreamer(const std::shared_ptr<Session>& session, const int separate_ms);
+		DataStreamer(const std::shared_ptr<Session>& session, const Sampling::SamplerOptions& sampler_opt);
 
 		~DataStreamer();
 
@@ -43,10 +46,15 @@ namespace Timestamp {
 			return this->data_que_.size(); 
 		}
 
+		/**
+		 * @brief サンプリング時刻のデッドラインからの遅れの分布
+		 */
+		const Sampling::JitterHistogram& jitter_histogram() const { return this->sampler_.histogram(); }
+
 	private:
 		std::shared_ptr<Session> session_;
 
-		const int separate_ms_;
+		Sampling::DeadlineSampler sampler_;
 
 		DataStreamerStatus status_{DataStreamerStatus::Close};
 
@@ -59,6 +67,8 @@ namespace Timestamp {
 	struct DataStreamerOptions {
 		std::shared_ptr<Session> session;
 		int separate_ms;
+		// 指定した場合はseparate_msより優先する(サブミリ秒周期，スピン待機など)
+		std::optional<Sampling::SamplerOptions> sampler{};
 	};
 
 	std::unique_ptr<DataStreamer> make_DataStreamerPtr(const DataStreamerOptions& opt);
@@ -0,0 +1,122 @@
+#include <ctime>
+
+#include "TimestampFormatter.hpp"
+
+namespace {
+	// オフセットを再取得する区間長[s]
+	constexpr int64_t offset_refresh_sec = 15 * 60;
+
+	int64_t floor_div(const int64_t a, const int64_t b) {
+		const int64_t q = a / b;
+		return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+	}
+
+	/**
+	 * @brief 1970-01-01からの日数を年月日へ変換する(proleptic Gregorian)
+	 */
+	void civil_from_days(int64_t days, int64_t& y, unsigned& m, unsigned& d) {
+		days += 719468;
+		const int64_t era = floor_div(days, 146097);
+		const unsigned doe = static_cast<unsigned>(days - era * 146097);
+		const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+		const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+		const unsigned mp = (5 * doy + 2) / 153;
+		d = doy - (153 * mp + 2) / 5 + 1;
+		m = mp < 10 ? mp + 3 : mp - 9;
+		y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2 ? 1 : 0);
+	}
+
+	/**
+	 * @brief 年月日を1970-01-01からの日数へ変換する(proleptic Gregorian)
+	 */
+	int64_t days_from_civil(int64_t y, const unsigned m, const unsigned d) {
+		y -= m <= 2 ? 1 : 0;
+		const int64_t era = floor_div(y, 400);
+		const unsigned yoe = static_cast<unsigned>(y - era * 400);
+		const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+		const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		return era * 146097 + static_cast<int64_t>(doe) - 719468;
+	}
+
+	char* write_digits(char* out, unsigned value, const int width) {
+		for (int i = width - 1; i >= 0; --i) {
+			out[i] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		}
+		return out + width;
+	}
+}
+
+namespace Timestamp {
+
+	DateTimeFormatter::DateTimeFormatter(const TimeZone zone)
+		: zone_(zone)
+	{}
+
+	char* DateTimeFormatter::format(std::chrono::system_clock::time_point tp, char* out)
+	{
+		const int64_t ms_since_epoch = std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+		const int64_t sec_since_epoch = floor_div(ms_since_epoch, 1000);
+		const unsigned msec = static_cast<unsigned>(ms_since_epoch - sec_since_epoch * 1000);
+
+		if (sec_since_epoch != this->prefix_sec_) {
+			this->update_prefix(sec_since_epoch);
+		}
+
+		for (size_t i = 0; i < prefix_size; ++i) {
+			out[i] = this->prefix_[i];
+		}
+		return write_digits(out + prefix_size, msec, 3);
+	}
+
+	void DateTimeFormatter::update_prefix(const int64_t sec_since_epoch)
+	{
+		int64_t sec = sec_since_epoch;
+		if (this->zone_ == TimeZone::Local) {
+			if (sec_since_epoch < this->offset_valid_begin_ || this->offset_valid_end_ <= sec_since_epoch) {
+				this->update_offset(sec_since_epoch);
+			}
+			sec += this->offset_sec_;
+		}
+
+		const int64_t days = floor_div(sec, 86400);
+		const unsigned sec_of_day = static_cast<unsigned>(sec - days * 86400);
+
+		int64_t year;
+		unsigned month, day;
+		civil_from_days(days, year, month, day);
+
+		char* p = this->prefix_.data();
+		p = write_digits(p, static_cast<unsigned>(year), 4);
+		*p++ = '-';
+		p = write_digits(p, month, 2);
+		*p++ = '-';
+		p = write_digits(p, day, 2);
+		*p++ = '_';
+		p = write_digits(p, sec_of_day / 3600, 2);
+		*p++ = ':';
+		p = write_digits(p, sec_of_day / 60 % 60, 2);
+		*p++ = ':';
+		p = write_digits(p, sec_of_day % 60, 2);
+		*p++ = '.';
+
+		this->prefix_sec_ = sec_since_epoch;
+	}
+
+	void DateTimeFormatter::update_offset(const int64_t sec_since_epoch)
+	{
+		const int64_t begin = floor_div(sec_since_epoch, offset_refresh_sec) * offset_refresh_sec;
+
+		std::time_t tt = static_cast<std::time_t>(begin);
+		std::tm local_tm{};
+		localtime_s(&local_tm, &tt);
+
+		const int64_t local_sec = days_from_civil(local_tm.tm_year + 1900, local_tm.tm_mon + 1, local_tm.tm_mday) * 86400
+			+ local_tm.tm_hour * 3600 + local_tm.tm_min * 60 + local_tm.tm_sec;
+
+		this->offset_sec_ = local_sec - begin;
+		this->offset_valid_begin_ = begin;
+		this->offset_valid_end_ = begin + offset_refresh_sec;
+	}
+
+} // namespace Timestamp
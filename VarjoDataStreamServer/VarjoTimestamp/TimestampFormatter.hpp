@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <limits>
+
+namespace Timestamp {
+
+	enum class TimeZone {
+		Utc, Local
+	};
+
+	/**
+	 * @brief system_clockの時刻を"YYYY-MM-DD_HH:MM:SS.mmm"形式へ変換する．
+	 *
+	 * 秒単位の日時部分とローカル時刻のオフセットをキャッシュし，同じ秒の間はミリ秒部分のみを整数演算で書き込む．
+	 * ローカル時刻のオフセットは15分区切りで再取得する(夏時間の切り替えはUTCの15分境界で起こるものとする)．
+	 * スレッドセーフではないため，書き込みスレッドごとにインスタンスを持つこと．
+	 */
+	class DateTimeFormatter {
+
+	public:
+		// "YYYY-MM-DD_HH:MM:SS.mmm"の文字数
+		static constexpr size_t formatted_size = 23;
+
+		explicit DateTimeFormatter(const TimeZone zone);
+
+		/**
+		 * @brief outにformatted_size文字を書き込み，書き込み終端を返す．終端文字は付与しない．
+		 */
+		char* format(std::chrono::system_clock::time_point tp, char* out);
+
+		TimeZone zone() const { return this->zone_; }
+
+	private:
+		void update_prefix(const int64_t sec_since_epoch);
+		void update_offset(const int64_t sec_since_epoch);
+
+	private:
+		static constexpr int64_t invalid_sec = std::numeric_limits<int64_t>::min();
+		static constexpr size_t prefix_size = 20;	// "YYYY-MM-DD_HH:MM:SS."
+
+		const TimeZone zone_;
+
+		int64_t prefix_sec_{invalid_sec};
+		std::array<char, prefix_size> prefix_{};
+
+		int64_t offset_sec_{0};
+		int64_t offset_valid_begin_{invalid_sec};
+		int64_t offset_valid_end_{invalid_sec};
+	};
+}
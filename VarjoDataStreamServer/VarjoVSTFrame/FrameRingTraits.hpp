@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+#include "varjo_vst_frame_type.hpp"
+#include "../util/DashcamRing.hpp"
+#include "../util/LzCodec.hpp"
+
+namespace VarjoVSTFrame {
+
+	/**
+	 * @brief Dashcam::RingRecorderにフレームを置く形．画素はLZで圧縮して持つ(縮まない場合はそのまま)
+	 * @detail EyeCam::Frameも同じ型なので，アイカメラの書き込み先にもそのまま使える．
+	 */
+	struct FrameRingTraits {
+		struct Stored {
+			Metadata metadata;
+			std::vector<uint8_t> packed;
+			size_t raw_size = 0;
+			bool compressed = false;
+		};
+
+		static int64_t timestamp_ns(const Frame& frame) { return static_cast<int64_t>(frame.metadata.timestamp); }
+
+		static Stored pack(const Frame& frame, const bool compress) {
+			Stored stored{ frame.metadata, {}, frame.data.size(), false };
+			if (compress) {
+				// 圧縮先は受け取るスレッドごとに使い回し，リングには縮んだ大きさだけを確保する
+				thread_local std::vector<uint8_t> scratch;
+				Lz::compress(frame.data.data(), frame.data.size(), scratch);
+				if (scratch.size() < frame.data.size()) {
+					stored.packed.assign(scratch.begin(), scratch.end());
+					stored.compressed = true;
+					return stored;
+				}
+			}
+			stored.packed = frame.data;
+			return stored;
+		}
+
+		static Frame unpack(Stored&& stored) {
+			Frame frame{ stored.metadata, {} };
+			if (!stored.compressed) {
+				frame.data = std::move(stored.packed);
+				return frame;
+			}
+			if (!Lz::decompress(stored.packed.data(), stored.packed.size(), frame.data, stored.raw_size)) {
+				throw std::runtime_error("Dashcam ring: corrupted frame");
+			}
+			return frame;
+		}
+
+		static size_t bytes(const Stored& stored) { return sizeof(Stored) + stored.packed.capacity(); }
+		static size_t raw_bytes(const Frame& frame) { return sizeof(Frame) + frame.data.size(); }
+	};
+
+	struct MetadataRingTraits : Dashcam::PlainRingTraits<Metadata> {
+		static int64_t timestamp_ns(const Metadata& metadata) { return static_cast<int64_t>(metadata.timestamp); }
+	};
+}
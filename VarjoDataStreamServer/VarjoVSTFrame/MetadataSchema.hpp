@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../util/RecordSchema.hpp"
+#include "varjo_vst_frame_type.hpp"
+
+namespace VarjoVSTFrame {
+
+	/**
+	 * @brief VSTのメタデータ(Metadata)の列の定義．CSVのヘッダ・1行の書き出し・読み込み・バイナリ形式はここから生成する
+	 */
+	namespace Schema {
+
+		inline constexpr auto wb_normalization_fields = RecordSchema::fields(
+			RecordSchema::columns<3>("whiteBalanceColorGains", [](auto& w) -> auto& { return w.whiteBalanceColorGains; }),
+			RecordSchema::columns<9>("invCCM.value", [](auto& w) -> auto& { return w.invCCM.value; }),
+			RecordSchema::columns<9>("ccm.value", [](auto& w) -> auto& { return w.ccm.value; })
+		);
+
+		inline constexpr auto distorted_color_fields = RecordSchema::fields(
+			RecordSchema::column("timestamp", [](auto& c) -> auto& { return c.timestamp; }),
+			RecordSchema::column("ev", [](auto& c) -> auto& { return c.ev; }),
+			RecordSchema::column("exposureTime", [](auto& c) -> auto& { return c.exposureTime; }),
+			RecordSchema::column("whiteBalanceTemperature", [](auto& c) -> auto& { return c.whiteBalanceTemperature; }),
+			RecordSchema::nested("wbNormalizationData.", [](auto& c) -> auto& { return c.wbNormalizationData; }, wb_normalization_fields),
+			RecordSchema::column("cameraCalibrationConstant", [](auto& c) -> auto& { return c.cameraCalibrationConstant; })
+		);
+
+		inline constexpr auto stream_frame_fields = RecordSchema::fields(
+			RecordSchema::column("type", [](auto& f) -> auto& { return f.type; }),
+			RecordSchema::column("id", [](auto& f) -> auto& { return f.id; }),
+			RecordSchema::column("frameNumber", [](auto& f) -> auto& { return f.frameNumber; }),
+			RecordSchema::column("channels", [](auto& f) -> auto& { return f.channels; }),
+			RecordSchema::column("dataFlags", [](auto& f) -> auto& { return f.dataFlags; }),
+			RecordSchema::columns<16>("hmdPose.value", [](auto& f) -> auto& { return f.hmdPose.value; }),
+			RecordSchema::nested("metadata.distortedColor.", [](auto& f) -> auto& { return f.metadata.distortedColor; }, distorted_color_fields)
+		);
+
+		inline constexpr auto intrinsics_fields = RecordSchema::fields(
+			RecordSchema::column("model", [](auto& i) -> auto& { return i.model; }),
+			RecordSchema::column("principalPointX", [](auto& i) -> auto& { return i.principalPointX; }),
+			RecordSchema::column("principalPointY", [](auto& i) -> auto& { return i.principalPointY; }),
+			RecordSchema::column("focalLengthX", [](auto& i) -> auto& { return i.focalLengthX; }),
+			RecordSchema::column("focalLengthY", [](auto& i) -> auto& { return i.focalLengthY; }),
+			RecordSchema::columns<8>("distortionCoefficients", [](auto& i) -> auto& { return i.distortionCoefficients; })
+		);
+
+		inline constexpr auto buffer_metadata_fields = RecordSchema::fields(
+			RecordSchema::column("format", [](auto& b) -> auto& { return b.format; }),
+			RecordSchema::column("type", [](auto& b) -> auto& { return b.type; }),
+			RecordSchema::column("byteSize", [](auto& b) -> auto& { return b.byteSize; }),
+			RecordSchema::column("rowStride", [](auto& b) -> auto& { return b.rowStride; }),
+			RecordSchema::column("width", [](auto& b) -> auto& { return b.width; }),
+			RecordSchema::column("height", [](auto& b) -> auto& { return b.height; })
+		);
+
+		inline constexpr auto metadata_fields = RecordSchema::fields(
+			RecordSchema::nested("streamFrame.", [](auto& m) -> auto& { return m.streamFrame; }, stream_frame_fields),
+			RecordSchema::column("channelIndex", [](auto& m) -> auto& { return m.channelIndex; }),
+			RecordSchema::column("timestamp", [](auto& m) -> auto& { return m.timestamp; }),
+			RecordSchema::columns<16>("extrinsics.value", [](auto& m) -> auto& { return m.extrinsics.value; }),
+			RecordSchema::nested("intrinsics.", [](auto& m) -> auto& { return m.intrinsics; }, intrinsics_fields),
+			RecordSchema::nested("bufferMetadata.", [](auto& m) -> auto& { return m.bufferMetadata; }, buffer_metadata_fields)
+		);
+	}
+
+	using MetadataRecord = RecordSchema::Record<Metadata, Schema::metadata_fields>;
+}
@@ -0,0 +1,176 @@
+#include <thread>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+#include "VSTPipelineBench.hpp"
+#include "../VarjoSession/SessionFrameSource.hpp"
+
+namespace {
+	std::unique_ptr<VarjoVSTFrame::IFrameSource> make_source(const VarjoVSTFrame::PipelineBenchOptions& opt, const double rate)
+	{
+		switch (opt.source) {
+		case VarjoVSTFrame::PipelineBenchSource::Dummy:
+			return std::make_unique<VarjoVSTFrame::VarjoVSTDummyCamStreamer>(opt.chnls, opt.buffer_capacity, rate);
+		case VarjoVSTFrame::PipelineBenchSource::Session:
+			return std::make_unique<VarjoSession::SessionFrameSource>(VarjoSession::SessionFrameSourceOptions{
+				.path = opt.session_path,
+				.speed = rate,
+				.loop = true,
+				.buffer_capacity = opt.buffer_capacity
+			});
+		}
+		throw std::invalid_argument("Unknown pipeline bench source.");
+	}
+
+	uint64_t skipped_of(const std::vector<FanoutSubscriberStats>& stats, const std::string& name)
+	{
+		for (const auto& s : stats) {
+			if (s.name == name) {
+				return s.skipped;
+			}
+		}
+		return 0;
+	}
+}
+
+namespace VarjoVSTFrame {
+
+	std::vector<PipelineBenchResult> run_PipelineBench(const PipelineBenchOptions& opt)
+	{
+		if (opt.rates.empty()) {
+			throw std::invalid_argument("Pipeline bench needs at least one rate.");
+		}
+
+		std::vector<PipelineBenchResult> results;
+		for (const double rate : opt.rates) {
+			auto tracer = std::make_shared<Profiling::StageTracer>();
+
+			DataLogger logger(opt.width, opt.height, opt.row_stride, opt.fanout_capacity);
+			if (opt.configure) {
+				opt.configure(logger, rate);
+			}
+			logger.set_stage_tracer(tracer);
+
+			auto source = make_source(opt, rate);
+			const IFrameSource* source_view = source.get();
+			logger.open_dataStreamer(std::move(source));
+			logger.start_logging();
+
+			std::this_thread::sleep_for(opt.warmup);
+
+			// ウォームアップ中の値を捨ててから計測する
+			tracer->reset();
+			const uint64_t dropped_before = source_view->dropped_count();
+			const auto stats_before = logger.subscriber_stats();
+
+			std::this_thread::sleep_for(opt.duration);
+
+			PipelineBenchResult result{};
+			result.rate = rate;
+			result.window_s = tracer->elapsed_s();
+			result.stages = tracer->summary();
+			result.received = tracer->count(Profiling::StageTracer::root_stage);
+			result.source_dropped = source_view->dropped_count() - dropped_before;
+			const auto stats_after = logger.subscriber_stats();
+
+			logger.end_logging();
+
+			result.offered_fps = result.received / result.window_s;
+			result.sustained_fps = -1.0;
+			for (const auto& stats : stats_after) {
+				uint64_t delivered = 0;
+				for (const auto& stage : result.stages) {
+					if (stage.name == stats.name + ".submit") {
+						delivered = stage.count;
+					}
+				}
+
+				const PipelineBenchSubscriberResult sub{
+					.name = stats.name,
+					.policy = stats.policy,
+					.delivered = delivered,
+					.skipped = stats.skipped - skipped_of(stats_before, stats.name),
+					.fps = delivered / result.window_s
+				};
+				if (sub.policy == FanoutPolicy::Lossless) {
+					result.sustained_fps = result.sustained_fps < 0.0 ? sub.fps : std::min(result.sustained_fps, sub.fps);
+				}
+				result.subscribers.push_back(sub);
+			}
+
+			// Losslessの出力先がない場合はリングへの発行までを処理レートとする
+			if (result.sustained_fps < 0.0) {
+				uint64_t published = 0;
+				for (const auto& stage : result.stages) {
+					if (stage.name == "publish") {
+						published = stage.count;
+					}
+				}
+				result.sustained_fps = published / result.window_s;
+			}
+
+			const double drop_ratio = result.received ? static_cast<double>(result.source_dropped) / result.received : 0.0;
+			result.saturated = drop_ratio > opt.max_drop_ratio || result.sustained_fps < result.offered_fps * opt.min_fps_ratio;
+			results.push_back(std::move(result));
+		}
+		return results;
+	}
+
+	void print_PipelineBenchResults(std::ostream& os, const std::vector<PipelineBenchResult>& results)
+	{
+		if (results.empty()) {
+			return;
+		}
+
+		const auto flags = os.flags();
+		os << std::fixed << std::setprecision(1);
+
+		const PipelineBenchResult* first_saturated = nullptr;
+		const PipelineBenchResult* last_sustained = nullptr;
+		for (const auto& result : results) {
+			os << "rate " << result.rate
+				<< ": offered " << result.offered_fps << " fps, sustained " << result.sustained_fps << " fps"
+				<< ", source dropped " << result.source_dropped << "/" << result.received
+				<< (result.saturated ? "  [SATURATED]" : "") << "\n";
+
+			os << "  " << std::left << std::setw(40) << "stage" << std::right
+				<< std::setw(10) << "count" << std::setw(11) << "p50[us]" << std::setw(11) << "p99[us]"
+				<< std::setw(12) << "p99.9[us]" << std::setw(11) << "max[us]" << "\n";
+			for (const auto& stage : result.stages) {
+				if (stage.parent.empty()) {
+					continue;
+				}
+				const auto print_row = [&os, &stage](const std::string& label, const Sampling::JitterSummary& s) {
+					os << "  " << std::left << std::setw(40) << label << std::right
+						<< std::setw(10) << stage.count << std::setw(11) << s.p50_us << std::setw(11) << s.p99_us
+						<< std::setw(12) << s.p999_us << std::setw(11) << s.max_us << "\n";
+				};
+				print_row(stage.parent + " -> " + stage.name, stage.latency);
+				if (stage.is_end_to_end) {
+					print_row(stage.name + " (end-to-end)", stage.end_to_end);
+				}
+			}
+			for (const auto& sub : result.subscribers) {
+				os << "  " << sub.name << ": " << sub.fps << " fps, delivered " << sub.delivered << ", skipped " << sub.skipped << "\n";
+			}
+
+			if (result.saturated) {
+				if (first_saturated == nullptr) first_saturated = &result;
+			} else if (first_saturated == nullptr) {
+				last_sustained = &result;
+			}
+		}
+
+		if (first_saturated != nullptr) {
+			os << "saturation point: rate " << first_saturated->rate;
+			if (last_sustained != nullptr) {
+				os << " (last sustained rate " << last_sustained->rate << ")";
+			}
+			os << "\n";
+		} else {
+			os << "no saturation up to rate " << results.back().rate << "\n";
+		}
+		os.flags(flags);
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <ostream>
+
+#include "VSTFrameDataLogger.hpp"
+#include "../util/StageTracer.hpp"
+
+namespace VarjoVSTFrame {
+
+	enum class PipelineBenchSource {
+		Dummy,		// 保存済みのダミーフレーム．rateはfps
+		Session		// 記録したセッション．rateは記録時に対する再生速度の倍率
+	};
+
+	struct PipelineBenchOptions {
+		PipelineBenchSource source = PipelineBenchSource::Dummy;
+		std::string session_path = "session.vses";
+		// 順に負荷を上げて計測する
+		std::vector<double> rates{ 30, 60, 90, 120, 180, 240 };
+
+		varjo_ChannelFlag chnls = varjo_ChannelFlag_Left | varjo_ChannelFlag_Right;
+		size_t buffer_capacity = 20;
+		size_t fanout_capacity = 32;
+		size_t width = 832;
+		size_t height = 640;
+		size_t row_stride = 896;
+
+		// 出力先の起動(ffmpegなど)を集計から除くための待ち時間と，計測時間
+		std::chrono::milliseconds warmup{ 2000 };
+		std::chrono::milliseconds duration{ 10000 };
+
+		/**
+		 * @brief rateごとに新しく作るDataLoggerへ出力先を開く．計測する構成はここで決める
+		 */
+		std::function<void(DataLogger& logger, const double rate)> configure;
+
+		// 供給元で捨てたフレームの割合がこれを超えるか，Losslessの出力先の処理レートが
+		// 供給レートのmin_fps_ratio倍を下回ったら飽和とみなす
+		double max_drop_ratio = 0.001;
+		double min_fps_ratio = 0.98;
+	};
+
+	struct PipelineBenchSubscriberResult {
+		std::string name;
+		FanoutPolicy policy;
+		uint64_t delivered;
+		uint64_t skipped;
+		double fps;
+	};
+
+	struct PipelineBenchResult {
+		double rate;
+		double window_s;
+		uint64_t received;			// 供給元が受け取ったフレーム数(左右の合計)
+		uint64_t source_dropped;	// DataLoggerが取り出す前に捨てられた数
+		double offered_fps;
+		double sustained_fps;		// Losslessの出力先のうち最も遅いものの処理レート
+		std::vector<PipelineBenchSubscriberResult> subscribers;
+		std::vector<Profiling::StageSummary> stages;
+		bool saturated;
+	};
+
+	/**
+	 * @brief DataLoggerをダミーまたはセッション再生から一定レートで駆動し，段ごとの遅延と処理レートを計測する．
+	 * @detail rateごとにDataLoggerを作り直し，warmupの後にStageTracerの集計をやり直してからduration計測する．
+	 *         Parallelの出力先ではsubmitの段は受け渡しまでの時間になり，書き込み自体は含まれない．
+	 */
+	std::vector<PipelineBenchResult> run_PipelineBench(const PipelineBenchOptions& opt);
+
+	/**
+	 * @brief 段ごとのパーセンタイルの表と，最初に飽和したレートを出力する
+	 */
+	void print_PipelineBenchResults(std::ostream& os, const std::vector<PipelineBenchResult>& results);
+}
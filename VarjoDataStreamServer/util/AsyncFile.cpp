@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "AsyncFile.hpp"
+#include "PerformanceChecker.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::LatencyHistogram& batch_write = PerformanceChecker::histogram("async_io_batch_write_ns");
+		PerformanceChecker::Counter& bytes_written = PerformanceChecker::counter("async_io_bytes_written_total");
+		PerformanceChecker::Counter& write_errors = PerformanceChecker::counter("async_io_write_errors_total");
+		PerformanceChecker::Gauge& pending_blocks = PerformanceChecker::gauge("async_io_pending_blocks");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+
+	constexpr size_t align_up(const size_t n) {
+		return (n + AsyncIo::io_alignment - 1) / AsyncIo::io_alignment * AsyncIo::io_alignment;
+	}
+
+	// 全てのAsyncFileで共有する．各ファイルが参照を持つので，静的な破棄の順序に関わらず返却できる
+	const std::shared_ptr<Memory::MemoryAccount>& io_account() {
+		static const std::shared_ptr<Memory::MemoryAccount> account =
+			Memory::MemoryBudget::shared().open_account("async_io", Memory::MemoryClass::Recording);
+		return account;
+	}
+
+	AsyncIo::AsyncFileOptions normalize(AsyncIo::AsyncFileOptions opt) {
+		opt.block_size = align_up(std::max<size_t>(opt.block_size, 1));
+		opt.max_inflight = std::max<size_t>(opt.max_inflight, 1);
+		return opt;
+	}
+}
+
+namespace AsyncIo {
+
+	AsyncFile::AsyncFile(const AsyncFileOptions& opt)
+		: opt_(normalize(opt))
+		, budget_account_(io_account())
+	{}
+
+	AsyncFile::~AsyncFile()
+	{
+		this->close();
+		this->budget_account_->release(this->allocated_bytes_.exchange(0));
+	}
+
+	bool AsyncFile::open(const std::filesystem::path& path)
+	{
+		if (this->open_) {
+			return false;
+		}
+		if (!this->open_native(path)) {
+			return false;
+		}
+
+		this->next_offset_ = 0;
+		this->appended_ = 0;
+		this->failed_ = false;
+		this->written_bytes_ = 0;
+		this->open_ = true;
+		return true;
+	}
+
+	void AsyncFile::close()
+	{
+		if (!this->open_) {
+			return;
+		}
+
+		// 半端なブロックも渡して，書き終えるまで待つ
+		this->submit_current();
+		this->io_task_.wait_idle();
+
+		// unbufferedの最後のブロックはゼロ詰めして書いているので，本来の長さに戻す
+		if (this->opt_.unbuffered && !this->failed() && this->appended_ % io_alignment != 0) {
+			if (!this->truncate_native(this->appended_)) {
+				this->failed_ = true;
+				metrics().write_errors.inc();
+			}
+		}
+
+		this->close_native();
+		this->open_ = false;
+	}
+
+	void AsyncFile::write(const void* data, const size_t size)
+	{
+		if (!this->open_) {
+			return;
+		}
+
+		const char* src = static_cast<const char*>(data);
+		size_t rest = size;
+		while (rest > 0) {
+			if (!this->current_.data) {
+				this->current_ = this->acquire_block();
+				this->current_.offset = this->next_offset_;
+			}
+
+			const size_t n = std::min(rest, this->opt_.block_size - this->current_.used);
+			std::memcpy(this->current_.data.get() + this->current_.used, src, n);
+			this->current_.used += n;
+			src += n;
+			rest -= n;
+
+			if (this->current_.used == this->opt_.block_size) {
+				this->submit_current();
+			}
+		}
+		this->appended_ += size;
+	}
+
+	void AsyncFile::flush()
+	{
+		// unbufferedではブロックの途中から書けないので，closeまで持つ
+		if (this->open_ && !this->opt_.unbuffered) {
+			this->submit_current();
+		}
+	}
+
+	AsyncFile::Block AsyncFile::acquire_block()
+	{
+		{
+			std::lock_guard<std::mutex> lk(this->que_mtx_);
+			if (!this->free_blocks_.empty()) {
+				Block block = std::move(this->free_blocks_.back());
+				this->free_blocks_.pop_back();
+				block.used = 0;
+				return block;
+			}
+		}
+
+		this->budget_account_->charge(this->opt_.block_size);
+		this->allocated_bytes_.fetch_add(this->opt_.block_size, std::memory_order_relaxed);
+
+		Block block;
+		block.data.reset(static_cast<char*>(::operator new[](this->opt_.block_size, std::align_val_t(io_alignment))));
+		return block;
+	}
+
+	void AsyncFile::submit_current()
+	{
+		if (!this->current_.data || this->current_.used == 0) {
+			return;
+		}
+
+		// unbufferedの半端なブロック(最後のみ)はセクタ境界までゼロで埋めて書く
+		if (this->opt_.unbuffered) {
+			std::memset(this->current_.data.get() + this->current_.used, 0, align_up(this->current_.used) - this->current_.used);
+		}
+
+		this->next_offset_ += this->current_.used;
+		{
+			std::lock_guard<std::mutex> lk(this->que_mtx_);
+			this->que_.push_back(std::move(this->current_));
+		}
+		this->current_ = Block{};
+		metrics().pending_blocks.add(1);
+		this->io_task_.notify();
+	}
+
+	size_t AsyncFile::write_size(const Block& block) const
+	{
+		// unbufferedでは長さもセクタの倍数にする(最後のブロックのみ半端になりうる)
+		return this->opt_.unbuffered ? align_up(block.used) : block.used;
+	}
+
+	void AsyncFile::io_worker()
+	{
+		std::deque<Block> batch;
+		{
+			std::lock_guard<std::mutex> lk(this->que_mtx_);
+			batch.swap(this->que_);
+		}
+		if (batch.empty()) {
+			return;
+		}
+
+		// 一度失敗したファイルには書かない(位置がずれたまま書き足さない)
+		if (!this->failed()) {
+			PerformanceChecker::ScopedTimer timer(metrics().batch_write);
+			if (!this->write_batch(batch)) {
+				this->failed_ = true;
+				metrics().write_errors.inc();
+			}
+		}
+		metrics().pending_blocks.add(-static_cast<int64_t>(batch.size()));
+
+		// ブロックを使い回しに戻す．予算が逼迫しているときは取っておかずに解放する
+		const size_t max_pooled = this->budget_account_->under_pressure() ? 0 : this->opt_.max_pooled_blocks;
+		size_t pooled = 0;
+		{
+			std::lock_guard<std::mutex> lk(this->que_mtx_);
+			for (auto& block : batch) {
+				if (this->free_blocks_.size() >= max_pooled) {
+					break;
+				}
+				this->free_blocks_.push_back(std::move(block));
+				++pooled;
+			}
+		}
+		const uint64_t freed = static_cast<uint64_t>(batch.size() - pooled) * this->opt_.block_size;
+		batch.clear();
+		this->allocated_bytes_.fetch_sub(freed, std::memory_order_relaxed);
+		this->budget_account_->release(freed);
+	}
+
+#ifdef _WIN32
+
+	bool AsyncFile::open_native(const std::filesystem::path& path)
+	{
+		DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED;
+		if (this->opt_.unbuffered) {
+			flags |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+		}
+
+		HANDLE h = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, flags, nullptr);
+		if (h == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		this->handle_ = h;
+
+		// 手動リセットのイベント．WriteFileが発行時に非シグナルに戻す
+		while (this->events_.size() < this->opt_.max_inflight) {
+			HANDLE ev = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			if (ev == nullptr) {
+				this->close_native();
+				return false;
+			}
+			this->events_.push_back(ev);
+		}
+		return true;
+	}
+
+	void AsyncFile::close_native()
+	{
+		if (this->handle_ != nullptr) {
+			CloseHandle(static_cast<HANDLE>(this->handle_));
+			this->handle_ = nullptr;
+		}
+		for (auto ev : this->events_) {
+			CloseHandle(static_cast<HANDLE>(ev));
+		}
+		this->events_.clear();
+	}
+
+	bool AsyncFile::truncate_native(const uint64_t size)
+	{
+		FILE_END_OF_FILE_INFO info{};
+		info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+		return SetFileInformationByHandle(static_cast<HANDLE>(this->handle_), FileEndOfFileInfo, &info, sizeof(info)) != FALSE;
+	}
+
+	bool AsyncFile::write_batch(std::deque<Block>& batch)
+	{
+		const HANDLE h = static_cast<HANDLE>(this->handle_);
+		std::vector<OVERLAPPED> ovs(this->opt_.max_inflight);
+
+		for (size_t begin = 0; begin < batch.size(); begin += this->opt_.max_inflight) {
+			const size_t n = std::min(this->opt_.max_inflight, batch.size() - begin);
+
+			// まとめて発行する
+			size_t issued = 0;
+			bool ok = true;
+			for (; issued < n; ++issued) {
+				const Block& block = batch[begin + issued];
+				OVERLAPPED& ov = ovs[issued];
+				ov = OVERLAPPED{};
+				ov.Offset = static_cast<DWORD>(block.offset);
+				ov.OffsetHigh = static_cast<DWORD>(block.offset >> 32);
+				ov.hEvent = static_cast<HANDLE>(this->events_[issued]);
+
+				if (!WriteFile(h, block.data.get(), static_cast<DWORD>(this->write_size(block)), nullptr, &ov)
+					&& GetLastError() != ERROR_IO_PENDING) {
+					ok = false;
+					break;
+				}
+			}
+
+			// 発行した分は失敗していても完了を待つ(OVERLAPPEDとブロックを使い終えるまで)
+			for (size_t i = 0; i < issued; ++i) {
+				const Block& block = batch[begin + i];
+				DWORD done = 0;
+				if (!GetOverlappedResult(h, &ovs[i], &done, TRUE) || done != this->write_size(block)) {
+					ok = false;
+					continue;
+				}
+				this->written_bytes_.fetch_add(block.used, std::memory_order_relaxed);
+				metrics().bytes_written.inc(block.used);
+			}
+
+			if (!ok) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+#else
+
+	bool AsyncFile::open_native(const std::filesystem::path& path)
+	{
+		int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+		if (this->opt_.unbuffered) {
+			flags |= O_DIRECT;
+		}
+#endif
+		this->fd_ = ::open(path.c_str(), flags, 0644);
+		return this->fd_ >= 0;
+	}
+
+	void AsyncFile::close_native()
+	{
+		if (this->fd_ >= 0) {
+			::close(this->fd_);
+			this->fd_ = -1;
+		}
+	}
+
+	bool AsyncFile::truncate_native(const uint64_t size)
+	{
+		return ::ftruncate(this->fd_, static_cast<off_t>(size)) == 0;
+	}
+
+	bool AsyncFile::write_batch(std::deque<Block>& batch)
+	{
+		for (const auto& block : batch) {
+			const size_t size = this->write_size(block);
+			size_t done = 0;
+			while (done < size) {
+				const ssize_t n = ::pwrite(this->fd_, block.data.get() + done, size - done, static_cast<off_t>(block.offset + done));
+				if (n < 0 && errno == EINTR) {
+					continue;
+				}
+				if (n <= 0) {
+					return false;
+				}
+				done += static_cast<size_t>(n);
+			}
+			this->written_bytes_.fetch_add(block.used, std::memory_order_relaxed);
+			metrics().bytes_written.inc(block.used);
+		}
+		return true;
+	}
+
+#endif
+}
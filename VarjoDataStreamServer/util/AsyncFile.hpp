@@ -0,0 +1,148 @@
+/************************************************************************************************************************
+	AsyncFile
+	CSV・バイナリ・セッションの各ライターが共有する非同期のファイル書き込み．
+	std::ofstreamでは書き込みスレッド自身がwrite()でディスクを待つため，ページキャッシュの書き戻しが重なると
+	ライターのキューが詰まっていた．AsyncFileではwriteは固定長のブロックへのコピーだけで，埋まったブロックを
+	ExecutorのI/Oプール(WorkerTask)に渡して戻る．ディスクを待つのはI/Oプールのスレッドだけになる．
+
+	- ブロック: io_alignment境界に揃えた固定長の領域．ファイルごとに使い回し(max_pooled_blocks個まで)，
+	            書き込みのたびに確保しない．
+	- まとめ書き: I/Oプールは溜まっているブロックをまとめて取り出し，Windowsでは最大max_inflight個のoverlapped
+	              WriteFileを同時に発行してから完了を待つ．それ以外の環境ではpwriteで順に書く(スレッドプールでの代替)．
+	- unbuffered: OSのキャッシュを通さずに書く(Windows: FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH，
+	              Linux: O_DIRECT)．大きなフレームデータ向け．書き込みはブロック単位に限られるので，flushは何もせず，
+	              最後の半端なブロックはcloseでゼロ詰めして書いてから本来の長さに切り詰める．
+
+	使い方(std::ofstreamと同じく，1つのファイルのwrite/flush/closeは同時に呼ばないこと):
+		AsyncIo::AsyncFile file;
+		file.open(path);
+		file.write(line.data(), line.size());	// コピーして戻る
+		file.flush();							// 半端なブロックも渡す(ディスクへの完了は待たない)
+		file.close();							// 全て書き終えるまで待つ
+
+	書き込みに失敗した場合はfailed()がtrueになり，以降のブロックは捨てる．
+
+	確保したブロックはメモリ予算(MemoryBudget)の"async_io"に計上する．記録を欠かさないため断らずに計上し(charge)，
+	ディスクが詰まった分はフレームの確保が断られることで入口側で抑える．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <new>
+
+#include "Executor.hpp"
+#include "MemoryBudget.hpp"
+
+namespace AsyncIo {
+
+	// unbufferedで要求される境界(セクタサイズ)．ブロックの先頭・長さ・ファイル内の位置はこの倍数になる
+	inline constexpr size_t io_alignment = 4096;
+
+	struct AsyncFileOptions {
+		size_t block_size = 1024 * 1024;		// io_alignmentの倍数に切り上げる
+		size_t max_inflight = 8;				// まとめ書きで同時に発行する書き込みの数
+		size_t max_pooled_blocks = 16;			// 使い回すブロック数の上限
+		bool unbuffered = false;				// OSのキャッシュを通さない
+	};
+
+	class AsyncFile {
+
+	public:
+		explicit AsyncFile(const AsyncFileOptions& opt = AsyncFileOptions{});
+
+		~AsyncFile();
+
+		AsyncFile(const AsyncFile&) = delete;
+		AsyncFile& operator=(const AsyncFile&) = delete;
+
+		/**
+		 * @brief ファイルを作り直して開く
+		 */
+		bool open(const std::filesystem::path& path);
+
+		/**
+		 * @brief 残りを全て渡し，書き終えるまで待ってから閉じる
+		 */
+		void close();
+
+		/**
+		 * @brief ブロックへコピーして戻る．埋まったブロックはI/Oプールへ渡す
+		 */
+		void write(const void* data, const size_t size);
+
+		void write(std::string_view s) {
+			this->write(s.data(), s.size());
+		}
+
+		/**
+		 * @brief 書きかけのブロックもI/Oプールへ渡す．unbufferedでは何もしない
+		 */
+		void flush();
+
+		// getter
+		bool is_open() const { return this->open_; }
+		bool failed() const { return this->failed_.load(std::memory_order_relaxed); }
+		uint64_t size() const { return this->appended_; }		// writeで渡したバイト数
+		uint64_t written_bytes() const { return this->written_bytes_.load(std::memory_order_relaxed); }		// ディスクへの書き込みが完了したバイト数
+
+	private:
+		struct AlignedDelete {
+			void operator()(char* p) const { ::operator delete[](p, std::align_val_t(io_alignment)); }
+		};
+
+		struct Block {
+			std::unique_ptr<char[], AlignedDelete> data;
+			size_t used = 0;
+			uint64_t offset = 0;
+		};
+
+		Block acquire_block();
+		void submit_current();
+		size_t write_size(const Block& block) const;
+
+		void io_worker();
+		bool write_batch(std::deque<Block>& batch);
+
+		bool open_native(const std::filesystem::path& path);
+		void close_native();
+		bool truncate_native(const uint64_t size);
+
+	private:
+		const AsyncFileOptions opt_;
+		bool open_ = false;
+
+#ifdef _WIN32
+		void* handle_ = nullptr;
+		std::vector<void*> events_;		// overlapped書き込みの完了通知．max_inflight個
+#else
+		int fd_ = -1;
+#endif
+
+		// writeを呼ぶスレッドのみが触る
+		Block current_;
+		uint64_t next_offset_ = 0;
+		uint64_t appended_ = 0;
+
+		std::deque<Block> que_;
+		std::vector<Block> free_blocks_;
+		std::mutex que_mtx_;
+
+		std::atomic_bool failed_{ false };
+		std::atomic<uint64_t> written_bytes_{ 0 };
+
+		const std::shared_ptr<Memory::MemoryAccount> budget_account_;
+		std::atomic<uint64_t> allocated_bytes_{ 0 };		// budget_account_に計上しているブロックの合計
+
+		Execution::WorkerTask io_task_{ [this] { this->io_worker(); }, Execution::TaskKind::Io };
+	};
+}
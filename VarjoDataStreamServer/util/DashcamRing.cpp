@@ -0,0 +1,88 @@
+#include <iostream>
+
+#include "DashcamRing.hpp"
+#include "TraceRecorder.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::Counter& triggers = PerformanceChecker::counter("dashcam_triggers_total");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+}
+
+namespace Dashcam {
+
+	Trigger::Trigger(const DashcamOptions& opt)
+		: opt_(opt)
+	{
+		if (!this->opt_.log_path.empty()) {
+			this->log_.open(this->opt_.log_path, std::ios::out | std::ios::trunc);
+			this->log_ << "time_ns,reason,window_begin_ns,window_end_ns\n";
+			this->log_.flush();
+		}
+	}
+
+	void Trigger::fire(const std::string& reason, const int64_t time_ns)
+	{
+		const int64_t t = time_ns != 0 ? time_ns : this->latest_ns();
+		if (t == 0) {
+			std::cerr << "Dashcam: trigger '" << reason << "' ignored (no data received yet)" << std::endl;
+			return;
+		}
+
+		const Window window{ t - static_cast<int64_t>(this->opt_.pre_s * 1e9), t + static_cast<int64_t>(this->opt_.post_s * 1e9) };
+		{
+			std::lock_guard lk(this->mtx_);
+
+			// 始まりの順に並べ，重なる窓はまとめる
+			auto it = std::upper_bound(this->windows_.begin(), this->windows_.end(), window,
+				[](const Window& a, const Window& b) { return a.begin_ns < b.begin_ns; });
+			it = this->windows_.insert(it, window);
+			std::vector<Window> merged;
+			merged.reserve(this->windows_.size());
+			for (const auto& w : this->windows_) {
+				if (!merged.empty() && w.begin_ns <= merged.back().end_ns) {
+					merged.back().end_ns = std::max(merged.back().end_ns, w.end_ns);
+				} else {
+					merged.push_back(w);
+				}
+			}
+			this->windows_ = std::move(merged);
+			this->events_.push_back(TriggerEvent{ t, reason, window.begin_ns, window.end_ns });
+
+			if (this->log_.is_open()) {
+				this->log_ << t << "," << reason << "," << window.begin_ns << "," << window.end_ns << "\n";
+				this->log_.flush();
+			}
+		}
+		this->version_.fetch_add(1, std::memory_order_release);
+
+		metrics().triggers.inc();
+		Profiling::trace_instant("dashcam.trigger", t);
+		std::cerr << "Dashcam: trigger '" << reason << "' at " << t << " ns (keep "
+			<< this->opt_.pre_s << " s before, " << this->opt_.post_s << " s after)" << std::endl;
+	}
+
+	void Trigger::observe(const int64_t time_ns)
+	{
+		int64_t latest = this->latest_ns_.load(std::memory_order_relaxed);
+		while (time_ns > latest && !this->latest_ns_.compare_exchange_weak(latest, time_ns, std::memory_order_relaxed)) {}
+	}
+
+	std::vector<Window> Trigger::windows() const
+	{
+		std::lock_guard lk(this->mtx_);
+		return this->windows_;
+	}
+
+	std::vector<TriggerEvent> Trigger::events() const
+	{
+		std::lock_guard lk(this->mtx_);
+		return this->events_;
+	}
+}
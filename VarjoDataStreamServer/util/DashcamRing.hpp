@@ -0,0 +1,320 @@
+/************************************************************************************************************************
+	DashcamRing
+	出来事の前後の数秒だけを記録するためのドライブレコーダー型の記録(dashcam mode)．
+	これまでは出来事の前後しか使わない実験でも全てをエンコードして書いていたため，エンコードの負荷と保存容量の大半が無駄になっていた．
+	各出力先の手前にRingRecorderを挟み，直近pre_s秒分をメモリ上のリングに(フレームは圧縮して)持っておく．
+	Triggerが引かれたら，[引かれた時刻 - pre_s, 引かれた時刻 + post_s]の窓に入るものだけを既存の書き込み先に渡す．
+
+	- Trigger: 全ての出力先で共有する．fire(reason)で窓を加える．時刻を省略すると，各リングが受け取った最新の時刻を使う．
+	           窓の中で引き直すと窓が後ろへ延びる．引いた記録は標準エラー・log_path(CSV)・TraceRecorder("dashcam.trigger")に残す．
+	- RingRecorder<T, Traits>: ISubmit<T>として書き込み先の代わりに渡す．受け取るごとに
+	    1. 窓に入らず，pre_sより古いもの・最新の窓より前(窓と窓の間)のものをリングから捨てる
+	    2. リングの先頭から窓に入るものを(展開して)書き込み先へ渡す．1回にcatchup個までなので，引いた直後に
+	       pre_s秒分を一度に積まず，受け取りの数倍の速さで追いつく
+	    3. リングが空で窓の中なら，受け取ったものをそのまま(ハンドルのまま)渡す．それ以外はリングに積む
+	  時刻はストリームによらず同じ時計(Varjoの時刻)で比べる．set_conditionで受け取ったものから引く条件(gazeの出来事など)を渡せる．
+	- Traits: T → リングに置く形(Stored)の変換．timestamp_ns / pack / unpack / bytes(置いた大きさ) / raw_bytes(元の大きさ)を持つ．
+	          小さな記録はPlainRingTraitsでそのまま置く．
+	- メモリ: リングはMemoryClass::Recordingのアカウント("dashcam_<名前>")で計上し，確保できなければ古いものから捨てる．
+	- 計装: dashcam_triggers_total，リングごとのdashcam_ring_items / dashcam_ring_evicted_total / dashcam_ring_flushed_total /
+	        dashcam_ring_dropped_total(確保できず捨てた数)，圧縮前後のdashcam_ring_raw_bytes_total / dashcam_ring_packed_bytes_total．
+
+	使い方:
+		auto trigger = std::make_shared<Dashcam::Trigger>(opt);
+		auto ring = std::make_shared<Dashcam::RingRecorder<Frame, FrameRingTraits>>("video_writer", trigger, *video_writer);
+		... ring->submit(frame) ...
+		trigger->fire("api");
+		...
+		ring->close();			// 窓に入る分を渡し切ってから
+		video_writer->close();
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+
+#include "ISubmit.hpp"
+#include "MemoryBudget.hpp"
+#include "PerformanceChecker.hpp"
+
+namespace Dashcam {
+
+	struct DashcamOptions {
+		double pre_s = 10.0;			// 引く前に遡って残す秒数
+		double post_s = 5.0;			// 引いた後に残す秒数
+		bool compress = true;			// フレームをリングに置くときに圧縮する
+		size_t catchup = 4;				// 1つ受け取るごとにリングから渡す最大数
+		std::string log_path;			// 引いた記録を書くCSV．空なら書かない
+	};
+
+	struct TriggerEvent {
+		int64_t time_ns;		// 引いた時刻(Varjoの時刻)
+		std::string reason;
+		int64_t window_begin_ns;
+		int64_t window_end_ns;
+	};
+
+	/**
+	 * @brief 残す時間帯．[begin_ns, end_ns]
+	 */
+	struct Window {
+		int64_t begin_ns;
+		int64_t end_ns;
+
+		bool contains(const int64_t t) const { return this->begin_ns <= t && t <= this->end_ns; }
+	};
+
+	/****************************************************************************************************
+	* @class Trigger
+	* @brief 全ての出力先で共有する引き金．残す時間帯の一覧を持つ
+	*****************************************************************************************************/
+
+	class Trigger {
+
+	public:
+		explicit Trigger(const DashcamOptions& opt = DashcamOptions{});
+
+		Trigger(const Trigger&) = delete;
+		Trigger& operator=(const Trigger&) = delete;
+
+		/**
+		 * @brief time_nsの前後を残す．time_ns = 0なら各リングが受け取った最新の時刻(まだ何も受け取っていなければ何もしない)．
+		 *        どのスレッドから呼んでもよい
+		 */
+		void fire(const std::string& reason, const int64_t time_ns = 0);
+
+		/**
+		 * @brief リングが受け取った時刻を知らせる
+		 */
+		void observe(const int64_t time_ns);
+
+		/**
+		 * @brief 窓が変わるたびに増える．リングは変わったときだけwindowsを取り直す
+		 */
+		uint64_t version() const { return this->version_.load(std::memory_order_acquire); }
+		std::vector<Window> windows() const;
+
+		std::vector<TriggerEvent> events() const;
+
+		const DashcamOptions& options() const { return this->opt_; }
+		int64_t latest_ns() const { return this->latest_ns_.load(std::memory_order_relaxed); }
+
+	private:
+		const DashcamOptions opt_;
+		std::atomic<int64_t> latest_ns_{ 0 };
+		std::atomic<uint64_t> version_{ 0 };
+
+		mutable std::mutex mtx_;
+		std::vector<Window> windows_;			// 時刻順．重なる窓は1つにまとめる
+		std::vector<TriggerEvent> events_;
+		std::ofstream log_;
+	};
+
+	/**
+	 * @brief 小さな記録をそのままリングに置くTraitsの土台．timestamp_nsだけを足して使う
+	 */
+	template <class T>
+	struct PlainRingTraits {
+		using Stored = T;
+		static Stored pack(const T& data, const bool /*compress*/) { return data; }
+		static T unpack(Stored&& stored) { return std::move(stored); }
+		static size_t bytes(const Stored&) { return sizeof(T); }
+		static size_t raw_bytes(const T&) { return sizeof(T); }
+	};
+
+	/****************************************************************************************************
+	* @class RingRecorder
+	* @brief 書き込み先の手前で直近pre_s秒分を持ち，Triggerの窓に入るものだけを渡す
+	* @detail submitは1つのスレッドから呼ぶ．closeはsubmitを呼び終えてから，書き込み先を閉じる前に呼ぶ．
+	*****************************************************************************************************/
+
+	template <class T, class Traits>
+	class RingRecorder : public ISubmit<T> {
+
+	public:
+		RingRecorder(const std::string& name, std::shared_ptr<Trigger> trigger, ISubmit<T>& downstream)
+			: name_(name)
+			, trigger_(std::move(trigger))
+			, downstream_(downstream)
+			, pre_ns_(static_cast<int64_t>(this->trigger_->options().pre_s * 1e9))
+			, account_(Memory::MemoryBudget::shared().open_account("dashcam_" + name, Memory::MemoryClass::Recording))
+			, items_(PerformanceChecker::gauge("dashcam_ring_items{ring=\"" + name + "\"}"))
+			, evicted_(PerformanceChecker::counter("dashcam_ring_evicted_total{ring=\"" + name + "\"}"))
+			, flushed_(PerformanceChecker::counter("dashcam_ring_flushed_total{ring=\"" + name + "\"}"))
+			, dropped_(PerformanceChecker::counter("dashcam_ring_dropped_total{ring=\"" + name + "\"}"))
+			, raw_bytes_(PerformanceChecker::counter("dashcam_ring_raw_bytes_total"))
+			, packed_bytes_(PerformanceChecker::counter("dashcam_ring_packed_bytes_total"))
+		{}
+
+		~RingRecorder() {
+			this->close();
+		}
+
+		RingRecorder(const RingRecorder&) = delete;
+		RingRecorder& operator=(const RingRecorder&) = delete;
+
+		/**
+		 * @brief 受け取ったものでcondition(data)がtrueならreasonでTriggerを引く．submitの前に呼ぶ
+		 */
+		void set_condition(std::function<bool(const T&)> condition, std::string reason) {
+			this->condition_ = std::move(condition);
+			this->condition_reason_ = std::move(reason);
+		}
+
+		/**
+		 * @brief 窓に入る分を全て書き込み先へ渡し，残りを捨てる
+		 */
+		void close() {
+			std::lock_guard lk(this->mtx_);
+			this->refresh_windows();
+			std::vector<T> out;
+			while (!this->ring_.empty()) {
+				if (this->in_window(this->ring_.front().timestamp_ns)) {
+					out.push_back(Traits::unpack(std::move(this->ring_.front().stored)));
+				} else {
+					this->evicted_.inc();
+				}
+				this->pop_front();
+			}
+			this->forward(std::move(out));
+		}
+
+		const std::string& name() const { return this->name_; }
+
+	private:
+		struct Entry {
+			int64_t timestamp_ns;
+			typename Traits::Stored stored;
+			size_t bytes;
+		};
+
+		void submit_batch_impl(SubmitBatch<T> batch) override {
+			std::lock_guard lk(this->mtx_);
+			std::move(batch).consume([this](T&& data) {
+				this->accept(data, [&] { this->downstream_.submit(std::move(data)); });
+			});
+		}
+
+		void submit_shared_impl(SharedPayload<T> data) override {
+			// 窓の中で追いついていれば，ハンドルのまま渡す(コピーなし)
+			std::lock_guard lk(this->mtx_);
+			this->accept(*data, [&] { this->downstream_.submit(std::move(data)); });
+		}
+
+		template <class Forward>
+		void accept(const T& data, Forward&& forward_live) {
+			const int64_t t = Traits::timestamp_ns(data);
+			this->trigger_->observe(t);
+			if (this->condition_ && this->condition_(data)) {
+				this->trigger_->fire(this->condition_reason_, t);
+			}
+			this->refresh_windows();
+
+			// 1. 窓に入らず，pre_sより古いか最新の窓の始まりより前のもの(窓の間)を捨てる
+			while (!this->ring_.empty()
+				&& !this->in_window(this->ring_.front().timestamp_ns)
+				&& (this->ring_.front().timestamp_ns < t - this->pre_ns_ || this->before_latest_window(this->ring_.front().timestamp_ns))) {
+				this->evicted_.inc();
+				this->pop_front();
+			}
+
+			// 2. 窓に入るものを先頭から渡す
+			std::vector<T> out;
+			while (!this->ring_.empty() && out.size() < this->trigger_->options().catchup
+				&& this->in_window(this->ring_.front().timestamp_ns)) {
+				out.push_back(Traits::unpack(std::move(this->ring_.front().stored)));
+				this->pop_front();
+			}
+			this->forward(std::move(out));
+
+			// 3. 追いついていればそのまま渡し，それ以外はリングに積む(順序を保つ)
+			if (this->ring_.empty() && this->in_window(t)) {
+				this->flushed_.inc();
+				forward_live();
+				return;
+			}
+			this->push_back(data, t);
+		}
+
+		void push_back(const T& data, const int64_t t) {
+			Entry entry{ t, Traits::pack(data, this->trigger_->options().compress), 0 };
+			entry.bytes = Traits::bytes(entry.stored);
+
+			// 確保できなければ窓に入らない古いものから手放す
+			while (!this->account_->try_reserve(entry.bytes)) {
+				if (this->ring_.empty() || this->in_window(this->ring_.front().timestamp_ns)) {
+					this->dropped_.inc();
+					return;
+				}
+				this->evicted_.inc();
+				this->pop_front();
+			}
+			this->packed_bytes_.inc(entry.bytes);
+			this->raw_bytes_.inc(Traits::raw_bytes(data));
+			this->ring_.push_back(std::move(entry));
+			this->items_.set(static_cast<int64_t>(this->ring_.size()));
+		}
+
+		void pop_front() {
+			this->account_->release(this->ring_.front().bytes);
+			this->ring_.pop_front();
+			this->items_.set(static_cast<int64_t>(this->ring_.size()));
+		}
+
+		void forward(std::vector<T>&& out) {
+			if (out.empty()) {
+				return;
+			}
+			this->flushed_.inc(out.size());
+			this->downstream_.submit(std::move(out));
+		}
+
+		void refresh_windows() {
+			const uint64_t version = this->trigger_->version();
+			if (version != this->windows_version_) {
+				this->windows_ = this->trigger_->windows();
+				this->windows_version_ = version;
+			}
+		}
+
+		bool in_window(const int64_t t) const {
+			return std::any_of(this->windows_.rbegin(), this->windows_.rend(), [t](const Window& w) { return w.contains(t); });
+		}
+
+		bool before_latest_window(const int64_t t) const {
+			return !this->windows_.empty() && t < this->windows_.back().begin_ns;
+		}
+
+	private:
+		const std::string name_;
+		const std::shared_ptr<Trigger> trigger_;
+		ISubmit<T>& downstream_;
+		const int64_t pre_ns_;
+		const std::shared_ptr<Memory::MemoryAccount> account_;
+
+		std::mutex mtx_;
+		std::deque<Entry> ring_;
+		std::vector<Window> windows_;
+		uint64_t windows_version_ = 0;
+
+		std::function<bool(const T&)> condition_;
+		std::string condition_reason_;
+
+		PerformanceChecker::Gauge& items_;
+		PerformanceChecker::Counter& evicted_;
+		PerformanceChecker::Counter& flushed_;
+		PerformanceChecker::Counter& dropped_;
+		PerformanceChecker::Counter& raw_bytes_;
+		PerformanceChecker::Counter& packed_bytes_;
+	};
+}
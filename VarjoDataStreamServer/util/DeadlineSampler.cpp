@@ -0,0 +1,218 @@
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+#include "DeadlineSampler.hpp"
+
+namespace {
+	inline void cpu_relax() {
+#ifdef _WIN32
+		YieldProcessor();
+#endif
+	}
+}
+
+namespace Sampling {
+
+	//////////////////////////////////////////////////////////////////////////////////////////////////
+	// JitterHistogram
+	//////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void JitterHistogram::record(std::chrono::nanoseconds lateness)
+	{
+		const int64_t ns = std::max<int64_t>(lateness.count(), 0);
+
+		this->bins_[bin_index(ns)].fetch_add(1, std::memory_order_relaxed);
+		this->count_.fetch_add(1, std::memory_order_relaxed);
+		this->sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+		if (ns > this->max_ns_.load(std::memory_order_relaxed)) {
+			this->max_ns_.store(ns, std::memory_order_relaxed);
+		}
+	}
+
+	void JitterHistogram::record_missed(uint64_t n)
+	{
+		this->missed_.fetch_add(n, std::memory_order_relaxed);
+	}
+
+	void JitterHistogram::reset()
+	{
+		for (auto& b : this->bins_) {
+			b.store(0, std::memory_order_relaxed);
+		}
+		this->count_.store(0, std::memory_order_relaxed);
+		this->missed_.store(0, std::memory_order_relaxed);
+		this->sum_ns_.store(0, std::memory_order_relaxed);
+		this->max_ns_.store(0, std::memory_order_relaxed);
+	}
+
+	double JitterHistogram::percentile_us(double q) const
+	{
+		const uint64_t total = this->count();
+		if (total == 0) {
+			return 0.0;
+		}
+
+		q = std::clamp(q, 0.0, 1.0);
+		const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total))));
+
+		uint64_t acc = 0;
+		for (size_t i = 0; i < bin_count; ++i) {
+			acc += this->bins_[i].load(std::memory_order_relaxed);
+			if (acc >= target) {
+				// オーバーフロービンは最大値で代用する
+				return (i == bin_count - 1) ? this->max_ns_.load(std::memory_order_relaxed) / 1000.0 : bin_upper_us(i);
+			}
+		}
+		return this->max_ns_.load(std::memory_order_relaxed) / 1000.0;
+	}
+
+	JitterSummary JitterHistogram::summary() const
+	{
+		const uint64_t n = this->count();
+
+		JitterSummary s{};
+		s.count = n;
+		s.missed = this->missed();
+		s.mean_us = n ? static_cast<double>(this->sum_ns_.load(std::memory_order_relaxed)) / n / 1000.0 : 0.0;
+		s.max_us = this->max_ns_.load(std::memory_order_relaxed) / 1000.0;
+		s.p50_us = this->percentile_us(0.50);
+		s.p99_us = this->percentile_us(0.99);
+		s.p999_us = this->percentile_us(0.999);
+		return s;
+	}
+
+	size_t JitterHistogram::bin_index(int64_t lateness_ns)
+	{
+		const int64_t us = lateness_ns / 1000;
+		if (us < 1000) {
+			return static_cast<size_t>(us);
+		} else if (us < 10000) {
+			return static_cast<size_t>(1000 + (us - 1000) / 10);
+		} else if (us < 100000) {
+			return static_cast<size_t>(1900 + (us - 10000) / 100);
+		} else {
+			return bin_count - 1;
+		}
+	}
+
+	double JitterHistogram::bin_upper_us(size_t index)
+	{
+		if (index < 1000) {
+			return static_cast<double>(index + 1);
+		} else if (index < 1900) {
+			return 1000.0 + static_cast<double>(index - 1000 + 1) * 10.0;
+		} else {
+			return 10000.0 + static_cast<double>(index - 1900 + 1) * 100.0;
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////////////////////
+	// DeadlineSampler
+	//////////////////////////////////////////////////////////////////////////////////////////////////
+
+	DeadlineSampler::DeadlineSampler(const SamplerOptions& opt)
+		: opt_(validated(opt))
+		, spin_window_(std::clamp(opt.spin_window, std::chrono::nanoseconds::zero(), opt.period / 2))
+	{
+#ifdef _WIN32
+		// 高分解能タイマーが使えない環境(Windows 10 1803より前)ではsleep_forで代用する
+		if (this->opt_.mode != SleepMode::Spin) {
+			this->timer_handle_ = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		}
+#endif
+	}
+
+	const SamplerOptions& DeadlineSampler::validated(const SamplerOptions& opt)
+	{
+		// 負のperiodではclampの範囲が逆転するので，spin_window_を計算する前に弾く
+		if (opt.period < std::chrono::nanoseconds::zero()) {
+			throw std::invalid_argument("DeadlineSampler: period must not be negative");
+		}
+		return opt;
+	}
+
+	DeadlineSampler::~DeadlineSampler()
+	{
+#ifdef _WIN32
+		if (this->timer_handle_) {
+			CloseHandle(static_cast<HANDLE>(this->timer_handle_));
+			this->timer_handle_ = nullptr;
+		}
+#endif
+	}
+
+	void DeadlineSampler::start()
+	{
+		this->next_deadline_ = clock::now();
+	}
+
+	DeadlineSampler::clock::time_point DeadlineSampler::wait_next()
+	{
+		// 周期0は待たずに回す
+		if (this->opt_.period == std::chrono::nanoseconds::zero()) {
+			return clock::now();
+		}
+
+		// 1周期以上遅れている場合は，過ぎたデッドラインを読み飛ばす
+		const auto now = clock::now();
+		if (now - this->next_deadline_ >= this->opt_.period) {
+			const auto behind = (now - this->next_deadline_) / this->opt_.period;
+			this->next_deadline_ += behind * this->opt_.period;
+			this->histogram_.record_missed(static_cast<uint64_t>(behind));
+		}
+
+		this->sleep_until(this->next_deadline_);
+		this->histogram_.record(clock::now() - this->next_deadline_);
+
+		const auto deadline = this->next_deadline_;
+		this->next_deadline_ += this->opt_.period;
+		return deadline;
+	}
+
+	void DeadlineSampler::sleep_until(clock::time_point tp)
+	{
+		auto os_sleep = [this](clock::duration d) {
+			if (d <= clock::duration::zero()) {
+				return;
+			}
+#ifdef _WIN32
+			if (this->timer_handle_) {
+				// 相対時間(100ns単位，負値)で指定する
+				LARGE_INTEGER due;
+				due.QuadPart = -static_cast<LONGLONG>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / 100);
+				if (SetWaitableTimer(static_cast<HANDLE>(this->timer_handle_), &due, 0, nullptr, nullptr, FALSE)) {
+					WaitForSingleObject(static_cast<HANDLE>(this->timer_handle_), INFINITE);
+					return;
+				}
+			}
+#endif
+			std::this_thread::sleep_for(d);
+		};
+
+		switch (this->opt_.mode) {
+		case SleepMode::Sleep:
+			os_sleep(tp - clock::now());
+			break;
+		case SleepMode::Hybrid:
+			os_sleep(tp - this->spin_window_ - clock::now());
+			while (clock::now() < tp) {
+				cpu_relax();
+			}
+			break;
+		case SleepMode::Spin:
+			while (clock::now() < tp) {
+				cpu_relax();
+			}
+			break;
+		}
+	}
+}
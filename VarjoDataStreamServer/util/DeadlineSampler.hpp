@@ -0,0 +1,122 @@
+/************************************************************************************************************************
+	Deadline Sampler
+	steady_clockの絶対デッドラインで周期実行するためのスケジューラと，そのスケジューリング誤差(ジッタ)のヒストグラム．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Sampling {
+
+	enum class SleepMode {
+		Sleep,		// OSのスリープのみ．CPU負荷は最小だがタイマー精度に依存する
+		Hybrid,		// デッドライン直前まではスリープし，残りをスピン待機する
+		Spin		// 常にスピン待機する．サブミリ秒周期向け
+	};
+
+	struct SamplerOptions {
+		// 0なら待たずに回す(従来のseparate_ms = 0と同じ)
+		std::chrono::nanoseconds period{std::chrono::milliseconds(1)};
+		SleepMode mode{SleepMode::Hybrid};
+		// Hybrid時にスピン待機へ切り替える，デッドラインまでの残り時間．periodの半分を超える分は切り詰める(常にスピンしないよう)
+		std::chrono::nanoseconds spin_window{std::chrono::microseconds(200)};
+	};
+
+	struct JitterSummary {
+		uint64_t count;
+		uint64_t missed;		// 処理が間に合わず読み飛ばした周期数
+		double mean_us;
+		double max_us;
+		double p50_us;
+		double p99_us;
+		double p999_us;
+	};
+
+	/**
+	 * @brief デッドラインからの遅れ[us]のヒストグラム．記録は単一スレッド，読み出しは任意のスレッドから行える．
+	 */
+	class JitterHistogram {
+
+	public:
+		// 1us刻み(～1ms)，10us刻み(～10ms)，100us刻み(～100ms)，それ以上はオーバーフロー
+		static constexpr size_t bin_count = 1000 + 900 + 900 + 1;
+
+		void record(std::chrono::nanoseconds lateness);
+		void record_missed(uint64_t n);
+		void reset();
+
+		uint64_t count() const { return this->count_.load(std::memory_order_relaxed); }
+		uint64_t missed() const { return this->missed_.load(std::memory_order_relaxed); }
+
+		/**
+		 * @brief 遅れのパーセンタイル[us]．該当ビンの上端を返す．
+		 */
+		double percentile_us(double q) const;
+
+		JitterSummary summary() const;
+
+	private:
+		static size_t bin_index(int64_t lateness_ns);
+		static double bin_upper_us(size_t index);
+
+	private:
+		std::array<std::atomic<uint64_t>, bin_count> bins_{};
+		std::atomic<uint64_t> count_{0};
+		std::atomic<uint64_t> missed_{0};
+		std::atomic<int64_t> sum_ns_{0};
+		std::atomic<int64_t> max_ns_{0};
+	};
+
+	/**
+	 * @brief 開始時刻 + n * period の絶対デッドラインで待機する．
+	 *
+	 * 待機時間を相対値で計算しないため，処理時間やタイマーの遅れが周期に蓄積しない．
+	 * デッドラインを1周期以上過ぎた場合は，過ぎた周期を読み飛ばして次のデッドラインへ合わせる．
+	 */
+	class DeadlineSampler {
+
+	public:
+		using clock = std::chrono::steady_clock;
+
+		explicit DeadlineSampler(const SamplerOptions& opt);
+		~DeadlineSampler();
+
+		DeadlineSampler(const DeadlineSampler&) = delete;
+		DeadlineSampler& operator=(const DeadlineSampler&) = delete;
+
+		/**
+		 * @brief 最初のデッドラインを現在時刻に設定する
+		 */
+		void start();
+
+		/**
+		 * @brief 次のデッドラインまで待機し，そのデッドライン時刻を返す
+		 */
+		clock::time_point wait_next();
+
+		const JitterHistogram& histogram() const { return this->histogram_; }
+		JitterHistogram& histogram() { return this->histogram_; }
+
+		const SamplerOptions& options() const { return this->opt_; }
+
+	private:
+		// periodを検証してからoptをそのまま返す．spin_window_の計算より前に呼ぶ
+		static const SamplerOptions& validated(const SamplerOptions& opt);
+
+		void sleep_until(clock::time_point tp);
+
+	private:
+		const SamplerOptions opt_;
+		const std::chrono::nanoseconds spin_window_;		// periodの半分までに切り詰めた値
+		clock::time_point next_deadline_{};
+		JitterHistogram histogram_;
+
+		// Windowsの高分解能待機タイマー(HANDLE)
+		void* timer_handle_{nullptr};
+	};
+}
@@ -0,0 +1,439 @@
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+
+#include "Executor.hpp"
+#include "PerformanceChecker.hpp"
+
+namespace {
+	struct Metrics {
+		PerformanceChecker::Counter& cpu_tasks = PerformanceChecker::counter("executor_tasks_total{pool=\"cpu\"}");
+		PerformanceChecker::Counter& io_tasks = PerformanceChecker::counter("executor_tasks_total{pool=\"io\"}");
+		PerformanceChecker::Counter& blocking_tasks = PerformanceChecker::counter("executor_tasks_total{pool=\"blocking\"}");
+		PerformanceChecker::Counter& steals = PerformanceChecker::counter("executor_steals_total");
+		PerformanceChecker::Counter& task_errors = PerformanceChecker::counter("executor_task_errors_total");
+		PerformanceChecker::Gauge& cpu_pending = PerformanceChecker::gauge("executor_pending_tasks{pool=\"cpu\"}");
+		PerformanceChecker::Gauge& io_pending = PerformanceChecker::gauge("executor_pending_tasks{pool=\"io\"}");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+
+	/**
+	 * @brief 呼び出したスレッドがCPUプールのワーカーなら，その所属と番号
+	 */
+	thread_local const void* current_executor = nullptr;
+	thread_local size_t current_worker_index = 0;
+
+	// shared()の設定
+	std::mutex shared_mtx;
+	Execution::ExecutorOptions shared_options;
+	bool shared_started = false;
+
+	bool pop_front(std::deque<Execution::Executor::Task>& que, Execution::Executor::Task& task) {
+		if (que.empty()) {
+			return false;
+		}
+		task = std::move(que.front());
+		que.pop_front();
+		return true;
+	}
+}
+
+namespace Execution {
+
+	Executor& Executor::shared()
+	{
+		static Executor executor([] {
+			std::lock_guard lk(shared_mtx);
+			shared_started = true;
+			return shared_options;
+		}());
+		return executor;
+	}
+
+	bool Executor::configure_shared(const ExecutorOptions& opt)
+	{
+		std::lock_guard lk(shared_mtx);
+		if (shared_started) {
+			return false;
+		}
+		shared_options = opt;
+		return true;
+	}
+
+	Executor::Executor(const ExecutorOptions& opt)
+	{
+		size_t cpu_threads = opt.cpu_threads;
+		if (cpu_threads == 0) {
+			const size_t hw = std::thread::hardware_concurrency();
+			cpu_threads = hw > 1 ? hw - 1 : 1;
+		}
+		const size_t io_threads = std::max<size_t>(opt.io_threads, 1);
+
+		// ワーカーが終了時に触る計装をshared()より先に作り，後に破棄されるようにする
+		PerformanceChecker::Registry::instance();
+		metrics();
+
+		for (size_t i = 0; i < cpu_threads; ++i) {
+			this->cpu_workers_.push_back(std::make_unique<CpuWorker>());
+		}
+		for (size_t i = 0; i < cpu_threads; ++i) {
+			this->cpu_workers_[i]->thread = std::thread(&Executor::cpu_worker, this, i);
+		}
+		for (size_t i = 0; i < io_threads; ++i) {
+			this->io_threads_.emplace_back(&Executor::io_worker, this, i);
+		}
+	}
+
+	Executor::~Executor()
+	{
+		{
+			std::lock_guard lk(this->cpu_sleep_mtx_);
+			this->stop_ = true;
+		}
+		this->cpu_sleep_cv_.notify_all();
+		{
+			std::lock_guard lk(this->io_mtx_);
+		}
+		this->io_cv_.notify_all();
+
+		for (auto& w : this->cpu_workers_) {
+			if (w->thread.joinable()) {
+				w->thread.join();
+			}
+		}
+		for (auto& t : this->io_threads_) {
+			if (t.joinable()) {
+				t.join();
+			}
+		}
+	}
+
+	void Executor::post(Task task, const TaskKind kind, const TaskPriority priority)
+	{
+		const size_t p = static_cast<size_t>(priority);
+
+		if (kind == TaskKind::Blocking) {
+			throw std::invalid_argument("Executor::post: TaskKind::Blocking is only for WorkerTask");
+		}
+		if (kind == TaskKind::Io) {
+			{
+				std::lock_guard lk(this->io_mtx_);
+				this->io_ques_[p].push_back(std::move(task));
+			}
+			metrics().io_pending.add(1);
+			this->io_cv_.notify_one();
+			return;
+		}
+
+		// ワーカー自身が積んだタスクは自分のキューへ(キャッシュに載ったまま続けて処理できる)．
+		// それ以外は順に割り振る
+		size_t index;
+		if (current_executor == this) {
+			index = current_worker_index;
+		} else {
+			index = this->next_worker_.fetch_add(1, std::memory_order_relaxed) % this->cpu_workers_.size();
+		}
+
+		CpuWorker& w = *this->cpu_workers_[index];
+		{
+			std::lock_guard lk(w.mtx);
+			w.ques[p].push_back(std::move(task));
+			this->cpu_pending_.fetch_add(1);
+		}
+		metrics().cpu_pending.add(1);
+
+		// 眠りに入る途中のワーカーが増分を見落とさないよう，ロックを通してから起こす
+		{
+			std::lock_guard lk(this->cpu_sleep_mtx_);
+		}
+		this->cpu_sleep_cv_.notify_one();
+	}
+
+	bool Executor::pop_cpu_task(const size_t index, Task& task)
+	{
+		const size_t n = this->cpu_workers_.size();
+
+		for (size_t p = 0; p < priority_count; ++p) {
+			// 自分のキューは新しい方から
+			{
+				CpuWorker& own = *this->cpu_workers_[index];
+				std::lock_guard lk(own.mtx);
+				auto& que = own.ques[p];
+				if (!que.empty()) {
+					task = std::move(que.back());
+					que.pop_back();
+					this->cpu_pending_.fetch_sub(1);
+					return true;
+				}
+			}
+
+			// 他のワーカーからは古い方を盗む．取り込み中のワーカーは飛ばす
+			for (size_t k = 1; k < n; ++k) {
+				CpuWorker& victim = *this->cpu_workers_[(index + k) % n];
+				std::unique_lock lk(victim.mtx, std::try_to_lock);
+				if (!lk.owns_lock()) {
+					continue;
+				}
+				if (pop_front(victim.ques[p], task)) {
+					this->cpu_pending_.fetch_sub(1);
+					metrics().steals.inc();
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void Executor::run_task(Task& task)
+	{
+		try {
+			task();
+		}
+		catch (const std::exception& e) {
+			metrics().task_errors.inc();
+			std::cerr << "Executor: task threw: " << e.what() << std::endl;
+		}
+		catch (...) {
+			metrics().task_errors.inc();
+			std::cerr << "Executor: task threw an unknown exception" << std::endl;
+		}
+		task = nullptr;
+	}
+
+	void Executor::cpu_worker(const size_t index)
+	{
+		auto thread_reg = PerformanceChecker::register_thread("executor_cpu_" + std::to_string(index));
+		current_executor = this;
+		current_worker_index = index;
+
+		Task task;
+		while (true) {
+			if (this->pop_cpu_task(index, task)) {
+				metrics().cpu_pending.add(-1);
+				this->run_task(task);
+				metrics().cpu_tasks.inc();
+				continue;
+			}
+
+			// try_lockで飛ばしたキューに残っている場合もあるので，cpu_pending_が0になるまでは眠らない
+			std::unique_lock lk(this->cpu_sleep_mtx_);
+			if (this->cpu_pending_.load() > 0) {
+				lk.unlock();
+				std::this_thread::yield();
+				continue;
+			}
+			if (this->stop_) {
+				break;
+			}
+			this->cpu_sleep_cv_.wait(lk, [this] { return this->stop_ || this->cpu_pending_.load() > 0; });
+		}
+
+		current_executor = nullptr;
+	}
+
+	void Executor::io_worker(const size_t index)
+	{
+		auto thread_reg = PerformanceChecker::register_thread("executor_io_" + std::to_string(index));
+
+		Task task;
+		while (true) {
+			{
+				std::unique_lock lk(this->io_mtx_);
+				this->io_cv_.wait(lk, [this] {
+					return this->stop_ || std::any_of(this->io_ques_.begin(), this->io_ques_.end(), [](const auto& q) { return !q.empty(); });
+				});
+
+				bool found = false;
+				for (auto& que : this->io_ques_) {
+					if (pop_front(que, task)) {
+						found = true;
+						break;
+					}
+				}
+				if (!found) {
+					// stop_かつ空
+					break;
+				}
+			}
+
+			metrics().io_pending.add(-1);
+			this->run_task(task);
+			metrics().io_tasks.inc();
+		}
+	}
+
+	void Executor::parallel_for(const size_t n, const std::function<void(size_t)>& fn)
+	{
+		if (n == 0) {
+			return;
+		}
+		if (n == 1) {
+			fn(0);
+			return;
+		}
+
+		// 手伝うタスクが呼び出しより後に動いても壊れないよう，状態は共有で持つ
+		struct State {
+			std::atomic<size_t> next{ 0 };
+			std::atomic<size_t> done{ 0 };
+			size_t n = 0;
+			const std::function<void(size_t)>* fn = nullptr;
+			std::mutex mtx;
+			std::condition_variable done_cv;
+			std::exception_ptr error;
+		};
+		auto state = std::make_shared<State>();
+		state->n = n;
+		state->fn = &fn;
+
+		auto work = [](State& s) {
+			size_t i;
+			while ((i = s.next.fetch_add(1)) < s.n) {
+				try {
+					(*s.fn)(i);
+				}
+				catch (...) {
+					std::lock_guard lk(s.mtx);
+					if (!s.error) {
+						s.error = std::current_exception();
+					}
+				}
+				if (s.done.fetch_add(1) + 1 == s.n) {
+					std::lock_guard lk(s.mtx);
+					s.done_cv.notify_all();
+				}
+			}
+		};
+
+		const size_t helpers = std::min(n - 1, this->cpu_workers_.size());
+		for (size_t i = 0; i < helpers; ++i) {
+			// fnは全ての添字が終わるまで(呼び出し元が戻るまで)有効．それ以降に動いた手伝いは何もせずに終わる
+			this->post([state, work] { work(*state); }, TaskKind::Cpu, TaskPriority::High);
+		}
+		work(*state);
+
+		std::unique_lock lk(state->mtx);
+		state->done_cv.wait(lk, [&] { return state->done.load() == n; });
+		if (state->error) {
+			std::rethrow_exception(state->error);
+		}
+	}
+
+	WorkerTask::WorkerTask(std::function<void()> body, const TaskKind kind, const TaskPriority priority, Executor& executor)
+		: body_(std::move(body)), kind_(kind), priority_(priority), executor_(executor)
+	{
+		if (this->kind_ == TaskKind::Blocking) {
+			metrics();
+			this->thread_ = std::thread(&WorkerTask::blocking_worker, this);
+		}
+	}
+
+	WorkerTask::~WorkerTask()
+	{
+		this->wait_idle();
+		if (this->thread_.joinable()) {
+			{
+				std::lock_guard lk(this->mtx_);
+				this->stop_ = true;
+			}
+			this->scheduled_cv_.notify_all();
+			this->thread_.join();
+		}
+	}
+
+	void WorkerTask::notify()
+	{
+		std::lock_guard lk(this->mtx_);
+		switch (this->state_) {
+		case State::Idle:
+			this->state_ = State::Scheduled;
+			this->schedule();
+			break;
+		case State::Running:
+			this->state_ = State::Rerun;
+			break;
+		default:
+			// 実行待ち・再実行待ちならその実行で処理される
+			break;
+		}
+	}
+
+	void WorkerTask::wait_idle()
+	{
+		std::unique_lock lk(this->mtx_);
+		this->idle_cv_.wait(lk, [this] { return this->state_ == State::Idle; });
+	}
+
+	void WorkerTask::schedule()
+	{
+		// mtx_を持って呼ぶ
+		if (this->kind_ == TaskKind::Blocking) {
+			this->scheduled_cv_.notify_one();
+		} else {
+			this->executor_.post([this] { this->run(); }, this->kind_, this->priority_);
+		}
+	}
+
+	void WorkerTask::run()
+	{
+		{
+			std::lock_guard lk(this->mtx_);
+			this->state_ = State::Running;
+		}
+
+		std::exception_ptr error;
+		try {
+			this->body_();
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard lk(this->mtx_);
+			if (this->state_ == State::Rerun) {
+				// 同じスレッドで回し続けず積み直し，他のタスクにも順番を回す
+				this->state_ = State::Scheduled;
+				this->schedule();
+			} else {
+				this->state_ = State::Idle;
+				this->idle_cv_.notify_all();
+			}
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void WorkerTask::blocking_worker()
+	{
+		while (true) {
+			{
+				std::unique_lock lk(this->mtx_);
+				this->scheduled_cv_.wait(lk, [this] { return this->stop_ || this->state_ == State::Scheduled; });
+				if (this->state_ != State::Scheduled) {
+					break;
+				}
+			}
+
+			try {
+				this->run();
+			}
+			catch (const std::exception& e) {
+				metrics().task_errors.inc();
+				std::cerr << "WorkerTask: task threw: " << e.what() << std::endl;
+			}
+			catch (...) {
+				metrics().task_errors.inc();
+				std::cerr << "WorkerTask: task threw an unknown exception" << std::endl;
+			}
+			metrics().blocking_tasks.inc();
+		}
+	}
+}
@@ -0,0 +1,188 @@
+/************************************************************************************************************************
+	Executor
+	ロガー・ライター・プレビューアが各自でstd::threadと待機ループを持つ代わりに，共有のスレッドプールでタスクとして動かす．
+	セッション全体のスレッド数を(CPUスレッド数 + I/Oスレッド数)に抑える．
+
+	- CPUプール: ワーカーごとのキューを持ち，空いたワーカーは他のワーカーのキューから盗む(work-stealing)．
+	             パディング除去などの計算はparallel_forでコア数に応じて分割できる．
+	- I/Oプール: ファイルへの書き込みのように，短く待って戻る処理を受け持つ．CPUプールを塞がないよう分けている．
+	- 専用スレッド(TaskKind::Blocking): ffmpegへのパイプの書き込み・_pclose・ロガーのように長く塞がりうる本体は，
+	             WorkerTaskごとに専用のスレッドで動かす．エンコーダの遅れでI/Oプールが埋まり，gazeの記録まで止まるのを防ぐ．
+	- 優先度: 同じプールの中ではHigh → Normal → Lowの順に取り出す(録画 > ログ > プレビューなど)．
+
+	WorkerTaskは「キューに積んだら通知し，ワーカーがキューを空にする」というこれまでのワーカースレッドの形をそのまま
+	タスクにしたもの．同じWorkerTaskの本体が同時に2つ実行されることはないので，書き込み順は保たれる．
+
+	使い方:
+		Execution::WorkerTask task([this] { this->drain(); }, Execution::TaskKind::Io);
+		... キューに積む ...
+		task.notify();		// 実行中ならもう一度実行される
+		task.wait_idle();	// close時などに，積んだ分を処理し終えるまで待つ
+
+	時刻に合わせてサンプリングするスレッドや，SDKの呼び出しでブロックするスレッドはタスクにせず専用スレッドのままにする．
+
+	注意: プール(Cpu/Io)で動くWorkerTaskの本体は，他のタスクの終了(wait_idleなど)や長いパイプの書き込みを待ってはいけない．
+	      待つタスクがプールのスレッドを全て塞ぐと，待たれているタスクを動かすスレッドがなくなり止まる．待つ本体はBlockingにする．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace Execution {
+
+	enum class TaskPriority {
+		High = 0,
+		Normal,
+		Low,
+	};
+
+	enum class TaskKind {
+		Cpu,		// 計算(work-stealingプール)
+		Io,			// 書き込みなど短い待ちを含む処理(I/Oプール)
+		Blocking,	// 長く塞がりうる処理(WorkerTaskごとの専用スレッド)．WorkerTaskでのみ使える
+	};
+
+	struct ExecutorOptions {
+		size_t cpu_threads = 0;		// 0ならハードウェアスレッド数 - 1(最低1)
+		size_t io_threads = 4;
+	};
+
+	class Executor {
+
+	public:
+		using Task = std::function<void()>;
+
+		/**
+		 * @brief プロセスで共有するExecutor．最初の呼び出しでconfigure_sharedの設定(未指定なら既定値)で起動する
+		 */
+		static Executor& shared();
+
+		/**
+		 * @brief shared()のスレッド数を指定する．既に起動している場合は何もせずfalseを返す
+		 */
+		static bool configure_shared(const ExecutorOptions& opt);
+
+		explicit Executor(const ExecutorOptions& opt = ExecutorOptions{});
+
+		/**
+		 * @brief 積まれているタスクを全て実行してからスレッドを止める
+		 */
+		~Executor();
+
+		Executor(const Executor&) = delete;
+		Executor& operator=(const Executor&) = delete;
+
+		/**
+		 * @brief タスクを積む．タスクが投げた例外は数えて捨てる(ワーカーは止めない)
+		 * @detail kindにBlockingは指定できない(WorkerTaskを使う)
+		 */
+		void post(Task task, const TaskKind kind = TaskKind::Cpu, const TaskPriority priority = TaskPriority::Normal);
+
+		/**
+		 * @brief fn(0) … fn(n - 1)をCPUプールで並列に実行し，全て終わるまで待つ．呼び出したスレッドも処理に加わる．
+		 * @detail 最初に投げられた例外を呼び出し元で投げ直す
+		 */
+		void parallel_for(const size_t n, const std::function<void(size_t)>& fn);
+
+		// getter
+		size_t cpu_thread_count() const { return this->cpu_workers_.size(); }
+		size_t io_thread_count() const { return this->io_threads_.size(); }
+
+	private:
+		static constexpr size_t priority_count = 3;
+		using PriorityQueues = std::array<std::deque<Task>, priority_count>;
+
+		struct CpuWorker {
+			std::mutex mtx;
+			PriorityQueues ques;
+			std::thread thread;
+		};
+
+		void cpu_worker(const size_t index);
+		void io_worker(const size_t index);
+
+		bool pop_cpu_task(const size_t index, Task& task);
+		void run_task(Task& task);
+
+	private:
+		// CPUプール
+		std::vector<std::unique_ptr<CpuWorker>> cpu_workers_;
+		std::atomic<size_t> next_worker_{ 0 };
+		std::atomic<int64_t> cpu_pending_{ 0 };		// 各キューに積まれている合計．ワーカーはこれが0の間だけ眠る
+		std::mutex cpu_sleep_mtx_;
+		std::condition_variable cpu_sleep_cv_;
+
+		// I/Oプール
+		std::vector<std::thread> io_threads_;
+		PriorityQueues io_ques_;
+		std::mutex io_mtx_;
+		std::condition_variable io_cv_;
+
+		std::atomic_bool stop_{ false };
+	};
+
+	/**
+	 * @brief 通知されるたびにbodyを1回実行するタスク．bodyはその時点で積まれている分を処理して戻ること．
+	 * @detail 実行中に通知された場合は，終わった後にもう一度積み直す(通知の取りこぼしはない)．
+	 *         所有するクラスのメンバーにする場合は，bodyが触るメンバーより後に宣言する(先に破棄され，実行の終了を待つ)．
+	 *         kindがBlockingなら，構築時に専用のスレッドを起こしてそこでbodyを実行する．
+	 */
+	class WorkerTask {
+
+	public:
+		WorkerTask(std::function<void()> body,
+			const TaskKind kind = TaskKind::Io,
+			const TaskPriority priority = TaskPriority::Normal,
+			Executor& executor = Executor::shared());
+
+		~WorkerTask();
+
+		WorkerTask(const WorkerTask&) = delete;
+		WorkerTask& operator=(const WorkerTask&) = delete;
+
+		void notify();
+
+		/**
+		 * @brief 実行中・実行待ちの分が終わるまで待つ
+		 */
+		void wait_idle();
+
+	private:
+		void schedule();
+		void run();
+		void blocking_worker();
+
+		enum class State {
+			Idle,
+			Scheduled,
+			Running,
+			Rerun,		// 実行中に通知された
+		};
+
+	private:
+		const std::function<void()> body_;
+		const TaskKind kind_;
+		const TaskPriority priority_;
+		Executor& executor_;
+
+		std::mutex mtx_;
+		std::condition_variable idle_cv_;
+		State state_ = State::Idle;
+
+		// Blockingのみ
+		std::condition_variable scheduled_cv_;
+		bool stop_ = false;
+		std::thread thread_;
+	};
+}
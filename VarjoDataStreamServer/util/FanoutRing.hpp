@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stdexcept>
+
+/**
+ * @brief 購読者ごとの受け取り方
+ */
+enum class FanoutPolicy {
+	LatestOnly,	// 追いつけない場合は最新のものだけを受け取る(プレビュー向け)
+	Lossless,	// 全て受け取る．リングが一杯になると発行側を待たせる(記録向け)
+	Decimate	// decimate_hzを超えない間隔に間引いて受け取る
+};
+
+struct FanoutSubscriberOptions {
+	std::string name;
+	FanoutPolicy policy = FanoutPolicy::LatestOnly;
+	double decimate_hz = 0.0;
+};
+
+struct FanoutSubscriberStats {
+	std::string name;
+	FanoutPolicy policy;
+	uint64_t lag;			// 未読の要素数
+	uint64_t delivered;
+	uint64_t skipped;		// ポリシーにより受け取らなかった要素数
+};
+
+/**
+ * @brief 1つの発行元から複数の購読者へ要素を配る共有リング．
+ *
+ * 要素はshared_ptrで1つだけ保持し，購読者はそれぞれ自分のカーソルで読む．遅い購読者がいても
+ * 他の購読者は待たされない．発行側を待たせるのはLosslessの購読者がリングを一周遅れそうな場合だけで，
+ * LatestOnly/Decimateの購読者は読み遅れた分を読み飛ばす．
+ * subscribeはpublishを始める前に呼ぶこと．
+ */
+template<class T>
+class FanoutRing {
+
+public:
+	using Ptr = std::shared_ptr<const T>;
+	using SubscriberId = size_t;
+
+	explicit FanoutRing(size_t capacity)
+		: capacity_(capacity)
+		, slots_(capacity)
+	{
+		if (capacity == 0) {
+			throw std::invalid_argument("FanoutRing: capacity must be positive");
+		}
+	}
+
+	FanoutRing(const FanoutRing&) = delete;
+	FanoutRing& operator=(const FanoutRing&) = delete;
+
+	SubscriberId subscribe(const FanoutSubscriberOptions& opt) {
+		if (opt.policy == FanoutPolicy::Decimate && opt.decimate_hz <= 0.0) {
+			throw std::invalid_argument("FanoutRing: decimate_hz must be positive");
+		}
+
+		std::lock_guard<std::mutex> lock(this->mtx_);
+		Subscriber sub;
+		sub.opt = opt;
+		sub.cursor = this->head_;
+		if (opt.policy == FanoutPolicy::Decimate) {
+			sub.min_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / opt.decimate_hz));
+		}
+		this->subscribers_.push_back(std::move(sub));
+		return this->subscribers_.size() - 1;
+	}
+
+	/**
+	 * @brief 要素を発行する．Losslessの購読者が一周遅れになる場合は空くまで待つ．閉じた後はfalse．
+	 */
+	bool publish(Ptr item) {
+		std::unique_lock<std::mutex> lock(this->mtx_);
+		this->space_cv_.wait(lock, [this] { return this->closed_ || !this->lossless_full(); });
+		if (this->closed_) {
+			return false;
+		}
+
+		// 上書きされる要素を読んでいない非Losslessの購読者は読み飛ばす
+		if (this->head_ >= this->capacity_) {
+			const uint64_t oldest = this->head_ - this->capacity_;
+			for (auto& sub : this->subscribers_) {
+				if (sub.cursor <= oldest) {
+					sub.skipped += oldest + 1 - sub.cursor;
+					sub.cursor = oldest + 1;
+				}
+			}
+		}
+
+		auto& slot = this->slots_[this->head_ % this->capacity_];
+		slot.item = std::move(item);
+		slot.published_at = std::chrono::steady_clock::now();
+		++this->head_;
+
+		lock.unlock();
+		this->data_cv_.notify_all();
+		return true;
+	}
+
+	/**
+	 * @brief 購読者idの次の要素を待って取り出す．閉じられて読む要素がなくなった場合はfalse．
+	 */
+	bool pop(const SubscriberId id, Ptr& out) {
+		std::unique_lock<std::mutex> lock(this->mtx_);
+		auto& sub = this->subscribers_.at(id);
+
+		while (true) {
+			this->data_cv_.wait(lock, [this, &sub] { return this->closed_ || sub.cursor < this->head_; });
+			if (sub.cursor >= this->head_) {
+				return false;
+			}
+
+			if (sub.opt.policy == FanoutPolicy::LatestOnly) {
+				sub.skipped += this->head_ - 1 - sub.cursor;
+				sub.cursor = this->head_ - 1;
+			}
+
+			const auto& slot = this->slots_[sub.cursor % this->capacity_];
+			++sub.cursor;
+
+			if (sub.opt.policy == FanoutPolicy::Decimate && sub.delivered > 0
+				&& slot.published_at - sub.last_delivered_at < sub.min_interval) {
+				++sub.skipped;
+				continue;
+			}
+
+			out = slot.item;
+			sub.last_delivered_at = slot.published_at;
+			++sub.delivered;
+			break;
+		}
+
+		const bool notify_space = sub.opt.policy == FanoutPolicy::Lossless;
+		lock.unlock();
+		if (notify_space) {
+			this->space_cv_.notify_all();
+		}
+		return true;
+	}
+
+	/**
+	 * @brief 発行を終える．購読者は残っている要素を読み終えるとpopがfalseを返す．
+	 */
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(this->mtx_);
+			this->closed_ = true;
+		}
+		this->space_cv_.notify_all();
+		this->data_cv_.notify_all();
+	}
+
+	std::vector<FanoutSubscriberStats> stats() const {
+		std::lock_guard<std::mutex> lock(this->mtx_);
+		std::vector<FanoutSubscriberStats> ret;
+		ret.reserve(this->subscribers_.size());
+		for (const auto& sub : this->subscribers_) {
+			ret.push_back(FanoutSubscriberStats{
+				.name = sub.opt.name,
+				.policy = sub.opt.policy,
+				.lag = this->head_ - sub.cursor,
+				.delivered = sub.delivered,
+				.skipped = sub.skipped
+			});
+		}
+		return ret;
+	}
+
+	uint64_t published_count() const {
+		std::lock_guard<std::mutex> lock(this->mtx_);
+		return this->head_;
+	}
+
+private:
+	struct Slot {
+		Ptr item;
+		std::chrono::steady_clock::time_point published_at;
+	};
+
+	struct Subscriber {
+		FanoutSubscriberOptions opt;
+		uint64_t cursor = 0;
+		uint64_t delivered = 0;
+		uint64_t skipped = 0;
+		std::chrono::steady_clock::duration min_interval{};
+		std::chrono::steady_clock::time_point last_delivered_at{};
+	};
+
+	bool lossless_full() const {
+		for (const auto& sub : this->subscribers_) {
+			if (sub.opt.policy == FanoutPolicy::Lossless && this->head_ - sub.cursor >= this->capacity_) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	const size_t capacity_;
+	std::vector<Slot> slots_;
+	uint64_t head_ = 0;
+	bool closed_ = false;
+
+	// subscribe後に要素のアドレスが変わらないようdequeで持つ
+	std::deque<Subscriber> subscribers_;
+
+	mutable std::mutex mtx_;
+	std::condition_variable data_cv_;
+	std::condition_variable space_cv_;
+};
@@ -0,0 +1,195 @@
+/************************************************************************************************************************
+	ISubmit<T>
+	各ストリームの受け取り口(ISubmitFrame, ISubmitEyeTrackingData, ISubmitFrameInfo, ISubmitTimestamp, ...)の共通の土台．
+
+	これまでは要素ごとにsubmit_*_impl(BorrowedOrOwned<T>)を呼んでいたため，vectorやqueueで渡しても要素数だけ仮想呼び出しと
+	ラッパーの生成が起きていた．ここでは渡し方によらず「まとまり(SubmitBatch)」を1つ作り，仮想呼び出しはまとまりごとに1回にする．
+
+	実装側はsubmit_batch_implだけを書く:
+		void submit_batch_impl(SubmitBatch<T> batch) override {
+			std::lock_guard lk(this->mtx_);
+			std::move(batch).consume([&](T&& data) { this->que_.push_back(std::move(data)); });	// 所有していればmove，借りていればコピー
+		}
+	書き出すだけならview()で借りたまま読めばよい(コピーは起きない)．要素ごとの処理を使い回す場合はfor_eachを使う．
+
+	SharedPayload<T>(参照カウント付きハンドル)で渡されたものは，既定では借りたまとまりとしてsubmit_batch_implに渡る．
+	キューに積む実装はsubmit_shared_implも書いてハンドルのまま持つ(コピーせずに済む)．
+
+	各ストリームの受け取り口はこのクラスを継承し，これまでの名前(submit_frame, submit_EyeTrackingDataなど)を
+	非仮想の転送関数として残しているので，呼び出し側はそのままでよい．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <span>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <variant>
+#include <utility>
+
+#include "BorrowedOrOwned.hpp"
+#include "SharedPayload.hpp"
+
+/**
+ * @brief submitに渡された要素のまとまり．借りた連続領域か，所有した要素(1つ or vector)のいずれか．
+ * @detail 借りた場合はsubmit_batch_implから戻るまでだけ有効．キューに残すならconsume/materializeで所有する．
+ */
+template <class T>
+class SubmitBatch {
+	std::variant<std::span<const T>, T, std::vector<T>> v_;
+
+public:
+	explicit SubmitBatch(std::span<const T> borrowed)
+		: v_(borrowed)
+	{}
+
+	explicit SubmitBatch(T&& owned)
+		: v_(std::in_place_index<1>, std::move(owned))
+	{}
+
+	explicit SubmitBatch(std::vector<T>&& owned)
+		: v_(std::in_place_index<2>, std::move(owned))
+	{}
+
+	std::span<const T> view() const {
+		switch (this->v_.index()) {
+		case 0: return std::get<0>(this->v_);
+		case 1: return std::span<const T>(&std::get<1>(this->v_), 1);
+		default: return std::span<const T>(std::get<2>(this->v_));
+		}
+	}
+
+	size_t size() const { return this->view().size(); }
+	bool empty() const { return this->size() == 0; }
+	bool owns() const noexcept { return this->v_.index() != 0; }
+
+	/**
+	 * @brief 先頭から順にfn(T&&)を呼ぶ．所有していればmoveし，借りていればコピーを渡す
+	 */
+	template <class Fn>
+	void consume(Fn&& fn) && {
+		switch (this->v_.index()) {
+		case 0:
+			for (const T& data : std::get<0>(this->v_)) {
+				fn(T(data));
+			}
+			break;
+		case 1:
+			fn(std::move(std::get<1>(this->v_)));
+			break;
+		default:
+			for (T& data : std::get<2>(this->v_)) {
+				fn(std::move(data));
+			}
+			break;
+		}
+	}
+
+	/**
+	 * @brief 先頭から順にfn(BorrowedOrOwned<T>)を呼ぶ．要素ごとの処理をそのまま使う場合に(所有していればmove，借りていれば参照)
+	 */
+	template <class Fn>
+	void for_each(Fn&& fn) && {
+		if (this->owns()) {
+			std::move(*this).consume([&](T&& data) { fn(BorrowedOrOwned<T>(std::move(data))); });
+		} else {
+			for (const T& data : std::get<0>(this->v_)) {
+				fn(BorrowedOrOwned<T>(data));
+			}
+		}
+	}
+
+	std::vector<T> materialize() && {
+		if (this->v_.index() == 2) {
+			return std::move(std::get<2>(this->v_));
+		}
+		std::vector<T> out;
+		out.reserve(this->size());
+		std::move(*this).consume([&](T&& data) { out.push_back(std::move(data)); });
+		return out;
+	}
+};
+
+template <class T>
+class ISubmit {
+public:
+	virtual ~ISubmit() = default;
+
+	void submit(const T& data) {
+		this->submit_batch_impl(SubmitBatch<T>(std::span<const T>(&data, 1)));
+	}
+
+	void submit(T&& data) {
+		this->submit_batch_impl(SubmitBatch<T>(std::move(data)));
+	}
+
+	void submit(std::span<const T> data) {
+		if (!data.empty()) {
+			this->submit_batch_impl(SubmitBatch<T>(data));
+		}
+	}
+
+	void submit(const std::vector<T>& data) {
+		this->submit(std::span<const T>(data));
+	}
+
+	void submit(std::vector<T>&& data) {
+		if (!data.empty()) {
+			this->submit_batch_impl(SubmitBatch<T>(std::move(data)));
+		}
+	}
+
+	/**
+	 * @brief queue/dequeは中身を取り出して渡す(呼び出し後は空になる)
+	 */
+	void submit(std::deque<T>& data) {
+		if (data.empty()) {
+			return;
+		}
+		std::vector<T> batch(std::make_move_iterator(data.begin()), std::make_move_iterator(data.end()));
+		data.clear();
+		this->submit_batch_impl(SubmitBatch<T>(std::move(batch)));
+	}
+
+	void submit(std::deque<T>&& data) {
+		this->submit(data);
+	}
+
+	void submit(std::queue<T>& data) {
+		std::vector<T> batch;
+		batch.reserve(data.size());
+		while (!data.empty()) {
+			batch.push_back(std::move(data.front()));
+			data.pop();
+		}
+		this->submit(std::move(batch));
+	}
+
+	void submit(std::queue<T>&& data) {
+		this->submit(data);
+	}
+
+	/**
+	 * @brief ハンドルで渡す．出力先が何個あっても中身はコピーされない
+	 */
+	void submit(SharedPayload<T> data) {
+		if (data) {
+			this->submit_shared_impl(std::move(data));
+		}
+	}
+
+protected:
+	/**
+	 * @brief まとまりの処理．空のまとまりでは呼ばれない
+	 */
+	virtual void submit_batch_impl(SubmitBatch<T> batch) = 0;
+
+	/**
+	 * @brief ハンドルの処理．既定では呼び出しの間だけ借りてsubmit_batch_implに渡す．nullでは呼ばれない
+	 */
+	virtual void submit_shared_impl(SharedPayload<T> data) {
+		this->submit_batch_impl(SubmitBatch<T>(std::span<const T>(data.get(), 1)));
+	}
+};
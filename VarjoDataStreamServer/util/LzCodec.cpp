@@ -0,0 +1,172 @@
+#include <cstring>
+
+#include "LzCodec.hpp"
+
+namespace {
+
+	constexpr size_t min_match = 4;
+	constexpr size_t last_literals = 5;		// 末尾のこのバイト数は必ずリテラルにする
+	constexpr size_t match_limit = 12;		// 末尾からこのバイト数以内では一致を探さない
+	constexpr size_t max_offset = 65535;
+	constexpr int hash_bits = 14;
+
+	inline uint32_t read32(const uint8_t* p) {
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint32_t hash32(const uint32_t v) {
+		return (v * 2654435761u) >> (32 - hash_bits);
+	}
+
+	inline void write_length(std::vector<uint8_t>& dst, size_t length) {
+		while (length >= 255) {
+			dst.push_back(255);
+			length -= 255;
+		}
+		dst.push_back(static_cast<uint8_t>(length));
+	}
+
+	void emit_sequence(std::vector<uint8_t>& dst, const uint8_t* literals, const size_t literal_length, const size_t offset, const size_t match_length) {
+		const size_t ml = match_length - min_match;
+		dst.push_back(static_cast<uint8_t>(((literal_length < 15 ? literal_length : 15) << 4) | (ml < 15 ? ml : 15)));
+		if (literal_length >= 15) {
+			write_length(dst, literal_length - 15);
+		}
+		dst.insert(dst.end(), literals, literals + literal_length);
+		dst.push_back(static_cast<uint8_t>(offset & 0xFF));
+		dst.push_back(static_cast<uint8_t>(offset >> 8));
+		if (ml >= 15) {
+			write_length(dst, ml - 15);
+		}
+	}
+
+	void emit_last_literals(std::vector<uint8_t>& dst, const uint8_t* literals, const size_t literal_length) {
+		dst.push_back(static_cast<uint8_t>((literal_length < 15 ? literal_length : 15) << 4));
+		if (literal_length >= 15) {
+			write_length(dst, literal_length - 15);
+		}
+		dst.insert(dst.end(), literals, literals + literal_length);
+	}
+}
+
+namespace Lz {
+
+	void compress(const uint8_t* src, const size_t size, std::vector<uint8_t>& dst)
+	{
+		dst.clear();
+		dst.reserve(compress_bound(size));
+
+		if (size <= match_limit) {
+			emit_last_literals(dst, src, size);
+			return;
+		}
+
+		// 位置+1を保持し，0は未登録を表す
+		std::vector<uint32_t> table(size_t(1) << hash_bits, 0);
+
+		const size_t limit = size - match_limit;
+		size_t ip = 0;
+		size_t anchor = 0;
+		while (ip < limit) {
+			const uint32_t seq = read32(src + ip);
+			const uint32_t h = hash32(seq);
+			const size_t ref = table[h];
+			table[h] = static_cast<uint32_t>(ip + 1);
+
+			if (ref == 0 || ip - (ref - 1) > max_offset || read32(src + ref - 1) != seq) {
+				// 一致しない区間が長いほど探索を間引く
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			const size_t match = ref - 1;
+			size_t length = min_match;
+			while (ip + length < size - last_literals && src[match + length] == src[ip + length]) {
+				++length;
+			}
+
+			emit_sequence(dst, src + anchor, ip - anchor, ip - match, length);
+			ip += length;
+			anchor = ip;
+
+			if (ip - 2 < limit) {
+				table[hash32(read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2 + 1);
+			}
+		}
+
+		emit_last_literals(dst, src + anchor, size - anchor);
+	}
+
+	bool decompress(const uint8_t* src, const size_t size, std::vector<uint8_t>& dst, const size_t decompressed_size)
+	{
+		dst.resize(decompressed_size);
+		uint8_t* out = dst.data();
+		size_t op = 0;
+		size_t ip = 0;
+
+		auto read_length = [&](size_t& length) {
+			uint8_t b;
+			do {
+				if (ip >= size) return false;
+				b = src[ip++];
+				length += b;
+			} while (b == 255);
+			return true;
+		};
+
+		while (ip < size) {
+			const uint8_t token = src[ip++];
+
+			size_t literal_length = token >> 4;
+			if (literal_length == 15 && !read_length(literal_length)) {
+				return false;
+			}
+			if (literal_length > size - ip || literal_length > decompressed_size - op) {
+				return false;
+			}
+			if (literal_length > 0) {
+				std::memcpy(out + op, src + ip, literal_length);
+			}
+			ip += literal_length;
+			op += literal_length;
+
+			// 最後のシーケンスはリテラルのみ
+			if (ip == size) {
+				break;
+			}
+
+			if (size - ip < 2) {
+				return false;
+			}
+			const size_t offset = src[ip] | (size_t(src[ip + 1]) << 8);
+			ip += 2;
+			if (offset == 0 || offset > op) {
+				return false;
+			}
+
+			size_t match_length = token & 0x0F;
+			if (match_length == 15 && !read_length(match_length)) {
+				return false;
+			}
+			match_length += min_match;
+			if (match_length > decompressed_size - op) {
+				return false;
+			}
+
+			// 重なりのあるコピーがあるため1バイトずつ進める(重ならない場合はまとめてコピー)
+			const uint8_t* match = out + op - offset;
+			if (offset >= match_length) {
+				std::memcpy(out + op, match, match_length);
+			} else {
+				for (size_t i = 0; i < match_length; ++i) {
+					out[op + i] = match[i];
+				}
+			}
+			op += match_length;
+		}
+
+		return op == decompressed_size;
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief 外部ライブラリに依存しない高速なLZ77圧縮(LZ4のブロック形式)．
+ *
+ * 圧縮率より速度を優先し，ログのチャンク圧縮に使う．compressはdstを上書きする．
+ */
+namespace Lz {
+
+	/**
+	 * @brief 圧縮後の最大サイズ
+	 */
+	constexpr size_t compress_bound(const size_t size) {
+		return size + size / 255 + 16;
+	}
+
+	void compress(const uint8_t* src, const size_t size, std::vector<uint8_t>& dst);
+
+	/**
+	 * @brief 展開後のサイズdecompressed_sizeは呼び出し側が保持しておく．壊れたデータの場合false．
+	 */
+	bool decompress(const uint8_t* src, const size_t size, std::vector<uint8_t>& dst, const size_t decompressed_size);
+}
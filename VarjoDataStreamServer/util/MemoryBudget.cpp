@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <limits>
+
+#include "MemoryBudget.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::Gauge& used = PerformanceChecker::gauge("memory_budget_used_bytes");
+		PerformanceChecker::Gauge& limit = PerformanceChecker::gauge("memory_budget_limit_bytes");
+		PerformanceChecker::Counter& denied = PerformanceChecker::counter("memory_budget_denied_total");
+		PerformanceChecker::Counter& reclaims = PerformanceChecker::counter("memory_budget_reclaims_total");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+
+	const char* class_label(const Memory::MemoryClass cls) {
+		return cls == Memory::MemoryClass::Preview ? "preview" : "recording";
+	}
+}
+
+namespace Memory {
+
+	/****************************************************************************************************
+	* MemoryAccount
+	*****************************************************************************************************/
+
+	MemoryAccount::MemoryAccount(MemoryBudget& budget, std::string name, const MemoryClass cls)
+		: budget_(budget)
+		, name_(std::move(name))
+		, class_(cls)
+		, bytes_gauge_(PerformanceChecker::gauge("memory_budget_bytes{account=\"" + this->name_ + "\",class=\"" + class_label(cls) + "\"}"))
+	{}
+
+	MemoryAccount::~MemoryAccount()
+	{
+		const uint64_t rest = this->used_.load(std::memory_order_relaxed);
+		if (rest > 0) {
+			this->budget_.sub(*this, rest);
+		}
+	}
+
+	bool MemoryAccount::try_reserve(const uint64_t bytes)
+	{
+		return this->budget_.reserve(*this, bytes);
+	}
+
+	void MemoryAccount::charge(const uint64_t bytes)
+	{
+		this->budget_.add(*this, bytes);
+	}
+
+	void MemoryAccount::release(const uint64_t bytes)
+	{
+		this->budget_.sub(*this, bytes);
+	}
+
+	void MemoryAccount::transfer_to(MemoryAccount& to, const uint64_t bytes)
+	{
+		this->budget_.transfer(*this, to, bytes);
+	}
+
+	void MemoryAccount::set_reclaimer(std::function<void()> reclaimer)
+	{
+		std::lock_guard lk(this->budget_.mtx_);
+		this->reclaimer_ = std::move(reclaimer);
+	}
+
+	bool MemoryAccount::under_pressure() const
+	{
+		return this->budget_.under_pressure(this->class_);
+	}
+
+	/****************************************************************************************************
+	* MemoryBudget
+	*****************************************************************************************************/
+
+	MemoryBudget& MemoryBudget::shared()
+	{
+		static MemoryBudget* budget = new MemoryBudget();
+		return *budget;
+	}
+
+	void MemoryBudget::configure(const MemoryBudgetOptions& opt)
+	{
+		this->limit_.store(opt.limit_bytes, std::memory_order_relaxed);
+		this->preview_high_water_.store(std::clamp(opt.preview_high_water, 0.0, 1.0), std::memory_order_relaxed);
+		metrics().limit.set(static_cast<int64_t>(opt.limit_bytes));
+	}
+
+	std::shared_ptr<MemoryAccount> MemoryBudget::open_account(std::string name, const MemoryClass cls)
+	{
+		auto account = std::shared_ptr<MemoryAccount>(new MemoryAccount(*this, std::move(name), cls));
+
+		std::lock_guard lk(this->mtx_);
+		std::erase_if(this->accounts_, [](const std::weak_ptr<MemoryAccount>& w) { return w.expired(); });
+		this->accounts_.push_back(account);
+		return account;
+	}
+
+	bool MemoryBudget::under_pressure(const MemoryClass cls) const
+	{
+		if (this->limit() == 0) {
+			return false;
+		}
+		return this->used() >= this->capacity_of(cls);
+	}
+
+	BudgetSnapshot MemoryBudget::snapshot() const
+	{
+		BudgetSnapshot snap{ this->limit(), this->used(), {} };
+
+		// lockしたアカウントの最後の参照をここで手放すとデストラクタがsubを呼ぶため，mtx_を離してから破棄する
+		std::vector<std::shared_ptr<MemoryAccount>> alive;
+		{
+			std::lock_guard lk(this->mtx_);
+			alive.reserve(this->accounts_.size());
+			for (const auto& w : this->accounts_) {
+				if (auto account = w.lock()) {
+					alive.push_back(std::move(account));
+				}
+			}
+		}
+		snap.accounts.reserve(alive.size());
+		for (const auto& account : alive) {
+			snap.accounts.push_back(AccountSnapshot{
+				account->name(), account->memory_class(), account->used(), account->peak(), account->denied()
+			});
+		}
+		return snap;
+	}
+
+	uint64_t MemoryBudget::capacity_of(const MemoryClass cls) const
+	{
+		const uint64_t limit = this->limit();
+		if (limit == 0) {
+			return std::numeric_limits<uint64_t>::max();
+		}
+		if (cls == MemoryClass::Preview) {
+			return static_cast<uint64_t>(static_cast<double>(limit) * this->preview_high_water_.load(std::memory_order_relaxed));
+		}
+		return limit;
+	}
+
+	bool MemoryBudget::reserve(MemoryAccount& account, const uint64_t bytes)
+	{
+		if (this->try_add(account, bytes)) {
+			return true;
+		}
+
+		// 記録の確保が届かない場合は，プレビューに手放させてからもう一度だけ試す
+		if (account.memory_class() == MemoryClass::Recording && this->reclaim_preview() > 0) {
+			if (this->try_add(account, bytes)) {
+				return true;
+			}
+		}
+
+		account.denied_.fetch_add(1, std::memory_order_relaxed);
+		metrics().denied.inc();
+		return false;
+	}
+
+	size_t MemoryBudget::reclaim_preview()
+	{
+		std::vector<std::shared_ptr<MemoryAccount>> holders;
+		std::vector<std::function<void()>> reclaimers;
+		{
+			std::lock_guard lk(this->mtx_);
+			for (const auto& w : this->accounts_) {
+				auto account = w.lock();
+				if (account == nullptr) {
+					continue;
+				}
+				if (account->memory_class() == MemoryClass::Preview && account->reclaimer_ && account->used() > 0) {
+					reclaimers.push_back(account->reclaimer_);
+				}
+				holders.push_back(std::move(account));
+			}
+		}
+
+		// reclaimerはその場でバッファを手放し，release(アカウントの破棄やプールへの返却を含む)が起きるので，mtx_を持たずに呼ぶ
+		for (auto& reclaimer : reclaimers) {
+			reclaimer();
+		}
+		metrics().reclaims.inc(reclaimers.size());
+		return reclaimers.size();
+	}
+
+	bool MemoryBudget::try_add(MemoryAccount& account, const uint64_t bytes)
+	{
+		const uint64_t capacity = this->capacity_of(account.memory_class());
+		uint64_t used = this->used_.load(std::memory_order_relaxed);
+		do {
+			if (used > capacity || bytes > capacity - used) {
+				return false;
+			}
+		} while (!this->used_.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+
+		this->count(account, bytes);
+		return true;
+	}
+
+	void MemoryBudget::add(MemoryAccount& account, const uint64_t bytes)
+	{
+		this->used_.fetch_add(bytes, std::memory_order_relaxed);
+		this->count(account, bytes);
+	}
+
+	void MemoryBudget::count(MemoryAccount& account, const uint64_t bytes)
+	{
+		const uint64_t account_used = account.used_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+		uint64_t peak = account.peak_.load(std::memory_order_relaxed);
+		while (account_used > peak && !account.peak_.compare_exchange_weak(peak, account_used, std::memory_order_relaxed)) {}
+		account.bytes_gauge_.add(static_cast<int64_t>(bytes));
+		metrics().used.set(static_cast<int64_t>(this->used()));
+	}
+
+	void MemoryBudget::sub(MemoryAccount& account, const uint64_t bytes)
+	{
+		if (bytes == 0) {
+			return;
+		}
+		this->used_.fetch_sub(bytes, std::memory_order_relaxed);
+		account.used_.fetch_sub(bytes, std::memory_order_relaxed);
+		account.bytes_gauge_.add(-static_cast<int64_t>(bytes));
+		metrics().used.set(static_cast<int64_t>(this->used()));
+	}
+
+	void MemoryBudget::transfer(MemoryAccount& from, MemoryAccount& to, const uint64_t bytes)
+	{
+		if (bytes == 0 || &from == &to) {
+			return;
+		}
+		from.used_.fetch_sub(bytes, std::memory_order_relaxed);
+		from.bytes_gauge_.add(-static_cast<int64_t>(bytes));
+		this->count(to, bytes);
+	}
+}
@@ -0,0 +1,191 @@
+/************************************************************************************************************************
+	MemoryBudget
+	フレームのキュー・プール・書き込みブロックなど，バッファを持つ段が共通で使うプロセス全体のメモリ予算．
+	これまでは段ごとにbuffer_capacityやbuffer_sizeの個数で上限を決めていたが，フレームの大きさや出力先の数で
+	実際の使用量が変わり，書き込みが詰まった長時間の記録ではRAMを使い切ることがあった．
+	各段は自分のMemoryAccountからバイト数で確保し，全体でlimit_bytesを超えないようにする．
+
+	- MemoryClass: Preview(プレビュー)とRecording(記録)の2つ．使用量がlimit_bytes * preview_high_waterを超えると
+	               Previewの確保は断る．Recordingの確保が上限に届いた場合は，先にPreviewのアカウントに登録された
+	               reclaimerを呼んで手放させてから確保し直す．プレビューは記録より先に削られる．
+	- try_reserve: 予算内なら確保してtrue．断った場合はfalseを返すので，呼び出し側でフレームを捨てる．
+	- charge: 断れない確保(書き込み途中のブロックなど)．予算を超えても記録するが，その分だけ他の確保が断られる．
+	- release: try_reserve/chargeした分を返す．アカウントを破棄すると残りは全て返る．
+	- transfer_to: 計上を別のアカウントへ付け替える(全体の使用量は変わらない)．記録側のプールのフレームをプレビューが
+	               持っている間だけPreviewに付け替え，reclaimerで手放すと予算が空くようにする．
+	- 計装: memory_budget_used_bytes / memory_budget_limit_bytes / memory_budget_bytes{account=...,class=...}，
+	        断った回数はmemory_budget_denied_total，reclaimerを呼んだ回数はmemory_budget_reclaims_total．
+	        snapshot()でアカウントごとの使用量・最大値・断った回数を取れる．
+
+	limit_bytes = 0(既定)では上限を設けず，計上だけ行う．
+
+	使い方:
+		auto account = Memory::MemoryBudget::shared().open_account("vst_frames", Memory::MemoryClass::Recording);
+		if (account->try_reserve(bytes)) { ... account->release(bytes); }
+		else { ... 捨てる ... }
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include "PerformanceChecker.hpp"
+
+namespace Memory {
+
+	enum class MemoryClass {
+		Preview,		// 削ってよい．Recordingより先に断る
+		Recording		// 記録に必要．上限に届いたらPreviewを手放させてから確保する
+	};
+
+	struct MemoryBudgetOptions {
+		uint64_t limit_bytes = 0;				// 0なら上限なし(計上のみ)
+		double preview_high_water = 0.75;		// 使用量がlimit_bytesのこの割合を超えたらPreviewの確保を断る
+	};
+
+	struct AccountSnapshot {
+		std::string name;
+		MemoryClass memory_class;
+		uint64_t used_bytes;
+		uint64_t peak_bytes;
+		uint64_t denied;
+	};
+
+	struct BudgetSnapshot {
+		uint64_t limit_bytes;
+		uint64_t used_bytes;
+		std::vector<AccountSnapshot> accounts;
+	};
+
+	class MemoryBudget;
+
+	/****************************************************************************************************
+	* @class MemoryAccount
+	* @brief 1つの段が予算から確保する窓口．MemoryBudget::open_accountで作る
+	*****************************************************************************************************/
+
+	class MemoryAccount {
+
+	public:
+		~MemoryAccount();
+
+		MemoryAccount(const MemoryAccount&) = delete;
+		MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+		/**
+		 * @brief 予算内なら確保してtrue．超える場合はfalse(何も確保しない)
+		 */
+		bool try_reserve(const uint64_t bytes);
+
+		/**
+		 * @brief 予算に関わらず確保したものとして計上する
+		 */
+		void charge(const uint64_t bytes);
+
+		void release(const uint64_t bytes);
+
+		/**
+		 * @brief bytes分の計上をtoへ付け替える．付け替えた側が持っている間だけ使い，手放すときにtransfer_toで戻す
+		 */
+		void transfer_to(MemoryAccount& to, const uint64_t bytes);
+
+		/**
+		 * @brief Recordingの確保が上限に届いたときに呼ばれる．Previewのアカウントで，持っているバッファを手放す処理を登録する
+		 * @detail 確保しようとしたスレッドから，MemoryBudgetのロックを持たずに呼ばれる．戻った直後に確保し直すので，
+		 *         その場で手放す(releaseする・持っているハンドルを捨てる)こと．次の確保まで遅らせると何も空かない．
+		 *         登録したアカウントより長く生きうるので，reclaimerが触る状態は共有で持つ．
+		 */
+		void set_reclaimer(std::function<void()> reclaimer);
+
+		/**
+		 * @brief このアカウントのクラスの確保が断られる水準まで予算を使っているか
+		 */
+		bool under_pressure() const;
+
+		// getter
+		const std::string& name() const { return this->name_; }
+		MemoryClass memory_class() const { return this->class_; }
+		uint64_t used() const { return this->used_.load(std::memory_order_relaxed); }
+		uint64_t peak() const { return this->peak_.load(std::memory_order_relaxed); }
+		uint64_t denied() const { return this->denied_.load(std::memory_order_relaxed); }
+
+	private:
+		friend class MemoryBudget;
+
+		MemoryAccount(MemoryBudget& budget, std::string name, const MemoryClass cls);
+
+	private:
+		MemoryBudget& budget_;
+		const std::string name_;
+		const MemoryClass class_;
+		PerformanceChecker::Gauge& bytes_gauge_;
+
+		std::atomic<uint64_t> used_{ 0 };
+		std::atomic<uint64_t> peak_{ 0 };
+		std::atomic<uint64_t> denied_{ 0 };
+		std::function<void()> reclaimer_;		// budget_のmtx_で保護
+	};
+
+	/****************************************************************************************************
+	* @class MemoryBudget
+	*****************************************************************************************************/
+
+	class MemoryBudget {
+
+	public:
+		/**
+		 * @brief プロセス全体で1つの予算．終了時まで破棄しない(静的なアカウントが後から返しに来るため)
+		 */
+		static MemoryBudget& shared();
+
+		MemoryBudget() = default;
+
+		MemoryBudget(const MemoryBudget&) = delete;
+		MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+		/**
+		 * @brief 上限を設定する．既に確保されている分はそのまま残る
+		 */
+		void configure(const MemoryBudgetOptions& opt);
+
+		std::shared_ptr<MemoryAccount> open_account(std::string name, const MemoryClass cls);
+
+		/**
+		 * @brief そのクラスの確保が断られる水準まで使っているか．Previewはキューに積む前にこれを見て間引く
+		 */
+		bool under_pressure(const MemoryClass cls) const;
+
+		BudgetSnapshot snapshot() const;
+
+		// getter
+		uint64_t used() const { return this->used_.load(std::memory_order_relaxed); }
+		uint64_t limit() const { return this->limit_.load(std::memory_order_relaxed); }
+
+	private:
+		friend class MemoryAccount;
+
+		bool reserve(MemoryAccount& account, const uint64_t bytes);
+		bool try_add(MemoryAccount& account, const uint64_t bytes);
+		void add(MemoryAccount& account, const uint64_t bytes);
+		void sub(MemoryAccount& account, const uint64_t bytes);
+		void transfer(MemoryAccount& from, MemoryAccount& to, const uint64_t bytes);
+		void count(MemoryAccount& account, const uint64_t bytes);		// アカウント側の計上と計装
+		size_t reclaim_preview();
+
+		uint64_t capacity_of(const MemoryClass cls) const;
+
+	private:
+		mutable std::mutex mtx_;		// accounts_とreclaimer_を保護する．確保・返却はused_へのatomic操作のみ
+		std::vector<std::weak_ptr<MemoryAccount>> accounts_;
+		std::atomic<uint64_t> used_{ 0 };
+		std::atomic<uint64_t> limit_{ 0 };
+		std::atomic<double> preview_high_water_{ 0.75 };
+	};
+}
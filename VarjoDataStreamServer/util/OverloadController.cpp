@@ -0,0 +1,206 @@
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+
+#include "OverloadController.hpp"
+#include "PerformanceChecker.hpp"
+#include "TraceRecorder.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::Gauge& level = PerformanceChecker::gauge("overload_level");
+		PerformanceChecker::Counter& decisions = PerformanceChecker::counter("overload_decisions_total");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+
+	int64_t now_ns() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+namespace Overload {
+
+	LoadProbe gauge_probe(const std::string& gauge_name, const double threshold)
+	{
+		auto& gauge = PerformanceChecker::gauge(gauge_name);
+		return [&gauge, threshold] {
+			return threshold > 0.0 ? static_cast<double>(gauge.value()) / threshold : 0.0;
+		};
+	}
+
+	LoadProbe latency_probe(const std::string& histogram_name, const double threshold_ms)
+	{
+		auto& histogram = PerformanceChecker::histogram(histogram_name);
+		// 前回の累積との差を取り，その周期に記録された分だけのp99を見る
+		auto last = std::make_shared<PerformanceChecker::HistogramSnapshot>(histogram.snapshot());
+		return [&histogram, threshold_ms, last] {
+			PerformanceChecker::HistogramSnapshot current = histogram.snapshot();
+			PerformanceChecker::HistogramSnapshot window;
+			window.buckets.resize(current.buckets.size());
+			for (size_t i = 0; i < current.buckets.size(); ++i) {
+				const uint64_t before = i < last->buckets.size() ? last->buckets[i] : 0;
+				window.buckets[i] = current.buckets[i] - std::min(before, current.buckets[i]);
+			}
+			window.count = current.count - std::min(last->count, current.count);
+			window.max_ns = current.max_ns;
+			*last = std::move(current);
+
+			if (threshold_ms <= 0.0 || window.count == 0) {
+				return 0.0;
+			}
+			return window.percentile_ns(0.99) / 1e6 / threshold_ms;
+		};
+	}
+
+	OverloadController::OverloadController(const OverloadOptions& opt)
+		: opt_(opt)
+	{}
+
+	OverloadController::~OverloadController()
+	{
+		this->stop();
+	}
+
+	void OverloadController::add_signal(std::string name, LoadProbe probe)
+	{
+		this->signals_.push_back(Signal{ std::move(name), std::move(probe) });
+	}
+
+	void OverloadController::add_action(std::string name, std::function<void(bool)> apply)
+	{
+		this->actions_.push_back(Action{ std::move(name), std::move(apply) });
+	}
+
+	void OverloadController::start()
+	{
+		if (this->thread_.joinable()) {
+			return;
+		}
+		if (!this->opt_.log_path.empty()) {
+			this->log_.open(this->opt_.log_path, std::ios::out | std::ios::trunc);
+			this->log_ << "time_ns,decision,level,action,signal,load\n";
+			this->log_.flush();
+		}
+
+		this->over_count_ = 0;
+		this->under_count_ = 0;
+		{
+			std::lock_guard lk(this->mtx_);
+			this->stop_ = false;
+		}
+		this->thread_ = std::thread(&OverloadController::worker, this);
+	}
+
+	void OverloadController::stop()
+	{
+		{
+			std::lock_guard lk(this->mtx_);
+			this->stop_ = true;
+		}
+		this->cv_.notify_all();
+		if (!this->thread_.joinable()) {
+			return;
+		}
+		this->thread_.join();
+
+		// 止めた後に削ったままにしない
+		while (this->level() > 0) {
+			this->decide(false, "stop", 0.0);
+		}
+		if (this->log_.is_open()) {
+			this->log_.close();
+		}
+	}
+
+	size_t OverloadController::level() const
+	{
+		std::lock_guard lk(this->mtx_);
+		return this->level_;
+	}
+
+	std::vector<ShedDecision> OverloadController::decisions() const
+	{
+		std::lock_guard lk(this->mtx_);
+		return this->decisions_;
+	}
+
+	void OverloadController::worker()
+	{
+		auto thread_reg = PerformanceChecker::register_thread("overload_controller");
+		const auto period = std::chrono::milliseconds(std::max(this->opt_.period_ms, 1));
+
+		std::unique_lock lk(this->mtx_);
+		while (!this->cv_.wait_for(lk, period, [this] { return this->stop_; })) {
+			lk.unlock();
+			this->tick();
+			lk.lock();
+		}
+	}
+
+	void OverloadController::tick()
+	{
+		// 最も負荷の高いsignalで判定する
+		double load = 0.0;
+		const std::string* worst = nullptr;
+		for (const auto& signal : this->signals_) {
+			const double v = signal.probe();
+			if (worst == nullptr || v > load) {
+				load = v;
+				worst = &signal.name;
+			}
+		}
+		if (worst == nullptr) {
+			return;
+		}
+
+		if (load >= 1.0) {
+			this->under_count_ = 0;
+			if (++this->over_count_ >= this->opt_.engage_after && this->level() < this->actions_.size()) {
+				this->decide(true, *worst, load);
+				this->over_count_ = 0;
+			}
+		} else if (load < this->opt_.release_below) {
+			this->over_count_ = 0;
+			if (++this->under_count_ >= this->opt_.release_after && this->level() > 0) {
+				this->decide(false, *worst, load);
+				this->under_count_ = 0;
+			}
+		} else {
+			// 閾値の間では現状を保つ
+			this->over_count_ = 0;
+			this->under_count_ = 0;
+		}
+	}
+
+	void OverloadController::decide(const bool engage, const std::string& signal, const double load)
+	{
+		size_t level = this->level();
+		const Action& action = this->actions_[engage ? level : level - 1];
+		action.apply(engage);
+		level = engage ? level + 1 : level - 1;
+
+		const ShedDecision decision{ now_ns(), engage, level, action.name, signal, load };
+		{
+			std::lock_guard lk(this->mtx_);
+			this->level_ = level;
+			this->decisions_.push_back(decision);
+		}
+		metrics().level.set(static_cast<int64_t>(level));
+		metrics().decisions.inc();
+		Profiling::trace_instant(engage ? "overload.engage" : "overload.release", static_cast<int64_t>(level));
+
+		std::cerr << "Overload: " << (engage ? "shed " : "restore ") << action.name
+			<< " (level " << level << "/" << this->actions_.size() << ", " << signal << "=" << load << ")" << std::endl;
+		if (this->log_.is_open()) {
+			this->log_ << decision.time_ns << "," << (engage ? "engage" : "release") << "," << level << ","
+				<< action.name << "," << signal << "," << load << "\n";
+			this->log_.flush();
+		}
+	}
+}
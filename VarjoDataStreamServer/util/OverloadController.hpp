@@ -0,0 +1,133 @@
+/************************************************************************************************************************
+	OverloadController
+	CPUやディスクが飽和したときに，価値の低い処理から順に削って記録(gaze・VSTの動画)を守るための制御．
+	これまでは飽和すると全ての段が一緒に遅れ，プレビューと一緒にgazeのサンプルや記録するフレームも失っていた．
+
+	- signal: 負荷の指標．1.0でちょうど閾値．キューの深さ(gauge)や段の遅延(histogramの周期ごとのp99)から作る．
+	- action: 削る処理．登録した順に1段ずつ効かせ(engage)，戻すときは逆順に外す(release)．
+	          例: プレビューを止める → メタデータを間引く → エンコーダのpresetを下げる → 記録するフレームを間引く
+	- 判定: period_msごとに全てのsignalの最大値を見る．engage_after回続けて1.0以上なら次の段を効かせ，
+	        release_after回続けてrelease_below未満なら最後に効かせた段を外す．
+	- 記録: 判断は全て標準エラー・log_path(CSV)・TraceRecorder("overload.engage"/"overload.release")に残し，
+	        decisions()でも取り出せる．overload_level(gauge)とoverload_decisions_total(counter)も更新する．
+
+	飽和している間もI/Oプールの空きを待たずに判定するため，専用のスレッドで動く．
+
+	使い方:
+		Overload::OverloadController controller(opt);
+		controller.add_signal("gaze_queue", Overload::gauge_probe("gaze_logger_queue", 1000));
+		controller.add_action("preview", [&](bool engage) { logger.set_subscriber_decimation("video_previewer", engage ? 0 : 1); });
+		controller.start();
+		...
+		controller.stop();		// 効かせている段は全て外す
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Overload {
+
+	struct OverloadOptions {
+		int period_ms = 100;
+		int engage_after = 3;			// 続けて過負荷と判定された回数がこれに達したら1段削る
+		int release_after = 30;			// 続けて余裕があると判定された回数がこれに達したら1段戻す
+		double release_below = 0.5;		// 全てのsignalがこれ未満なら余裕がある
+		std::string log_path;			// 判断を追記するCSV．空なら書かない
+	};
+
+	/**
+	 * @brief 負荷の指標を返す．1.0以上で過負荷
+	 */
+	using LoadProbe = std::function<double()>;
+
+	/**
+	 * @brief gaugeの値 / threshold
+	 */
+	LoadProbe gauge_probe(const std::string& gauge_name, const double threshold);
+
+	/**
+	 * @brief 前回呼ばれてから記録された分のp99 / threshold_ms．記録がなければ0
+	 */
+	LoadProbe latency_probe(const std::string& histogram_name, const double threshold_ms);
+
+	struct ShedDecision {
+		int64_t time_ns;		// steady_clock
+		bool engaged;			// trueなら削った，falseなら戻した
+		size_t level;			// 判断の後に効いている段の数
+		std::string action;
+		std::string signal;		// 判断の時点で最も負荷の高かったsignal
+		double load;
+	};
+
+	class OverloadController {
+
+	public:
+		explicit OverloadController(const OverloadOptions& opt = OverloadOptions{});
+
+		~OverloadController();
+
+		OverloadController(const OverloadController&) = delete;
+		OverloadController& operator=(const OverloadController&) = delete;
+
+		/**
+		 * @brief startの前に呼ぶ
+		 */
+		void add_signal(std::string name, LoadProbe probe);
+
+		/**
+		 * @brief 削る順に登録する．applyはengage(true)/release(false)で制御スレッドから呼ばれる．startの前に呼ぶ
+		 */
+		void add_action(std::string name, std::function<void(bool)> apply);
+
+		void start();
+
+		/**
+		 * @brief 制御を止め，効かせている段を逆順に全て外す
+		 */
+		void stop();
+
+		size_t level() const;
+		std::vector<ShedDecision> decisions() const;
+
+	private:
+		struct Signal {
+			std::string name;
+			LoadProbe probe;
+		};
+
+		struct Action {
+			std::string name;
+			std::function<void(bool)> apply;
+		};
+
+		void worker();
+		void tick();
+		void decide(const bool engage, const std::string& signal, const double load);
+
+	private:
+		const OverloadOptions opt_;
+		std::vector<Signal> signals_;
+		std::vector<Action> actions_;
+
+		// 制御スレッドのみが触る
+		int over_count_ = 0;
+		int under_count_ = 0;
+		std::ofstream log_;
+
+		mutable std::mutex mtx_;
+		std::condition_variable cv_;
+		bool stop_ = true;
+		size_t level_ = 0;
+		std::vector<ShedDecision> decisions_;
+		std::thread thread_;
+	};
+}
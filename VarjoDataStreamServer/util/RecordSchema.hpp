@@ -0,0 +1,724 @@
+/************************************************************************************************************************
+	Record Schema
+	記録する構造体の列を1か所(フィールド記述子のconstexprなタプル)に書き，そこから
+		・CSVのヘッダ
+		・CSVの1行の書き出し(to_chars．確保なし・列ごとの分岐なし．最大長はコンパイル時に決まる)
+		・CSVの1行の読み込み(from_chars)
+		・固定長のバイナリレコードの書き出し・読み込み
+	を全てテンプレートで生成する．ヘッダと書き出し処理を別々に手で保守してずれることがなくなる．
+
+		inline constexpr auto ray_fields = RecordSchema::fields(
+			RecordSchema::columns<3>("Origin", [](auto& r) -> auto& { return r.origin; }, xyz),	// OriginX, OriginY, OriginZ
+			RecordSchema::columns<3>("Forward", [](auto& r) -> auto& { return r.forward; }, xyz)
+		);
+		inline constexpr auto gaze_fields = RecordSchema::fields(
+			RecordSchema::nested("leftEye", [](auto& g) -> auto& { return g.leftEye; }, ray_fields),	// leftEyeOriginX, ...
+			RecordSchema::column("focusDistance", [](auto& g) -> auto& { return g.focusDistance; })
+		);
+		using GazeRecord = RecordSchema::Record<varjo_Gaze, gaze_fields>;
+
+	取り出し関数は(auto& r) -> auto&の形で書く．constなレコードからは書き出し，非constなレコードへは読み込みに使う．
+	列の値の変換はValueCodec(整数・浮動小数点数・optional)を型から選ぶ．名前付きの値(NamedCodec)や日時のように
+	変換を変えたい列はcolumn<Codec>(...)で指定する．Codecのbinary_sizeが0の列は他の列から導出される表示用の列で，
+	バイナリには含めず，読み込みでは読み飛ばす．
+
+	バイナリ形式
+		FileHeader : magic "VRSB"(4) | version u16 | reserved u16 | column_count u32 | record_size u32 | fingerprint u64
+		Record     : 各列の値をスキーマの順に固定長で並べたもの(record_sizeバイト)．数値はリトルエンディアン．
+	fingerprintはヘッダ行とレコード長から求める．読み込み側のスキーマと一致しないファイルは開かない．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <fstream>
+#include <filesystem>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <bit>
+
+namespace RecordSchema {
+
+	static_assert(std::endian::native == std::endian::little, "RecordSchema binary format assumes a little-endian host");
+
+	/**
+	 * @brief 記録ファイルの形式
+	 */
+	enum class RecordFormat {
+		Csv, Binary
+	};
+
+	/****************************************************************************************************
+	* 列の値の変換
+	*****************************************************************************************************/
+
+	namespace detail {
+		template<class V>
+		bool parse_number(std::string_view s, V& v) {
+			const auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+			return ec == std::errc() && ptr == s.data() + s.size();
+		}
+	}
+
+	template<class V>
+	struct ValueCodec;
+
+	template<class V> requires std::is_integral_v<V>
+	struct ValueCodec<V> {
+		static constexpr size_t max_text = std::numeric_limits<V>::digits10 + 3;	// 桁数 + 符号
+		static constexpr size_t binary_size = sizeof(V);
+
+		static char* to_text(const V v, char* p) { return std::to_chars(p, p + max_text, v).ptr; }
+		static bool from_text(std::string_view s, V& v) { return detail::parse_number(s, v); }
+		static char* to_binary(const V v, char* p) { std::memcpy(p, &v, sizeof(V)); return p + sizeof(V); }
+		static const char* from_binary(const char* p, V& v) { std::memcpy(&v, p, sizeof(V)); return p + sizeof(V); }
+	};
+
+	/**
+	 * @brief 浮動小数点数は読み戻して同じ値になる最短の表記で書く
+	 */
+	template<class V> requires std::is_floating_point_v<V>
+	struct ValueCodec<V> {
+		static constexpr size_t max_text = std::numeric_limits<V>::max_digits10 + 8;	// 仮数 + 符号・小数点・指数部
+		static constexpr size_t binary_size = sizeof(V);
+
+		static char* to_text(const V v, char* p) { return std::to_chars(p, p + max_text, v).ptr; }
+		static bool from_text(std::string_view s, V& v) { return detail::parse_number(s, v); }
+		static char* to_binary(const V v, char* p) { std::memcpy(p, &v, sizeof(V)); return p + sizeof(V); }
+		static const char* from_binary(const char* p, V& v) { std::memcpy(&v, p, sizeof(V)); return p + sizeof(V); }
+	};
+
+	/**
+	 * @brief 値がない場合はCSVでは"null"，バイナリでは有無フラグ(u8) + 値
+	 */
+	template<class V>
+	struct ValueCodec<std::optional<V>> {
+		using Inner = ValueCodec<V>;
+		static constexpr std::string_view null_text = "null";
+		static constexpr size_t max_text = std::max(Inner::max_text, null_text.size());
+		static constexpr size_t binary_size = 1 + Inner::binary_size;
+
+		static char* to_text(const std::optional<V>& v, char* p) {
+			if (!v.has_value()) {
+				std::memcpy(p, null_text.data(), null_text.size());
+				return p + null_text.size();
+			}
+			return Inner::to_text(*v, p);
+		}
+
+		static bool from_text(std::string_view s, std::optional<V>& v) {
+			if (s == null_text) {
+				v.reset();
+				return true;
+			}
+			V value{};
+			if (!Inner::from_text(s, value)) {
+				return false;
+			}
+			v = value;
+			return true;
+		}
+
+		static char* to_binary(const std::optional<V>& v, char* p) {
+			*p++ = v.has_value() ? 1 : 0;
+			return Inner::to_binary(v.value_or(V{}), p);
+		}
+
+		static const char* from_binary(const char* p, std::optional<V>& v) {
+			const bool has_value = *p++ != 0;
+			V value{};
+			p = Inner::from_binary(p, value);
+			v = has_value ? std::optional<V>(value) : std::nullopt;
+			return p;
+		}
+	};
+
+	template<class V, size_t K>
+	using NameTable = std::array<std::pair<V, std::string_view>, K>;
+
+	/**
+	 * @brief CSVでは表の名前で書く整数(状態値など)．表にない値は数値のまま書く．バイナリでは数値
+	 */
+	template<class V, const auto& Names>
+	struct NamedCodec {
+		using Inner = ValueCodec<V>;
+		static constexpr size_t max_text = [] {
+			size_t m = Inner::max_text;
+			for (const auto& [value, name] : Names) {
+				m = std::max(m, name.size());
+			}
+			return m;
+		}();
+		static constexpr size_t binary_size = Inner::binary_size;
+
+		static char* to_text(const V v, char* p) {
+			for (const auto& [value, name] : Names) {
+				if (value == v) {
+					std::memcpy(p, name.data(), name.size());
+					return p + name.size();
+				}
+			}
+			return Inner::to_text(v, p);
+		}
+
+		static bool from_text(std::string_view s, V& v) {
+			for (const auto& [value, name] : Names) {
+				if (name == s) {
+					v = value;
+					return true;
+				}
+			}
+			return Inner::from_text(s, v);
+		}
+
+		static char* to_binary(const V v, char* p) { return Inner::to_binary(v, p); }
+		static const char* from_binary(const char* p, V& v) { return Inner::from_binary(p, v); }
+	};
+
+	/****************************************************************************************************
+	* フィールド記述子
+	*****************************************************************************************************/
+
+	/**
+	 * @brief 列の型からValueCodecを選ぶ印
+	 */
+	struct AutoCodec {};
+
+	/**
+	 * @brief CSVの1行を','で区切って先頭から順に取り出す
+	 */
+	class CellReader {
+
+	public:
+		explicit CellReader(std::string_view line)
+			: rest_(line)
+		{}
+
+		bool next(std::string_view& cell) {
+			if (this->exhausted_) {
+				return false;
+			}
+			const size_t pos = this->rest_.find(',');
+			if (pos == std::string_view::npos) {
+				cell = this->rest_;
+				this->exhausted_ = true;
+			} else {
+				cell = this->rest_.substr(0, pos);
+				this->rest_.remove_prefix(pos + 1);
+			}
+			return true;
+		}
+
+		bool at_end() const { return this->exhausted_; }
+
+	private:
+		std::string_view rest_;
+		bool exhausted_ = false;
+	};
+
+	namespace detail {
+		template<class Codec, class V>
+		using resolve_codec_t = std::conditional_t<std::is_same_v<Codec, AutoCodec>, ValueCodec<std::remove_cvref_t<V>>, Codec>;
+
+		template<class Get, class Rec>
+		using member_t = std::remove_cvref_t<std::invoke_result_t<const Get&, const Rec&>>;
+
+		template<class Get, class Rec>
+		using element_t = std::remove_cvref_t<decltype(std::declval<const member_t<Get, Rec>&>()[0])>;
+
+		inline void append_index(std::string& out, const size_t i) {
+			char buf[24];
+			out.append(buf, std::to_chars(buf, buf + sizeof(buf), i).ptr);
+		}
+
+		template<class Fields>
+		struct FieldsColumnCount;
+
+		template<class... F>
+		struct FieldsColumnCount<std::tuple<F...>> {
+			static constexpr size_t value = (F::column_count + ... + 0);
+		};
+
+		template<class Rec, class Fields>
+		struct FieldsTraits;
+
+		template<class Rec, class... F>
+		struct FieldsTraits<Rec, std::tuple<F...>> {
+			static constexpr size_t column_count = FieldsColumnCount<std::tuple<F...>>::value;
+			static constexpr size_t max_text = (F::template max_text<Rec>() + ... + 0);
+			static constexpr size_t binary_size = (F::template binary_size<Rec>() + ... + 0);
+		};
+
+		template<class Fields>
+		void append_header(const Fields& fields, std::string& out, std::string_view prefix) {
+			std::apply([&](const auto&... f) { (f.append_header(out, prefix), ...); }, fields);
+		}
+
+		template<class Rec, class Fields>
+		char* to_text(const Fields& fields, const Rec& r, char* p) {
+			std::apply([&](const auto&... f) { ((p = f.to_text(r, p)), ...); }, fields);
+			return p;
+		}
+
+		template<class Rec, class Fields>
+		bool from_text(const Fields& fields, Rec& r, CellReader& cells) {
+			return std::apply([&](const auto&... f) { return (f.from_text(r, cells) && ...); }, fields);
+		}
+
+		template<class Rec, class Fields>
+		char* to_binary(const Fields& fields, const Rec& r, char* p) {
+			std::apply([&](const auto&... f) { ((p = f.to_binary(r, p)), ...); }, fields);
+			return p;
+		}
+
+		template<class Rec, class Fields>
+		const char* from_binary(const Fields& fields, Rec& r, const char* p) {
+			std::apply([&](const auto&... f) { ((p = f.from_binary(r, p)), ...); }, fields);
+			return p;
+		}
+	}
+
+	/**
+	 * @brief 1列
+	 */
+	template<class Codec, class Get>
+	struct Column {
+		std::string_view name;
+		Get get;
+
+		template<class Rec>
+		using codec_t = detail::resolve_codec_t<Codec, detail::member_t<Get, Rec>>;
+
+		static constexpr size_t column_count = 1;
+		template<class Rec> static constexpr size_t max_text() { return codec_t<Rec>::max_text + 1; }
+		template<class Rec> static constexpr size_t binary_size() { return codec_t<Rec>::binary_size; }
+
+		void append_header(std::string& out, std::string_view prefix) const {
+			out.append(prefix).append(this->name).push_back(',');
+		}
+
+		template<class Rec>
+		char* to_text(const Rec& r, char* p) const {
+			p = codec_t<Rec>::to_text(this->get(r), p);
+			*p++ = ',';
+			return p;
+		}
+
+		template<class Rec>
+		bool from_text(Rec& r, CellReader& cells) const {
+			std::string_view cell;
+			return cells.next(cell) && codec_t<Rec>::from_text(cell, this->get(r));
+		}
+
+		template<class Rec>
+		char* to_binary(const Rec& r, char* p) const {
+			return codec_t<Rec>::to_binary(this->get(r), p);
+		}
+
+		template<class Rec>
+		const char* from_binary(Rec& r, const char* p) const {
+			return codec_t<Rec>::from_binary(p, this->get(r));
+		}
+	};
+
+	/**
+	 * @brief 要素数Nの配列を N列に展開する．列名はname + suffixes[i]，suffixesを省略した場合はname[i]
+	 */
+	template<size_t N, class Codec, class Get>
+	struct Columns {
+		std::string_view name;
+		Get get;
+		std::array<std::string_view, N> suffixes{};
+
+		template<class Rec>
+		using codec_t = detail::resolve_codec_t<Codec, detail::element_t<Get, Rec>>;
+
+		static constexpr size_t column_count = N;
+		template<class Rec> static constexpr size_t max_text() { return N * (codec_t<Rec>::max_text + 1); }
+		template<class Rec> static constexpr size_t binary_size() { return N * codec_t<Rec>::binary_size; }
+
+		void append_header(std::string& out, std::string_view prefix) const {
+			for (size_t i = 0; i < N; ++i) {
+				out.append(prefix).append(this->name);
+				if (this->suffixes[i].empty()) {
+					out.push_back('[');
+					detail::append_index(out, i);
+					out.push_back(']');
+				} else {
+					out.append(this->suffixes[i]);
+				}
+				out.push_back(',');
+			}
+		}
+
+		template<class Rec>
+		char* to_text(const Rec& r, char* p) const {
+			const auto& values = this->get(r);
+			for (size_t i = 0; i < N; ++i) {
+				p = codec_t<Rec>::to_text(values[i], p);
+				*p++ = ',';
+			}
+			return p;
+		}
+
+		template<class Rec>
+		bool from_text(Rec& r, CellReader& cells) const {
+			auto& values = this->get(r);
+			std::string_view cell;
+			for (size_t i = 0; i < N; ++i) {
+				if (!cells.next(cell) || !codec_t<Rec>::from_text(cell, values[i])) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template<class Rec>
+		char* to_binary(const Rec& r, char* p) const {
+			const auto& values = this->get(r);
+			for (size_t i = 0; i < N; ++i) {
+				p = codec_t<Rec>::to_binary(values[i], p);
+			}
+			return p;
+		}
+
+		template<class Rec>
+		const char* from_binary(Rec& r, const char* p) const {
+			auto& values = this->get(r);
+			for (size_t i = 0; i < N; ++i) {
+				p = codec_t<Rec>::from_binary(p, values[i]);
+			}
+			return p;
+		}
+	};
+
+	/**
+	 * @brief 入れ子の構造体．列名はprefix + 入れ子側の列名
+	 */
+	template<class Fields, class Get>
+	struct Nested {
+		std::string_view prefix;
+		Get get;
+		Fields fields;
+
+		template<class Rec>
+		using traits = detail::FieldsTraits<detail::member_t<Get, Rec>, Fields>;
+
+		static constexpr size_t column_count = detail::FieldsColumnCount<Fields>::value;
+		template<class Rec> static constexpr size_t max_text() { return traits<Rec>::max_text; }
+		template<class Rec> static constexpr size_t binary_size() { return traits<Rec>::binary_size; }
+
+		void append_header(std::string& out, std::string_view prefix) const {
+			detail::append_header(this->fields, out, std::string(prefix).append(this->prefix));
+		}
+
+		template<class Rec>
+		char* to_text(const Rec& r, char* p) const { return detail::to_text(this->fields, this->get(r), p); }
+
+		template<class Rec>
+		bool from_text(Rec& r, CellReader& cells) const { return detail::from_text(this->fields, this->get(r), cells); }
+
+		template<class Rec>
+		char* to_binary(const Rec& r, char* p) const { return detail::to_binary(this->fields, this->get(r), p); }
+
+		template<class Rec>
+		const char* from_binary(Rec& r, const char* p) const { return detail::from_binary(this->fields, this->get(r), p); }
+	};
+
+	/**
+	 * @brief 入れ子の構造体の配列．列名はprefix + i + separator + 入れ子側の列名
+	 */
+	template<size_t N, class Fields, class Get>
+	struct NestedArray {
+		std::string_view prefix;
+		std::string_view separator;
+		Get get;
+		Fields fields;
+
+		template<class Rec>
+		using traits = detail::FieldsTraits<detail::element_t<Get, Rec>, Fields>;
+
+		static constexpr size_t column_count = N * detail::FieldsColumnCount<Fields>::value;
+		template<class Rec> static constexpr size_t max_text() { return N * traits<Rec>::max_text; }
+		template<class Rec> static constexpr size_t binary_size() { return N * traits<Rec>::binary_size; }
+
+		void append_header(std::string& out, std::string_view prefix) const {
+			for (size_t i = 0; i < N; ++i) {
+				std::string p(prefix);
+				p.append(this->prefix);
+				detail::append_index(p, i);
+				p.append(this->separator);
+				detail::append_header(this->fields, out, p);
+			}
+		}
+
+		template<class Rec>
+		char* to_text(const Rec& r, char* p) const {
+			const auto& items = this->get(r);
+			for (size_t i = 0; i < N; ++i) {
+				p = detail::to_text(this->fields, items[i], p);
+			}
+			return p;
+		}
+
+		template<class Rec>
+		bool from_text(Rec& r, CellReader& cells) const {
+			auto& items = this->get(r);
+			for (size_t i = 0; i < N; ++i) {
+				if (!detail::from_text(this->fields, items[i], cells)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template<class Rec>
+		char* to_binary(const Rec& r, char* p) const {
+			const auto& items = this->get(r);
+			for (size_t i = 0; i < N; ++i) {
+				p = detail::to_binary(this->fields, items[i], p);
+			}
+			return p;
+		}
+
+		template<class Rec>
+		const char* from_binary(Rec& r, const char* p) const {
+			auto& items = this->get(r);
+			for (size_t i = 0; i < N; ++i) {
+				p = detail::from_binary(this->fields, items[i], p);
+			}
+			return p;
+		}
+	};
+
+	template<class... F>
+	constexpr auto fields(F... f) {
+		return std::tuple<F...>(f...);
+	}
+
+	template<class Codec = AutoCodec, class Get>
+	constexpr auto column(std::string_view name, Get get) {
+		return Column<Codec, Get>{ name, get };
+	}
+
+	template<size_t N, class Codec = AutoCodec, class Get>
+	constexpr auto columns(std::string_view name, Get get, std::array<std::string_view, N> suffixes = {}) {
+		return Columns<N, Codec, Get>{ name, get, suffixes };
+	}
+
+	template<class Get, class... F>
+	constexpr auto nested(std::string_view prefix, Get get, const std::tuple<F...>& fields) {
+		return Nested<std::tuple<F...>, Get>{ prefix, get, fields };
+	}
+
+	template<size_t N, class Get, class... F>
+	constexpr auto nested_array(std::string_view prefix, std::string_view separator, Get get, const std::tuple<F...>& fields) {
+		return NestedArray<N, std::tuple<F...>, Get>{ prefix, separator, get, fields };
+	}
+
+	/****************************************************************************************************
+	* レコード
+	*****************************************************************************************************/
+
+	/**
+	 * @brief フィールド記述子から生成したレコードの読み書き
+	 */
+	template<class Rec, const auto& Fields>
+	struct Record {
+		using value_type = Rec;
+		using Traits = detail::FieldsTraits<Rec, std::remove_cvref_t<decltype(Fields)>>;
+
+		static constexpr size_t column_count = Traits::column_count;
+		static constexpr size_t max_line_size = Traits::max_text;		// 改行を含むCSVの1行の最大長
+		static constexpr size_t binary_size = Traits::binary_size;		// バイナリの1レコードの長さ
+
+		static constexpr char magic[4] = { 'V', 'R', 'S', 'B' };
+		static constexpr uint16_t version = 1;
+		static constexpr size_t binary_header_size = 24;
+
+		static_assert(column_count > 0, "RecordSchema: a record needs at least one column");
+
+		/**
+		 * @brief 改行付きのヘッダ行
+		 */
+		static const std::string& header() {
+			static const std::string h = [] {
+				std::string s;
+				detail::append_header(Fields, s, "");
+				s.back() = '\n';
+				return s;
+			}();
+			return h;
+		}
+
+		/**
+		 * @brief 改行付きの1行をoutに書き，書き込み終端を返す．outにはmax_line_sizeバイト必要
+		 */
+		static char* write_text(const Rec& r, char* out) {
+			char* p = detail::to_text(Fields, r, out);
+			p[-1] = '\n';
+			return p;
+		}
+
+		/**
+		 * @brief 1行を読む(末尾の改行はあってもなくてもよい)．列数・値が合わなければfalse
+		 */
+		static bool parse_text(std::string_view line, Rec& r) {
+			while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+				line.remove_suffix(1);
+			}
+			CellReader cells(line);
+			return detail::from_text(Fields, r, cells) && cells.at_end();
+		}
+
+		/**
+		 * @brief outにbinary_sizeバイト書き，書き込み終端を返す
+		 */
+		static char* write_binary(const Rec& r, char* out) {
+			return detail::to_binary(Fields, r, out);
+		}
+
+		/**
+		 * @brief inからbinary_sizeバイト読み，読み込み終端を返す
+		 */
+		static const char* read_binary(const char* in, Rec& r) {
+			return detail::from_binary(Fields, r, in);
+		}
+
+		/**
+		 * @brief スキーマの識別値(ヘッダ行とレコード長のFNV-1a)
+		 */
+		static uint64_t fingerprint() {
+			uint64_t h = 14695981039346656037ull;
+			const auto mix = [&h](const unsigned char c) { h = (h ^ c) * 1099511628211ull; };
+			for (const char c : header()) {
+				mix(static_cast<unsigned char>(c));
+			}
+			for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+				mix(static_cast<unsigned char>(binary_size >> (8 * i)));
+			}
+			return h;
+		}
+
+		static void write_binary_header(std::vector<char>& out) {
+			const uint16_t reserved = 0;
+			const uint32_t columns = static_cast<uint32_t>(column_count);
+			const uint32_t record_size = static_cast<uint32_t>(binary_size);
+			const uint64_t print = fingerprint();
+
+			const size_t offset = out.size();
+			out.resize(offset + binary_header_size);
+			char* p = out.data() + offset;
+			std::memcpy(p, magic, sizeof(magic)); p += sizeof(magic);
+			std::memcpy(p, &version, sizeof(version)); p += sizeof(version);
+			std::memcpy(p, &reserved, sizeof(reserved)); p += sizeof(reserved);
+			std::memcpy(p, &columns, sizeof(columns)); p += sizeof(columns);
+			std::memcpy(p, &record_size, sizeof(record_size)); p += sizeof(record_size);
+			std::memcpy(p, &print, sizeof(print));
+		}
+
+		/**
+		 * @brief 先頭binary_header_sizeバイトがこのスキーマのものか
+		 */
+		static bool check_binary_header(const char* data, const size_t size) {
+			std::vector<char> expected;
+			write_binary_header(expected);
+			return size >= binary_header_size && std::memcmp(data, expected.data(), binary_header_size) == 0;
+		}
+	};
+
+	/**
+	 * @brief Recordで書いたファイル(CSV/バイナリ)を先頭から読み出す．
+	 * @detail ヘッダが読み込み側のスキーマと一致しない場合はopenが失敗する．
+	 *         書き込み中に終了したファイルは，末尾の不完全なレコードを無視してそれまでを返す．
+	 */
+	template<class RecordT>
+	class RecordFileReader {
+
+	public:
+		using value_type = typename RecordT::value_type;
+
+		RecordFileReader(const std::string& path, const RecordFormat format)
+			: path_(path)
+			, format_(format)
+		{}
+
+		bool open() {
+			if (this->format_ == RecordFormat::Csv) {
+				this->file_.open(this->path_, std::ios::in);
+				std::string line;
+				if (!this->file_.is_open() || !std::getline(this->file_, line)) {
+					return false;
+				}
+				return line + "\n" == RecordT::header();
+			} else {
+				this->file_.open(this->path_, std::ios::in | std::ios::binary);
+				char head[RecordT::binary_header_size];
+				return this->file_.is_open()
+					&& this->file_.read(head, sizeof(head))
+					&& RecordT::check_binary_header(head, sizeof(head));
+			}
+		}
+
+		void close() {
+			if (this->file_.is_open()) {
+				this->file_.close();
+			}
+		}
+
+		/**
+		 * @brief 次のレコードを読み出す．終端または読めない行・レコードに達した場合はfalse
+		 */
+		bool read_next(value_type& out) {
+			if (this->format_ == RecordFormat::Csv) {
+				if (!std::getline(this->file_, this->line_)) {
+					return false;
+				}
+				if (!RecordT::parse_text(this->line_, out)) {
+					this->corrupted_ = true;
+					return false;
+				}
+				return true;
+			} else {
+				if (!this->file_.read(this->record_.data(), this->record_.size())) {
+					return false;
+				}
+				RecordT::read_binary(this->record_.data(), out);
+				return true;
+			}
+		}
+
+		std::vector<value_type> read_all() {
+			std::vector<value_type> out;
+			value_type r{};
+			while (this->read_next(r)) {
+				out.push_back(r);
+			}
+			return out;
+		}
+
+		bool is_open() const { return this->file_.is_open(); }
+
+		// 読めない行で読み出しを打ち切った場合true
+		bool is_corrupted() const { return this->corrupted_; }
+
+	private:
+		std::filesystem::path path_;
+		const RecordFormat format_;
+		std::ifstream file_;
+		std::string line_;
+		std::array<char, RecordT::binary_size> record_{};
+		bool corrupted_ = false;
+	};
+}
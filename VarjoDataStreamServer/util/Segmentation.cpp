@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <limits>
+
+#include "Segmentation.hpp"
+#include "PerformanceChecker.hpp"
+
+namespace {
+	// 計装
+	struct Metrics {
+		PerformanceChecker::LatencyHistogram& segment_close = PerformanceChecker::histogram("segment_close_ns");
+		PerformanceChecker::Counter& segments_closed = PerformanceChecker::counter("segments_closed_total");
+		PerformanceChecker::Gauge& pending_segments = PerformanceChecker::gauge("segment_close_pending");
+	};
+
+	Metrics& metrics() {
+		static Metrics m;
+		return m;
+	}
+
+	constexpr int64_t no_epoch = std::numeric_limits<int64_t>::min();
+	std::atomic<int64_t> g_epoch_ns{ no_epoch };
+
+	std::string zero_pad(const uint64_t n, const size_t width) {
+		std::string s = std::to_string(n);
+		if (s.size() < width) {
+			s.insert(0, width - s.size(), '0');
+		}
+		return s;
+	}
+}
+
+namespace Segmentation {
+
+	int64_t shared_epoch_ns(const int64_t timestamp_ns)
+	{
+		int64_t epoch = g_epoch_ns.load(std::memory_order_acquire);
+		if (epoch != no_epoch) {
+			return epoch;
+		}
+		// 最初に来たストリームの時刻を基準にする．失敗したらepochには他のストリームが決めた基準が入る
+		if (g_epoch_ns.compare_exchange_strong(epoch, timestamp_ns, std::memory_order_acq_rel)) {
+			return timestamp_ns;
+		}
+		return epoch;
+	}
+
+	void reset_shared_epoch()
+	{
+		g_epoch_ns.store(no_epoch, std::memory_order_release);
+	}
+
+	SegmentPlan::SegmentPlan(const SegmentOptions& opt, const std::filesystem::path& base_path)
+		: opt_(opt),
+		duration_ns_(static_cast<int64_t>(opt.duration_s * 1e9)),
+		base_path_(base_path)
+	{}
+
+	bool SegmentPlan::should_roll(const SegmentInfo& current, const int64_t timestamp_ns) const
+	{
+		if (this->duration_ns_ > 0 && this->index_of(timestamp_ns) > current.index) {
+			return true;
+		}
+		return this->opt_.max_bytes > 0 && current.bytes >= this->opt_.max_bytes;
+	}
+
+	SegmentInfo SegmentPlan::first(const int64_t timestamp_ns) const
+	{
+		SegmentInfo info;
+		info.index = this->index_of(timestamp_ns);
+		info.part = 0;
+		info.path = this->path_of(info.index, info.part);
+		info.first_ns = timestamp_ns;
+		info.last_ns = timestamp_ns;
+		return info;
+	}
+
+	SegmentInfo SegmentPlan::next(const SegmentInfo& current, const int64_t timestamp_ns) const
+	{
+		SegmentInfo info;
+		const uint64_t index = this->index_of(timestamp_ns);
+		if (index > current.index) {
+			info.index = index;
+			info.part = 0;
+		}
+		else {
+			// サイズで区切った．時刻が戻っていても同じ時間帯の続きにする
+			info.index = current.index;
+			info.part = current.part + 1;
+		}
+		info.path = this->path_of(info.index, info.part);
+		info.first_ns = timestamp_ns;
+		info.last_ns = timestamp_ns;
+		return info;
+	}
+
+	uint64_t SegmentPlan::index_of(const int64_t timestamp_ns) const
+	{
+		if (this->duration_ns_ <= 0) {
+			return 0;
+		}
+		const int64_t elapsed = timestamp_ns - shared_epoch_ns(timestamp_ns);
+		return elapsed > 0 ? static_cast<uint64_t>(elapsed / this->duration_ns_) : 0;
+	}
+
+	std::filesystem::path SegmentPlan::path_of(const uint64_t index, const uint32_t part) const
+	{
+		std::string name = this->base_path_.stem().string() + "_" + zero_pad(index, 5);
+		if (part > 0) {
+			name += "_" + std::to_string(part);
+		}
+		name += this->base_path_.extension().string();
+		return this->base_path_.parent_path() / name;
+	}
+
+	std::filesystem::path SegmentPlan::manifest_path() const
+	{
+		return this->base_path_.parent_path() / (this->base_path_.stem().string() + "_segments.csv");
+	}
+
+	SegmentCloser::~SegmentCloser()
+	{
+		this->close();
+	}
+
+	bool SegmentCloser::open(const std::filesystem::path& manifest_path)
+	{
+		this->manifest_.open(manifest_path, std::ios::out | std::ios::trunc);
+		if (!this->manifest_) {
+			return false;
+		}
+		this->manifest_ << "index,part,file,first_ns,last_ns,records,bytes\n";
+		this->manifest_.flush();
+		return true;
+	}
+
+	void SegmentCloser::close()
+	{
+		this->closer_task_.wait_idle();
+		if (this->manifest_.is_open()) {
+			this->manifest_.close();
+		}
+	}
+
+	void SegmentCloser::submit(SegmentInfo info, CloseFn close_fn)
+	{
+		{
+			std::lock_guard<std::mutex> lk(this->que_mtx_);
+			this->que_.push_back(Pending{ std::move(info), std::move(close_fn) });
+		}
+		metrics().pending_segments.add(1);
+		this->closer_task_.notify();
+	}
+
+	void SegmentCloser::closer_worker()
+	{
+		std::deque<Pending> batch;
+		{
+			std::lock_guard<std::mutex> lk(this->que_mtx_);
+			batch.swap(this->que_);
+		}
+
+		// 出した順に閉じて，閉じ終えたものからmanifestに書く
+		for (auto& pending : batch) {
+			{
+				PerformanceChecker::ScopedTimer timer(metrics().segment_close);
+				if (pending.close_fn) {
+					pending.close_fn(pending.info);
+				}
+			}
+
+			const auto& info = pending.info;
+			if (this->manifest_.is_open()) {
+				this->manifest_ << info.index << ',' << info.part << ',' << info.path.filename().string() << ','
+					<< info.first_ns << ',' << info.last_ns << ',' << info.records << ',' << info.bytes << '\n';
+				this->manifest_.flush();
+			}
+			metrics().segments_closed.inc();
+			metrics().pending_segments.add(-1);
+		}
+	}
+
+	SegmentedFile::SegmentedFile(const SegmentOptions& opt, const AsyncIo::AsyncFileOptions& file_opt)
+		: opt_(opt),
+		file_opt_(file_opt)
+	{}
+
+	SegmentedFile::~SegmentedFile()
+	{
+		this->close();
+	}
+
+	bool SegmentedFile::open(const std::filesystem::path& path, HeaderWriter header_writer)
+	{
+		if (this->open_) {
+			return false;
+		}
+		this->header_writer_ = std::move(header_writer);
+		this->failed_ = false;
+
+		if (!this->opt_.enabled()) {
+			// 区切らない: これまでどおり1本のファイル
+			this->file_ = std::make_shared<AsyncIo::AsyncFile>(this->file_opt_);
+			if (!this->file_->open(path)) {
+				this->file_.reset();
+				return false;
+			}
+			if (this->header_writer_) {
+				this->header_writer_(*this->file_);
+			}
+			this->open_ = true;
+			return true;
+		}
+
+		this->plan_.emplace(this->opt_, path);
+		if (!this->closer_.open(this->plan_->manifest_path())) {
+			this->plan_.reset();
+			return false;
+		}
+		this->open_ = true;
+		return true;
+	}
+
+	void SegmentedFile::close()
+	{
+		if (!this->open_) {
+			return;
+		}
+
+		if (this->plan_) {
+			this->finish_segment();
+			this->closer_.close();
+			this->plan_.reset();
+		}
+		else if (this->file_) {
+			this->file_->close();
+			this->failed_ = this->failed_ || this->file_->failed();
+			this->file_.reset();
+		}
+		this->open_ = false;
+	}
+
+	void SegmentedFile::begin_record(const int64_t timestamp_ns)
+	{
+		if (!this->plan_ || this->failed()) {
+			return;
+		}
+
+		if (!this->file_) {
+			this->start_segment(this->plan_->first(timestamp_ns));
+		}
+		else {
+			this->current_.bytes = this->file_->size();
+			if (this->plan_->should_roll(this->current_, timestamp_ns)) {
+				const SegmentInfo next = this->plan_->next(this->current_, timestamp_ns);
+				this->finish_segment();
+				this->start_segment(next);
+			}
+		}
+
+		++this->current_.records;
+		this->current_.last_ns = std::max(this->current_.last_ns, static_cast<int64_t>(timestamp_ns));
+	}
+
+	void SegmentedFile::write(const void* data, const size_t size)
+	{
+		if (this->file_) {
+			this->file_->write(data, size);
+		}
+	}
+
+	void SegmentedFile::flush()
+	{
+		if (this->file_) {
+			this->file_->flush();
+		}
+	}
+
+	bool SegmentedFile::failed() const
+	{
+		return this->failed_.load(std::memory_order_relaxed) || (this->file_ && this->file_->failed());
+	}
+
+	void SegmentedFile::start_segment(const SegmentInfo& info)
+	{
+		this->current_ = info;
+		this->file_ = std::make_shared<AsyncIo::AsyncFile>(this->file_opt_);
+		if (!this->file_->open(info.path)) {
+			this->file_.reset();
+			this->failed_ = true;
+			return;
+		}
+		if (this->header_writer_) {
+			this->header_writer_(*this->file_);
+		}
+	}
+
+	void SegmentedFile::finish_segment()
+	{
+		if (!this->file_) {
+			return;
+		}
+
+		// 閉じる(書き終えるまで待つ)のはSegmentCloserに任せ，次のセグメントへすぐ移る
+		this->closer_.submit(this->current_, [this, file = std::move(this->file_)](SegmentInfo& info) {
+			file->close();
+			info.bytes = file->size();
+			if (file->failed()) {
+				this->failed_ = true;
+			}
+		});
+		this->file_.reset();
+	}
+}
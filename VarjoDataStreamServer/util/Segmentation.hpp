@@ -0,0 +1,203 @@
+/************************************************************************************************************************
+	Segmentation
+	長時間の記録を1本のファイルにせず，一定の時間・サイズごとのセグメントに分けて書くための共通部品．
+	書き終えたセグメントは記録を続けている間に取り出して，アップロード・変換・解析に回せる．
+	異常終了しても失われるのは書きかけのセグメントだけになる．
+
+	- 時間での区切り: レコードの時刻(Varjoの時刻)を全ストリーム共通の基準時刻(最初に記録されたレコードの時刻)から
+	                  duration_sごとに区切る．ストリームが違っても同じ番号のセグメントは同じ時間帯になる．
+	- サイズでの区切り: 同じ時間帯の中でmax_bytesを超えたら続きを別のファイル(part)にする．
+	- ファイル名: 元のパスが"dir/gaze.csv"なら"dir/gaze_00003.csv"，partが1以上なら"dir/gaze_00003_1.csv"．
+	- manifest: "dir/gaze_segments.csv"に閉じ終えたセグメントを1行ずつ追記する．
+	            index,part,file,first_ns,last_ns,records,bytes
+	            行が追記されたセグメントは書き終えているので，そのまま読んでよい．
+
+	セグメントを閉じる処理(AsyncFile::closeやffmpegの終了待ち)はSegmentCloserが専用のスレッドで順に行い，
+	書き込みスレッドは待たない．
+
+	AsyncFileに書く記録(CSV・バイナリ)はSegmentedFileを使う:
+		Segmentation::SegmentedFile file(segment_opt);
+		file.open(path, [this](AsyncIo::AsyncFile& f) { f.write(header); });	// ヘッダはセグメントごとに書く
+		file.begin_record(timestamp_ns);		// 区切りを越えていればここで次のセグメントに移る
+		file.write(line.data(), line.size());
+
+	区切らない設定(既定)では，これまでどおり指定したパスに1本で書き，manifestも作らない．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+#include "AsyncFile.hpp"
+#include "Executor.hpp"
+
+namespace Segmentation {
+
+	struct SegmentOptions {
+		double duration_s = 0.0;		// 0なら時間では区切らない
+		uint64_t max_bytes = 0;			// 0ならサイズでは区切らない
+
+		bool enabled() const { return this->duration_s > 0.0 || this->max_bytes > 0; }
+	};
+
+	/**
+	 * @brief 全ストリームで共有する時間の区切りの基準．最初に呼ばれたときの時刻を基準にする
+	 */
+	int64_t shared_epoch_ns(const int64_t timestamp_ns);
+
+	/**
+	 * @brief 基準時刻を捨てる．新しい記録を始める前に呼ぶ
+	 */
+	void reset_shared_epoch();
+
+	struct SegmentInfo {
+		uint64_t index = 0;			// 時間の区切りの番号(全ストリーム共通)
+		uint32_t part = 0;			// 同じ時間帯の中でサイズで分けた番号
+		std::filesystem::path path;
+		int64_t first_ns = 0;
+		int64_t last_ns = 0;
+		uint64_t records = 0;
+		uint64_t bytes = 0;
+	};
+
+	/**
+	 * @brief 区切る位置とファイル名を決める
+	 */
+	class SegmentPlan {
+
+	public:
+		SegmentPlan(const SegmentOptions& opt, const std::filesystem::path& base_path);
+
+		/**
+		 * @brief timestamp_nsのレコードの前で区切るか．時刻が前の時間帯に戻った場合は区切らない
+		 */
+		bool should_roll(const SegmentInfo& current, const int64_t timestamp_ns) const;
+
+		SegmentInfo first(const int64_t timestamp_ns) const;
+
+		/**
+		 * @brief currentの次のセグメント．同じ時間帯ならpartを進める
+		 */
+		SegmentInfo next(const SegmentInfo& current, const int64_t timestamp_ns) const;
+
+		uint64_t index_of(const int64_t timestamp_ns) const;
+		std::filesystem::path path_of(const uint64_t index, const uint32_t part) const;
+		std::filesystem::path manifest_path() const;
+
+	private:
+		const SegmentOptions opt_;
+		const int64_t duration_ns_;
+		const std::filesystem::path base_path_;
+	};
+
+	/**
+	 * @brief セグメントを専用のスレッドで順に閉じ，閉じ終えたものをmanifestに追記する
+	 * @detail 閉じるときはAsyncFileの書き終え(I/Oプール)や_pcloseを待つので，I/Oプールでは動かさない．
+	 *         全ての出力が同じ時刻で区切るため，I/Oプールで待つと閉じる側だけでプールが埋まり，書き込みが進まなくなる．
+	 */
+	class SegmentCloser {
+
+	public:
+		using CloseFn = std::function<void(SegmentInfo& info)>;
+
+		SegmentCloser() = default;
+		~SegmentCloser();
+
+		SegmentCloser(const SegmentCloser&) = delete;
+		SegmentCloser& operator=(const SegmentCloser&) = delete;
+
+		bool open(const std::filesystem::path& manifest_path);
+
+		/**
+		 * @brief 積んだ分を全て閉じ終えるまで待ってからmanifestを閉じる
+		 */
+		void close();
+
+		/**
+		 * @brief close_fnで閉じてからinfoをmanifestに書く．close_fnはbytesなどを更新してよい
+		 */
+		void submit(SegmentInfo info, CloseFn close_fn);
+
+	private:
+		struct Pending {
+			SegmentInfo info;
+			CloseFn close_fn;
+		};
+
+		void closer_worker();
+
+	private:
+		std::ofstream manifest_;
+		std::deque<Pending> que_;
+		std::mutex que_mtx_;
+		Execution::WorkerTask closer_task_{ [this] { this->closer_worker(); }, Execution::TaskKind::Blocking };
+	};
+
+	/**
+	 * @brief AsyncFileをセグメントごとに開き直す．1つのファイルのopen/begin_record/write/closeは同時に呼ばないこと
+	 */
+	class SegmentedFile {
+
+	public:
+		using HeaderWriter = std::function<void(AsyncIo::AsyncFile& file)>;
+
+		explicit SegmentedFile(const SegmentOptions& opt = SegmentOptions{}, const AsyncIo::AsyncFileOptions& file_opt = AsyncIo::AsyncFileOptions{});
+		~SegmentedFile();
+
+		SegmentedFile(const SegmentedFile&) = delete;
+		SegmentedFile& operator=(const SegmentedFile&) = delete;
+
+		/**
+		 * @brief 区切らない場合はpathを開いてヘッダを書く．区切る場合は最初のレコードで1つ目のセグメントを開く
+		 */
+		bool open(const std::filesystem::path& path, HeaderWriter header_writer);
+
+		void close();
+
+		/**
+		 * @brief 次に書くレコードの時刻を渡す．区切りを越えていれば次のセグメントに移る
+		 */
+		void begin_record(const int64_t timestamp_ns);
+
+		void write(const void* data, const size_t size);
+
+		void write(std::string_view s) {
+			this->write(s.data(), s.size());
+		}
+
+		void flush();
+
+		// getter
+		bool is_open() const { return this->open_; }
+		bool failed() const;
+		bool segmented() const { return this->plan_.has_value(); }
+
+	private:
+		void start_segment(const SegmentInfo& info);
+		void finish_segment();
+
+	private:
+		const SegmentOptions opt_;
+		const AsyncIo::AsyncFileOptions file_opt_;
+		bool open_ = false;
+
+		std::optional<SegmentPlan> plan_;
+		HeaderWriter header_writer_;
+		std::shared_ptr<AsyncIo::AsyncFile> file_;		// 閉じるときはSegmentCloserに渡す
+		SegmentInfo current_;
+		std::atomic_bool failed_{ false };
+
+		SegmentCloser closer_;
+	};
+}
@@ -0,0 +1,178 @@
+/************************************************************************************************************************
+	SharedPayload<T> / PayloadPool<T>
+	1つのフレームを複数の出力先に渡すための，変更しない前提の参照カウント付きハンドル．
+
+	SharedPayload<T>はshared_ptr<const T>そのもの．ハンドルを渡すとき・キューに積むときは参照カウントが増えるだけで
+	中身はコピーされない．出力先を何個つないでもフレーム1枚分のメモリで済む．
+	発行した後は誰も書き換えないこと(必要なら各自でコピーする)．
+
+	PayloadPool<T>は使い終わったTを捨てずに取っておき，次のacquireで使い回す．Framedataのようにvectorを持つ型では
+	確保済みの領域もそのまま残るので，フレームごとの大きな確保・解放がなくなる．
+		auto frame = pool.acquire();			// 使い回し(なければ新規)．この時点では書き込んでよい
+		fill(frame->data);
+		SharedPayload<Frame> handle = std::move(frame);	// 以後は読み取りのみ．最後のハンドルが消えるとプールに戻る
+	プールが先に破棄された場合，戻ってきたTはその場で解放される．
+
+	MemoryAccountを渡すと，プールが持つTの数(使用中+取っておいている分)を1つitem_bytesとして予算に計上する．
+		PayloadPool<Frame> pool(8, account, frame_bytes);
+		auto frame = pool.try_acquire();		// 予算が足りなければnullptr．呼び出し側でフレームを捨てる
+	予算が逼迫しているときは，戻ってきたTを取っておかずに解放して予算を返す．
+	charge_of(handle)でプールのハンドルの計上先を取れる(他の段が持つ間だけ計上を付け替える場合)．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <optional>
+
+#include "MemoryBudget.hpp"
+
+template<class T>
+using SharedPayload = std::shared_ptr<const T>;
+
+/**
+ * @brief 所有している値をハンドルにする(ムーブのみ．コピーは起きない)
+ */
+template<class T>
+SharedPayload<T> make_SharedPayload(T&& value) {
+	return std::make_shared<const T>(std::move(value));
+}
+
+template<class T>
+class PayloadPool {
+
+	struct State {
+		std::mutex mtx;
+		std::vector<std::unique_ptr<T>> free;
+		size_t max_pooled;
+		std::shared_ptr<Memory::MemoryAccount> account;
+		uint64_t item_bytes;
+
+		~State() {
+			// 取っておいた分はプールと一緒に解放されるので予算へ返す
+			if (this->account != nullptr) {
+				this->account->release(this->free.size() * this->item_bytes);
+			}
+		}
+	};
+
+	struct Recycler {
+		std::weak_ptr<State> state;
+		std::shared_ptr<Memory::MemoryAccount> account;		// プールより後まで残るTの分も返せるよう，T自身が持つ
+		uint64_t item_bytes;
+
+		void operator()(T* p) const {
+			std::unique_ptr<T> item(p);
+			if (auto s = this->state.lock()) {
+				const bool pressure = this->account != nullptr && this->account->under_pressure();
+				std::lock_guard<std::mutex> lk(s->mtx);
+				if (!pressure && s->free.size() < s->max_pooled) {
+					s->free.push_back(std::move(item));
+					return;
+				}
+			}
+			item.reset();
+			if (this->account != nullptr) {
+				this->account->release(this->item_bytes);
+			}
+		}
+	};
+
+public:
+	struct Charge {
+		std::shared_ptr<Memory::MemoryAccount> account;		// nullptrなら計上していない
+		uint64_t bytes;
+	};
+
+	/**
+	 * @brief いずれかのPayloadPool<T>から取り出したハンドルなら，その計上先とT1つ分のバイト数．それ以外はnullopt
+	 */
+	static std::optional<Charge> charge_of(const std::shared_ptr<const T>& handle) {
+		if (const Recycler* recycler = std::get_deleter<Recycler>(handle)) {
+			return Charge{ recycler->account, recycler->item_bytes };
+		}
+		return std::nullopt;
+	}
+
+	/**
+	 * @param max_pooled 取っておく数の上限．これを超えて戻ってきた分は解放する
+	 * @param account 新しく確保するTを計上する先．nullptrなら計上しない
+	 * @param item_bytes T1つ分として計上するバイト数
+	 */
+	explicit PayloadPool(const size_t max_pooled, std::shared_ptr<Memory::MemoryAccount> account = nullptr, const uint64_t item_bytes = 0)
+		: state_(std::make_shared<State>())
+		, account_(std::move(account))
+		, item_bytes_(item_bytes)
+	{
+		this->state_->max_pooled = max_pooled;
+		this->state_->free.reserve(max_pooled);
+		this->state_->account = this->account_;
+		this->state_->item_bytes = item_bytes;
+	}
+
+	PayloadPool(const PayloadPool&) = delete;
+	PayloadPool& operator=(const PayloadPool&) = delete;
+
+	/**
+	 * @brief 書き込み可能なTを取り出す．使い回しの場合は前回の中身が残っているので，呼び出し側で上書きする
+	 */
+	std::shared_ptr<T> acquire() {
+		return this->take(true);
+	}
+
+	/**
+	 * @brief acquireと同じだが，新しく確保する分が予算に収まらなければnullptrを返す
+	 */
+	std::shared_ptr<T> try_acquire() {
+		return this->take(false);
+	}
+
+	/**
+	 * @brief 取っておいている数
+	 */
+	size_t pooled() const {
+		std::lock_guard<std::mutex> lk(this->state_->mtx);
+		return this->state_->free.size();
+	}
+
+private:
+	std::shared_ptr<T> take(const bool force) {
+		std::unique_ptr<T> item;
+		{
+			std::lock_guard<std::mutex> lk(this->state_->mtx);
+			if (!this->state_->free.empty()) {
+				item = std::move(this->state_->free.back());
+				this->state_->free.pop_back();
+			}
+		}
+		if (!item) {
+			// 取っておいた分は計上済み．新しく確保する分だけ予算から取る
+			if (this->account_ != nullptr) {
+				if (force) {
+					this->account_->charge(this->item_bytes_);
+				} else if (!this->account_->try_reserve(this->item_bytes_)) {
+					// 確保し直す間にプレビューが手放した(reclaimer)分がプールに戻っていれば使う
+					std::lock_guard<std::mutex> lk(this->state_->mtx);
+					if (this->state_->free.empty()) {
+						return nullptr;
+					}
+					item = std::move(this->state_->free.back());
+					this->state_->free.pop_back();
+				}
+			}
+			if (!item) {
+				item = std::make_unique<T>();
+			}
+		}
+		return std::shared_ptr<T>(item.release(), Recycler{ this->state_, this->account_, this->item_bytes_ });
+	}
+
+private:
+	std::shared_ptr<State> state_;
+	std::shared_ptr<Memory::MemoryAccount> account_;
+	const uint64_t item_bytes_;
+};
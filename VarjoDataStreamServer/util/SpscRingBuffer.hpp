@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <stdexcept>
+
+/**
+ * @brief 単一プロデューサ・単一コンシューマのロックフリーリングバッファ．
+ *
+ * try_pushはプロデューサスレッドのみ，try_pop/drainはコンシューマスレッドのみから呼ぶこと．
+ * 容量は2のべき乗へ切り上げる．満杯の場合try_pushはfalseを返し，要素は破棄されない(呼び出し側で扱う)．
+ */
+template<class T>
+class SpscRingBuffer {
+
+	static constexpr size_t cache_line_size = 64;
+
+public:
+	explicit SpscRingBuffer(size_t capacity)
+		: mask_(round_up_pow2(capacity) - 1)
+		, buffer_(mask_ + 1)
+	{}
+
+	SpscRingBuffer(const SpscRingBuffer&) = delete;
+	SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+	bool try_push(const T& item) {
+		return this->emplace_impl(item);
+	}
+
+	bool try_push(T&& item) {
+		return this->emplace_impl(std::move(item));
+	}
+
+	bool try_pop(T& out) {
+		const size_t head = this->head_.load(std::memory_order_relaxed);
+		if (head == this->cached_tail_) {
+			this->cached_tail_ = this->tail_.load(std::memory_order_acquire);
+			if (head == this->cached_tail_) {
+				return false;
+			}
+		}
+
+		out = std::move(this->buffer_[head & this->mask_]);
+		this->head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief 取り出せる要素を最大max_count個まとめて取り出し，fに渡す．取り出した個数を返す．
+	 */
+	template<class F>
+	size_t drain(F&& f, size_t max_count = static_cast<size_t>(-1)) {
+		const size_t head = this->head_.load(std::memory_order_relaxed);
+		this->cached_tail_ = this->tail_.load(std::memory_order_acquire);
+
+		size_t n = this->cached_tail_ - head;
+		if (n > max_count) {
+			n = max_count;
+		}
+		for (size_t i = 0; i < n; ++i) {
+			f(std::move(this->buffer_[(head + i) & this->mask_]));
+		}
+
+		this->head_.store(head + n, std::memory_order_release);
+		return n;
+	}
+
+	// 他スレッドから呼んだ場合は概算値
+	size_t size() const {
+		const size_t tail = this->tail_.load(std::memory_order_acquire);
+		const size_t head = this->head_.load(std::memory_order_acquire);
+		return tail - head;
+	}
+
+	bool empty() const { return this->size() == 0; }
+
+	size_t capacity() const { return this->mask_ + 1; }
+
+private:
+	template<class U>
+	bool emplace_impl(U&& item) {
+		const size_t tail = this->tail_.load(std::memory_order_relaxed);
+		if (tail - this->cached_head_ > this->mask_) {
+			this->cached_head_ = this->head_.load(std::memory_order_acquire);
+			if (tail - this->cached_head_ > this->mask_) {
+				return false;
+			}
+		}
+
+		this->buffer_[tail & this->mask_] = std::forward<U>(item);
+		this->tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	static size_t round_up_pow2(size_t n) {
+		if (n == 0) {
+			throw std::invalid_argument("SpscRingBuffer: capacity must be positive");
+		}
+		size_t p = 1;
+		while (p < n) {
+			p <<= 1;
+		}
+		return p;
+	}
+
+private:
+	const size_t mask_;
+	std::vector<T> buffer_;
+
+	// コンシューマ側
+	alignas(cache_line_size) std::atomic<size_t> head_{0};
+	size_t cached_tail_{0};
+
+	// プロデューサ側
+	alignas(cache_line_size) std::atomic<size_t> tail_{0};
+	size_t cached_head_{0};
+};
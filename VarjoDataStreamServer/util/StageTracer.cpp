@@ -0,0 +1,138 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "StageTracer.hpp"
+
+namespace {
+	size_t round_up_pow2(size_t n) {
+		size_t p = 1;
+		while (p < n) {
+			p <<= 1;
+		}
+		return p;
+	}
+
+	// 連番のkeyがスロット表全体に散らばるようにする
+	inline uint64_t mix(uint64_t key) {
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		return key;
+	}
+}
+
+namespace Profiling {
+
+	StageTracer::StageTracer(const std::string& root_name, const size_t slot_count)
+		: slots_(new Slot[round_up_pow2(std::max<size_t>(slot_count, 2))]),
+		slot_mask_(round_up_pow2(std::max<size_t>(slot_count, 2)) - 1),
+		window_start_ns_(now_ns())
+	{
+		auto root = std::make_unique<Stage>();
+		root->name = root_name;
+		root->parent = root_stage;
+		root->end_to_end = false;
+		this->stages_.push_back(std::move(root));
+	}
+
+	StageTracer::StageId StageTracer::add_stage(const std::string& name, const StageId parent, const bool end_to_end)
+	{
+		for (StageId i = 0; i < this->stages_.size(); ++i) {
+			if (this->stages_[i]->name == name) {
+				return i;
+			}
+		}
+		if (parent >= this->stages_.size()) {
+			throw std::invalid_argument("Unknown parent stage for " + name);
+		}
+		if (this->stages_.size() >= max_stages) {
+			throw std::runtime_error("Too many stages in StageTracer.");
+		}
+
+		auto stage = std::make_unique<Stage>();
+		stage->name = name;
+		stage->parent = parent;
+		stage->end_to_end = end_to_end;
+		this->stages_.push_back(std::move(stage));
+		return static_cast<StageId>(this->stages_.size() - 1);
+	}
+
+	void StageTracer::mark(const uint64_t key, const StageId stage)
+	{
+		const int64_t now = now_ns();
+		Slot& slot = this->slots_[mix(key) & this->slot_mask_];
+		Stage& st = *this->stages_[stage];
+		st.count.fetch_add(1, std::memory_order_relaxed);
+
+		if (stage == root_stage) {
+			// 以前のフレームの時刻を消してからkeyを書き換える
+			for (auto& t : slot.time_ns) {
+				t.store(0, std::memory_order_relaxed);
+			}
+			slot.time_ns[root_stage].store(now, std::memory_order_relaxed);
+			slot.key.store(key, std::memory_order_release);
+			return;
+		}
+
+		// スロットが別のフレームに使い回されていれば計らない
+		if (slot.key.load(std::memory_order_acquire) != key) {
+			st.unmatched.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		slot.time_ns[stage].store(now, std::memory_order_relaxed);
+
+		const int64_t parent_ns = slot.time_ns[st.parent].load(std::memory_order_relaxed);
+		if (parent_ns == 0) {
+			st.unmatched.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		st.latency.record(std::chrono::nanoseconds(now - parent_ns));
+
+		if (st.end_to_end) {
+			const int64_t root_ns = slot.time_ns[root_stage].load(std::memory_order_relaxed);
+			if (root_ns != 0) {
+				st.total.record(std::chrono::nanoseconds(now - root_ns));
+			}
+		}
+	}
+
+	void StageTracer::reset()
+	{
+		for (auto& stage : this->stages_) {
+			stage->count.store(0, std::memory_order_relaxed);
+			stage->unmatched.store(0, std::memory_order_relaxed);
+			stage->latency.reset();
+			stage->total.reset();
+		}
+		this->window_start_ns_.store(now_ns(), std::memory_order_relaxed);
+	}
+
+	std::vector<StageSummary> StageTracer::summary() const
+	{
+		std::vector<StageSummary> ret;
+		ret.reserve(this->stages_.size());
+		for (StageId i = 0; i < this->stages_.size(); ++i) {
+			const auto& stage = *this->stages_[i];
+			ret.push_back(StageSummary{
+				.name = stage.name,
+				.parent = i == root_stage ? std::string() : this->stages_[stage.parent]->name,
+				.count = stage.count.load(std::memory_order_relaxed),
+				.unmatched = stage.unmatched.load(std::memory_order_relaxed),
+				.latency = stage.latency.summary(),
+				.end_to_end = stage.total.summary(),
+				.is_end_to_end = stage.end_to_end
+			});
+		}
+		return ret;
+	}
+
+	double StageTracer::elapsed_s() const
+	{
+		return (now_ns() - this->window_start_ns_.load(std::memory_order_relaxed)) / 1e9;
+	}
+
+	int64_t StageTracer::now_ns()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+	}
+}
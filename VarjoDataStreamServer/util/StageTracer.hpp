@@ -0,0 +1,102 @@
+/************************************************************************************************************************
+	Stage Tracer
+	フレームがパイプラインの各段(受信 → 取り出し → padding除去 → 配信 → 出力先)を通過した時刻を記録し，
+	段ごとの遅延のパーセンタイルと通過数を集計する．
+
+	段は親(直前の段)を持つ木として登録する．mark(key, stage)でその段の時刻を記録すると，
+	同じkeyの親の時刻との差がその段の遅延としてヒストグラムに入る．end_to_endの段は起点(root)からの差も記録する．
+	時刻はkeyのハッシュで引くスロット表に置くため，記録中にロックやメモリ確保は行わない．
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+
+#include "DeadlineSampler.hpp"
+
+namespace Profiling {
+
+	struct StageSummary {
+		std::string name;
+		std::string parent;
+		uint64_t count;			// 通過数
+		uint64_t unmatched;		// 親の時刻が見つからず遅延を計れなかった数
+		Sampling::JitterSummary latency;			// 親の段からの遅延
+		Sampling::JitterSummary end_to_end;		// 起点からの遅延(end_to_endの段のみ)
+		bool is_end_to_end;
+	};
+
+	/**
+	 * @brief 段ごとの遅延を計るトレーサー．段の登録は計測開始前に一つのスレッドで行うこと．
+	 * @detail 一つの段のmarkは一つのスレッドから呼ぶ(ヒストグラムは段ごとに単一の書き手を前提とする)．
+	 *         スロットはslot_count個で使い回すため，同時に処理中のフレーム数はslot_countより十分小さくすること．
+	 */
+	class StageTracer {
+
+	public:
+		using StageId = uint32_t;
+		using clock = std::chrono::steady_clock;
+
+		static constexpr size_t max_stages = 32;
+		static constexpr StageId root_stage = 0;
+
+		explicit StageTracer(const std::string& root_name = "source", const size_t slot_count = 4096);
+
+		StageTracer(const StageTracer&) = delete;
+		StageTracer& operator=(const StageTracer&) = delete;
+
+		/**
+		 * @brief 段を登録してIDを返す．同名の段が既にあればそのIDを返す．
+		 */
+		StageId add_stage(const std::string& name, const StageId parent, const bool end_to_end = false);
+
+		/**
+		 * @brief keyのフレームがstageを通過した時刻を記録する．root_stageの場合はそのkeyのスロットを初期化する．
+		 */
+		void mark(const uint64_t key, const StageId stage);
+
+		/**
+		 * @brief 集計をやり直す(ウォームアップ後に呼ぶ)．スロットの時刻は残すため処理中のフレームも計れる．
+		 */
+		void reset();
+
+		std::vector<StageSummary> summary() const;
+
+		// getter
+		size_t stage_count() const { return this->stages_.size(); }
+		uint64_t count(const StageId stage) const { return this->stages_[stage]->count.load(std::memory_order_relaxed); }
+		const std::string& stage_name(const StageId stage) const { return this->stages_[stage]->name; }
+		// reset(または生成)からの経過秒
+		double elapsed_s() const;
+
+	private:
+		struct Stage {
+			std::string name;
+			StageId parent;
+			bool end_to_end;
+			std::atomic<uint64_t> count{0};
+			std::atomic<uint64_t> unmatched{0};
+			Sampling::JitterHistogram latency;
+			Sampling::JitterHistogram total;
+		};
+
+		struct Slot {
+			std::atomic<uint64_t> key{~uint64_t(0)};
+			std::atomic<int64_t> time_ns[max_stages]{};
+		};
+
+		static int64_t now_ns();
+
+	private:
+		std::vector<std::unique_ptr<Stage>> stages_;
+		std::unique_ptr<Slot[]> slots_;
+		const size_t slot_mask_;
+		std::atomic<int64_t> window_start_ns_;
+	};
+}
@@ -0,0 +1,209 @@
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+#include "TraceRecorder.hpp"
+
+namespace {
+	std::string escape_json(const std::string& s) {
+		std::string out;
+		out.reserve(s.size());
+		for (const char c : s) {
+			if (c == '"' || c == '\\') {
+				out += '\\';
+				out += c;
+			} else if (static_cast<unsigned char>(c) < 0x20) {
+				char buf[8];
+				std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+				out += buf;
+			} else {
+				out += c;
+			}
+		}
+		return out;
+	}
+
+	/**
+	 * @brief スレッドと記録先バッファの対応．スレッド終了時にバッファを解放可能にする
+	 */
+	struct ThreadSlot {
+		void* buffer = nullptr;
+		uint64_t generation = 0;
+		std::atomic_bool* exited = nullptr;
+
+		~ThreadSlot() {
+			if (this->exited != nullptr) {
+				this->exited->store(true);
+			}
+		}
+	};
+
+	thread_local ThreadSlot thread_slot;
+}
+
+namespace Profiling {
+
+	TraceRecorder& TraceRecorder::instance()
+	{
+		static TraceRecorder recorder;
+		return recorder;
+	}
+
+	void TraceRecorder::start(const TraceOptions& opt)
+	{
+		std::lock_guard lk(this->mtx_);
+
+		// 終了したスレッドのバッファを捨て，残りは世代で区別する
+		std::erase_if(this->buffers_, [](const std::unique_ptr<ThreadBuffer>& b) { return b->exited.load(); });
+
+		this->opt_ = opt;
+		this->opt_.events_per_thread = std::max<size_t>(this->opt_.events_per_thread, 1);
+		this->start_ticks_ = PerformanceChecker::Ticks::now();
+		this->generation_.fetch_add(1);
+		enabled_.store(true);
+	}
+
+	void TraceRecorder::stop()
+	{
+		enabled_.store(false);
+	}
+
+	TraceRecorder::ThreadBuffer* TraceRecorder::this_thread_buffer()
+	{
+		const uint64_t generation = this->generation_.load(std::memory_order_relaxed);
+		if (thread_slot.buffer != nullptr && thread_slot.generation == generation) {
+			return static_cast<ThreadBuffer*>(thread_slot.buffer);
+		}
+
+		// start()をまたいだ場合は前の世代のバッファを手放す
+		if (thread_slot.exited != nullptr) {
+			thread_slot.exited->store(true);
+		}
+
+		auto buffer = std::make_unique<ThreadBuffer>();
+		buffer->generation = generation;
+		buffer->name = PerformanceChecker::Registry::current_thread_name();
+
+		std::lock_guard lk(this->mtx_);
+		buffer->tid = this->next_tid_++;
+		buffer->events.resize(this->opt_.events_per_thread);
+		if (buffer->name.empty()) {
+			buffer->name = "thread " + std::to_string(buffer->tid);
+		}
+
+		thread_slot.buffer = buffer.get();
+		thread_slot.generation = generation;
+		thread_slot.exited = &buffer->exited;
+		this->buffers_.push_back(std::move(buffer));
+		return static_cast<ThreadBuffer*>(thread_slot.buffer);
+	}
+
+	void TraceRecorder::push(const Event& e)
+	{
+		ThreadBuffer* b = this->this_thread_buffer();
+		const uint64_t n = b->written.load(std::memory_order_relaxed);
+		b->events[n % b->events.size()] = e;
+		b->written.store(n + 1, std::memory_order_release);
+	}
+
+	void TraceRecorder::record_complete(const char* name, const uint64_t start_ticks, const uint64_t end_ticks, const int64_t arg)
+	{
+		this->push(Event{ start_ticks, end_ticks, name, arg });
+	}
+
+	void TraceRecorder::record_instant(const char* name, const int64_t arg)
+	{
+		const uint64_t now = PerformanceChecker::Ticks::now();
+		this->push(Event{ now, now, name, arg });
+	}
+
+	void TraceRecorder::set_thread_name(const std::string& name)
+	{
+		ThreadBuffer* b = this->this_thread_buffer();
+		if (b->name != name) {
+			std::lock_guard lk(this->mtx_);
+			b->name = name;
+		}
+	}
+
+	uint64_t TraceRecorder::event_count() const
+	{
+		std::lock_guard lk(this->mtx_);
+		const uint64_t generation = this->generation_.load();
+		uint64_t n = 0;
+		for (const auto& b : this->buffers_) {
+			if (b->generation == generation) {
+				n += std::min<uint64_t>(b->written.load(std::memory_order_acquire), b->events.size());
+			}
+		}
+		return n;
+	}
+
+	uint64_t TraceRecorder::overwritten_count() const
+	{
+		std::lock_guard lk(this->mtx_);
+		const uint64_t generation = this->generation_.load();
+		uint64_t n = 0;
+		for (const auto& b : this->buffers_) {
+			const uint64_t written = b->written.load(std::memory_order_acquire);
+			if (b->generation == generation && written > b->events.size()) {
+				n += written - b->events.size();
+			}
+		}
+		return n;
+	}
+
+	bool TraceRecorder::write_ChromeTrace(const std::string& path) const
+	{
+		std::ofstream ofs(path, std::ios::binary);
+		if (!ofs.is_open()) {
+			return false;
+		}
+
+		std::lock_guard lk(this->mtx_);
+		const uint64_t generation = this->generation_.load();
+		const double ns_per_tick = PerformanceChecker::Ticks::ns_per_tick();
+		auto to_us = [&](const uint64_t ticks) {
+			return static_cast<double>(static_cast<int64_t>(ticks - this->start_ticks_)) * ns_per_tick * 1e-3;
+		};
+
+		ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		ofs << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"VarjoDataStreamServer\"}}";
+
+		char line[512];
+		for (const auto& b : this->buffers_) {
+			if (b->generation != generation) {
+				continue;
+			}
+
+			ofs << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+				<< ",\"args\":{\"name\":\"" << escape_json(b->name) << "\"}}";
+
+			// リングの古い方から順に出す
+			const uint64_t written = b->written.load(std::memory_order_acquire);
+			const uint64_t count = std::min<uint64_t>(written, b->events.size());
+			for (uint64_t i = written - count; i < written; ++i) {
+				const Event& e = b->events[i % b->events.size()];
+				const double ts = to_us(e.start_ticks);
+				int len;
+				if (e.end_ticks == e.start_ticks) {
+					len = std::snprintf(line, sizeof(line),
+						",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+						e.name, ts, b->tid);
+				} else {
+					len = std::snprintf(line, sizeof(line),
+						",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+						e.name, ts, to_us(e.end_ticks) - ts, b->tid);
+				}
+				ofs.write(line, std::clamp(len, 0, static_cast<int>(sizeof(line)) - 1));
+				if (e.arg >= 0) {
+					ofs << ",\"args\":{\"frame\":" << e.arg << "}";
+				}
+				ofs << "}";
+			}
+		}
+
+		ofs << "\n]}\n";
+		return ofs.good();
+	}
+}
@@ -0,0 +1,146 @@
+/************************************************************************************************************************
+	Trace Recorder
+	パイプラインの各段の開始・終了時刻をスレッドごとに記録し，Chrome/Perfettoのトレース(JSON)として書き出す．
+	フレーム遅延が跳ねたときに，Varjoのコールバック・datastream_worker・logging_worker・書き込みスレッドが
+	どう重なっていたかを chrome://tracing や ui.perfetto.dev で確認する．
+
+	記録は段の終了時に1件(開始時刻・終了時刻・段名・フレーム番号)を自スレッドのリングバッファへ書くだけで，
+	ロックもメモリ確保もしない．バッファが一杯になると古いものから上書きする(直近の記録が残る)．
+	無効な間はTraceScopeはフラグを1回読むだけなので，常に埋め込んだままにしてよい．
+
+	使い方:
+		TraceRecorder::instance().start();
+		... 記録 ...
+		TraceRecorder::instance().stop();
+		TraceRecorder::instance().write_ChromeTrace("trace.json");	// パイプラインを閉じた後に呼ぶ
+
+**************************************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include "PerformanceChecker.hpp"
+
+namespace Profiling {
+
+	struct TraceOptions {
+		size_t events_per_thread = size_t(1) << 16;	// スレッドごとに保持する件数(1件32バイト)
+	};
+
+	/**
+	 * @brief 段の記録の収集先．段名は文字列リテラルなど書き出しまで有効なものを渡すこと．
+	 */
+	class TraceRecorder {
+
+	public:
+		static TraceRecorder& instance();
+
+		static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+		/**
+		 * @brief 記録を始める．それまでの記録は破棄する．
+		 */
+		void start(const TraceOptions& opt = TraceOptions{});
+		void stop();
+
+		/**
+		 * @brief Chromeのtrace event形式で書き出す．書き込み中のスレッドがない状態(stop後)で呼ぶこと．
+		 */
+		bool write_ChromeTrace(const std::string& path) const;
+
+		/**
+		 * @brief 記録できた件数と，バッファが一杯で上書きされた件数
+		 */
+		uint64_t event_count() const;
+		uint64_t overwritten_count() const;
+
+		void record_complete(const char* name, const uint64_t start_ticks, const uint64_t end_ticks, const int64_t arg);
+		void record_instant(const char* name, const int64_t arg);
+
+		/**
+		 * @brief 呼び出したスレッドの表示名．PerformanceChecker::register_threadで登録済みならその名前が使われる．
+		 */
+		void set_thread_name(const std::string& name);
+
+	private:
+		TraceRecorder() = default;
+
+		struct Event {
+			uint64_t start_ticks;
+			uint64_t end_ticks;	// instantはstartと同じ
+			const char* name;
+			int64_t arg;		// フレーム番号など．負の場合は出力しない
+		};
+
+		struct ThreadBuffer {
+			uint64_t generation;	// start()ごとに増える．古い世代のバッファは書き出さない
+			uint32_t tid;
+			std::string name;
+			std::vector<Event> events;
+			std::atomic<uint64_t> written{ 0 };
+			std::atomic_bool exited{ false };
+		};
+
+		ThreadBuffer* this_thread_buffer();
+		void push(const Event& e);
+
+	private:
+		static inline std::atomic_bool enabled_{ false };
+
+		mutable std::mutex mtx_;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+		TraceOptions opt_;
+		std::atomic<uint64_t> generation_{ 0 };
+		uint64_t start_ticks_ = 0;
+		uint32_t next_tid_ = 1;
+	};
+
+	/**
+	 * @brief スコープの開始から終了までを1つの段として記録する
+	 */
+	class TraceScope {
+
+	public:
+		explicit TraceScope(const char* name, const int64_t arg = -1)
+			: name_(name), arg_(arg), start_(TraceRecorder::enabled() ? PerformanceChecker::Ticks::now() : 0)
+		{}
+
+		~TraceScope() {
+			if (this->start_ != 0) {
+				TraceRecorder::instance().record_complete(this->name_, this->start_, PerformanceChecker::Ticks::now(), this->arg_);
+			}
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+
+	private:
+		const char* const name_;
+		const int64_t arg_;
+		const uint64_t start_;
+	};
+
+	/**
+	 * @brief 破棄などの時点を記録する
+	 */
+	inline void trace_instant(const char* name, const int64_t arg = -1) {
+		if (TraceRecorder::enabled()) {
+			TraceRecorder::instance().record_instant(name, arg);
+		}
+	}
+
+	/**
+	 * @brief register_threadしないスレッド(Varjoのコールバックなど)の表示名を付ける．無効な間は何もしない．
+	 */
+	inline void trace_thread_name(const char* name) {
+		if (TraceRecorder::enabled()) {
+			TraceRecorder::instance().set_thread_name(name);
+		}
+	}
+}